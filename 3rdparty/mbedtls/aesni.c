@@ -0,0 +1,31 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+// aesni.inc is the mbedtls aesni.c without mbedtls_aesni_has_support(),
+// which executes the CPUID instruction (see CMakeLists.txt). CPUID raises an
+// exception in an enclave, so this replacement calls oe_cpuid() instead.
+#include "aesni.inc"
+
+#if defined(MBEDTLS_AESNI_C) && defined(MBEDTLS_HAVE_X86_64)
+
+#include <openenclave/enclave.h>
+
+int mbedtls_aesni_has_support(unsigned int what)
+{
+    static int done = 0;
+    static unsigned int c = 0;
+
+    if (!done)
+    {
+        uint32_t eax, ebx, ecx, edx;
+
+        if (oe_cpuid(1, 0, &eax, &ebx, &ecx, &edx) == OE_OK)
+            c = ecx;
+
+        done = 1;
+    }
+
+    return (c & what) != 0;
+}
+
+#endif /* defined(MBEDTLS_AESNI_C) && defined(MBEDTLS_HAVE_X86_64) */
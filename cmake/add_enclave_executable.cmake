@@ -18,9 +18,21 @@
 # - the resulting binary name is not reflected by the target
 #   (complicating install rules)
 #
+# The enclave binary is checked for CPUID instructions (see check_cpuid.cmake)
+#
+set(CHECK_CPUID_SCRIPT ${CMAKE_CURRENT_LIST_DIR}/check_cpuid.cmake)
+
 function(add_enclave_executable BIN SIGNCONF)
 	add_executable(${BIN} ${ARGN})
 
+	# warn about CPUID instructions, which trap in enclaves
+	if (CMAKE_OBJDUMP)
+		add_custom_command(TARGET ${BIN} POST_BUILD
+			COMMAND ${CMAKE_COMMAND} -DOBJDUMP=${CMAKE_OBJDUMP}
+				-DIMAGE=$<TARGET_FILE:${BIN}> -P ${CHECK_CPUID_SCRIPT}
+			)
+	endif()
+
 	# custom rule to generate signing key
 	add_custom_command(OUTPUT ${BIN}-private.pem
 		COMMAND openssl genrsa -out ${BIN}-private.pem -3 3072
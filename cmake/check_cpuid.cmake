@@ -0,0 +1,55 @@
+# Copyright (c) Microsoft Corporation. All rights reserved.
+# Licensed under the MIT License.
+#
+# Script to report the functions of an enclave image that execute CPUID
+#
+# The CPUID instruction raises an exception in an enclave, which the enclave
+# emulates after a round trip to the host. Enclave code should call
+# oe_cpuid() instead.
+#
+# Usage:
+#
+#	cmake -DOBJDUMP=<objdump> -DIMAGE=<file> [-DFATAL=ON]
+#		-P check_cpuid.cmake
+#
+# Reports a warning, or an error if FATAL is set.
+#
+
+execute_process(
+	COMMAND ${OBJDUMP} -d --no-show-raw-insn ${IMAGE}
+	OUTPUT_VARIABLE DISASSEMBLY
+	RESULT_VARIABLE RESULT
+	ERROR_QUIET)
+
+if (NOT RESULT EQUAL 0)
+	message(WARNING "Cannot disassemble ${IMAGE} to look for CPUID")
+	return()
+endif()
+
+# Match the function labels and the CPUID instructions in order
+string(REGEX MATCHALL "<[^>\n]+>:\n|\tcpuid" TOKENS "${DISASSEMBLY}")
+
+set(FUNCTION "")
+set(FUNCTIONS "")
+
+foreach (TOKEN ${TOKENS})
+	if (TOKEN MATCHES "^<([^>]+)>:")
+		set(FUNCTION ${CMAKE_MATCH_1})
+	else()
+		list(APPEND FUNCTIONS ${FUNCTION})
+	endif()
+endforeach()
+
+if (FUNCTIONS)
+	list(REMOVE_DUPLICATES FUNCTIONS)
+	string(REPLACE ";" " " FUNCTIONS "${FUNCTIONS}")
+
+	if (FATAL)
+		set(MODE FATAL_ERROR)
+	else()
+		set(MODE WARNING)
+	endif()
+
+	message(${MODE} "${IMAGE} executes CPUID, which traps in an enclave, in: "
+		"${FUNCTIONS}. Call oe_cpuid() instead.")
+endif()
@@ -0,0 +1,240 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#include "certcache.h"
+#include <openenclave/internal/raise.h>
+#include <openenclave/internal/sha.h>
+#include "common.h"
+
+#ifdef OE_BUILD_ENCLAVE
+#include <openenclave/internal/thread.h>
+#else
+#include "../host/hostthread.h"
+#endif
+
+#ifdef OE_USE_LIBSGX
+
+/*
+**==============================================================================
+**
+** Trusted-root and issuer chain cache:
+**
+**     Every quote carries the same few issuer chains (the Intel root CA and
+**     the platform or processor CA), and the revocation info returned for it
+**     carries the same TCB signing and CRL issuer chains. Instead of parsing
+**     and verifying them for every quote, each chain is verified once and
+**     kept, keyed by the SHA-256 hash of its PEM text.
+**
+**     The cache holds at most OE_CERT_CACHE_MAX_CHAINS chains and evicts the
+**     least recently used one when full. Callers get their own handle to
+**     the certificates of a cached chain (see oe_cert_chain_share()), so an
+**     entry may be evicted while its chain is still in use.
+**
+**==============================================================================
+*/
+
+typedef struct _chain_entry
+{
+    OE_SHA256 hash;
+    oe_cert_chain_t chain;
+    uint64_t last_used;
+} chain_entry_t;
+
+typedef struct _root_key_entry
+{
+    OE_SHA256 hash;
+    oe_ec_public_key_t key;
+} root_key_entry_t;
+
+static chain_entry_t _chains[OE_CERT_CACHE_MAX_CHAINS];
+static size_t _num_chains;
+static uint64_t _chain_clock;
+
+static root_key_entry_t _root_keys[OE_CERT_CACHE_MAX_ROOT_KEYS];
+static size_t _num_root_keys;
+
+#ifdef OE_BUILD_ENCLAVE
+static oe_mutex_t _lock = OE_MUTEX_INITIALIZER;
+#else
+static oe_mutex _lock = OE_H_MUTEX_INITIALIZER;
+#endif
+
+static oe_result_t _hash(const void* data, size_t size, OE_SHA256* hash)
+{
+    oe_result_t result = OE_UNEXPECTED;
+    oe_sha256_context_t ctx;
+
+    OE_CHECK(oe_sha256_init(&ctx));
+    OE_CHECK(oe_sha256_update(&ctx, data, size));
+    OE_CHECK(oe_sha256_final(&ctx, hash));
+
+    result = OE_OK;
+
+done:
+    return result;
+}
+
+/* Find the chain with the given hash (called with the lock held) */
+static chain_entry_t* _find_chain(const OE_SHA256* hash)
+{
+    for (size_t i = 0; i < _num_chains; i++)
+    {
+        if (memcmp(&_chains[i].hash, hash, sizeof(*hash)) == 0)
+        {
+            _chains[i].last_used = ++_chain_clock;
+            return &_chains[i];
+        }
+    }
+
+    return NULL;
+}
+
+/* Get a free entry, evicting the least recently used chain if the cache is
+ * full (called with the lock held) */
+static chain_entry_t* _new_chain_entry(void)
+{
+    chain_entry_t* entry;
+
+    if (_num_chains < OE_CERT_CACHE_MAX_CHAINS)
+        return &_chains[_num_chains++];
+
+    entry = &_chains[0];
+
+    for (size_t i = 1; i < _num_chains; i++)
+    {
+        if (_chains[i].last_used < entry->last_used)
+            entry = &_chains[i];
+    }
+
+    oe_cert_chain_free(&entry->chain);
+    return entry;
+}
+
+oe_result_t oe_cert_cache_read_chain(
+    const void* pem_data,
+    size_t pem_size,
+    oe_cert_chain_t* chain)
+{
+    oe_result_t result = OE_UNEXPECTED;
+    OE_SHA256 hash;
+    chain_entry_t* entry;
+    oe_cert_chain_t read;
+    oe_cert_chain_t shared;
+
+    memset(&read, 0, sizeof(read));
+    memset(&shared, 0, sizeof(shared));
+
+    if (chain)
+        memset(chain, 0, sizeof(*chain));
+
+    if (!pem_data || !pem_size || !chain)
+        OE_RAISE(OE_INVALID_PARAMETER);
+
+    OE_CHECK(_hash(pem_data, pem_size, &hash));
+
+    oe_mutex_lock(&_lock);
+    {
+        if ((entry = _find_chain(&hash)))
+            result = oe_cert_chain_share(&entry->chain, chain);
+    }
+    oe_mutex_unlock(&_lock);
+
+    if (entry)
+        goto done;
+
+    /* Read and verify the chain, and make the handle kept by the cache,
+     * without holding the lock */
+    OE_CHECK(oe_cert_chain_read_pem(&read, pem_data, pem_size));
+    OE_CHECK(oe_cert_chain_share(&read, &shared));
+
+    oe_mutex_lock(&_lock);
+    {
+        /* Another thread may have cached the same chain meanwhile */
+        if (!_find_chain(&hash))
+        {
+            entry = _new_chain_entry();
+            memcpy(&entry->hash, &hash, sizeof(hash));
+            memcpy(&entry->chain, &shared, sizeof(shared));
+            memset(&shared, 0, sizeof(shared));
+            entry->last_used = ++_chain_clock;
+        }
+    }
+    oe_mutex_unlock(&_lock);
+
+    memcpy(chain, &read, sizeof(read));
+    memset(&read, 0, sizeof(read));
+
+    result = OE_OK;
+
+done:
+
+    /* Release the chains that were not handed out (this fails harmlessly
+     * for chains that were never read or were moved) */
+    oe_cert_chain_free(&read);
+    oe_cert_chain_free(&shared);
+
+    return result;
+}
+
+oe_result_t oe_cert_cache_read_root_key(
+    const void* pem_data,
+    size_t pem_size,
+    const oe_ec_public_key_t** key)
+{
+    oe_result_t result = OE_UNEXPECTED;
+    OE_SHA256 hash;
+
+    if (key)
+        *key = NULL;
+
+    if (!pem_data || !pem_size || !key)
+        OE_RAISE(OE_INVALID_PARAMETER);
+
+    OE_CHECK(_hash(pem_data, pem_size, &hash));
+
+    /* Root keys are cheap to read, so they are read under the lock */
+    oe_mutex_lock(&_lock);
+    {
+        root_key_entry_t* entry = NULL;
+
+        for (size_t i = 0; i < _num_root_keys; i++)
+        {
+            if (memcmp(&_root_keys[i].hash, &hash, sizeof(hash)) == 0)
+            {
+                entry = &_root_keys[i];
+                break;
+            }
+        }
+
+        if (!entry && _num_root_keys < OE_CERT_CACHE_MAX_ROOT_KEYS)
+        {
+            entry = &_root_keys[_num_root_keys];
+            result = oe_ec_public_key_read_pem(
+                &entry->key, (const uint8_t*)pem_data, pem_size);
+
+            if (result == OE_OK)
+            {
+                memcpy(&entry->hash, &hash, sizeof(hash));
+                _num_root_keys++;
+            }
+            else
+                entry = NULL;
+        }
+        else if (!entry)
+            result = OE_OUT_OF_MEMORY;
+
+        if (entry)
+        {
+            *key = &entry->key;
+            result = OE_OK;
+        }
+    }
+    oe_mutex_unlock(&_lock);
+
+    OE_CHECK(result);
+
+done:
+    return result;
+}
+
+#endif
@@ -0,0 +1,69 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#ifndef _OE_COMMON_CERTCACHE_H
+#define _OE_COMMON_CERTCACHE_H
+
+#include <openenclave/bits/defs.h>
+#include <openenclave/bits/result.h>
+#include <openenclave/bits/types.h>
+#include <openenclave/internal/cert.h>
+#include <openenclave/internal/ec.h>
+
+OE_EXTERNC_BEGIN
+
+#ifdef OE_USE_LIBSGX
+
+/* Maximum number of issuer chains kept by the cache */
+#define OE_CERT_CACHE_MAX_CHAINS 16
+
+/* Maximum number of trusted root keys kept by the cache */
+#define OE_CERT_CACHE_MAX_ROOT_KEYS 4
+
+/**
+ * Reads a chain of issuer certificates through the process-wide cache.
+ *
+ * An issuer chain (intermediate CA certificates and the root certificate,
+ * without a leaf) is read and verified with oe_cert_chain_read_pem() the first
+ * time it is seen. Later reads of the same PEM text (identified by its SHA-256
+ * hash) return the already verified chain without parsing it again. Use
+ * oe_cert_verify_with_verified_chain() to verify certificates against it.
+ *
+ * The cache keeps at most OE_CERT_CACHE_MAX_CHAINS chains and evicts the
+ * least recently used one when full. The returned chain shares its
+ * certificates with the cache and stays valid after an eviction. The caller
+ * must release it with oe_cert_chain_free().
+ *
+ * @param pem_data zero-terminated PEM certificate chain.
+ * @param pem_size size of the PEM data including the zero-terminator.
+ * @param chain initialized with the verified chain.
+ *
+ * @return OE_OK if the chain was read and verified.
+ */
+oe_result_t oe_cert_cache_read_chain(
+    const void* pem_data,
+    size_t pem_size,
+    oe_cert_chain_t* chain);
+
+/**
+ * Reads a trusted root public key through the process-wide cache.
+ *
+ * The key is parsed with oe_ec_public_key_read_pem() only the first time it is
+ * requested. The returned key is owned by the cache.
+ *
+ * @param pem_data zero-terminated PEM public key.
+ * @param pem_size size of the PEM data including the zero-terminator.
+ * @param key set to the cached key.
+ *
+ * @return OE_OK if the key was read.
+ */
+oe_result_t oe_cert_cache_read_root_key(
+    const void* pem_data,
+    size_t pem_size,
+    const oe_ec_public_key_t** key);
+
+#endif
+
+OE_EXTERNC_END
+
+#endif // _OE_COMMON_CERTCACHE_H
@@ -7,7 +7,9 @@
 #include <openenclave/internal/raise.h>
 #include <openenclave/internal/sgxtypes.h>
 #include <openenclave/internal/sha.h>
+#include <openenclave/internal/trace.h>
 #include <openenclave/internal/utils.h>
+#include "certcache.h"
 #include "common.h"
 #include "revocation.h"
 
@@ -149,6 +151,67 @@ done:
     return result;
 }
 
+// Reads the leaf (first) certificate of a PEM certificate chain, and returns
+// the remainder of the chain, which holds the issuers of the leaf. As in the
+// PCK certificate chain of Intel's quotes, the leaf is expected to come first.
+oe_result_t oe_read_leaf_cert(
+    const uint8_t* pem_data,
+    size_t pem_size,
+    oe_cert_t* leaf_cert,
+    const uint8_t** issuer_pem_data,
+    size_t* issuer_pem_size)
+{
+    static const char _end[] = "-----END CERTIFICATE-----";
+    const size_t end_size = sizeof(_end) - 1;
+    oe_result_t result = OE_UNEXPECTED;
+    char* leaf_pem = NULL;
+    size_t leaf_size = 0;
+
+    // Must have pem_size-1 non-zero characters followed by zero-terminator.
+    if (pem_size < end_size + 1 || pem_data[pem_size - 1] != '\0')
+        OE_RAISE(OE_INVALID_PARAMETER);
+
+    // Find the end of the first certificate.
+    for (size_t i = 0; i + end_size < pem_size; i++)
+    {
+        if (memcmp(pem_data + i, _end, end_size) == 0)
+        {
+            leaf_size = i + end_size;
+            break;
+        }
+    }
+
+    if (leaf_size == 0)
+        OE_RAISE(OE_INVALID_PARAMETER);
+
+    // Skip the white space that follows the leaf certificate, as
+    // oe_cert_chain_read_pem() does between certificates.
+    while (pem_data[leaf_size] == ' ' || pem_data[leaf_size] == '\t' ||
+           pem_data[leaf_size] == '\r' || pem_data[leaf_size] == '\n')
+        leaf_size++;
+
+    // The issuers must follow the leaf certificate.
+    if (leaf_size == pem_size - 1)
+        OE_RAISE(OE_INVALID_PARAMETER);
+
+    if (!(leaf_pem = (char*)malloc(leaf_size + 1)))
+        OE_RAISE(OE_OUT_OF_MEMORY);
+
+    memcpy(leaf_pem, pem_data, leaf_size);
+    leaf_pem[leaf_size] = '\0';
+
+    OE_CHECK(oe_cert_read_pem(leaf_cert, leaf_pem, leaf_size + 1));
+
+    *issuer_pem_data = pem_data + leaf_size;
+    *issuer_pem_size = pem_size - leaf_size;
+
+    result = OE_OK;
+
+done:
+    free(leaf_pem);
+    return result;
+}
+
 oe_result_t VerifyQuoteImpl(
     const uint8_t* quote,
     size_t quote_size,
@@ -164,7 +227,10 @@ oe_result_t VerifyQuoteImpl(
     sgx_quote_auth_data_t* quote_auth_data = NULL;
     sgx_qe_auth_data_t qe_auth_data = {0};
     sgx_qe_cert_data_t qe_cert_data = {0};
-    oe_cert_chain_t pck_cert_chain = {0};
+    oe_cert_chain_t issuer_chain = {0};
+    const uint8_t* issuer_pem = NULL;
+    size_t issuer_pem_size = 0;
+    oe_verify_cert_error_t cert_verify_error = {0};
     oe_sha256_context_t sha256_ctx = {0};
     OE_SHA256 sha256 = {0};
     oe_ec_public_key_t attestation_key = {0};
@@ -173,7 +239,7 @@ oe_result_t VerifyQuoteImpl(
     oe_cert_t intermediate_cert = {0};
     oe_ec_public_key_t leaf_public_key = {0};
     oe_ec_public_key_t root_public_key = {0};
-    oe_ec_public_key_t expected_root_public_key = {0};
+    const oe_ec_public_key_t* expected_root_public_key = NULL;
     bool key_equal = false;
 
     OE_CHECK(
@@ -208,38 +274,57 @@ oe_result_t VerifyQuoteImpl(
 
     // PckCertificate Chain validations.
     {
-        // Read and validate the chain.
+        // Only the leaf certificate differs from one platform to another.
+        // Its issuers (the platform or processor CA and Intel's root CA) are
+        // read and verified once, and then kept in the certificate cache.
         OE_CHECK(
-            oe_cert_chain_read_pem(
-                &pck_cert_chain,
+            oe_read_leaf_cert(
                 pem_pck_certificate,
-                pem_pck_certificate_size));
+                pem_pck_certificate_size,
+                &leaf_cert,
+                &issuer_pem,
+                &issuer_pem_size));
 
-        // Fetch leaf and root certificates.
-        OE_CHECK(oe_cert_chain_get_leaf_cert(&pck_cert_chain, &leaf_cert));
-        OE_CHECK(oe_cert_chain_get_root_cert(&pck_cert_chain, &root_cert));
         OE_CHECK(
-            oe_cert_chain_get_cert(&pck_cert_chain, 1, &intermediate_cert));
+            oe_cert_cache_read_chain(
+                issuer_pem,
+                issuer_pem_size,
+                &issuer_chain));
+
+        // Verify the leaf certificate against its (already verified) issuers.
+        if (oe_cert_verify_with_verified_chain(
+                &leaf_cert, &issuer_chain, NULL, 0, &cert_verify_error) !=
+            OE_OK)
+        {
+            OE_TRACE_INFO(
+                "oe_cert_verify failed with error = %s\n",
+                cert_verify_error.buf);
+            OE_RAISE(OE_VERIFY_FAILED);
+        }
+
+        // Fetch root and intermediate certificates.
+        OE_CHECK(oe_cert_chain_get_root_cert(&issuer_chain, &root_cert));
+        OE_CHECK(oe_cert_chain_get_cert(&issuer_chain, 0, &intermediate_cert));
 
         OE_CHECK(oe_cert_get_ec_public_key(&leaf_cert, &leaf_public_key));
         OE_CHECK(oe_cert_get_ec_public_key(&root_cert, &root_public_key));
 
         // Ensure that the root certificate matches root of trust.
         OE_CHECK(
-            oe_ec_public_key_read_pem(
-                &expected_root_public_key,
-                (const uint8_t*)g_expected_root_certificate_key,
-                strlen(g_expected_root_certificate_key) + 1));
+            oe_cert_cache_read_root_key(
+                g_expected_root_certificate_key,
+                strlen(g_expected_root_certificate_key) + 1,
+                &expected_root_public_key));
 
         OE_CHECK(
             oe_ec_public_key_equal(
-                &root_public_key, &expected_root_public_key, &key_equal));
+                &root_public_key, expected_root_public_key, &key_equal));
         if (!key_equal)
             OE_RAISE(OE_VERIFY_FAILED);
 
         OE_CHECK(
             oe_enforce_revocation(
-                &leaf_cert, &intermediate_cert, &pck_cert_chain));
+                &leaf_cert, &intermediate_cert, &issuer_chain));
     }
 
     // Quote validations.
@@ -314,12 +399,11 @@ oe_result_t VerifyQuoteImpl(
 done:
     oe_ec_public_key_free(&leaf_public_key);
     oe_ec_public_key_free(&root_public_key);
-    oe_ec_public_key_free(&expected_root_public_key);
     oe_ec_public_key_free(&attestation_key);
     oe_cert_free(&leaf_cert);
     oe_cert_free(&root_cert);
     oe_cert_free(&intermediate_cert);
-    oe_cert_chain_free(&pck_cert_chain);
+    oe_cert_chain_free(&issuer_chain);
     return result;
 }
 
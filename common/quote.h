@@ -7,6 +7,7 @@
 #include <openenclave/bits/defs.h>
 #include <openenclave/bits/result.h>
 #include <openenclave/bits/types.h>
+#include <openenclave/internal/cert.h>
 
 OE_EXTERNC_BEGIN
 
@@ -20,6 +21,24 @@ oe_result_t VerifyQuoteImpl(
     const uint8_t* enc_tcb_info_json,
     size_t enc_tcb_info_json_size);
 
+#ifdef OE_USE_LIBSGX
+
+/**
+ * Read the leaf (first) certificate of a zero-terminated PEM certificate
+ * chain, and return the remainder of the chain, which holds the issuers of the
+ * leaf. This is exposed for tests.
+ *
+ * @return OE_INVALID_PARAMETER if the PEM data has no leaf or no issuers.
+ */
+oe_result_t oe_read_leaf_cert(
+    const uint8_t* pem_data,
+    size_t pem_size,
+    oe_cert_t* leaf_cert,
+    const uint8_t** issuer_pem_data,
+    size_t* issuer_pem_size);
+
+#endif
+
 OE_EXTERNC_END
 
 #endif // _OE_COMMON_QUOTE_H
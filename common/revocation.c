@@ -17,6 +17,7 @@
 #include <openenclave/internal/thread.h>
 #include <openenclave/internal/trace.h>
 #include <openenclave/internal/utils.h>
+#include "certcache.h"
 #include "common.h"
 #include "tcbinfo.h"
 
@@ -201,12 +202,13 @@ oe_result_t oe_enforce_revocation(
 
     OE_CHECK(oe_get_revocation_info(&revocation_args));
 
-    // Apply revocation info.
+    // Apply revocation info. The issuer chains are the same for every quote
+    // of a platform, so they are verified once and kept in the cert cache.
     OE_CHECK(
-        oe_cert_chain_read_pem(
-            &tcb_issuer_chain,
+        oe_cert_cache_read_chain(
             revocation_args.tcb_issuer_chain,
-            revocation_args.tcb_issuer_chain_size));
+            revocation_args.tcb_issuer_chain_size,
+            &tcb_issuer_chain));
 
     // Read CRLs for each cert other than root. If any CRL is missing, the read
     // will error out.
@@ -216,13 +218,14 @@ oe_result_t oe_enforce_revocation(
             oe_crl_read_der(
                 &crls[i], revocation_args.crl[i], revocation_args.crl_size[i]));
         OE_CHECK(
-            oe_cert_chain_read_pem(
-                &crl_issuer_chain[i],
+            oe_cert_cache_read_chain(
                 revocation_args.crl_issuer_chain[i],
-                revocation_args.crl_issuer_chain_size[i]));
+                revocation_args.crl_issuer_chain_size[i],
+                &crl_issuer_chain[i]));
     }
 
-    // Verify the leaf cert.
+    // Verify the leaf cert. The CRL issuer chain was verified when it was
+    // cached, so only the validity of its certificates is checked again.
     // oe_cert_verify incorporates openssl -crl_check_all semantics.
     // For successful verification:
     //    1. The certificate chain must be valid. Each cert must
@@ -237,7 +240,7 @@ oe_result_t oe_enforce_revocation(
     // constraint. If the crl_issuer_chain was different from the certificate
     // chain, then verification would fail because the CRLs will not be found
     // for certificates in the chain.
-    r = oe_cert_verify(
+    r = oe_cert_verify_with_verified_chain(
         leaf_cert, &crl_issuer_chain[0], crl_ptrs, 2, &cert_verify_error);
     if (r != OE_OK)
     {
@@ -256,19 +259,13 @@ oe_result_t oe_enforce_revocation(
     platform_tcb_level.status = OE_TCB_LEVEL_STATUS_UNKNOWN;
 
     OE_CHECK(
-        oe_parse_tcb_info_json(
+        oe_verify_tcb_info_json(
             revocation_args.tcb_info,
             revocation_args.tcb_info_size,
+            &tcb_issuer_chain,
             &platform_tcb_level,
             &parsed_tcb_info));
 
-    OE_CHECK(
-        oe_verify_tcb_signature(
-            parsed_tcb_info.tcb_info_start,
-            parsed_tcb_info.tcb_info_size,
-            (sgx_ecdsa256_signature_t*)parsed_tcb_info.signature,
-            &tcb_issuer_chain));
-
     // Check that the tcb has been issued after the earliest date that the
     // enclave accepts.
     if (oe_datetime_compare(
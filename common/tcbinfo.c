@@ -6,8 +6,15 @@
 #include <openenclave/internal/raise.h>
 #include <openenclave/internal/trace.h>
 #include <openenclave/internal/utils.h>
+#include "certcache.h"
 #include "common.h"
 
+#ifdef OE_BUILD_ENCLAVE
+#include <openenclave/internal/thread.h>
+#else
+#include "../host/hostthread.h"
+#endif
+
 #ifdef OE_USE_LIBSGX
 
 // Public key of Intel's root certificate.
@@ -24,10 +31,58 @@ OE_INLINE uint8_t _is_space(uint8_t c)
         c == '\r' || c == '\0');
 }
 
+// The scanners below examine eight bytes at a time in a 64-bit register
+// (SIMD within a register), which works alike on the host and in enclaves.
+#define _ONES 0x0101010101010101ULL
+#define _HIGHS 0x8080808080808080ULL
+
+OE_INLINE uint64_t _load64(const uint8_t* p)
+{
+    uint64_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+// Return a mask with the high bit set in the bytes of v that are zero. Bits
+// above the lowest set bit may be false positives.
+OE_INLINE uint64_t _zero_bytes(uint64_t v)
+{
+    return (v - _ONES) & ~v & _HIGHS;
+}
+
 // Skip white space.
 static const uint8_t* _skip_ws(const uint8_t* itr, const uint8_t* end)
 {
     while (itr < end && _is_space(*itr))
+    {
+        // Skip runs of spaces (indentation) eight at a time.
+        if (end - itr >= 8 && _load64(itr) == _ONES * ' ')
+            itr += 8;
+        else
+            ++itr;
+    }
+    return itr;
+}
+
+// Find the first quote or backslash (or the end).
+static const uint8_t* _find_quote_or_escape(
+    const uint8_t* itr,
+    const uint8_t* end)
+{
+    while (end - itr >= 8)
+    {
+        uint64_t v = _load64(itr);
+        uint64_t mask =
+            _zero_bytes(v ^ (_ONES * '"')) | _zero_bytes(v ^ (_ONES * '\\'));
+
+        // The lowest set bit is a true match (x86 is little endian).
+        if (mask)
+            return itr + (__builtin_ctzll(mask) >> 3);
+
+        itr += 8;
+    }
+
+    while (itr < end && *itr != '"' && *itr != '\\')
         ++itr;
     return itr;
 }
@@ -103,13 +158,9 @@ static oe_result_t _read_string(
     if (p < end && *p == '"')
     {
         *str = ++p;
-        while (p < end && *p != '"')
-        {
-            if (*p == '\\')
-                OE_RAISE(OE_TCB_INFO_PARSE_ERROR);
-
-            ++p;
-        }
+        p = _find_quote_or_escape(p, end);
+        if (p < end && *p == '\\')
+            OE_RAISE(OE_TCB_INFO_PARSE_ERROR);
 
         if (p < end && *p == '"')
         {
@@ -314,6 +365,17 @@ static void _determine_platform_tcb_level(
     platform_tcb_level->status = tcb_level->status;
 }
 
+// Where the parse puts the tcb levels that it reads.
+typedef struct _tcb_level_sink
+{
+    // If not null, its status is determined from the levels as they are read.
+    oe_tcb_level_t* platform_tcb_level;
+
+    // If not null, receives the first max_levels levels.
+    oe_tcb_level_t* levels;
+    size_t max_levels;
+} tcb_level_sink_t;
+
 /**
  * Type: tcbLevel
  * Schema:
@@ -325,8 +387,8 @@ static void _determine_platform_tcb_level(
 static oe_result_t _read_tcb_level(
     const uint8_t** itr,
     const uint8_t* end,
-    oe_tcb_level_t* platform_tcb_level,
-    oe_parsed_tcb_info_t* parsed_info)
+    oe_parsed_tcb_info_t* parsed_info,
+    tcb_level_sink_t* sink)
 {
     oe_result_t result = OE_TCB_INFO_PARSE_ERROR;
     oe_tcb_level_t tcb_level = {{0}};
@@ -358,7 +420,13 @@ static oe_result_t _read_tcb_level(
 
     if (tcb_level.status != OE_TCB_LEVEL_STATUS_UNKNOWN)
     {
-        _determine_platform_tcb_level(platform_tcb_level, &tcb_level);
+        if (sink->platform_tcb_level)
+            _determine_platform_tcb_level(sink->platform_tcb_level, &tcb_level);
+
+        if (parsed_info->num_tcb_levels < sink->max_levels)
+            sink->levels[parsed_info->num_tcb_levels] = tcb_level;
+
+        parsed_info->num_tcb_levels++;
         result = OE_OK;
     }
 
@@ -379,8 +447,8 @@ done:
 static oe_result_t _read_tcb_info(
     const uint8_t** itr,
     const uint8_t* end,
-    oe_tcb_level_t* platform_tcb_level,
-    oe_parsed_tcb_info_t* parsed_info)
+    oe_parsed_tcb_info_t* parsed_info,
+    tcb_level_sink_t* sink)
 {
     oe_result_t result = OE_TCB_INFO_PARSE_ERROR;
     uint64_t value = 0;
@@ -388,6 +456,7 @@ static oe_result_t _read_tcb_info(
     size_t date_size = 0;
 
     parsed_info->tcb_info_start = *itr;
+    parsed_info->num_tcb_levels = 0;
     OE_CHECK(_read('{', itr, end));
 
     OE_TRACE_INFO("Reading version\n");
@@ -433,7 +502,7 @@ static oe_result_t _read_tcb_info(
     OE_CHECK(_read('[', itr, end));
     while (*itr < end)
     {
-        OE_CHECK(_read_tcb_level(itr, end, platform_tcb_level, parsed_info));
+        OE_CHECK(_read_tcb_level(itr, end, parsed_info, sink));
         // Read end of array or comma separator.
         if (*itr < end && **itr == ']')
             break;
@@ -460,33 +529,26 @@ done:
  *    "signature" : "hex string"
  * }
  */
-oe_result_t oe_parse_tcb_info_json(
+static oe_result_t _read_tcb_info_json(
     const uint8_t* tcb_info_json,
     size_t tcb_info_json_size,
-    oe_tcb_level_t* platform_tcb_level,
-    oe_parsed_tcb_info_t* parsed_info)
+    oe_parsed_tcb_info_t* parsed_info,
+    tcb_level_sink_t* sink)
 {
     oe_result_t result = OE_TCB_INFO_PARSE_ERROR;
     const uint8_t* itr = tcb_info_json;
     const uint8_t* end = tcb_info_json + tcb_info_json_size;
 
-    if (tcb_info_json == NULL || tcb_info_json_size == 0 ||
-        platform_tcb_level == NULL || parsed_info == NULL)
-        OE_RAISE(OE_INVALID_PARAMETER);
-
     // Pointer wrapping.
     if (end <= itr)
         OE_RAISE(OE_INVALID_PARAMETER);
 
-    if (platform_tcb_level->status != OE_TCB_LEVEL_STATUS_UNKNOWN)
-        OE_RAISE(OE_INVALID_PARAMETER);
-
     itr = _skip_ws(itr, end);
     OE_CHECK(_read('{', &itr, end));
 
     OE_TRACE_INFO("Reading tcbInfo\n");
     OE_CHECK(_read_property_name_and_colon("tcbInfo", &itr, end));
-    OE_CHECK(_read_tcb_info(&itr, end, platform_tcb_level, parsed_info));
+    OE_CHECK(_read_tcb_info(&itr, end, parsed_info, sink));
     OE_CHECK(_read(',', &itr, end));
 
     OE_TRACE_INFO("Reading signature\n");
@@ -499,9 +561,6 @@ oe_result_t oe_parse_tcb_info_json(
 
     if (itr == end)
     {
-        if (platform_tcb_level->status != OE_TCB_LEVEL_STATUS_UP_TO_DATE)
-            OE_RAISE(OE_TCB_LEVEL_INVALID);
-
         OE_TRACE_INFO("TCB Info json parsing successful.\n");
         result = OE_OK;
     }
@@ -509,6 +568,46 @@ done:
     return result;
 }
 
+// Check the status of the platform determined from the tcb levels.
+static oe_result_t _check_platform_tcb_level(
+    const oe_tcb_level_t* platform_tcb_level)
+{
+    oe_result_t result = OE_UNEXPECTED;
+
+    if (platform_tcb_level->status != OE_TCB_LEVEL_STATUS_UP_TO_DATE)
+        OE_RAISE(OE_TCB_LEVEL_INVALID);
+
+    result = OE_OK;
+done:
+    return result;
+}
+
+oe_result_t oe_parse_tcb_info_json(
+    const uint8_t* tcb_info_json,
+    size_t tcb_info_json_size,
+    oe_tcb_level_t* platform_tcb_level,
+    oe_parsed_tcb_info_t* parsed_info)
+{
+    oe_result_t result = OE_TCB_INFO_PARSE_ERROR;
+    tcb_level_sink_t sink = {platform_tcb_level, NULL, 0};
+
+    if (tcb_info_json == NULL || tcb_info_json_size == 0 ||
+        platform_tcb_level == NULL || parsed_info == NULL)
+        OE_RAISE(OE_INVALID_PARAMETER);
+
+    if (platform_tcb_level->status != OE_TCB_LEVEL_STATUS_UNKNOWN)
+        OE_RAISE(OE_INVALID_PARAMETER);
+
+    OE_CHECK(
+        _read_tcb_info_json(
+            tcb_info_json, tcb_info_json_size, parsed_info, &sink));
+    OE_CHECK(_check_platform_tcb_level(platform_tcb_level));
+
+    result = OE_OK;
+done:
+    return result;
+}
+
 static oe_result_t _ecdsa_verify(
     oe_ec_public_key_t* publicKey,
     const void* data,
@@ -559,7 +658,7 @@ oe_result_t oe_verify_tcb_signature(
     oe_cert_t leaf_cert = {0};
     oe_ec_public_key_t tcb_root_key = {0};
     oe_ec_public_key_t tcb_signing_key = {0};
-    oe_ec_public_key_t trusted_root_key = {0};
+    const oe_ec_public_key_t* trusted_root_key = NULL;
     bool root_of_trust_match = false;
 
     if (tcb_info_start == NULL || tcb_info_size == 0 || signature == NULL ||
@@ -578,14 +677,14 @@ oe_result_t oe_verify_tcb_signature(
 
     // Ensure that the root certificate matches root of trust.
     OE_CHECK(
-        oe_ec_public_key_read_pem(
-            &trusted_root_key,
-            (const uint8_t*)_trusted_root_key_pem,
-            strlen(_trusted_root_key_pem) + 1));
+        oe_cert_cache_read_root_key(
+            _trusted_root_key_pem,
+            strlen(_trusted_root_key_pem) + 1,
+            &trusted_root_key));
 
     OE_CHECK(
         oe_ec_public_key_equal(
-            &trusted_root_key, &tcb_root_key, &root_of_trust_match));
+            trusted_root_key, &tcb_root_key, &root_of_trust_match));
 
     if (!root_of_trust_match)
     {
@@ -596,7 +695,6 @@ oe_result_t oe_verify_tcb_signature(
 
     result = OE_OK;
 done:
-    oe_ec_public_key_free(&trusted_root_key);
     oe_ec_public_key_free(&tcb_signing_key);
     oe_ec_public_key_free(&tcb_root_key);
 
@@ -606,4 +704,210 @@ done:
     return result;
 }
 
+/*
+**==============================================================================
+**
+** TCB info cache:
+**
+**     The TCB info of a platform (identified by its FMSPC) is the same for
+**     every quote of the platform until Intel issues a new one. A verified
+**     TCB info is therefore kept with its parsed levels, in an array of the
+**     size of the JSON's tcbLevels. Since the cached copy was verified, a
+**     byte-identical TCB info is authentic, whatever the certificate chain
+**     that comes with it.
+**
+**==============================================================================
+*/
+
+typedef struct _tcb_info_entry
+{
+    uint8_t* json;
+    size_t json_size;
+    oe_parsed_tcb_info_t parsed_info;
+
+    /* parsed_info.num_tcb_levels levels, in the order of the JSON */
+    oe_tcb_level_t* tcb_levels;
+} tcb_info_entry_t;
+
+static tcb_info_entry_t _tcb_infos[OE_TCB_INFO_CACHE_SIZE];
+static size_t _next_victim;
+
+#ifdef OE_BUILD_ENCLAVE
+static oe_mutex_t _tcb_infos_lock = OE_MUTEX_INITIALIZER;
+#else
+static oe_mutex _tcb_infos_lock = OE_H_MUTEX_INITIALIZER;
+#endif
+
+// Copy out the parsed info of a cached tcb info identical to the given one,
+// and determine the status of the platform from its levels.
+static bool _find_tcb_info(
+    const uint8_t* tcb_info_json,
+    size_t tcb_info_json_size,
+    oe_tcb_level_t* platform_tcb_level,
+    oe_parsed_tcb_info_t* parsed_info)
+{
+    bool found = false;
+
+    oe_mutex_lock(&_tcb_infos_lock);
+
+    for (size_t i = 0; i < OE_COUNTOF(_tcb_infos); i++)
+    {
+        const tcb_info_entry_t* entry = &_tcb_infos[i];
+
+        if (entry->json && entry->json_size == tcb_info_json_size &&
+            memcmp(entry->json, tcb_info_json, tcb_info_json_size) == 0)
+        {
+            *parsed_info = entry->parsed_info;
+
+            // Point into the caller's copy of the json.
+            parsed_info->tcb_info_start = tcb_info_json +
+                (entry->parsed_info.tcb_info_start - entry->json);
+
+            for (size_t j = 0; j < entry->parsed_info.num_tcb_levels; j++)
+            {
+                _determine_platform_tcb_level(
+                    platform_tcb_level, &entry->tcb_levels[j]);
+            }
+
+            found = true;
+            break;
+        }
+    }
+
+    oe_mutex_unlock(&_tcb_infos_lock);
+
+    return found;
+}
+
+// Cache a verified tcb info, replacing the older one of the same FMSPC.
+void oe_cache_tcb_info_json(
+    const uint8_t* tcb_info_json,
+    size_t tcb_info_json_size,
+    const oe_parsed_tcb_info_t* parsed_info)
+{
+    tcb_info_entry_t* entry = NULL;
+    uint8_t* json = NULL;
+    oe_tcb_level_t* tcb_levels = NULL;
+    oe_parsed_tcb_info_t levels_info = {0};
+    tcb_level_sink_t sink = {NULL, NULL, parsed_info->num_tcb_levels};
+
+    // Failing to cache the tcb info is not an error.
+    if (!(json = (uint8_t*)malloc(tcb_info_json_size)) ||
+        !(tcb_levels = (oe_tcb_level_t*)calloc(
+              parsed_info->num_tcb_levels, sizeof(oe_tcb_level_t))))
+        goto failed;
+
+    memcpy(json, tcb_info_json, tcb_info_json_size);
+
+    // Read the levels again, now that their number is known.
+    sink.levels = tcb_levels;
+    if (_read_tcb_info_json(json, tcb_info_json_size, &levels_info, &sink) !=
+            OE_OK ||
+        levels_info.num_tcb_levels != parsed_info->num_tcb_levels)
+        goto failed;
+
+    oe_mutex_lock(&_tcb_infos_lock);
+
+    for (size_t i = 0; i < OE_COUNTOF(_tcb_infos) && !entry; i++)
+    {
+        if (_tcb_infos[i].json &&
+            memcmp(
+                _tcb_infos[i].parsed_info.fmspc,
+                parsed_info->fmspc,
+                sizeof(parsed_info->fmspc)) == 0)
+        {
+            entry = &_tcb_infos[i];
+        }
+    }
+
+    for (size_t i = 0; i < OE_COUNTOF(_tcb_infos) && !entry; i++)
+    {
+        if (!_tcb_infos[i].json)
+            entry = &_tcb_infos[i];
+    }
+
+    if (!entry)
+    {
+        entry = &_tcb_infos[_next_victim];
+        _next_victim = (_next_victim + 1) % OE_COUNTOF(_tcb_infos);
+    }
+
+    free(entry->json);
+    free(entry->tcb_levels);
+    entry->json = json;
+    entry->json_size = tcb_info_json_size;
+    entry->parsed_info = *parsed_info;
+    entry->parsed_info.tcb_info_start =
+        json + (parsed_info->tcb_info_start - tcb_info_json);
+    entry->tcb_levels = tcb_levels;
+
+    oe_mutex_unlock(&_tcb_infos_lock);
+    return;
+
+failed:
+    free(tcb_levels);
+    free(json);
+}
+
+void oe_clear_tcb_info_cache(void)
+{
+    oe_mutex_lock(&_tcb_infos_lock);
+
+    for (size_t i = 0; i < OE_COUNTOF(_tcb_infos); i++)
+    {
+        free(_tcb_infos[i].json);
+        free(_tcb_infos[i].tcb_levels);
+        _tcb_infos[i].json = NULL;
+        _tcb_infos[i].json_size = 0;
+        _tcb_infos[i].tcb_levels = NULL;
+    }
+
+    _next_victim = 0;
+
+    oe_mutex_unlock(&_tcb_infos_lock);
+}
+
+oe_result_t oe_verify_tcb_info_json(
+    const uint8_t* tcb_info_json,
+    size_t tcb_info_json_size,
+    oe_cert_chain_t* tcb_cert_chain,
+    oe_tcb_level_t* platform_tcb_level,
+    oe_parsed_tcb_info_t* parsed_info)
+{
+    oe_result_t result = OE_UNEXPECTED;
+    tcb_level_sink_t sink = {platform_tcb_level, NULL, 0};
+
+    if (tcb_info_json == NULL || tcb_info_json_size == 0 ||
+        tcb_cert_chain == NULL || platform_tcb_level == NULL ||
+        parsed_info == NULL)
+        OE_RAISE(OE_INVALID_PARAMETER);
+
+    if (platform_tcb_level->status != OE_TCB_LEVEL_STATUS_UNKNOWN)
+        OE_RAISE(OE_INVALID_PARAMETER);
+
+    if (!_find_tcb_info(
+            tcb_info_json, tcb_info_json_size, platform_tcb_level, parsed_info))
+    {
+        OE_CHECK(
+            _read_tcb_info_json(
+                tcb_info_json, tcb_info_json_size, parsed_info, &sink));
+
+        OE_CHECK(
+            oe_verify_tcb_signature(
+                parsed_info->tcb_info_start,
+                parsed_info->tcb_info_size,
+                (sgx_ecdsa256_signature_t*)parsed_info->signature,
+                tcb_cert_chain));
+
+        oe_cache_tcb_info_json(
+            tcb_info_json, tcb_info_json_size, parsed_info);
+    }
+
+    OE_CHECK(_check_platform_tcb_level(platform_tcb_level));
+
+    result = OE_OK;
+done:
+    return result;
+}
+
 #endif
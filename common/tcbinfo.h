@@ -31,6 +31,9 @@ typedef struct _oe_tcb_level
     oe_tcb_level_status_t status;
 } oe_tcb_level_t;
 
+/* Number of TCB infos (one per FMSPC) kept by oe_verify_tcb_info_json() */
+#define OE_TCB_INFO_CACHE_SIZE 8
+
 typedef struct _oe_parsed_tcb_info
 {
     uint32_t version;
@@ -40,6 +43,9 @@ typedef struct _oe_parsed_tcb_info
     uint8_t signature[64];
     const uint8_t* tcb_info_start;
     size_t tcb_info_size;
+
+    /* Number of TCB levels in the JSON */
+    size_t num_tcb_levels;
 } oe_parsed_tcb_info_t;
 
 /**
@@ -70,6 +76,37 @@ oe_result_t oe_parse_tcb_info_json(
     oe_tcb_level_t* platform_tcb_level,
     oe_parsed_tcb_info_t* parsed_info);
 
+/**
+ * oe_verify_tcb_info_json parses the given tcb info json string like
+ * oe_parse_tcb_info_json and verifies its signature with the given tcb
+ * signing certificate chain like oe_verify_tcb_signature.
+ *
+ * Verified tcb infos are cached per FMSPC, with their tcb levels. When the
+ * given json string is identical to a cached one, it is neither parsed nor
+ * verified again: only the status of the platform_tcb_level is determined
+ * from the cached levels.
+ */
+oe_result_t oe_verify_tcb_info_json(
+    const uint8_t* tcb_info_json,
+    size_t tcb_info_json_size,
+    oe_cert_chain_t* tcb_cert_chain,
+    oe_tcb_level_t* platform_tcb_level,
+    oe_parsed_tcb_info_t* parsed_info);
+
+/**
+ * Add a tcb info json string, whose signature was verified, and its parsed
+ * info to the cache of oe_verify_tcb_info_json. This is exposed for tests.
+ */
+void oe_cache_tcb_info_json(
+    const uint8_t* tcb_info_json,
+    size_t tcb_info_json_size,
+    const oe_parsed_tcb_info_t* parsed_info);
+
+/**
+ * Drop the tcb infos cached by oe_verify_tcb_info_json.
+ */
+void oe_clear_tcb_info_cache(void);
+
 oe_result_t oe_verify_tcb_signature(
     const uint8_t* tcb_info_start,
     size_t tcb_info_size,
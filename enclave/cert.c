@@ -239,19 +239,100 @@ static mbedtls_x509_crt* _find_root_cert(mbedtls_x509_crt* chain)
 }
 
 /* Return true if the CRL list contains a CRL for this CA. */
-static mbedtls_x509_crl* _crl_list_find_issuer_for_cert(
-    mbedtls_x509_crl* crl_list,
-    mbedtls_x509_crt* crt)
+static const crl_t* _crl_list_find_issuer_for_cert(
+    const oe_crl_t* const* crls,
+    size_t num_crls,
+    const mbedtls_x509_crt* crt)
 {
-    for (mbedtls_x509_crl* p = crl_list; p; p = p->next)
+    for (size_t i = 0; i < num_crls; i++)
     {
-        if (_x509_buf_equal(&p->issuer_raw, &crt->subject_raw))
+        const crl_t* p = (const crl_t*)crls[i];
+
+        if (_x509_buf_equal(&p->crl->issuer_raw, &crt->subject_raw))
             return p;
     }
 
     return NULL;
 }
 
+/* Check a certificate against the CRLs of its issuer in the chain. This
+ * performs the checks of x509_crt_verifycrl() in mbedtls, but uses the index
+ * built by oe_crl_read_der(), so that the cost of the check does not depend
+ * on the number of revoked certificates. Returns the MBEDTLS_X509_BADCRL_*
+ * and MBEDTLS_X509_BADCERT_* verification flags. */
+static uint32_t _check_crls(
+    const mbedtls_x509_crt* crt,
+    mbedtls_x509_crt* chain,
+    const oe_crl_t* const* crls,
+    size_t num_crls)
+{
+    const mbedtls_x509_crt_profile* profile =
+        &mbedtls_x509_crt_profile_default;
+    mbedtls_x509_crt* ca;
+    uint32_t flags = 0;
+
+    /* Like mbedtls, do not check self-signed (root) certificates */
+    if (_x509_buf_equal(&crt->subject_raw, &crt->issuer_raw))
+        return 0;
+
+    /* Find the issuer of the certificate */
+    for (ca = chain; ca; ca = ca->next)
+    {
+        if (_x509_buf_equal(&ca->subject_raw, &crt->issuer_raw))
+            break;
+    }
+
+    if (!ca)
+        return MBEDTLS_X509_BADCERT_NOT_TRUSTED;
+
+    for (size_t i = 0; i < num_crls; i++)
+    {
+        const crl_t* impl = (const crl_t*)crls[i];
+        const mbedtls_x509_crl* crl = impl->crl;
+
+        if (crl->version == 0 ||
+            !_x509_buf_equal(&crl->issuer_raw, &ca->subject_raw))
+        {
+            continue;
+        }
+
+        /* Check that the CA may sign CRLs */
+        if (mbedtls_x509_crt_check_key_usage(ca, MBEDTLS_X509_KU_CRL_SIGN) !=
+            0)
+        {
+            flags |= MBEDTLS_X509_BADCRL_NOT_TRUSTED;
+            break;
+        }
+
+        if (!(profile->allowed_mds & MBEDTLS_X509_ID_FLAG(crl->sig_md)))
+            flags |= MBEDTLS_X509_BADCRL_BAD_MD;
+
+        if (!(profile->allowed_pks & MBEDTLS_X509_ID_FLAG(crl->sig_pk)))
+            flags |= MBEDTLS_X509_BADCRL_BAD_PK;
+
+        /* Check that the CRL is signed by the CA */
+        if (!crl_verify_signature(impl, ca))
+        {
+            flags |= MBEDTLS_X509_BADCRL_NOT_TRUSTED;
+            break;
+        }
+
+        if (mbedtls_x509_time_is_past(&crl->next_update))
+            flags |= MBEDTLS_X509_BADCRL_EXPIRED;
+
+        if (mbedtls_x509_time_is_future(&crl->this_update))
+            flags |= MBEDTLS_X509_BADCRL_FUTURE;
+
+        if (crl_is_revoked(impl, crt))
+        {
+            flags |= MBEDTLS_X509_BADCERT_REVOKED;
+            break;
+        }
+    }
+
+    return flags;
+}
+
 /**
  * Return true is time t1 is chronologically before or at time t2.
  */
@@ -685,18 +766,43 @@ done:
     return result;
 }
 
-oe_result_t oe_cert_verify(
+oe_result_t oe_cert_chain_share(
+    const oe_cert_chain_t* chain,
+    oe_cert_chain_t* shared)
+{
+    oe_result_t result = OE_UNEXPECTED;
+    const CertChain* impl = (const CertChain*)chain;
+    CertChain* shared_impl = (CertChain*)shared;
+
+    /* Clear the implementation (making it invalid) */
+    if (shared_impl)
+        oe_memset(shared_impl, 0, sizeof(CertChain));
+
+    /* Check the parameters */
+    if (!_cert_chain_is_valid(impl) || !shared_impl)
+        OE_RAISE(OE_INVALID_PARAMETER);
+
+    /* Increment the reference count of the referent */
+    OE_CHECK(_cert_chain_init(shared_impl, impl->referent));
+
+    result = OE_OK;
+
+done:
+    return result;
+}
+
+static oe_result_t _verify_cert(
     oe_cert_t* cert,
     oe_cert_chain_t* chain,
     const oe_crl_t* const* crls,
     size_t num_crls,
+    bool chain_verified,
     oe_verify_cert_error_t* error)
 {
     oe_result_t result = OE_UNEXPECTED;
     Cert* cert_impl = (Cert*)cert;
     CertChain* chain_impl = (CertChain*)chain;
     uint32_t flags = 0;
-    mbedtls_x509_crl* crl_list = NULL;
 
     /* Initialize error */
     if (error)
@@ -716,46 +822,21 @@ oe_result_t oe_cert_verify(
         OE_RAISE(OE_INVALID_PARAMETER);
     }
 
-    // Build the list of CRLS if any. Copy them onto auxilliary memory
-    // to avoid modifying them when putting them on the list.
-    if (crls && num_crls)
+    /* Reject invalid CRLs */
+    for (size_t i = 0; i < num_crls; i++)
     {
-        mbedtls_x509_crl* last = NULL;
-
-        for (size_t i = 0; i < num_crls; i++)
+        if (!crls || !crl_is_valid((const crl_t*)crls[i]))
         {
-            const crl_t* crl_impl = (crl_t*)crls[i];
-            mbedtls_x509_crl* p;
-
-            if (!crl_is_valid(crl_impl))
-                OE_RAISE(OE_INVALID_PARAMETER);
-
-            if (!(p = oe_malloc(sizeof(mbedtls_x509_crl))))
-                OE_RAISE(OE_OUT_OF_MEMORY);
-
-            OE_CHECK(
-                oe_memcpy_s(
-                    p, sizeof(*p), crl_impl->crl, sizeof(mbedtls_x509_crl)));
-
-            /* Append to the linked-list */
-            {
-                p->next = NULL;
-
-                if (crl_list)
-                    last->next = p;
-                else
-                    crl_list = p;
-            }
-
-            last = p;
+            _set_err(error, "invalid crl parameter");
+            OE_RAISE(OE_INVALID_PARAMETER);
         }
     }
 
-    /* Verify the certificate */
+    /* Verify the certificate (the CRLs are checked below) */
     if (mbedtls_x509_crt_verify(
             cert_impl->cert,
             chain_impl->referent->crt,
-            crl_list,
+            NULL,
             NULL,
             &flags,
             NULL,
@@ -770,18 +851,28 @@ oe_result_t oe_cert_verify(
         OE_RAISE(OE_VERIFY_FAILED);
     }
 
-    /* Verify every certificate in the certificate chain. */
+    /* Verify every certificate in the certificate chain. If the chain is
+     * known to be verified already, only check that the certificates are
+     * still valid. */
     for (mbedtls_x509_crt* p = chain_impl->referent->crt; p; p = p->next)
     {
-        /* Verify the current certificate in the chain. */
-        if (mbedtls_x509_crt_verify(
-                p,
-                chain_impl->referent->crt,
-                crl_list,
-                NULL,
-                &flags,
-                NULL,
-                NULL) != 0)
+        int r = 0;
+
+        if (!chain_verified)
+        {
+            r = mbedtls_x509_crt_verify(
+                p, chain_impl->referent->crt, NULL, NULL, &flags, NULL, NULL);
+        }
+        else if (mbedtls_x509_time_is_past(&p->valid_to))
+        {
+            flags = MBEDTLS_X509_BADCERT_EXPIRED;
+        }
+        else if (mbedtls_x509_time_is_future(&p->valid_from))
+        {
+            flags = MBEDTLS_X509_BADCERT_FUTURE;
+        }
+
+        if (r != 0 || flags)
         {
             if (error)
             {
@@ -791,34 +882,64 @@ oe_result_t oe_cert_verify(
 
             OE_RAISE(OE_VERIFY_FAILED);
         }
+    }
+
+    /* Check the certificate and every certificate in the certificate chain
+     * against the CRLs */
+    if (num_crls)
+    {
+        flags = _check_crls(
+            cert_impl->cert, chain_impl->referent->crt, crls, num_crls);
 
-        /* Verify that the CRL list has an issuer for this certificate. */
-        if (crl_list)
+        for (mbedtls_x509_crt* p = chain_impl->referent->crt; p && !flags;
+             p = p->next)
         {
-            if (!_crl_list_find_issuer_for_cert(crl_list, p))
+            /* Verify that the CRL list has an issuer for this certificate. */
+            if (!_crl_list_find_issuer_for_cert(crls, num_crls, p))
             {
                 _set_err(error, "unable to get certificate CRL");
                 OE_RAISE(OE_VERIFY_FAILED);
             }
+
+            flags = _check_crls(p, chain_impl->referent->crt, crls, num_crls);
+        }
+
+        if (flags)
+        {
+            if (error)
+            {
+                mbedtls_x509_crt_verify_info(
+                    error->buf, sizeof(error->buf), "", flags);
+            }
+
+            OE_RAISE(OE_VERIFY_FAILED);
         }
     }
 
     result = OE_OK;
 
 done:
+    return result;
+}
 
-    if (crl_list)
-    {
-        /* Free the linked list of CRL objects */
-        for (mbedtls_x509_crl* p = crl_list; p;)
-        {
-            mbedtls_x509_crl* next = p->next;
-            oe_free(p);
-            p = next;
-        }
-    }
+oe_result_t oe_cert_verify(
+    oe_cert_t* cert,
+    oe_cert_chain_t* chain,
+    const oe_crl_t* const* crls,
+    size_t num_crls,
+    oe_verify_cert_error_t* error)
+{
+    return _verify_cert(cert, chain, crls, num_crls, false, error);
+}
 
-    return result;
+oe_result_t oe_cert_verify_with_verified_chain(
+    oe_cert_t* cert,
+    oe_cert_chain_t* chain,
+    const oe_crl_t* const* crls,
+    size_t num_crls,
+    oe_verify_cert_error_t* error)
+{
+    return _verify_cert(cert, chain, crls, num_crls, true, error);
 }
 
 oe_result_t oe_cert_get_rsa_public_key(
@@ -8,6 +8,7 @@
 #include <openenclave/internal/calls.h>
 #include <openenclave/internal/enclavelibc.h>
 #include <openenclave/internal/fault.h>
+#include <openenclave/internal/fiber.h>
 #include <openenclave/internal/globals.h>
 #include <openenclave/internal/hostalloc.h>
 #include <openenclave/internal/jump.h>
@@ -16,13 +17,16 @@
 #include <openenclave/internal/raise.h>
 #include <openenclave/internal/reloc.h>
 #include <openenclave/internal/sgxtypes.h>
+#include <openenclave/internal/task.h>
 #include <openenclave/internal/thread.h>
 #include <openenclave/internal/utils.h>
 #include "../report.h"
 #include "asmdefs.h"
 #include "cpuid.h"
+#include "heapprofile.h"
 #include "init.h"
 #include "report.h"
+#include "sharedbuf.h"
 #include "td.h"
 #include "thread.h"
 
@@ -213,18 +217,14 @@ static const oe_ecall_pages_t* _get_ecall_pages()
     return pages;
 }
 
-static oe_result_t _handle_call_enclave(uint64_t arg_in)
+/* Dispatch one call whose arguments were validated to be outside the enclave */
+static oe_result_t _call_enclave_function(oe_call_enclave_args_t* args_ptr)
 {
-    oe_call_enclave_args_t args, *args_ptr;
+    oe_call_enclave_args_t args;
     oe_result_t result = OE_OK;
     uint64_t vaddr;
     const oe_ecall_pages_t* ecall_pages = _get_ecall_pages();
 
-    if (!oe_is_outside_enclave((void*)arg_in, sizeof(oe_call_enclave_args_t)))
-    {
-        OE_RAISE(OE_INVALID_PARAMETER);
-    }
-    args_ptr = (oe_call_enclave_args_t*)arg_in;
     args = *args_ptr;
 
     if (!args.vaddr || (args.func >= ecall_pages->num_vaddrs) ||
@@ -246,6 +246,95 @@ done:
     return result;
 }
 
+/* Call the function at the given index of the ECALL pages. The generated
+ * ECALL function checks that its arguments are outside the enclave. */
+static oe_result_t _handle_call_enclave_function(uint16_t func, uint64_t arg_in)
+{
+    oe_result_t result = OE_UNEXPECTED;
+    const oe_ecall_pages_t* ecall_pages = _get_ecall_pages();
+    uint64_t index = func - OE_ECALL_TABLE_BASE;
+    oe_enclave_func_t function;
+
+    if (index >= ecall_pages->num_vaddrs || !ecall_pages->vaddrs[index])
+        OE_RAISE(OE_NOT_FOUND);
+
+    /* Do not speculate past the bounds check */
+    __builtin_ia32_lfence();
+
+    function = (oe_enclave_func_t)(
+        (uint64_t)__oe_get_enclave_base() + ecall_pages->vaddrs[index]);
+    function((void*)arg_in);
+
+    result = OE_OK;
+
+done:
+    return result;
+}
+
+static oe_result_t _handle_call_enclave(uint64_t arg_in)
+{
+    oe_result_t result = OE_UNEXPECTED;
+
+    if (!oe_is_outside_enclave((void*)arg_in, sizeof(oe_call_enclave_args_t)))
+    {
+        OE_RAISE(OE_INVALID_PARAMETER);
+    }
+
+    OE_CHECK(_call_enclave_function((oe_call_enclave_args_t*)arg_in));
+
+    result = OE_OK;
+
+done:
+    return result;
+}
+
+/*
+**==============================================================================
+**
+** _handle_call_enclave_batch()
+**
+**     Dispatch a vector of high-level enclave calls during a single entry.
+**     Each call reports its own result, so one invalid call does not stop
+**     the others.
+**
+**==============================================================================
+*/
+
+static oe_result_t _handle_call_enclave_batch(uint64_t arg_in)
+{
+    oe_result_t result = OE_UNEXPECTED;
+    oe_call_enclave_batch_args_t args;
+    size_t size;
+
+    if (!oe_is_outside_enclave((void*)arg_in, sizeof(args)))
+        OE_RAISE(OE_INVALID_PARAMETER);
+
+    /* Copy the arguments to prevent TOCTOU issues */
+    args = *(oe_call_enclave_batch_args_t*)arg_in;
+
+    if (!args.calls)
+        OE_RAISE(OE_INVALID_PARAMETER);
+
+    OE_CHECK(
+        oe_safe_mul_sizet(args.num_calls, sizeof(*args.calls), &size));
+
+    if (!oe_is_outside_enclave(args.calls, size))
+        OE_RAISE(OE_INVALID_PARAMETER);
+
+    for (size_t i = 0; i < args.num_calls; i++)
+    {
+        oe_result_t r = _call_enclave_function(&args.calls[i]);
+
+        if (r != OE_OK)
+            args.calls[i].result = r;
+    }
+
+    result = OE_OK;
+
+done:
+    return result;
+}
+
 /*
 **==============================================================================
 **
@@ -333,11 +422,36 @@ static void _handle_ecall(
             arg_out = _handle_call_enclave(arg_in);
             break;
         }
+        case OE_ECALL_CALL_ENCLAVE_BATCH:
+        {
+            arg_out = _handle_call_enclave_batch(arg_in);
+            break;
+        }
+        case OE_ECALL_THREAD_START:
+        {
+            arg_out = oe_handle_thread_start(arg_in);
+            break;
+        }
+        case OE_ECALL_GET_HEAP_PROFILE:
+        {
+            arg_out = oe_handle_get_heap_profile(arg_in);
+            break;
+        }
         case OE_ECALL_DESTRUCTOR:
         {
+            /* The host does not start threads any more */
+            oe_thread_cancel_pending();
+
+            /* Stop the workers of the task runtime */
+            oe_task_runtime_stop();
+
             /* Call functions installed by __cxa_atexit() and oe_atexit() */
             oe_call_atexit_functions();
 
+            /* Destroy the thread-specific data that outlives ECALLs, which
+             * the atexit functions may still use */
+            oe_thread_destruct_tcs_specific();
+
             /* Call all finalization functions */
             oe_call_fini_functions();
 
@@ -371,8 +485,25 @@ static void _handle_ecall(
             oe_handle_verify_report(arg_in, &arg_out);
             break;
         }
+        case OE_ECALL_REGISTER_SHARED_BUFFER:
+        {
+            arg_out = oe_handle_register_shared_buffer(arg_in);
+            break;
+        }
+        case OE_ECALL_UNREGISTER_SHARED_BUFFER:
+        {
+            arg_out = oe_handle_unregister_shared_buffer(arg_in);
+            break;
+        }
         default:
         {
+            /* Call the function with this index in the ECALL pages */
+            if (func >= OE_ECALL_TABLE_BASE && func < OE_OCALL_BASE)
+            {
+                arg_out = _handle_call_enclave_function(func, arg_in);
+                break;
+            }
+
             /* No function found with the number */
             result = OE_NOT_FOUND;
             goto done;
@@ -530,6 +661,190 @@ done:
     return result;
 }
 
+/*
+**==============================================================================
+**
+** oe_call_host_function()
+**
+**     Call the OCALL function with the given id in the OCALL table of an EDL
+**     file. The host id of the function is fetched by name on its first call
+**     and cached in the table; later calls pass args directly.
+**
+**==============================================================================
+*/
+
+oe_result_t oe_call_host_function(
+    oe_ocall_table_t* table,
+    uint32_t function_id,
+    void* args)
+{
+    oe_result_t result = OE_UNEXPECTED;
+    char* name = NULL;
+    uint32_t host_id;
+
+    /* Reject invalid parameters */
+    if (!table || function_id >= table->num_ocalls)
+        OE_RAISE(OE_INVALID_PARAMETER);
+
+    /* Fetch the host id of the function on its first call */
+    if (!(host_id = __atomic_load_n(
+              &table->host_ids[function_id], __ATOMIC_ACQUIRE)))
+    {
+        const char* func = table->names[function_id];
+        size_t len = oe_strlen(func);
+        uint64_t arg_out = 0;
+
+        if (!(name = oe_host_alloc_for_call_host(len + 1)))
+        {
+            /* If the enclave is in crashing/crashed status, new OCALL should
+             * fail immediately. */
+            OE_CHECK(__oe_enclave_status);
+            OE_RAISE(OE_OUT_OF_MEMORY);
+        }
+
+        OE_CHECK(oe_memcpy_s(name, len + 1, func, len + 1));
+
+        OE_CHECK(
+            oe_ocall(
+                OE_OCALL_GET_HOST_FUNCTION_ID, (uint64_t)name, &arg_out));
+
+        if (arg_out >= OE_MAX_OCALL_TABLE_FUNCTIONS)
+            OE_RAISE(OE_UNEXPECTED);
+
+        host_id = (uint32_t)arg_out + 1;
+        __atomic_store_n(
+            &table->host_ids[function_id], host_id, __ATOMIC_RELEASE);
+    }
+
+    if (host_id > OE_MAX_OCALL_TABLE_FUNCTIONS)
+        OE_RAISE(OE_UNEXPECTED);
+
+    /* Call into the host */
+    OE_CHECK(
+        oe_ocall(
+            (uint16_t)(OE_OCALL_TABLE_BASE + host_id - 1),
+            (uint64_t)args,
+            NULL));
+
+    result = OE_OK;
+
+done:
+    oe_host_free_for_call_host(name);
+    return result;
+}
+
+/*
+**==============================================================================
+**
+** oe_call_host_async()
+** oe_async_ocall_is_done()
+** oe_async_ocall_wait()
+**
+**     The handle of an asynchronous OCALL is the oe_async_ocall_status_t at
+**     the start of the host record of the call. The enclave polls its done
+**     flag in place and waits with OE_OCALL_WAIT_ASYNC.
+**
+**     While the call is not done, the waiting fiber lets the other ready
+**     fibers of its TCS run. Only when none is ready does the TCS park on
+**     the host, in OE_OCALL_WAIT_ASYNC, until the call is done: an OCALL
+**     keeps its TCS, which no other enclave thread can use meanwhile.
+**
+**==============================================================================
+*/
+
+oe_result_t oe_call_host_async(
+    const char* func,
+    void* args_in,
+    oe_async_ocall_t** handle)
+{
+    oe_result_t result = OE_UNEXPECTED;
+    oe_call_host_async_args_t* args = NULL;
+    oe_async_ocall_status_t* status;
+
+    if (handle)
+        *handle = NULL;
+
+    /* Reject invalid parameters */
+    if (!func || !handle)
+        OE_RAISE(OE_INVALID_PARAMETER);
+
+    /* Initialize the arguments */
+    {
+        size_t len = oe_strlen(func);
+        size_t total_len;
+
+        OE_CHECK(
+            oe_safe_add_sizet(
+                len, 1 + sizeof(oe_call_host_async_args_t), &total_len));
+
+        if (!(args = oe_host_alloc_for_call_host(total_len)))
+        {
+            OE_CHECK(__oe_enclave_status);
+            OE_RAISE(OE_OUT_OF_MEMORY);
+        }
+
+        OE_CHECK(oe_memcpy_s(args->func, len + 1, func, len + 1));
+
+        args->args = args_in;
+        args->result = OE_UNEXPECTED;
+        args->handle = NULL;
+    }
+
+    /* Post the call to the host */
+    OE_CHECK(oe_ocall(OE_OCALL_CALL_HOST_ASYNC, (uint64_t)args, NULL));
+    OE_CHECK(args->result);
+
+    /* The enclave reads the status in place, so it must be host memory */
+    status = args->handle;
+
+    if (!status || !oe_is_outside_enclave(status, sizeof(*status)))
+        OE_RAISE(OE_UNEXPECTED);
+
+    *handle = (oe_async_ocall_t*)status;
+
+    result = OE_OK;
+
+done:
+    oe_host_free_for_call_host(args);
+    return result;
+}
+
+bool oe_async_ocall_is_done(const oe_async_ocall_t* handle)
+{
+    const oe_async_ocall_status_t* status =
+        (const oe_async_ocall_status_t*)handle;
+
+    if (!status || !oe_is_outside_enclave(status, sizeof(*status)))
+        return false;
+
+    return __atomic_load_n(&status->done, __ATOMIC_ACQUIRE) != 0;
+}
+
+oe_result_t oe_async_ocall_wait(oe_async_ocall_t* handle)
+{
+    oe_result_t result = OE_UNEXPECTED;
+    uint64_t arg_out = 0;
+
+    if (!handle ||
+        !oe_is_outside_enclave(handle, sizeof(oe_async_ocall_status_t)))
+    {
+        OE_RAISE(OE_INVALID_PARAMETER);
+    }
+
+    /* Run the other fibers of the TCS while the call runs */
+    while (!oe_async_ocall_is_done(handle) && oe_fiber_has_ready())
+        oe_fiber_yield();
+
+    /* The host releases the record, so the result is returned in arg_out */
+    OE_CHECK(oe_ocall(OE_OCALL_WAIT_ASYNC, (uint64_t)handle, &arg_out));
+    OE_CHECK((oe_result_t)arg_out);
+
+    result = OE_OK;
+
+done:
+    return result;
+}
+
 /*
 **==============================================================================
 **
@@ -74,21 +74,55 @@ done:
 */
 int oe_emulate_cpuid(uint64_t* rax, uint64_t* rbx, uint64_t* rcx, uint64_t* rdx)
 {
-    // upper bits zeroed on 64-bit for CPUID
-    uint32_t cpuid_leaf = (*rax) & 0xFFFFFFFF;
-    uint32_t cpuid_sub_leaf = (*rcx) & 0xFFFFFFFF;
+    uint32_t eax, ebx, ecx, edx;
 
-    if (cpuid_leaf < OE_CPUID_LEAF_COUNT)
+    // upper bits zeroed on 64-bit for CPUID
+    if (oe_cpuid(
+            (*rax) & 0xFFFFFFFF, (*rcx) & 0xFFFFFFFF, &eax, &ebx, &ecx, &edx) !=
+        OE_OK)
     {
-        // For leaf 4 of cpuid, only subleaf of 0 is emulated
-        if ((cpuid_leaf == 4) && (cpuid_sub_leaf != 0))
-            return -1;
-
-        *rax = _oe_cpuid_table[cpuid_leaf][OE_CPUID_RAX];
-        *rbx = _oe_cpuid_table[cpuid_leaf][OE_CPUID_RBX];
-        *rcx = _oe_cpuid_table[cpuid_leaf][OE_CPUID_RCX];
-        *rdx = _oe_cpuid_table[cpuid_leaf][OE_CPUID_RDX];
-        return 0;
+        return -1;
     }
-    return -1;
+
+    *rax = eax;
+    *rbx = ebx;
+    *rcx = ecx;
+    *rdx = edx;
+    return 0;
+}
+
+/*
+**==============================================================================
+**
+** oe_cpuid()
+**
+**     Return the CPUID information cached at initialization, like
+**     oe_emulate_cpuid() but without the exception raised by the CPUID
+**     instruction and the ECALL that handles it.
+**
+**==============================================================================
+*/
+oe_result_t oe_cpuid(
+    uint32_t leaf,
+    uint32_t subleaf,
+    uint32_t* eax,
+    uint32_t* ebx,
+    uint32_t* ecx,
+    uint32_t* edx)
+{
+    if (!eax || !ebx || !ecx || !edx)
+        return OE_INVALID_PARAMETER;
+
+    if (leaf >= OE_CPUID_LEAF_COUNT)
+        return OE_UNSUPPORTED;
+
+    // For leaf 4 of cpuid, only subleaf of 0 is cached
+    if ((leaf == 4) && (subleaf != 0))
+        return OE_UNSUPPORTED;
+
+    *eax = _oe_cpuid_table[leaf][OE_CPUID_RAX];
+    *ebx = _oe_cpuid_table[leaf][OE_CPUID_RBX];
+    *ecx = _oe_cpuid_table[leaf][OE_CPUID_RCX];
+    *edx = _oe_cpuid_table[leaf][OE_CPUID_RDX];
+    return OE_OK;
 }
@@ -0,0 +1,542 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#include <openenclave/enclave.h>
+#include <openenclave/internal/calls.h>
+#include <openenclave/internal/enclavelibc.h>
+#include <openenclave/internal/fiber.h>
+#include <openenclave/internal/sgxtypes.h>
+#include <openenclave/internal/thread.h>
+#include <openenclave/internal/utils.h>
+#include "td.h"
+
+#define FIBER_MAGIC 0x3e8b5d0f61c2a947
+
+/* Initial MXCSR (all exceptions masked) and x87 control word */
+#define FIBER_INITIAL_FP_CONTROL (0x1f80 | ((uint64_t)0x037f << 32))
+
+typedef struct _scheduler scheduler_t;
+
+struct _oe_fiber
+{
+    uint64_t magic;
+
+    /* Stack pointer saved by oe_fiber_switch() */
+    void* sp;
+
+    /* The scheduler of the TCS that runs the fiber */
+    scheduler_t* scheduler;
+
+    void (*func)(void* arg);
+    void* arg;
+    void* stack;
+
+    /* Lock used to synchronize the fields below */
+    oe_spinlock_t lock;
+    bool done;
+    oe_fiber_t* joiner;
+
+    /* References of the joiner and of the running fiber itself */
+    uint32_t refs;
+
+    /* Next fiber in the ready queue or in a wait queue */
+    oe_fiber_t* next;
+};
+
+/*
+**==============================================================================
+**
+** Schedulers:
+**
+**     Each TCS has a scheduler with a queue of ready fibers, which fibers of
+**     other TCSs may add to. The running fiber picks the next one when it
+**     yields or blocks. With no ready fiber, the TCS waits (with an OCALL)
+**     until another TCS adds one. The context of the ECALL is the main fiber
+**     of the scheduler.
+**
+**     A fiber that returns is done and makes its joiner ready, but cannot
+**     release its own stack. The fiber that runs next on the TCS releases it.
+**
+**==============================================================================
+*/
+
+struct _scheduler
+{
+    /* Lock used to synchronize the queue and sleeping */
+    oe_spinlock_t lock;
+    oe_fiber_t* front;
+    oe_fiber_t* back;
+    bool sleeping;
+
+    const void* tcs;
+    oe_fiber_t* current;
+    oe_fiber_t main;
+
+    /* Fiber that returned and switched to the current one */
+    oe_fiber_t* returned;
+};
+
+static scheduler_t _schedulers[OE_SGX_MAX_TCS];
+static uint64_t _num_schedulers;
+
+void oe_fiber_switch(void** from_sp, void* to_sp);
+void oe_fiber_start(void);
+void oe_fiber_main(oe_fiber_t* fiber);
+
+static scheduler_t* _get_scheduler(void)
+{
+    td_t* td = oe_get_td();
+    scheduler_t* scheduler;
+    uint64_t index;
+
+    if (td->fiber_scheduler)
+        return &_schedulers[td->fiber_scheduler - 1];
+
+    /* Every TCS gets a scheduler since there are no more TCSs than these */
+    index = __atomic_fetch_add(&_num_schedulers, 1, __ATOMIC_ACQ_REL);
+    oe_assert(index < OE_COUNTOF(_schedulers));
+
+    scheduler = &_schedulers[index];
+    scheduler->tcs = td_to_tcs(td);
+    scheduler->main.magic = FIBER_MAGIC;
+    scheduler->main.scheduler = scheduler;
+    scheduler->current = &scheduler->main;
+
+    td->fiber_scheduler = index + 1;
+    return scheduler;
+}
+
+/* Make a fiber ready on its TCS, waking the TCS if it waits */
+static void _make_ready(oe_fiber_t* fiber)
+{
+    scheduler_t* scheduler = fiber->scheduler;
+    bool sleeping;
+
+    fiber->next = NULL;
+
+    oe_spin_lock(&scheduler->lock);
+    {
+        if (scheduler->back)
+            scheduler->back->next = fiber;
+        else
+            scheduler->front = fiber;
+
+        scheduler->back = fiber;
+
+        sleeping = scheduler->sleeping;
+        scheduler->sleeping = false;
+    }
+    oe_spin_unlock(&scheduler->lock);
+
+    if (sleeping)
+        oe_ocall(OE_OCALL_THREAD_WAKE, (uint64_t)scheduler->tcs, NULL);
+}
+
+/* Drop a reference to the fiber (called with its lock held) */
+static void _release_fiber(oe_fiber_t* fiber)
+{
+    if (--fiber->refs == 0)
+    {
+        oe_spin_unlock(&fiber->lock);
+        fiber->magic = 0;
+        oe_free(fiber);
+        return;
+    }
+
+    oe_spin_unlock(&fiber->lock);
+}
+
+/* Release the stack of the fiber that returned before the switch */
+static void _release_returned(scheduler_t* scheduler)
+{
+    oe_fiber_t* fiber = scheduler->returned;
+
+    if (!fiber)
+        return;
+
+    scheduler->returned = NULL;
+    oe_free(fiber->stack);
+
+    oe_spin_lock(&fiber->lock);
+    fiber->stack = NULL;
+    _release_fiber(fiber);
+}
+
+/* Run the next ready fiber; returns when the current one runs again */
+static void _schedule(scheduler_t* scheduler)
+{
+    oe_fiber_t* current = scheduler->current;
+    oe_fiber_t* next;
+
+    for (;;)
+    {
+        oe_spin_lock(&scheduler->lock);
+
+        if ((next = scheduler->front))
+        {
+            if (!(scheduler->front = next->next))
+                scheduler->back = NULL;
+
+            oe_spin_unlock(&scheduler->lock);
+            break;
+        }
+
+        scheduler->sleeping = true;
+        oe_spin_unlock(&scheduler->lock);
+
+        /* Wakes that arrive before the wait are not lost */
+        oe_ocall(OE_OCALL_THREAD_WAIT, (uint64_t)scheduler->tcs, NULL);
+    }
+
+    if (next == current)
+        return;
+
+    scheduler->current = next;
+    oe_fiber_switch(&current->sp, next->sp);
+
+    /* The current fiber runs again */
+    _release_returned(scheduler);
+}
+
+void oe_fiber_main(oe_fiber_t* fiber)
+{
+    scheduler_t* scheduler = fiber->scheduler;
+    oe_fiber_t* joiner;
+
+    _release_returned(scheduler);
+
+    fiber->func(fiber->arg);
+
+    oe_spin_lock(&fiber->lock);
+    fiber->done = true;
+    joiner = fiber->joiner;
+    oe_spin_unlock(&fiber->lock);
+
+    if (joiner)
+        _make_ready(joiner);
+
+    /* Never returns, since the fiber is not ready anymore */
+    scheduler->returned = fiber;
+    _schedule(scheduler);
+    oe_abort();
+}
+
+static oe_fiber_t* _get_fiber(oe_fiber_t* fiber)
+{
+    if (!fiber || !oe_is_within_enclave(fiber, sizeof(oe_fiber_t)) ||
+        fiber->magic != FIBER_MAGIC)
+    {
+        return NULL;
+    }
+
+    return fiber;
+}
+
+/*
+**==============================================================================
+**
+** oe_fiber_t
+**
+**==============================================================================
+*/
+
+oe_result_t oe_fiber_create(
+    oe_fiber_t** fiber_out,
+    size_t stack_size,
+    void (*func)(void* arg),
+    void* arg)
+{
+    oe_fiber_t* fiber;
+    uint64_t* sp;
+
+    if (!fiber_out || !func)
+        return OE_INVALID_PARAMETER;
+
+    if (stack_size == 0)
+        stack_size = OE_FIBER_DEFAULT_STACK_SIZE;
+
+    if (stack_size < OE_FIBER_MIN_STACK_SIZE)
+        stack_size = OE_FIBER_MIN_STACK_SIZE;
+
+    if (stack_size > OE_SIZE_MAX - OE_PAGE_SIZE)
+        return OE_INVALID_PARAMETER;
+
+    stack_size = oe_round_up_to_multiple(stack_size, OE_PAGE_SIZE);
+
+    if (!(fiber = (oe_fiber_t*)oe_calloc(1, sizeof(oe_fiber_t))))
+        return OE_OUT_OF_MEMORY;
+
+    if (!(fiber->stack = oe_memalign(OE_PAGE_SIZE, stack_size)))
+    {
+        oe_free(fiber);
+        return OE_OUT_OF_MEMORY;
+    }
+
+    fiber->magic = FIBER_MAGIC;
+    fiber->scheduler = _get_scheduler();
+    fiber->func = func;
+    fiber->arg = arg;
+    fiber->lock = OE_SPINLOCK_INITIALIZER;
+    fiber->refs = 2;
+
+    /* The frame restored by oe_fiber_switch(), which returns to
+     * oe_fiber_start() with RSP at the (16-byte aligned) top of the stack,
+     * so that its call to oe_fiber_main() follows the ABI */
+    sp = (uint64_t*)((uint8_t*)fiber->stack + stack_size);
+    *--sp = (uint64_t)oe_fiber_start;
+    *--sp = 0;                /* RBP */
+    *--sp = 0;                /* RBX */
+    *--sp = (uint64_t)fiber; /* R12 */
+    *--sp = 0;                /* R13 */
+    *--sp = 0;                /* R14 */
+    *--sp = 0;                /* R15 */
+    *--sp = FIBER_INITIAL_FP_CONTROL;
+    fiber->sp = sp;
+
+    *fiber_out = fiber;
+    _make_ready(fiber);
+
+    return OE_OK;
+}
+
+oe_result_t oe_fiber_join(oe_fiber_t* fiber)
+{
+    scheduler_t* scheduler = _get_scheduler();
+    oe_fiber_t* self = scheduler->current;
+
+    if (!_get_fiber(fiber) || fiber == self ||
+        fiber == &fiber->scheduler->main)
+    {
+        return OE_INVALID_PARAMETER;
+    }
+
+    oe_spin_lock(&fiber->lock);
+
+    if (fiber->joiner)
+    {
+        oe_spin_unlock(&fiber->lock);
+        return OE_INVALID_PARAMETER;
+    }
+
+    fiber->joiner = self;
+
+    while (!fiber->done)
+    {
+        oe_spin_unlock(&fiber->lock);
+        _schedule(scheduler);
+        oe_spin_lock(&fiber->lock);
+    }
+
+    _release_fiber(fiber);
+
+    return OE_OK;
+}
+
+oe_fiber_t* oe_fiber_self(void)
+{
+    return _get_scheduler()->current;
+}
+
+void oe_fiber_yield(void)
+{
+    scheduler_t* scheduler = _get_scheduler();
+
+    _make_ready(scheduler->current);
+    _schedule(scheduler);
+}
+
+bool oe_fiber_has_ready(void)
+{
+    scheduler_t* scheduler = _get_scheduler();
+    bool ready;
+
+    oe_spin_lock(&scheduler->lock);
+    ready = scheduler->front != NULL;
+    oe_spin_unlock(&scheduler->lock);
+
+    return ready;
+}
+
+/*
+**==============================================================================
+**
+** oe_fiber_mutex_t and oe_fiber_cond_t
+**
+**     Waiting fibers are queued on the object and leave the ready queue of
+**     their TCS until another fiber (of any TCS) makes them ready again. An
+**     unlocked mutex is handed to its first waiter.
+**
+**==============================================================================
+*/
+
+static void _push_back(oe_fiber_t** front, oe_fiber_t** back, oe_fiber_t* f)
+{
+    f->next = NULL;
+
+    if (*back)
+        (*back)->next = f;
+    else
+        *front = f;
+
+    *back = f;
+}
+
+static oe_fiber_t* _pop_front(oe_fiber_t** front, oe_fiber_t** back)
+{
+    oe_fiber_t* fiber = *front;
+
+    if (fiber && !(*front = fiber->next))
+        *back = NULL;
+
+    return fiber;
+}
+
+oe_result_t oe_fiber_mutex_lock(oe_fiber_mutex_t* mutex)
+{
+    scheduler_t* scheduler;
+    oe_fiber_t* self;
+
+    if (!mutex)
+        return OE_INVALID_PARAMETER;
+
+    scheduler = _get_scheduler();
+    self = scheduler->current;
+
+    oe_spin_lock(&mutex->lock);
+
+    if (mutex->owner == self)
+    {
+        oe_spin_unlock(&mutex->lock);
+        return OE_BUSY;
+    }
+
+    if (!mutex->owner)
+    {
+        mutex->owner = self;
+        oe_spin_unlock(&mutex->lock);
+        return OE_OK;
+    }
+
+    _push_back(&mutex->front, &mutex->back, self);
+    oe_spin_unlock(&mutex->lock);
+
+    /* Resumed when the mutex is handed to this fiber */
+    do
+        _schedule(scheduler);
+    while (__atomic_load_n(&mutex->owner, __ATOMIC_ACQUIRE) != self);
+
+    return OE_OK;
+}
+
+oe_result_t oe_fiber_mutex_trylock(oe_fiber_mutex_t* mutex)
+{
+    oe_result_t result = OE_BUSY;
+
+    if (!mutex)
+        return OE_INVALID_PARAMETER;
+
+    oe_spin_lock(&mutex->lock);
+
+    if (!mutex->owner)
+    {
+        mutex->owner = oe_fiber_self();
+        result = OE_OK;
+    }
+
+    oe_spin_unlock(&mutex->lock);
+
+    return result;
+}
+
+oe_result_t oe_fiber_mutex_unlock(oe_fiber_mutex_t* mutex)
+{
+    oe_fiber_t* next;
+
+    if (!mutex)
+        return OE_INVALID_PARAMETER;
+
+    oe_spin_lock(&mutex->lock);
+
+    if (mutex->owner != oe_fiber_self())
+    {
+        oe_spin_unlock(&mutex->lock);
+        return OE_NOT_OWNER;
+    }
+
+    next = _pop_front(&mutex->front, &mutex->back);
+    __atomic_store_n(&mutex->owner, next, __ATOMIC_RELEASE);
+    oe_spin_unlock(&mutex->lock);
+
+    if (next)
+        _make_ready(next);
+
+    return OE_OK;
+}
+
+oe_result_t oe_fiber_cond_wait(oe_fiber_cond_t* cond, oe_fiber_mutex_t* mutex)
+{
+    scheduler_t* scheduler;
+    oe_fiber_t* self;
+    oe_result_t result;
+
+    if (!cond || !mutex)
+        return OE_INVALID_PARAMETER;
+
+    scheduler = _get_scheduler();
+    self = scheduler->current;
+
+    if (__atomic_load_n(&mutex->owner, __ATOMIC_ACQUIRE) != self)
+        return OE_NOT_OWNER;
+
+    /* Queue this fiber before unlocking, so that no signal is lost */
+    oe_spin_lock(&cond->lock);
+    _push_back(&cond->front, &cond->back, self);
+    oe_spin_unlock(&cond->lock);
+
+    if ((result = oe_fiber_mutex_unlock(mutex)) != OE_OK)
+        return result;
+
+    _schedule(scheduler);
+
+    return oe_fiber_mutex_lock(mutex);
+}
+
+oe_result_t oe_fiber_cond_signal(oe_fiber_cond_t* cond)
+{
+    oe_fiber_t* fiber;
+
+    if (!cond)
+        return OE_INVALID_PARAMETER;
+
+    oe_spin_lock(&cond->lock);
+    fiber = _pop_front(&cond->front, &cond->back);
+    oe_spin_unlock(&cond->lock);
+
+    if (fiber)
+        _make_ready(fiber);
+
+    return OE_OK;
+}
+
+oe_result_t oe_fiber_cond_broadcast(oe_fiber_cond_t* cond)
+{
+    oe_fiber_t* fiber;
+
+    if (!cond)
+        return OE_INVALID_PARAMETER;
+
+    oe_spin_lock(&cond->lock);
+    fiber = cond->front;
+    cond->front = NULL;
+    cond->back = NULL;
+    oe_spin_unlock(&cond->lock);
+
+    while (fiber)
+    {
+        oe_fiber_t* next = fiber->next;
+        _make_ready(fiber);
+        fiber = next;
+    }
+
+    return OE_OK;
+}
@@ -116,6 +116,35 @@ const void* __oe_get_heap_end()
     return (const uint8_t*)__oe_get_heap_base() + __oe_get_heap_size();
 }
 
+/*
+**==============================================================================
+**
+** Static TLS (set only if the image has a PT_TLS segment):
+**
+**==============================================================================
+*/
+
+OE_EXPORT uint64_t oe_tls_image_vaddr;
+OE_EXPORT uint64_t oe_tls_image_size;
+OE_EXPORT uint64_t oe_tls_block_size;
+
+const void* __oe_get_tls_image_base()
+{
+    const unsigned char* base = __oe_get_enclave_base();
+
+    return base + oe_tls_image_vaddr;
+}
+
+size_t __oe_get_tls_image_size()
+{
+    return oe_tls_image_size;
+}
+
+size_t __oe_get_tls_block_size()
+{
+    return oe_tls_block_size;
+}
+
 /*
 **==============================================================================
 **
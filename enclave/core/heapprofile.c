@@ -0,0 +1,463 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#include "heapprofile.h"
+#include <openenclave/enclave.h>
+#include <openenclave/internal/calls.h>
+#include <openenclave/internal/enclavelibc.h>
+#include <openenclave/internal/malloc.h>
+#include <openenclave/internal/sgxtypes.h>
+#include <openenclave/internal/thread.h>
+
+/*
+**==============================================================================
+**
+** Heap profile:
+**
+**     Each TCS counts the bytes it allocates down from a random interval
+**     (in its td_t), and samples the allocation that brings the countdown to
+**     zero. Only sampled allocations take the profile lock: their call stack
+**     is charged to a call site, and the allocation is added to the map of
+**     live samples so that its site is credited when it is freed.
+**
+**     The profile is allocated by the first oe_heap_profiler_start() and is
+**     never released, since sampled allocations may be freed at any time.
+**
+**==============================================================================
+*/
+
+/* Number of buckets of the call site index (a power of two) */
+#define _SITE_BUCKETS (2 * OE_HEAP_PROFILE_MAX_SITES)
+
+/* Number of buckets of the map of live samples (a power of two). Samples are
+ * dropped when it is three quarters full. */
+#define _LIVE_BUCKETS OE_HEAP_PROFILE_MAX_LIVE
+
+typedef struct _live_sample
+{
+    /* Address of the allocation, or zero if the bucket is empty */
+    uint64_t ptr;
+    uint64_t size;
+    uint64_t site;
+} live_sample_t;
+
+typedef struct _heap_profile
+{
+    oe_heap_profile_site_t sites[OE_HEAP_PROFILE_MAX_SITES];
+    uint64_t num_sites;
+
+    /* Index plus one of the site of each stack hash, or zero */
+    uint16_t site_index[_SITE_BUCKETS];
+    uint64_t site_hashes[OE_HEAP_PROFILE_MAX_SITES];
+
+    /* Linear probing map of the live samples by address */
+    live_sample_t live[_LIVE_BUCKETS];
+    uint64_t num_live;
+} heap_profile_t;
+
+static heap_profile_t* _profile;
+static oe_spinlock_t _lock = OE_SPINLOCK_INITIALIZER;
+
+/* Mean number of bytes between samples, or zero when stopped */
+static volatile uint64_t _sample_interval;
+
+/* Serializes oe_heap_profiler_start() */
+static oe_mutex_t _start_mutex = OE_MUTEX_INITIALIZER;
+
+/*
+**==============================================================================
+**
+** Sample intervals
+**
+**==============================================================================
+*/
+
+/* Return a random number from the xorshift64* generator of the TCS */
+static uint64_t _next_random(td_t* td)
+{
+    uint64_t x = td->heap_sample_random;
+
+    x ^= x >> 12;
+    x ^= x << 25;
+    x ^= x >> 27;
+    td->heap_sample_random = x;
+
+    return x * 0x2545F4914F6CDD1DULL;
+}
+
+/* Return a nonzero seed that differs across TCSs and enclave instances */
+static uint64_t _seed(td_t* td)
+{
+    static volatile uint64_t _counter;
+    uint64_t z = (uint64_t)td;
+
+    z += __atomic_add_fetch(&_counter, 1, __ATOMIC_RELAXED);
+
+    /* splitmix64 finalizer */
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    z ^= z >> 31;
+
+    return z ? z : 1;
+}
+
+/* Natural logarithm of x in (0, 1], accurate to about 1e-6 */
+static double _log(double x)
+{
+    const double ln2 = 0.69314718055994530942;
+    union {
+        double d;
+        uint64_t u;
+    } bits;
+    int64_t exponent;
+    double m, t, t2, series;
+
+    /* x = m * 2^exponent with m in [1, 2) */
+    bits.d = x;
+    exponent = (int64_t)((bits.u >> 52) & 0x7ff) - 1023;
+    bits.u = (bits.u & 0x000fffffffffffffULL) | 0x3ff0000000000000ULL;
+    m = bits.d;
+
+    /* ln(m) = 2 * atanh(t) with t = (m - 1) / (m + 1) in [0, 1/3) */
+    t = (m - 1.0) / (m + 1.0);
+    t2 = t * t;
+
+    series = 1.0 / 7 + t2 / 9;
+    series = 1.0 / 5 + t2 * series;
+    series = 1.0 / 3 + t2 * series;
+    series = 1.0 + t2 * series;
+
+    return (double)exponent * ln2 + 2.0 * t * series;
+}
+
+/* Return the number of bytes before the next sample of the TCS, drawn from
+ * an exponential distribution of the given mean */
+static int64_t _next_interval(td_t* td, uint64_t mean)
+{
+    /* Uniform in (0, 1] with 53 random bits */
+    double u = (double)((_next_random(td) >> 11) + 1) / 9007199254740992.0;
+    double interval = -_log(u) * (double)mean;
+
+    /* u >= 2^-53, so the interval stays below 37 times the mean */
+    return (int64_t)interval + 1;
+}
+
+bool oe_heap_profile_sample(size_t size)
+{
+    uint64_t mean = __atomic_load_n(&_sample_interval, __ATOMIC_RELAXED);
+    td_t* td;
+
+    if (!mean)
+        return false;
+
+    td = oe_get_td();
+    td->heap_sample_countdown -= (int64_t)size;
+
+    if (td->heap_sample_countdown > 0)
+        return false;
+
+    /* Seed the generator of the TCS on its first allocation, which is not
+     * sampled */
+    if (!td->heap_sample_random)
+    {
+        td->heap_sample_random = _seed(td);
+        td->heap_sample_countdown = _next_interval(td, mean);
+        return false;
+    }
+
+    td->heap_sample_countdown = _next_interval(td, mean);
+    return true;
+}
+
+/*
+**==============================================================================
+**
+** Recording
+**
+**==============================================================================
+*/
+
+/* Walk the frame pointers of the caller of the caller, checking that each
+ * frame and return address lies within the enclave (see oe_backtrace(),
+ * which only walks frames with the debug allocator) */
+OE_NEVER_INLINE
+static uint64_t _capture_stack(uint64_t* frames)
+{
+    void** frame = (void**)__builtin_frame_address(0);
+    uint64_t depth = 0;
+    bool skip = true;
+
+    while (depth < OE_HEAP_PROFILE_MAX_DEPTH)
+    {
+        void** next;
+
+        if (!oe_is_within_enclave(frame, 2 * sizeof(void*)))
+            break;
+
+        if (!oe_is_within_enclave(frame[1], 1))
+            break;
+
+        /* Skip the return address into oe_heap_profile_record_allocation() */
+        if (skip)
+            skip = false;
+        else
+            frames[depth++] = (uint64_t)frame[1];
+
+        /* Frames move up the stack, which also stops cycles */
+        next = (void**)frame[0];
+
+        if (next <= frame)
+            break;
+
+        frame = next;
+    }
+
+    return depth;
+}
+
+static uint64_t _hash_stack(const uint64_t* frames, uint64_t depth)
+{
+    uint64_t hash = 14695981039346656037ULL;
+
+    for (uint64_t i = 0; i < depth; i++)
+    {
+        hash ^= frames[i];
+        hash *= 1099511628211ULL;
+    }
+
+    return hash;
+}
+
+static uint64_t _hash_ptr(uint64_t ptr)
+{
+    return (ptr >> 4) * 0x9E3779B97F4A7C15ULL;
+}
+
+/* Return the site of the stack, adding it if needed, or null if the site
+ * table is full. Called with the lock held. */
+static oe_heap_profile_site_t* _find_site(
+    heap_profile_t* profile,
+    const uint64_t* frames,
+    uint64_t depth)
+{
+    uint64_t hash = _hash_stack(frames, depth);
+    uint64_t bucket = hash & (_SITE_BUCKETS - 1);
+    oe_heap_profile_site_t* site;
+
+    for (;; bucket = (bucket + 1) & (_SITE_BUCKETS - 1))
+    {
+        uint16_t index = profile->site_index[bucket];
+
+        if (!index)
+            break;
+
+        site = &profile->sites[index - 1];
+
+        if (profile->site_hashes[index - 1] == hash && site->depth == depth &&
+            oe_memcmp(site->frames, frames, depth * sizeof(uint64_t)) == 0)
+        {
+            return site;
+        }
+    }
+
+    if (profile->num_sites == OE_HEAP_PROFILE_MAX_SITES)
+        return NULL;
+
+    site = &profile->sites[profile->num_sites];
+    site->depth = depth;
+    oe_memcpy(site->frames, frames, depth * sizeof(uint64_t));
+    profile->site_hashes[profile->num_sites] = hash;
+    profile->site_index[bucket] = (uint16_t)++profile->num_sites;
+
+    return site;
+}
+
+bool oe_heap_profile_record_allocation(void* ptr, size_t size)
+{
+    uint64_t frames[OE_HEAP_PROFILE_MAX_DEPTH];
+    uint64_t depth = _capture_stack(frames);
+    oe_heap_profile_site_t* site;
+    uint64_t bucket;
+    bool recorded = false;
+
+    oe_spin_lock(&_lock);
+
+    if (!_profile || _profile->num_live >= _LIVE_BUCKETS / 4 * 3)
+        goto done;
+
+    if (!(site = _find_site(_profile, frames, depth)))
+        goto done;
+
+    bucket = _hash_ptr((uint64_t)ptr) & (_LIVE_BUCKETS - 1);
+
+    while (_profile->live[bucket].ptr)
+        bucket = (bucket + 1) & (_LIVE_BUCKETS - 1);
+
+    _profile->live[bucket].ptr = (uint64_t)ptr;
+    _profile->live[bucket].size = size;
+    _profile->live[bucket].site = (uint64_t)(site - _profile->sites);
+    _profile->num_live++;
+
+    site->alloc_count++;
+    site->alloc_bytes += size;
+    site->live_count++;
+    site->live_bytes += size;
+    recorded = true;
+
+done:
+    oe_spin_unlock(&_lock);
+    return recorded;
+}
+
+void oe_heap_profile_record_free(void* ptr)
+{
+    const uint64_t mask = _LIVE_BUCKETS - 1;
+    live_sample_t* live;
+    oe_heap_profile_site_t* site;
+    uint64_t hole;
+    uint64_t bucket;
+
+    oe_spin_lock(&_lock);
+
+    if (!_profile)
+        goto done;
+
+    live = _profile->live;
+    hole = _hash_ptr((uint64_t)ptr) & mask;
+
+    while (live[hole].ptr != (uint64_t)ptr)
+    {
+        if (!live[hole].ptr)
+            goto done;
+
+        hole = (hole + 1) & mask;
+    }
+
+    site = &_profile->sites[live[hole].site];
+    site->live_count--;
+    site->live_bytes -= live[hole].size;
+    _profile->num_live--;
+
+    /* Shift back the following samples that may not be found past the hole
+     * (deletion without tombstones) */
+    for (bucket = (hole + 1) & mask; live[bucket].ptr;
+         bucket = (bucket + 1) & mask)
+    {
+        uint64_t home = _hash_ptr(live[bucket].ptr) & mask;
+
+        /* Leave the sample if its home lies cyclically in (hole, bucket] */
+        if (hole <= bucket ? (hole < home && home <= bucket)
+                           : (hole < home || home <= bucket))
+            continue;
+
+        live[hole] = live[bucket];
+        hole = bucket;
+    }
+
+    live[hole].ptr = 0;
+
+done:
+    oe_spin_unlock(&_lock);
+}
+
+/*
+**==============================================================================
+**
+** Control
+**
+**==============================================================================
+*/
+
+oe_result_t oe_heap_profiler_start(size_t sample_interval)
+{
+#if defined(OE_USE_DEBUG_MALLOC)
+    OE_UNUSED(sample_interval);
+    return OE_UNSUPPORTED;
+#else
+    oe_result_t result = OE_UNEXPECTED;
+
+    if (!sample_interval)
+        sample_interval = OE_HEAP_PROFILE_DEFAULT_SAMPLE_INTERVAL;
+
+    oe_mutex_lock(&_start_mutex);
+
+    /* The profile is allocated while no allocation is sampled, since the
+     * allocator would otherwise record it with the lock held */
+    if (!_profile)
+    {
+        heap_profile_t* profile = oe_calloc(1, sizeof(heap_profile_t));
+
+        if (!profile)
+        {
+            result = OE_OUT_OF_MEMORY;
+            goto done;
+        }
+
+        oe_spin_lock(&_lock);
+        _profile = profile;
+        oe_spin_unlock(&_lock);
+    }
+
+    __atomic_store_n(&_sample_interval, sample_interval, __ATOMIC_RELAXED);
+    result = OE_OK;
+
+done:
+    oe_mutex_unlock(&_start_mutex);
+    return result;
+#endif
+}
+
+void oe_heap_profiler_stop(void)
+{
+    __atomic_store_n(&_sample_interval, 0, __ATOMIC_RELAXED);
+}
+
+uint64_t oe_handle_get_heap_profile(uint64_t arg_in)
+{
+    oe_get_heap_profile_args_t* host_args = (oe_get_heap_profile_args_t*)arg_in;
+    oe_get_heap_profile_args_t args;
+    uint64_t num_sites = 0;
+
+    if (!host_args || !oe_is_outside_enclave(host_args, sizeof(args)))
+        return OE_INVALID_PARAMETER;
+
+    /* Copy the arguments so that the host cannot change them after they are
+     * checked */
+    oe_memcpy(&args, host_args, sizeof(args));
+
+    oe_spin_lock(&_lock);
+
+    if (!_profile)
+    {
+        args.result = OE_NOT_FOUND;
+    }
+    else if (args.num_sites < _profile->num_sites)
+    {
+        args.result = OE_BUFFER_TOO_SMALL;
+        num_sites = _profile->num_sites;
+    }
+    else
+    {
+        size_t size = _profile->num_sites * sizeof(oe_heap_profile_site_t);
+
+        num_sites = _profile->num_sites;
+
+        if (size && !oe_is_outside_enclave(args.sites, size))
+        {
+            args.result = OE_INVALID_PARAMETER;
+        }
+        else
+        {
+            oe_memcpy(args.sites, _profile->sites, size);
+            args.result = OE_OK;
+        }
+    }
+
+    oe_spin_unlock(&_lock);
+
+    host_args->num_sites = num_sites;
+    host_args->sample_interval = _sample_interval;
+    host_args->result = args.result;
+
+    return OE_OK;
+}
@@ -0,0 +1,24 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#ifndef _OE_CORE_HEAPPROFILE_H
+#define _OE_CORE_HEAPPROFILE_H
+
+#include <openenclave/bits/types.h>
+
+// Count an allocation of the given size against the sample countdown of the
+// TCS. Return true if the allocation should be sampled.
+bool oe_heap_profile_sample(size_t size);
+
+// Record a sampled allocation with the call stack of the caller. Return true
+// if it was recorded, in which case oe_heap_profile_record_free() must be
+// called when it is freed.
+bool oe_heap_profile_record_allocation(void* ptr, size_t size);
+
+// Record that a recorded allocation is freed (before it is freed).
+void oe_heap_profile_record_free(void* ptr);
+
+// Handle OE_ECALL_GET_HEAP_PROFILE: copy the profile to the host.
+uint64_t oe_handle_get_heap_profile(uint64_t arg_in);
+
+#endif /* _OE_CORE_HEAPPROFILE_H */
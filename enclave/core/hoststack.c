@@ -4,7 +4,13 @@
 /*
  Host allocation for callouts
 
- Facilitate small and nested allocations of host memory. Data is organized in
+ Facilitate small and nested allocations of host memory. Allocations are first
+ made LIFO from the per-TCS host stack that the host reserves when it binds a
+ thread to the TCS. Its bounds and top are kept in the td_t (in enclave
+ memory), so the host cannot tamper with them and allocating never costs an
+ OCALL once the stack is known.
+
+ Allocations that do not fit fall back to buckets. Data is organized in
  buckets with embedded metadata, with one "active" bucket (to pull allocations
  from) and one "standby" bucket. "active" put to standby on underflow (i.e.,
  freeing from a different bucket than the "active").
@@ -13,8 +19,12 @@
 
 #include <openenclave/enclave.h>
 #include <openenclave/internal/atexit.h>
+#include <openenclave/internal/calls.h>
 #include <openenclave/internal/enclavelibc.h>
+#include <openenclave/internal/hostalloc.h>
+#include <openenclave/internal/sgxtypes.h>
 #include <openenclave/internal/thread.h>
+#include <openenclave/internal/utils.h>
 
 #ifndef MAX
 #define MAX(a, b) (((a) > (b)) ? (a) : (b))
@@ -93,7 +103,11 @@ void oe_free_thread_buckets(void* arg)
 
 static void _host_stack_init(void)
 {
-    if (oe_thread_key_create(&_host_stack_tls_key, oe_free_thread_buckets))
+    /* The buckets are kept across ECALLs on the same TCS */
+    if (oe_thread_key_create_ex(
+            &_host_stack_tls_key,
+            oe_free_thread_buckets,
+            OE_THREAD_KEY_TCS_LIFETIME))
     {
         oe_abort();
     }
@@ -169,6 +183,111 @@ static size_t _get_bucket_available_bytes(const Bucket* b)
     return b->size - b->base_free;
 }
 
+#if !defined(OE_HOST_STACK_BUCKETS_ONLY)
+
+typedef enum HostStackState {
+    HOST_STACK_UNKNOWN = 0,
+    HOST_STACK_AVAILABLE = 1,
+    HOST_STACK_UNAVAILABLE = 2,
+} HostStackState;
+
+// Alignment of allocations from the host stack
+static const size_t _host_stack_align = 16;
+
+// Return the td_t if its host stack is available, fetching it the first time
+static td_t* _get_host_stack(void)
+{
+    td_t* td = oe_get_td();
+    oe_get_host_stack_args_t* args;
+
+    if (td->host_stack_state == HOST_STACK_AVAILABLE)
+        return td;
+
+    if (td->host_stack_state == HOST_STACK_UNAVAILABLE)
+        return NULL;
+
+    // Mark unavailable first: the OCALL below allocates from the buckets.
+    td->host_stack_state = HOST_STACK_UNAVAILABLE;
+
+    if (!(args = oe_host_alloc_for_call_host(sizeof(*args))))
+        return NULL;
+
+    if (oe_ocall(OE_OCALL_GET_HOST_STACK, (uint64_t)args, NULL) == OE_OK)
+    {
+        const uint64_t base = (uint64_t)args->base;
+        const uint64_t size = args->size;
+
+        if (base && size && size <= OE_INT32_MAX &&
+            (base % _host_stack_align) == 0 &&
+            oe_is_outside_enclave((void*)base, size))
+        {
+            td->host_stack_base = base;
+            td->host_stack_size = size;
+            td->host_stack_used = 0;
+            td->host_stack_state = HOST_STACK_AVAILABLE;
+        }
+    }
+
+    oe_host_free_for_call_host(args);
+
+    return td->host_stack_state == HOST_STACK_AVAILABLE ? td : NULL;
+}
+
+static void* _host_stack_alloc(size_t size)
+{
+    td_t* td;
+    uint64_t offset;
+
+    if (!(td = _get_host_stack()))
+        return NULL;
+
+    offset = oe_round_up_to_multiple(td->host_stack_used, _host_stack_align);
+
+    if (offset > td->host_stack_size || size > td->host_stack_size - offset)
+        return NULL;
+
+    td->host_stack_used = offset + size;
+    return (void*)(td->host_stack_base + offset);
+}
+
+// Returns true if <p> was allocated from the host stack (and frees it)
+static bool _host_stack_free(void* p)
+{
+    td_t* td = oe_get_td();
+    const uint64_t addr = (uint64_t)p;
+
+    if (td->host_stack_state != HOST_STACK_AVAILABLE)
+        return false;
+
+    if (addr < td->host_stack_base ||
+        addr >= td->host_stack_base + td->host_stack_size)
+        return false;
+
+    // Frees must be in reverse order of allocation
+    if (addr - td->host_stack_base > td->host_stack_used)
+        oe_abort();
+
+    td->host_stack_used = addr - td->host_stack_base;
+    return true;
+}
+
+#else /* !defined(OE_HOST_STACK_BUCKETS_ONLY) */
+
+// Whitebox tests of the buckets (see tests/ocall-alloc) bypass the host stack
+static void* _host_stack_alloc(size_t size)
+{
+    OE_UNUSED(size);
+    return NULL;
+}
+
+static bool _host_stack_free(void* p)
+{
+    OE_UNUSED(p);
+    return false;
+}
+
+#endif /* !defined(OE_HOST_STACK_BUCKETS_ONLY) */
+
 void* oe_host_alloc_for_call_host(size_t size)
 {
     ThreadBuckets* tb; // deliberate non-init
@@ -177,6 +296,9 @@ void* oe_host_alloc_for_call_host(size_t size)
     if (!size || (size > OE_INT32_MAX))
         return NULL;
 
+    if ((ret_val = _host_stack_alloc(size)))
+        return ret_val;
+
     if ((tb = _get_thread_buckets()) == NULL)
         return NULL;
 
@@ -247,6 +369,9 @@ void oe_host_free_for_call_host(void* p)
     if (p == NULL)
         return;
 
+    if (_host_stack_free(p))
+        return;
+
     bucket_element = (BucketElement*)p - 1;
     if (_fetch_bucket_element(bucket_element, &e))
         oe_abort();
@@ -73,6 +73,11 @@ static void _check_memory_boundaries(void)
 
     if (!oe_is_within_enclave(__oe_get_heap_base(), __oe_get_heap_size()))
         oe_abort();
+
+    if (__oe_get_tls_image_size() > __oe_get_tls_block_size() ||
+        !oe_is_within_enclave(
+            __oe_get_tls_image_base(), __oe_get_tls_image_size()))
+        oe_abort();
 }
 
 /*
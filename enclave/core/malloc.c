@@ -10,6 +10,7 @@
 #include <openenclave/internal/raise.h>
 #include <openenclave/internal/thread.h>
 #include "debugmalloc.h"
+#include "heapprofile.h"
 
 #define HAVE_MMAP 0
 #define LACKS_UNISTD_H
@@ -59,6 +60,45 @@ static int _dlmalloc_stats_fprintf(FILE* stream, const char* format, ...);
 #define FREE dlfree
 #endif
 
+#if !defined(OE_USE_DEBUG_MALLOC)
+
+/* Allocations recorded by the heap profiler are marked with FLAG4_BIT (which
+ * dlmalloc leaves to extensions) in their chunk header, so that freeing an
+ * allocation that was not sampled only tests a bit. The bit is set and
+ * cleared with the dlmalloc lock held, since dlmalloc updates the header of
+ * an allocated chunk when its neighbors are allocated or freed. dlfree() and
+ * dlrealloc() drop the bit when they release the chunk. */
+static void _set_sampled(void* ptr, bool sampled)
+{
+    if (!PREACTION(gm))
+    {
+        mchunkptr chunk = mem2chunk(ptr);
+
+        if (sampled)
+            chunk->head |= FLAG4_BIT;
+        else
+            chunk->head &= ~FLAG4_BIT;
+
+        POSTACTION(gm);
+    }
+}
+
+static bool _is_sampled(void* ptr)
+{
+    return ptr && (mem2chunk(ptr)->head & FLAG4_BIT);
+}
+
+static void _sample_allocation(void* ptr, size_t size)
+{
+    if (ptr && oe_heap_profile_sample(size) &&
+        oe_heap_profile_record_allocation(ptr, size))
+    {
+        _set_sampled(ptr, true);
+    }
+}
+
+#endif /* !defined(OE_USE_DEBUG_MALLOC) */
+
 static oe_allocation_failure_callback_t _failure_callback;
 
 void oe_set_allocation_failure_callback(
@@ -71,6 +111,10 @@ void* oe_malloc(size_t size)
 {
     void* p = MALLOC(size);
 
+#if !defined(OE_USE_DEBUG_MALLOC)
+    _sample_allocation(p, size);
+#endif
+
     if (!p && size)
     {
         errno = ENOMEM;
@@ -84,6 +128,11 @@ void* oe_malloc(size_t size)
 
 void oe_free(void* ptr)
 {
+#if !defined(OE_USE_DEBUG_MALLOC)
+    if (_is_sampled(ptr))
+        oe_heap_profile_record_free(ptr);
+#endif
+
     FREE(ptr);
 }
 
@@ -91,6 +140,12 @@ void* oe_calloc(size_t nmemb, size_t size)
 {
     void* p = CALLOC(nmemb, size);
 
+#if !defined(OE_USE_DEBUG_MALLOC)
+    /* On success, nmemb * size does not overflow */
+    if (p)
+        _sample_allocation(p, nmemb * size);
+#endif
+
     if (!p && nmemb && size)
     {
         errno = ENOMEM;
@@ -104,8 +159,26 @@ void* oe_calloc(size_t nmemb, size_t size)
 
 void* oe_realloc(void* ptr, size_t size)
 {
+#if !defined(OE_USE_DEBUG_MALLOC)
+    bool sampled = _is_sampled(ptr);
+#endif
     void* p = REALLOC(ptr, size);
 
+#if !defined(OE_USE_DEBUG_MALLOC)
+    /* The old allocation is released unless realloc() failed. A block that
+     * was resized in place may keep its mark, so it is unmarked before it is
+     * sampled again as a new allocation. */
+    if (sampled && p)
+    {
+        oe_heap_profile_record_free(ptr);
+
+        if (p == ptr)
+            _set_sampled(p, false);
+    }
+
+    _sample_allocation(p, size);
+#endif
+
     if (!p && size)
     {
         errno = ENOMEM;
@@ -121,6 +194,11 @@ int oe_posix_memalign(void** memptr, size_t alignment, size_t size)
 {
     int rc = POSIX_MEMALIGN(memptr, alignment, size);
 
+#if !defined(OE_USE_DEBUG_MALLOC)
+    if (rc == 0)
+        _sample_allocation(*memptr, size);
+#endif
+
     if (rc != 0 && size)
     {
         errno = ENOMEM;
@@ -136,6 +214,10 @@ void* oe_memalign(size_t alignment, size_t size)
 {
     void* p = MEMALIGN(alignment, size);
 
+#if !defined(OE_USE_DEBUG_MALLOC)
+    _sample_allocation(p, size);
+#endif
+
     if (!p && size)
     {
         errno = ENOMEM;
@@ -0,0 +1,222 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#include "sharedbuf.h"
+#include <openenclave/enclave.h>
+#include <openenclave/internal/calls.h>
+#include <openenclave/internal/enclavelibc.h>
+#include <openenclave/internal/raise.h>
+#include <openenclave/internal/thread.h>
+#include <openenclave/internal/utils.h>
+
+/*
+**==============================================================================
+**
+** Shared buffer registry:
+**
+**     Host memory regions registered by oe_register_shared_buffer(). Each
+**     region is validated with oe_is_outside_enclave() once, when it is
+**     registered, so that checking a [shared] parameter or a view is a
+**     bounds check against this table.
+**
+**==============================================================================
+*/
+
+typedef struct _shared_buffer
+{
+    uint64_t start;
+    uint64_t end;
+} shared_buffer_t;
+
+static shared_buffer_t _buffers[OE_MAX_SHARED_BUFFERS];
+static size_t _num_buffers;
+static oe_spinlock_t _lock = OE_SPINLOCK_INITIALIZER;
+
+/* Copy the host arguments into enclave memory and validate them */
+static oe_result_t _get_args(uint64_t arg_in, shared_buffer_t* buffer)
+{
+    oe_result_t result = OE_UNEXPECTED;
+    oe_shared_buffer_args_t args;
+
+    if (!oe_is_outside_enclave((void*)arg_in, sizeof(args)))
+        OE_RAISE(OE_INVALID_PARAMETER);
+
+    args = *(oe_shared_buffer_args_t*)arg_in;
+
+    if (!args.buffer || !args.size ||
+        !oe_is_outside_enclave(args.buffer, args.size))
+    {
+        OE_RAISE(OE_INVALID_PARAMETER);
+    }
+
+    buffer->start = (uint64_t)args.buffer;
+    buffer->end = buffer->start + args.size;
+
+    result = OE_OK;
+
+done:
+    return result;
+}
+
+oe_result_t oe_handle_register_shared_buffer(uint64_t arg_in)
+{
+    oe_result_t result = OE_UNEXPECTED;
+    shared_buffer_t buffer;
+    bool locked = false;
+
+    OE_CHECK(_get_args(arg_in, &buffer));
+
+    oe_spin_lock(&_lock);
+    locked = true;
+
+    /* Reject regions that overlap an existing registration */
+    for (size_t i = 0; i < _num_buffers; i++)
+    {
+        if (buffer.start < _buffers[i].end && _buffers[i].start < buffer.end)
+            OE_RAISE(OE_INVALID_PARAMETER);
+    }
+
+    if (_num_buffers == OE_MAX_SHARED_BUFFERS)
+        OE_RAISE(OE_OUT_OF_MEMORY);
+
+    _buffers[_num_buffers++] = buffer;
+
+    result = OE_OK;
+
+done:
+
+    if (locked)
+        oe_spin_unlock(&_lock);
+
+    return result;
+}
+
+oe_result_t oe_handle_unregister_shared_buffer(uint64_t arg_in)
+{
+    oe_result_t result = OE_UNEXPECTED;
+    shared_buffer_t buffer;
+    bool locked = false;
+
+    OE_CHECK(_get_args(arg_in, &buffer));
+
+    oe_spin_lock(&_lock);
+    locked = true;
+
+    for (size_t i = 0; i < _num_buffers; i++)
+    {
+        if (_buffers[i].start == buffer.start && _buffers[i].end == buffer.end)
+        {
+            _buffers[i] = _buffers[--_num_buffers];
+            result = OE_OK;
+            goto done;
+        }
+    }
+
+    OE_RAISE(OE_NOT_FOUND);
+
+done:
+
+    if (locked)
+        oe_spin_unlock(&_lock);
+
+    return result;
+}
+
+bool oe_is_within_shared_buffer(const void* ptr, size_t size)
+{
+    const uint64_t start = (uint64_t)ptr;
+    const uint64_t end = start + (size == 0 ? 1 : size);
+    bool found = false;
+
+    /* Disallow null and check that the arithmetic does not wrap */
+    if (!start || end <= start)
+        return false;
+
+    oe_spin_lock(&_lock);
+    {
+        for (size_t i = 0; i < _num_buffers; i++)
+        {
+            if (start >= _buffers[i].start && end <= _buffers[i].end)
+            {
+                found = true;
+                break;
+            }
+        }
+    }
+    oe_spin_unlock(&_lock);
+
+    /* Registered regions are outside the enclave, but check again since it
+     * costs little and makes this function safe on its own */
+    return found && oe_is_outside_enclave(ptr, size);
+}
+
+oe_result_t oe_shared_buffer_view_init(
+    oe_shared_buffer_view_t* view,
+    const void* ptr,
+    size_t size)
+{
+    oe_result_t result = OE_UNEXPECTED;
+
+    if (view)
+    {
+        view->data = NULL;
+        view->size = 0;
+    }
+
+    if (!view || !oe_is_within_shared_buffer(ptr, size))
+        OE_RAISE(OE_INVALID_PARAMETER);
+
+    view->data = (const uint8_t*)ptr;
+    view->size = size;
+
+    result = OE_OK;
+
+done:
+    return result;
+}
+
+const void* oe_shared_buffer_view_at(
+    const oe_shared_buffer_view_t* view,
+    size_t offset,
+    size_t size)
+{
+    if (!view || !view->data || offset > view->size ||
+        size > view->size - offset)
+    {
+        return NULL;
+    }
+
+    return view->data + offset;
+}
+
+oe_result_t oe_shared_buffer_view_read(
+    const oe_shared_buffer_view_t* view,
+    size_t offset,
+    void* data,
+    size_t size)
+{
+    oe_result_t result = OE_UNEXPECTED;
+    const void* src;
+
+    if (!(src = oe_shared_buffer_view_at(view, offset, size)))
+        OE_RAISE(OE_INVALID_PARAMETER);
+
+    if (size == 0)
+    {
+        result = OE_OK;
+        goto done;
+    }
+
+    if (!data || !oe_is_within_enclave(data, size))
+        OE_RAISE(OE_INVALID_PARAMETER);
+
+    oe_memcpy(data, src, size);
+
+    /* Prevent speculative use of the copy before the bounds checks */
+    OE_ATOMIC_MEMORY_BARRIER_ACQUIRE();
+
+    result = OE_OK;
+
+done:
+    return result;
+}
@@ -0,0 +1,17 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#ifndef _OE_ENCLAVE_CORE_SHAREDBUF_H
+#define _OE_ENCLAVE_CORE_SHAREDBUF_H
+
+#include <openenclave/bits/result.h>
+#include <openenclave/bits/types.h>
+
+/* Maximum number of shared buffers the host may register at once */
+#define OE_MAX_SHARED_BUFFERS 16
+
+oe_result_t oe_handle_register_shared_buffer(uint64_t arg_in);
+
+oe_result_t oe_handle_unregister_shared_buffer(uint64_t arg_in);
+
+#endif /* _OE_ENCLAVE_CORE_SHAREDBUF_H */
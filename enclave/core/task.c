@@ -0,0 +1,564 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#include <openenclave/enclave.h>
+#include <openenclave/internal/enclavelibc.h>
+#include <openenclave/internal/fault.h>
+#include <openenclave/internal/sgxtypes.h>
+#include <openenclave/internal/task.h>
+#include <openenclave/internal/thread.h>
+#include "td.h"
+
+/*
+**==============================================================================
+**
+** Tasks:
+**
+**     A task is allocated when it is spawned and freed by the function that
+**     runs it. Its group counts it as pending from the spawn until it has
+**     run.
+**
+**==============================================================================
+*/
+
+typedef struct _task
+{
+    void (*run)(struct _task* task);
+    oe_task_group_t* group;
+} task_t;
+
+typedef struct _call_task
+{
+    task_t base;
+    void (*func)(void* arg);
+    void* arg;
+} call_task_t;
+
+typedef struct _range_task
+{
+    task_t base;
+    void (*body)(size_t begin, size_t end, void* arg);
+    void* arg;
+    size_t begin;
+    size_t end;
+    size_t grain;
+} range_task_t;
+
+static void _execute(task_t* task)
+{
+    oe_task_group_t* group = task->group;
+
+    task->run(task);
+    __atomic_sub_fetch(&group->pending, 1, __ATOMIC_RELEASE);
+}
+
+/*
+**==============================================================================
+**
+** Deques:
+**
+**     Chase-Lev work-stealing deques of fixed size. The owner pushes and
+**     pops tasks at the bottom; other threads steal them at the top. Deques
+**     are assigned to TCSs on first use and kept for the life of the enclave.
+**
+**==============================================================================
+*/
+
+#define DEQUE_MASK (OE_TASK_DEQUE_SIZE - 1)
+
+OE_STATIC_ASSERT((OE_TASK_DEQUE_SIZE & DEQUE_MASK) == 0);
+
+typedef struct _deque
+{
+    OE_ALIGNED(64) volatile int64_t top;
+    OE_ALIGNED(64) volatile int64_t bottom;
+    task_t* volatile tasks[OE_TASK_DEQUE_SIZE];
+} deque_t;
+
+static deque_t _deques[OE_SGX_MAX_TCS];
+static uint64_t _num_deques;
+
+/* Get the deque of the calling TCS (or null if none is left) */
+static deque_t* _get_deque(void)
+{
+    td_t* td = oe_get_td();
+    uint64_t index;
+
+    if (td->task_deque)
+        return &_deques[td->task_deque - 1];
+
+    index = __atomic_fetch_add(&_num_deques, 1, __ATOMIC_ACQ_REL);
+
+    if (index >= OE_COUNTOF(_deques))
+        return NULL;
+
+    td->task_deque = index + 1;
+    return &_deques[index];
+}
+
+static bool _deque_push(deque_t* deque, task_t* task)
+{
+    int64_t bottom = __atomic_load_n(&deque->bottom, __ATOMIC_RELAXED);
+    int64_t top = __atomic_load_n(&deque->top, __ATOMIC_ACQUIRE);
+
+    if (bottom - top >= OE_TASK_DEQUE_SIZE)
+        return false;
+
+    __atomic_store_n(
+        &deque->tasks[bottom & DEQUE_MASK], task, __ATOMIC_RELAXED);
+    __atomic_store_n(&deque->bottom, bottom + 1, __ATOMIC_RELEASE);
+
+    return true;
+}
+
+static task_t* _deque_pop(deque_t* deque)
+{
+    int64_t bottom = __atomic_load_n(&deque->bottom, __ATOMIC_RELAXED) - 1;
+    int64_t top;
+    task_t* task = NULL;
+
+    __atomic_store_n(&deque->bottom, bottom, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    top = __atomic_load_n(&deque->top, __ATOMIC_RELAXED);
+
+    if (top <= bottom)
+    {
+        task = __atomic_load_n(
+            &deque->tasks[bottom & DEQUE_MASK], __ATOMIC_RELAXED);
+
+        if (top == bottom)
+        {
+            /* The last task: race with thieves */
+            if (!__atomic_compare_exchange_n(
+                    &deque->top,
+                    &top,
+                    top + 1,
+                    false,
+                    __ATOMIC_SEQ_CST,
+                    __ATOMIC_RELAXED))
+            {
+                task = NULL;
+            }
+
+            __atomic_store_n(&deque->bottom, bottom + 1, __ATOMIC_RELAXED);
+        }
+    }
+    else
+    {
+        __atomic_store_n(&deque->bottom, bottom + 1, __ATOMIC_RELAXED);
+    }
+
+    return task;
+}
+
+static task_t* _deque_steal(deque_t* deque)
+{
+    int64_t top = __atomic_load_n(&deque->top, __ATOMIC_ACQUIRE);
+    int64_t bottom;
+    task_t* task;
+
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    bottom = __atomic_load_n(&deque->bottom, __ATOMIC_ACQUIRE);
+
+    if (top >= bottom)
+        return NULL;
+
+    task = __atomic_load_n(&deque->tasks[top & DEQUE_MASK], __ATOMIC_RELAXED);
+
+    if (!__atomic_compare_exchange_n(
+            &deque->top,
+            &top,
+            top + 1,
+            false,
+            __ATOMIC_SEQ_CST,
+            __ATOMIC_RELAXED))
+    {
+        return NULL;
+    }
+
+    return task;
+}
+
+/* Pop a task from the own deque or steal one from another deque */
+static task_t* _find_task(deque_t* self)
+{
+    size_t num_deques = __atomic_load_n(&_num_deques, __ATOMIC_ACQUIRE);
+    size_t start = self ? (size_t)(self - _deques) + 1 : 0;
+    task_t* task;
+
+    if (self && (task = _deque_pop(self)))
+        return task;
+
+    if (num_deques > OE_COUNTOF(_deques))
+        num_deques = OE_COUNTOF(_deques);
+
+    for (size_t i = 0; i < num_deques; i++)
+    {
+        deque_t* deque = &_deques[(start + i) % num_deques];
+
+        if (deque != self && (task = _deque_steal(deque)))
+            return task;
+    }
+
+    return NULL;
+}
+
+static bool _has_tasks(void)
+{
+    size_t num_deques = __atomic_load_n(&_num_deques, __ATOMIC_ACQUIRE);
+
+    if (num_deques > OE_COUNTOF(_deques))
+        num_deques = OE_COUNTOF(_deques);
+
+    for (size_t i = 0; i < num_deques; i++)
+    {
+        if (__atomic_load_n(&_deques[i].top, __ATOMIC_ACQUIRE) <
+            __atomic_load_n(&_deques[i].bottom, __ATOMIC_ACQUIRE))
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/*
+**==============================================================================
+**
+** Workers:
+**
+**     Idle workers try to steal for a while and then sleep on a condition
+**     variable. Threads that spawn a task signal it only when a worker is
+**     sleeping; the worker counts itself as sleeping before it checks the
+**     deques for the last time, so that no task is left unnoticed.
+**
+**==============================================================================
+*/
+
+/* Number of attempts to steal a task before sleeping */
+#define WORKER_SPIN_COUNT 128
+
+static struct
+{
+    oe_mutex_t mutex;
+    oe_cond_t cond;
+
+    /* Incremented (under the mutex) whenever sleeping workers are woken */
+    uint64_t epoch;
+    uint64_t num_sleeping;
+    bool stopping;
+
+    oe_thread_t workers[OE_SGX_MAX_TCS];
+    size_t num_workers;
+} _runtime = {.mutex = OE_MUTEX_INITIALIZER, .cond = OE_COND_INITIALIZER};
+
+/* Wake a sleeping worker after spawning a task */
+static void _notify_workers(void)
+{
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+
+    if (__atomic_load_n(&_runtime.num_sleeping, __ATOMIC_RELAXED) == 0)
+        return;
+
+    oe_mutex_lock(&_runtime.mutex);
+    _runtime.epoch++;
+    oe_cond_signal(&_runtime.cond);
+    oe_mutex_unlock(&_runtime.mutex);
+}
+
+/* Wait for tasks to be spawned; returns false when the worker must stop */
+static bool _sleep(void)
+{
+    bool stopping;
+
+    for (size_t i = 0; i < WORKER_SPIN_COUNT; i++)
+    {
+        if (_has_tasks())
+            return true;
+
+        oe_pause();
+    }
+
+    oe_mutex_lock(&_runtime.mutex);
+    {
+        uint64_t epoch = _runtime.epoch;
+
+        __atomic_add_fetch(&_runtime.num_sleeping, 1, __ATOMIC_SEQ_CST);
+
+        if (!_has_tasks())
+        {
+            while (epoch == _runtime.epoch && !_runtime.stopping)
+                oe_cond_wait(&_runtime.cond, &_runtime.mutex);
+        }
+
+        __atomic_sub_fetch(&_runtime.num_sleeping, 1, __ATOMIC_RELAXED);
+        stopping = _runtime.stopping;
+    }
+    oe_mutex_unlock(&_runtime.mutex);
+
+    return !stopping;
+}
+
+static void* _worker(void* arg)
+{
+    deque_t* self = _get_deque();
+
+    OE_UNUSED(arg);
+
+    for (;;)
+    {
+        task_t* task = _find_task(self);
+
+        if (task)
+            _execute(task);
+        else if (!_sleep())
+            break;
+    }
+
+    return NULL;
+}
+
+oe_result_t oe_task_runtime_start(size_t num_workers)
+{
+    oe_result_t result = OE_OK;
+
+    /* At least one TCS is left to the host */
+    if (num_workers == 0 || num_workers >= OE_SGX_MAX_TCS)
+        return OE_INVALID_PARAMETER;
+
+    oe_mutex_lock(&_runtime.mutex);
+
+    if (_runtime.num_workers == 0 && !_runtime.stopping)
+    {
+        while (_runtime.num_workers < num_workers)
+        {
+            oe_thread_t* worker = &_runtime.workers[_runtime.num_workers];
+
+            if (oe_thread_create(worker, _worker, NULL) != OE_OK)
+            {
+                result = OE_FAILURE;
+                break;
+            }
+
+            _runtime.num_workers++;
+        }
+    }
+
+    oe_mutex_unlock(&_runtime.mutex);
+
+    if (result != OE_OK)
+        oe_task_runtime_stop();
+
+    return result;
+}
+
+void oe_task_runtime_stop(void)
+{
+    size_t num_workers;
+
+    oe_mutex_lock(&_runtime.mutex);
+
+    if (_runtime.stopping)
+    {
+        oe_mutex_unlock(&_runtime.mutex);
+        return;
+    }
+
+    num_workers = _runtime.num_workers;
+    _runtime.stopping = true;
+    oe_cond_broadcast(&_runtime.cond);
+    oe_mutex_unlock(&_runtime.mutex);
+
+    for (size_t i = 0; i < num_workers; i++)
+        oe_thread_join(_runtime.workers[i], NULL);
+
+    oe_mutex_lock(&_runtime.mutex);
+    _runtime.num_workers = 0;
+    _runtime.stopping = false;
+    oe_mutex_unlock(&_runtime.mutex);
+}
+
+/*
+**==============================================================================
+**
+** Task groups:
+**
+**==============================================================================
+*/
+
+/* Maximum number of pauses between two polls of a task group */
+#define WAIT_MAX_BACKOFF 1024
+
+static void _spawn(oe_task_group_t* group, task_t* task)
+{
+    deque_t* deque = _get_deque();
+
+    task->group = group;
+    __atomic_add_fetch(&group->pending, 1, __ATOMIC_RELAXED);
+
+    if (!deque || !_deque_push(deque, task))
+    {
+        _execute(task);
+        return;
+    }
+
+    _notify_workers();
+}
+
+static void _run_call_task(task_t* task)
+{
+    call_task_t* call = (call_task_t*)task;
+    void (*func)(void*) = call->func;
+    void* arg = call->arg;
+
+    oe_free(call);
+    func(arg);
+}
+
+oe_result_t oe_task_group_run(
+    oe_task_group_t* group,
+    void (*func)(void* arg),
+    void* arg)
+{
+    call_task_t* call;
+
+    if (!group || !func)
+        return OE_INVALID_PARAMETER;
+
+    /* Without memory for the task, it runs now */
+    if (!(call = (call_task_t*)oe_malloc(sizeof(call_task_t))))
+    {
+        func(arg);
+        return OE_OK;
+    }
+
+    call->base.run = _run_call_task;
+    call->func = func;
+    call->arg = arg;
+    _spawn(group, &call->base);
+
+    return OE_OK;
+}
+
+oe_result_t oe_task_group_wait(oe_task_group_t* group)
+{
+    deque_t* self;
+    size_t backoff = 1;
+
+    if (!group)
+        return OE_INVALID_PARAMETER;
+
+    self = _get_deque();
+
+    while (__atomic_load_n(&group->pending, __ATOMIC_ACQUIRE) != 0)
+    {
+        task_t* task = _find_task(self);
+
+        if (task)
+        {
+            _execute(task);
+            backoff = 1;
+            continue;
+        }
+
+        /* The remaining tasks run on other threads: poll less and less
+         * often, to leave the memory bus and the hyperthread to them */
+        for (size_t i = 0; i < backoff; i++)
+            oe_pause();
+
+        if (backoff < WAIT_MAX_BACKOFF)
+            backoff *= 2;
+    }
+
+    return OE_OK;
+}
+
+/*
+**==============================================================================
+**
+** oe_parallel_for()
+**
+**==============================================================================
+*/
+
+/* Number of subranges per thread when the grain is not given */
+#define PARALLEL_FOR_SPLITS 8
+
+static void _run_range_task(task_t* task);
+
+/* Spawn the upper halves of the range until it fits the grain, then process
+ * the rest on this thread */
+static void _run_range(
+    oe_task_group_t* group,
+    void (*body)(size_t begin, size_t end, void* arg),
+    void* arg,
+    size_t begin,
+    size_t end,
+    size_t grain)
+{
+    while (end - begin > grain)
+    {
+        size_t middle = begin + (end - begin) / 2;
+        range_task_t* range;
+
+        if (!(range = (range_task_t*)oe_malloc(sizeof(range_task_t))))
+            break;
+
+        range->base.run = _run_range_task;
+        range->body = body;
+        range->arg = arg;
+        range->begin = middle;
+        range->end = end;
+        range->grain = grain;
+        _spawn(group, &range->base);
+
+        end = middle;
+    }
+
+    body(begin, end, arg);
+}
+
+static void _run_range_task(task_t* task)
+{
+    range_task_t range = *(range_task_t*)task;
+
+    oe_free(task);
+    _run_range(
+        range.base.group,
+        range.body,
+        range.arg,
+        range.begin,
+        range.end,
+        range.grain);
+}
+
+oe_result_t oe_parallel_for(
+    size_t begin,
+    size_t end,
+    size_t grain,
+    void (*body)(size_t begin, size_t end, void* arg),
+    void* arg)
+{
+    oe_task_group_t group = OE_TASK_GROUP_INITIALIZER;
+
+    if (!body || begin > end)
+        return OE_INVALID_PARAMETER;
+
+    if (begin == end)
+        return OE_OK;
+
+    if (grain == 0)
+    {
+        size_t num_threads =
+            __atomic_load_n(&_runtime.num_workers, __ATOMIC_RELAXED) + 1;
+
+        grain = (end - begin) / (num_threads * PARALLEL_FOR_SPLITS);
+
+        if (grain == 0)
+            grain = 1;
+    }
+
+    _run_range(&group, body, arg, begin, end, grain);
+
+    return oe_task_group_wait(&group);
+}
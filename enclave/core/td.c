@@ -206,12 +206,59 @@ bool td_initialized(td_t* td)
 **         +-------------------------+
 **         | GS page (contains td_t) |
 **         +-------------------------+
+**         | TSD page                |
+**         +-------------------------+
+**         | TLS block pages         | (only if the image has TLS)
+**         +-------------------------+
+**         | FS page (TCB)           | (only if the image has TLS)
+**         +-------------------------+
 **
 **     Note: the host register fields are pre-initialized by oe_enter:
 **
 **==============================================================================
 */
 
+/*
+**==============================================================================
+**
+** _init_tls()
+**
+**     Initialize the static TLS block of the thread from the TLS image (the
+**     .tdata and .tbss sections). As in the x86-64 TLS ABI, the block ends
+**     at the thread pointer, which is the address of the thread control
+**     block (TCB) in the FS page. Offset zero of the TCB holds the thread
+**     pointer itself. Like the TSD page, the block lives as long as the TCS,
+**     so it is only initialized the first time the TCS is entered, after the
+**     relocations of the TLS image have been applied.
+**
+**==============================================================================
+*/
+
+static void _init_tls(td_t* td)
+{
+    size_t block_size = __oe_get_tls_block_size();
+    size_t image_size = __oe_get_tls_image_size();
+    uint64_t* tcb;
+    uint8_t* block;
+
+    /* If the image has no TLS */
+    if (!block_size)
+        return;
+
+    tcb = (uint64_t*)((uint8_t*)td + (2 * OE_PAGE_SIZE) +
+                      oe_round_up_to_multiple(block_size, OE_PAGE_SIZE));
+
+    /* If already initialized */
+    if (*tcb == (uint64_t)tcb)
+        return;
+
+    block = (uint8_t*)tcb - block_size;
+    oe_memcpy(block, __oe_get_tls_image_base(), image_size);
+    oe_memset(block + image_size, 0, block_size - image_size);
+
+    *tcb = (uint64_t)tcb;
+}
+
 void td_init(td_t* td)
 {
     /* If not already initialized */
@@ -234,6 +281,13 @@ void td_init(td_t* td)
 
         /* List of callsites is initially empty */
         td->callsites = NULL;
+
+        /* Allocations from the host stack do not outlive the outermost
+         * ECALL, even if an ECALL failed before releasing them */
+        td->host_stack_used = 0;
+
+        /* Initialize the static TLS block (once per TCS) */
+        _init_tls(td);
     }
 }
 
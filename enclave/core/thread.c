@@ -6,6 +6,7 @@
 #include <openenclave/enclave.h>
 #include <openenclave/internal/calls.h>
 #include <openenclave/internal/enclavelibc.h>
+#include <openenclave/internal/fault.h>
 #include <openenclave/internal/hostalloc.h>
 #include <openenclave/internal/raise.h>
 #include <openenclave/internal/sgxtypes.h>
@@ -62,6 +63,41 @@ done:
     return ret;
 }
 
+static int _thread_wake_tcs(const void* tcs)
+{
+    if (oe_ocall(OE_OCALL_THREAD_WAKE, (uint64_t)tcs, NULL) != OE_OK)
+        return -1;
+
+    return 0;
+}
+
+static int _thread_wake_multiple(const void* tcs[], size_t num_tcs)
+{
+    int ret = -1;
+    oe_thread_wake_multiple_args_t* args = NULL;
+
+    if (num_tcs > OE_THREAD_WAKE_MULTIPLE_MAX)
+        goto done;
+
+    if (!(args = oe_host_alloc_for_call_host(
+              sizeof(oe_thread_wake_multiple_args_t))))
+        goto done;
+
+    args->num_tcs = num_tcs;
+
+    for (size_t i = 0; i < num_tcs; i++)
+        args->tcs[i] = tcs[i];
+
+    if (oe_ocall(OE_OCALL_THREAD_WAKE_MULTIPLE, (uint64_t)args, NULL) != OE_OK)
+        goto done;
+
+    ret = 0;
+
+done:
+    oe_host_free_for_call_host(args);
+    return ret;
+}
+
 /*
 **==============================================================================
 **
@@ -131,6 +167,12 @@ static __inline__ bool _queue_empty(Queue* queue)
 
 oe_thread_t oe_thread_self(void)
 {
+    td_t* td = oe_get_td();
+
+    /* Threads created by oe_thread_create() are identified by their handle */
+    if (td && td->created_thread)
+        return (oe_thread_t)td->created_thread;
+
     return (oe_thread_t)oe_get_thread_data();
 }
 
@@ -139,6 +181,271 @@ bool oe_thread_equal(oe_thread_t thread1, oe_thread_t thread2)
     return thread1 == thread2;
 }
 
+/*
+**==============================================================================
+**
+** oe_thread_create()
+**
+**     A created thread is described by a record in enclave memory, whose
+**     address is the thread handle. The record is posted to the host with
+**     OE_OCALL_THREAD_CREATE; a host thread then enters the enclave on a free
+**     TCS with OE_ECALL_THREAD_START and runs the start routine. Records wait
+**     on the pending list until then, so that the host can only start threads
+**     that were created, and each of them only once.
+**
+**     The record is referenced by the creator (until it joins or detaches the
+**     thread) and by the thread (until it returns), and freed by the last of
+**     them. A joiner waits on its own TCS and is woken by the thread.
+**
+**==============================================================================
+*/
+
+#define THREAD_MAGIC 0x5c1d8e9a2f4b7306
+
+typedef struct _oe_thread_impl
+{
+    uint64_t magic;
+    void* (*start_routine)(void*);
+    void* arg;
+    void* retval;
+
+    /* Lock used to synchronize the fields below */
+    oe_spinlock_t lock;
+    bool done;
+    bool detached;
+    bool joined;
+    oe_thread_data_t* joiner;
+    uint32_t refs;
+
+    /* Next record on the pending list */
+    struct _oe_thread_impl* next;
+} oe_thread_impl_t;
+
+static oe_spinlock_t _pending_threads_lock = OE_SPINLOCK_INITIALIZER;
+static oe_thread_impl_t* _pending_threads;
+
+/* Remove the record from the pending list if it is there */
+static bool _remove_pending_thread(oe_thread_impl_t* thread)
+{
+    bool found = false;
+
+    oe_spin_lock(&_pending_threads_lock);
+    {
+        oe_thread_impl_t** p = &_pending_threads;
+
+        /* The record is not accessed before it is found on the list */
+        for (; *p; p = &(*p)->next)
+        {
+            if (*p == thread)
+            {
+                *p = thread->next;
+                thread->next = NULL;
+                found = true;
+                break;
+            }
+        }
+    }
+    oe_spin_unlock(&_pending_threads_lock);
+
+    return found;
+}
+
+static oe_thread_impl_t* _get_thread_impl(oe_thread_t thread)
+{
+    oe_thread_impl_t* impl = (oe_thread_impl_t*)thread;
+
+    if (!impl || !oe_is_within_enclave(impl, sizeof(oe_thread_impl_t)) ||
+        impl->magic != THREAD_MAGIC)
+    {
+        return NULL;
+    }
+
+    return impl;
+}
+
+/* Drop a reference to the record (called with its lock held) */
+static void _release_thread_impl(oe_thread_impl_t* impl)
+{
+    if (--impl->refs == 0)
+    {
+        oe_spin_unlock(&impl->lock);
+        impl->magic = 0;
+        oe_free(impl);
+        return;
+    }
+
+    oe_spin_unlock(&impl->lock);
+}
+
+oe_result_t oe_thread_create(
+    oe_thread_t* thread,
+    void* (*start_routine)(void*),
+    void* arg)
+{
+    oe_result_t result = OE_UNEXPECTED;
+    oe_thread_impl_t* impl = NULL;
+
+    if (!thread || !start_routine)
+        OE_RAISE(OE_INVALID_PARAMETER);
+
+    if (!(impl = (oe_thread_impl_t*)oe_calloc(1, sizeof(oe_thread_impl_t))))
+        OE_RAISE(OE_OUT_OF_MEMORY);
+
+    impl->magic = THREAD_MAGIC;
+    impl->start_routine = start_routine;
+    impl->arg = arg;
+    impl->lock = OE_SPINLOCK_INITIALIZER;
+    impl->refs = 2;
+
+    oe_spin_lock(&_pending_threads_lock);
+    impl->next = _pending_threads;
+    _pending_threads = impl;
+    oe_spin_unlock(&_pending_threads_lock);
+
+    /* The thread may start (and return) before the OCALL returns */
+    *thread = (oe_thread_t)impl;
+
+    if (oe_ocall(OE_OCALL_THREAD_CREATE, (uint64_t)impl, NULL) != OE_OK)
+    {
+        /* Unless the host started the thread anyway */
+        if (_remove_pending_thread(impl))
+        {
+            *thread = 0;
+            OE_RAISE(OE_FAILURE);
+        }
+    }
+
+    impl = NULL;
+    result = OE_OK;
+
+done:
+
+    if (impl)
+    {
+        impl->magic = 0;
+        oe_free(impl);
+    }
+
+    return result;
+}
+
+oe_result_t oe_thread_join(oe_thread_t thread, void** retval)
+{
+    oe_thread_impl_t* impl;
+    oe_thread_data_t* self = oe_get_thread_data();
+    void* value;
+
+    if (!(impl = _get_thread_impl(thread)) || thread == oe_thread_self())
+        return OE_INVALID_PARAMETER;
+
+    oe_spin_lock(&impl->lock);
+
+    if (impl->detached || impl->joined)
+    {
+        oe_spin_unlock(&impl->lock);
+        return OE_INVALID_PARAMETER;
+    }
+
+    impl->joined = true;
+
+    while (!impl->done)
+    {
+        impl->joiner = self;
+        oe_spin_unlock(&impl->lock);
+        _thread_wait(self);
+        oe_spin_lock(&impl->lock);
+    }
+
+    impl->joiner = NULL;
+    value = impl->retval;
+    _release_thread_impl(impl);
+
+    if (retval)
+        *retval = value;
+
+    return OE_OK;
+}
+
+oe_result_t oe_thread_detach(oe_thread_t thread)
+{
+    oe_thread_impl_t* impl;
+
+    if (!(impl = _get_thread_impl(thread)))
+        return OE_INVALID_PARAMETER;
+
+    oe_spin_lock(&impl->lock);
+
+    if (impl->detached || impl->joined)
+    {
+        oe_spin_unlock(&impl->lock);
+        return OE_INVALID_PARAMETER;
+    }
+
+    impl->detached = true;
+    _release_thread_impl(impl);
+
+    return OE_OK;
+}
+
+uint64_t oe_handle_thread_start(uint64_t arg_in)
+{
+    oe_thread_impl_t* impl = (oe_thread_impl_t*)arg_in;
+    td_t* td = oe_get_td();
+    oe_thread_data_t* joiner;
+    void* retval;
+
+    /* Only threads created by oe_thread_create() are started, once */
+    if (!_remove_pending_thread(impl))
+        return OE_INVALID_PARAMETER;
+
+    td->created_thread = (uint64_t)impl;
+    retval = impl->start_routine(impl->arg);
+
+    /* The thread-specific data of the thread is destroyed before it may be
+     * joined */
+    oe_thread_destruct_specific();
+    td->created_thread = 0;
+
+    oe_spin_lock(&impl->lock);
+    impl->retval = retval;
+    impl->done = true;
+    joiner = impl->joiner;
+    _release_thread_impl(impl);
+
+    if (joiner)
+        _thread_wake(joiner);
+
+    return OE_OK;
+}
+
+void oe_thread_cancel_pending(void)
+{
+    oe_thread_impl_t* pending;
+
+    oe_spin_lock(&_pending_threads_lock);
+    pending = _pending_threads;
+    _pending_threads = NULL;
+    oe_spin_unlock(&_pending_threads_lock);
+
+    while (pending)
+    {
+        oe_thread_impl_t* impl = pending;
+        oe_thread_data_t* joiner;
+
+        pending = impl->next;
+        impl->next = NULL;
+
+        oe_spin_lock(&impl->lock);
+        impl->retval = NULL;
+        impl->done = true;
+        joiner = impl->joiner;
+        _release_thread_impl(impl);
+
+        if (joiner)
+            _thread_wake(joiner);
+    }
+}
+
 /*
 **==============================================================================
 **
@@ -512,61 +819,387 @@ oe_result_t oe_cond_broadcast(oe_cond_t* condition)
 **
 ** oe_rwlock_t
 **
+**     Readers normally take the lock without writing to it: a reader marks
+**     the lock as read by its TCS in one of the td_t.rwlock_readers slots of
+**     the TCS, so read-mostly locks shared by many TCSs do not bounce a cache
+**     line between them. This is allowed while the lock is read-biased. A
+**     writer revokes the bias and then waits for the slots of all TCSs to
+**     drop the lock before it proceeds.
+**
+**     Readers that find the bias revoked, or whose slot is in use by another
+**     lock, fall back to the reader count, which is protected by a spinlock.
+**     These readers restore the bias after OE_RWLOCK_BIAS_INHIBIT of them
+**     acquired the lock without contention from writers, so that locks that
+**     are often written stay on the reader count.
+**
+**     Waiting threads are queued in nodes on their own stacks. A releasing
+**     thread wakes either the first waiting writer or all the waiting
+**     readers, with one OCALL for all of them. A writer spins for a while
+**     on the slots of the TCSs and then waits in the queue too: once the
+**     bias is revoked, readers that release the lock through their slots
+**     wake the queue.
+**
 **==============================================================================
 */
 
+#define OE_RWLOCK_READER_SLOTS OE_COUNTOF(((td_t*)0)->rwlock_readers)
+#define OE_RWLOCK_BIAS_INHIBIT 256
+#define OE_RWLOCK_WRITER_SPIN_COUNT 1024
+
+/* A thread waiting on a readers-writer lock (on the stack of the thread) */
+typedef struct _oe_rwlock_waiter
+{
+    oe_thread_data_t* thread;
+    struct _oe_rwlock_waiter* next;
+    bool queued;
+    bool writer;
+} oe_rwlock_waiter_t;
+
 /* Internal readers-writer lock variable implementation. */
 typedef struct _oe_rwlock_impl
 {
     /* Spinlock for synchronizing readers and writers.*/
     oe_spinlock_t lock;
 
-    /* Number of reader threads owning this lock. */
+    /* Number of reader threads owning this lock through the reader count */
     uint32_t readers;
 
     /* The writer thread that currently owns this lock.*/
     oe_thread_data_t* writer;
 
     /* Queue of threads waiting on this variable. */
-    Queue queue;
+    oe_rwlock_waiter_t* front;
+    oe_rwlock_waiter_t* back;
+
+    /* Readers may take the lock through the slots of their TCS */
+    volatile uint8_t read_bias;
 
+    /* Flags given to oe_rwlock_init_ex() */
+    uint8_t flags;
+
+    /* Number of writers waiting on this variable */
+    uint16_t writers_waiting;
+
+    /* Number of contention-free readers until the bias is restored */
+    uint32_t bias_inhibit;
 } oe_rwlock_impl_t;
 
 OE_STATIC_ASSERT(sizeof(oe_rwlock_impl_t) <= sizeof(oe_rwlock_t));
 
-oe_result_t oe_rwlock_init(oe_rwlock_t* read_write_lock)
+/* TCSs that have taken a read lock through their slots */
+static td_t* _reader_tds[OE_SGX_MAX_TCS];
+static size_t _num_reader_tds;
+static oe_spinlock_t _reader_tds_lock = OE_SPINLOCK_INITIALIZER;
+
+static volatile uint64_t* _get_reader_slot(
+    td_t* td,
+    const oe_rwlock_impl_t* rw_lock)
+{
+    uint64_t addr = (uint64_t)rw_lock;
+    size_t index = ((addr >> 3) ^ (addr >> 11)) % OE_RWLOCK_READER_SLOTS;
+
+    return (volatile uint64_t*)&td->rwlock_readers[index];
+}
+
+/* Record a TCS that takes read locks through its slots (once per TCS) */
+static bool _register_reader_td(td_t* td)
+{
+    if (__atomic_load_n(&td->rwlock_registered, __ATOMIC_ACQUIRE))
+        return true;
+
+    oe_spin_lock(&_reader_tds_lock);
+    {
+        if (!td->rwlock_registered &&
+            _num_reader_tds < OE_COUNTOF(_reader_tds))
+        {
+            _reader_tds[_num_reader_tds] = td;
+            __atomic_store_n(
+                &_num_reader_tds, _num_reader_tds + 1, __ATOMIC_RELEASE);
+            __atomic_store_n(&td->rwlock_registered, 1, __ATOMIC_RELEASE);
+        }
+    }
+    oe_spin_unlock(&_reader_tds_lock);
+
+    return td->rwlock_registered != 0;
+}
+
+static oe_result_t _wake_waiters(oe_rwlock_impl_t* rw_lock);
+
+/* Wake the threads waiting on the lock after a slot of the current TCS was
+ * released, if the bias was revoked: a writer that revoked it may be waiting
+ * for the slots to be released */
+static oe_result_t _wake_slot_waiters(oe_rwlock_impl_t* rw_lock)
+{
+    // Pairs with the revocation of the bias by writers.
+    if (__atomic_load_n(&rw_lock->read_bias, __ATOMIC_SEQ_CST))
+        return OE_OK;
+
+    oe_spin_lock(&rw_lock->lock);
+
+    if (rw_lock->front && rw_lock->readers == 0 && !rw_lock->writer)
+        return _wake_waiters(rw_lock);
+
+    oe_spin_unlock(&rw_lock->lock);
+
+    return OE_OK;
+}
+
+/* Try to take a read lock through the slot of the current TCS */
+static bool _try_fast_rdlock(oe_rwlock_impl_t* rw_lock, td_t* td)
+{
+    volatile uint64_t* slot;
+    uint64_t expected = 0;
+
+    if (!__atomic_load_n(&rw_lock->read_bias, __ATOMIC_RELAXED))
+        return false;
+
+    if (!_register_reader_td(td))
+        return false;
+
+    slot = _get_reader_slot(td, rw_lock);
+
+    if (!__atomic_compare_exchange_n(
+            slot,
+            &expected,
+            (uint64_t)rw_lock,
+            false,
+            __ATOMIC_SEQ_CST,
+            __ATOMIC_RELAXED))
+    {
+        return false;
+    }
+
+    /* Pairs with the revocation of the bias by writers */
+    if (__atomic_load_n(&rw_lock->read_bias, __ATOMIC_SEQ_CST))
+        return true;
+
+    /* A writer that saw the slot may already wait for it to be released */
+    __atomic_store_n(slot, 0, __ATOMIC_SEQ_CST);
+    _wake_slot_waiters(rw_lock);
+    return false;
+}
+
+/* Release a read lock taken through the slot of the current TCS */
+static bool _try_fast_rdunlock(oe_rwlock_impl_t* rw_lock, td_t* td)
+{
+    volatile uint64_t* slot = _get_reader_slot(td, rw_lock);
+
+    if (__atomic_load_n(slot, __ATOMIC_RELAXED) != (uint64_t)rw_lock)
+        return false;
+
+    /* Sequentially consistent, so that either this reader sees the bias
+     * revoked or the writer that revoked it sees the slot released */
+    __atomic_store_n(slot, 0, __ATOMIC_SEQ_CST);
+    return true;
+}
+
+/* Whether any TCS holds a read lock through its slots */
+static bool _has_fast_readers(oe_rwlock_impl_t* rw_lock)
+{
+    size_t num_tds = __atomic_load_n(&_num_reader_tds, __ATOMIC_SEQ_CST);
+
+    for (size_t i = 0; i < num_tds; i++)
+    {
+        volatile uint64_t* slot = _get_reader_slot(_reader_tds[i], rw_lock);
+
+        /* Pairs with the release of the slots by readers */
+        if (__atomic_load_n(slot, __ATOMIC_SEQ_CST) == (uint64_t)rw_lock)
+            return true;
+    }
+
+    return false;
+}
+
+/* Revoke the read bias (called with the spinlock held) */
+static void _revoke_read_bias(oe_rwlock_impl_t* rw_lock)
+{
+    if (rw_lock->read_bias)
+    {
+        __atomic_store_n(&rw_lock->read_bias, 0, __ATOMIC_SEQ_CST);
+        rw_lock->bias_inhibit = OE_RWLOCK_BIAS_INHIBIT;
+    }
+}
+
+/* Account for a reader that acquired the lock through the reader count and
+ * restore the read bias if writers left the lock alone for long enough
+ * (called with the spinlock held) */
+static void _add_slow_reader(oe_rwlock_impl_t* rw_lock)
+{
+    rw_lock->readers++;
+
+    if (!rw_lock->read_bias && rw_lock->writers_waiting == 0)
+    {
+        if (rw_lock->bias_inhibit)
+            rw_lock->bias_inhibit--;
+        else
+            __atomic_store_n(&rw_lock->read_bias, 1, __ATOMIC_RELEASE);
+    }
+}
+
+static bool _reader_must_wait(oe_rwlock_impl_t* rw_lock)
+{
+    if (rw_lock->writer)
+        return true;
+
+    return (rw_lock->flags & OE_RWLOCK_PREFER_WRITER) &&
+           rw_lock->writers_waiting > 0;
+}
+
+static void _queue_waiter(
+    oe_rwlock_impl_t* rw_lock,
+    oe_rwlock_waiter_t* waiter)
+{
+    /* Already queued if woken spuriously */
+    if (waiter->queued)
+        return;
+
+    waiter->queued = true;
+    waiter->next = NULL;
+
+    if (rw_lock->back)
+        rw_lock->back->next = waiter;
+    else
+        rw_lock->front = waiter;
+
+    rw_lock->back = waiter;
+}
+
+/* Remove a waiter that acquires the lock while still queued, after a wake
+ * that was not meant for it, before its node goes out of scope */
+static void _unqueue_waiter(
+    oe_rwlock_impl_t* rw_lock,
+    oe_rwlock_waiter_t* waiter)
+{
+    oe_rwlock_waiter_t* prev = NULL;
+    oe_rwlock_waiter_t* p = rw_lock->front;
+
+    if (!waiter->queued)
+        return;
+
+    for (; p && p != waiter; prev = p, p = p->next)
+        ;
+
+    if (p)
+    {
+        if (prev)
+            prev->next = p->next;
+        else
+            rw_lock->front = p->next;
+
+        if (rw_lock->back == p)
+            rw_lock->back = prev;
+    }
+
+    waiter->queued = false;
+}
+
+// The current thread must hold the spinlock.
+// _wake_waiters releases ownership of the spinlock.
+static oe_result_t _wake_waiters(oe_rwlock_impl_t* rw_lock)
+{
+    const void* tcs[OE_THREAD_WAKE_MULTIPLE_MAX];
+    size_t num_tcs = 0;
+    oe_rwlock_waiter_t* prev = NULL;
+    oe_rwlock_waiter_t* p = rw_lock->front;
+    oe_rwlock_waiter_t* writer = NULL;
+
+    // Prefer the first writer if the front of the queue is a writer or if
+    // writers are preferred. Wake all the readers otherwise.
+    if (p && (p->writer || (rw_lock->flags & OE_RWLOCK_PREFER_WRITER)))
+    {
+        for (; p && !p->writer; prev = p, p = p->next)
+            ;
+
+        writer = p;
+        p = rw_lock->front;
+        prev = NULL;
+    }
+
+    // Unlink the threads to wake. A woken thread leaves the queue, so it
+    // queues itself again if it cannot acquire the lock.
+    while (p && num_tcs < OE_COUNTOF(tcs))
+    {
+        oe_rwlock_waiter_t* next = p->next;
+
+        if (writer ? p == writer : !p->writer)
+        {
+            if (prev)
+                prev->next = next;
+            else
+                rw_lock->front = next;
+
+            if (rw_lock->back == p)
+                rw_lock->back = prev;
+
+            tcs[num_tcs++] = td_to_tcs((td_t*)p->thread);
+
+            // The waiter may return once this is cleared.
+            p->queued = false;
+
+            if (writer)
+                break;
+        }
+        else
+        {
+            prev = p;
+        }
+
+        p = next;
+    }
+
+    // Release the lock and wake up the waiters. This allows waiter that is
+    // woken up to immediately acquire the spinlock and subsequently, the
+    // ownership of the rw_lock.
+    oe_spin_unlock(&rw_lock->lock);
+
+    if (num_tcs == 1)
+        return _thread_wake_tcs(tcs[0]) == 0 ? OE_OK : OE_FAILURE;
+
+    if (num_tcs > 1)
+        return _thread_wake_multiple(tcs, num_tcs) == 0 ? OE_OK : OE_FAILURE;
+
+    return OE_OK;
+}
+
+oe_result_t oe_rwlock_init_ex(oe_rwlock_t* read_write_lock, uint32_t flags)
 {
     oe_rwlock_impl_t* rw_lock = (oe_rwlock_impl_t*)read_write_lock;
-    oe_result_t result = OE_UNEXPECTED;
 
-    if (!rw_lock)
+    if (!rw_lock || (flags & ~OE_RWLOCK_PREFER_WRITER))
         return OE_INVALID_PARAMETER;
 
     oe_memset(rw_lock, 0, sizeof(oe_rwlock_t));
     rw_lock->lock = OE_SPINLOCK_INITIALIZER;
+    rw_lock->flags = (uint8_t)flags;
 
-    result = OE_OK;
+    return OE_OK;
+}
 
-    return result;
+oe_result_t oe_rwlock_init(oe_rwlock_t* read_write_lock)
+{
+    return oe_rwlock_init_ex(read_write_lock, 0);
 }
 
 oe_result_t oe_rwlock_rdlock(oe_rwlock_t* read_write_lock)
 {
     oe_rwlock_impl_t* rw_lock = (oe_rwlock_impl_t*)read_write_lock;
     oe_thread_data_t* self = oe_get_thread_data();
+    oe_rwlock_waiter_t waiter = {self, NULL, false, false};
 
     if (!rw_lock)
         return OE_INVALID_PARAMETER;
 
+    if (_try_fast_rdlock(rw_lock, (td_t*)self))
+        return OE_OK;
+
     oe_spin_lock(&rw_lock->lock);
 
     // Wait for writer to finish.
     // Multiple readers can concurrently operate.
-    while (rw_lock->writer != NULL)
+    while (_reader_must_wait(rw_lock))
     {
         // Add self to list of waiters, and go to wait state.
-        if (!_queue_contains(&rw_lock->queue, self))
-            _queue_push_back(&rw_lock->queue, self);
+        _queue_waiter(rw_lock, &waiter);
 
         oe_spin_unlock(&rw_lock->lock);
         _thread_wait(self);
@@ -576,8 +1209,10 @@ oe_result_t oe_rwlock_rdlock(oe_rwlock_t* read_write_lock)
         oe_spin_lock(&rw_lock->lock);
     }
 
+    _unqueue_waiter(rw_lock, &waiter);
+
     // Increment number of readers.
-    rw_lock->readers++;
+    _add_slow_reader(rw_lock);
 
     oe_spin_unlock(&rw_lock->lock);
 
@@ -591,14 +1226,17 @@ oe_result_t oe_rwlock_tryrdlock(oe_rwlock_t* read_write_lock)
     if (!rw_lock)
         return OE_INVALID_PARAMETER;
 
+    if (_try_fast_rdlock(rw_lock, (td_t*)oe_get_thread_data()))
+        return OE_OK;
+
     oe_spin_lock(&rw_lock->lock);
 
     oe_result_t result = OE_BUSY;
 
     // If no writer is active, then lock is successful.
-    if (rw_lock->writer == NULL)
+    if (!_reader_must_wait(rw_lock))
     {
-        rw_lock->readers++;
+        _add_slow_reader(rw_lock);
         result = OE_OK;
     }
 
@@ -607,30 +1245,6 @@ oe_result_t oe_rwlock_tryrdlock(oe_rwlock_t* read_write_lock)
     return result;
 }
 
-// The current thread must hold the spinlock.
-// _wake_waiters releases ownership of the spinlock.
-static oe_result_t _wake_waiters(oe_rwlock_impl_t* rw_lock)
-{
-    oe_thread_data_t* p = NULL;
-    Queue waiters = {NULL, NULL};
-
-    // Take a snapshot of current list of waiters.
-    while ((p = _queue_pop_front(&rw_lock->queue)))
-        _queue_push_back(&waiters, p);
-
-    // Release the lock and wake up the waiters. This allows waiter that is
-    // woken up to immediately acquire the spinlock and subsequently, the
-    // ownership of the rw_lock.
-    oe_spin_unlock(&rw_lock->lock);
-
-    // Wake the waiters in FIFO order. However actual acquisition of the lock
-    // will be dependent on OS scheduling of the threads.
-    while ((p = _queue_pop_front(&waiters)))
-        _thread_wake(p);
-
-    return OE_OK;
-}
-
 static oe_result_t _rwlock_rdunlock(oe_rwlock_t* read_write_lock)
 {
     oe_rwlock_impl_t* rw_lock = (oe_rwlock_impl_t*)read_write_lock;
@@ -638,6 +1252,9 @@ static oe_result_t _rwlock_rdunlock(oe_rwlock_t* read_write_lock)
     if (!rw_lock)
         return OE_INVALID_PARAMETER;
 
+    if (_try_fast_rdunlock(rw_lock, (td_t*)oe_get_thread_data()))
+        return _wake_slot_waiters(rw_lock);
+
     oe_spin_lock(&rw_lock->lock);
 
     // There must be at least 1 reader and no writers.
@@ -647,9 +1264,9 @@ static oe_result_t _rwlock_rdunlock(oe_rwlock_t* read_write_lock)
         return OE_NOT_OWNER;
     }
 
-    if (--rw_lock->readers == 0)
+    if (--rw_lock->readers == 0 && rw_lock->front)
     {
-        // This is the last reader. Wake up all waiting threads.
+        // This is the last reader. Wake up the waiting threads.
         return _wake_waiters(rw_lock);
     }
 
@@ -662,6 +1279,7 @@ oe_result_t oe_rwlock_wrlock(oe_rwlock_t* read_write_lock)
 {
     oe_rwlock_impl_t* rw_lock = (oe_rwlock_impl_t*)read_write_lock;
     oe_thread_data_t* self = oe_get_thread_data();
+    oe_rwlock_waiter_t waiter = {self, NULL, false, true};
 
     if (!rw_lock)
         return OE_INVALID_PARAMETER;
@@ -675,12 +1293,35 @@ oe_result_t oe_rwlock_wrlock(oe_rwlock_t* read_write_lock)
         return OE_BUSY;
     }
 
-    // Wait for all readers and any other writer to finish.
-    while (rw_lock->readers > 0 || rw_lock->writer != NULL)
+    // Keep readers from restoring the read bias while this writer waits.
+    rw_lock->writers_waiting++;
+    _revoke_read_bias(rw_lock);
+
+    // Spin for a while on the readers that hold the lock through their
+    // slots, which usually release it soon. Readers may still acquire the
+    // lock through the reader count meanwhile, so that readers that lock
+    // recursively do not deadlock.
+    if (_has_fast_readers(rw_lock))
+    {
+        oe_spin_unlock(&rw_lock->lock);
+
+        for (size_t i = 0;
+             i < OE_RWLOCK_WRITER_SPIN_COUNT && _has_fast_readers(rw_lock);
+             i++)
+        {
+            oe_pause();
+        }
+
+        oe_spin_lock(&rw_lock->lock);
+    }
+
+    // Wait for all readers and any other writer to finish. Readers that
+    // release the lock through their slots wake the queue.
+    while (_has_fast_readers(rw_lock) || rw_lock->readers > 0 ||
+           rw_lock->writer != NULL)
     {
         // Add self to list of waiters, and go to wait state.
-        if (!_queue_contains(&rw_lock->queue, self))
-            _queue_push_back(&rw_lock->queue, self);
+        _queue_waiter(rw_lock, &waiter);
 
         oe_spin_unlock(&rw_lock->lock);
 
@@ -691,6 +1332,9 @@ oe_result_t oe_rwlock_wrlock(oe_rwlock_t* read_write_lock)
         oe_spin_lock(&rw_lock->lock);
     }
 
+    _unqueue_waiter(rw_lock, &waiter);
+
+    rw_lock->writers_waiting--;
     rw_lock->writer = self;
     oe_spin_unlock(&rw_lock->lock);
 
@@ -711,8 +1355,13 @@ oe_result_t oe_rwlock_trywrlock(oe_rwlock_t* read_write_lock)
     // If no readers and no writers are active, then lock is successful.
     if (rw_lock->readers == 0 && rw_lock->writer == NULL)
     {
-        rw_lock->writer = self;
-        result = OE_OK;
+        _revoke_read_bias(rw_lock);
+
+        if (!_has_fast_readers(rw_lock))
+        {
+            rw_lock->writer = self;
+            result = OE_OK;
+        }
     }
 
     oe_spin_unlock(&rw_lock->lock);
@@ -761,7 +1410,8 @@ oe_result_t oe_rwlock_destroy(oe_rwlock_t* read_write_lock)
     oe_spin_lock(&rw_lock->lock);
 
     // There must not be any active readers or writers.
-    if (rw_lock->readers != 0 || rw_lock->writer != NULL)
+    if (rw_lock->readers != 0 || rw_lock->writer != NULL ||
+        _has_fast_readers(rw_lock))
     {
         oe_spin_unlock(&rw_lock->lock);
         return OE_BUSY;
@@ -791,6 +1441,29 @@ oe_result_t oe_rwlock_unlock(oe_rwlock_t* read_write_lock)
         return _rwlock_rdunlock(read_write_lock);
 }
 
+/*
+**==============================================================================
+**
+** oe_seqlock_t
+**
+**==============================================================================
+*/
+
+void oe_seqlock_write_lock(oe_seqlock_t* seqlock)
+{
+    oe_spin_lock(&seqlock->lock);
+
+    // Readers retry while the sequence number is odd.
+    __atomic_store_n(&seqlock->seq, seqlock->seq + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+}
+
+void oe_seqlock_write_unlock(oe_seqlock_t* seqlock)
+{
+    __atomic_store_n(&seqlock->seq, seqlock->seq + 1, __ATOMIC_RELEASE);
+    oe_spin_unlock(&seqlock->lock);
+}
+
 /*
 **==============================================================================
 **
@@ -801,14 +1474,40 @@ oe_result_t oe_rwlock_unlock(oe_rwlock_t* read_write_lock)
 
 #define MAX_KEYS (OE_PAGE_SIZE / sizeof(void*))
 
+/*
+**==============================================================================
+**
+** Each TCS keeps a bitmap of the keys that have a non-null value in its TSD
+** page (td_t.tsd_keys), so that the destruction of the thread-specific data
+** at the end of the outermost ECALL visits only those keys, rather than
+** scanning all MAX_KEYS slots on every ECALL. The slots are protected by a
+** seqlock, so that the destruction reads them without taking a lock.
+**
+** Values of keys created with OE_THREAD_KEY_TCS_LIFETIME are left in place
+** at the end of the ECALL. Each TCS that holds such values is recorded in
+** _tcs_tds[] so that their destructors can be called when the enclave is
+** terminated.
+**
+**==============================================================================
+*/
+
+#define TSD_KEY_WORDS (MAX_KEYS / 64)
+
+OE_STATIC_ASSERT(OE_COUNTOF(((td_t*)0)->tsd_keys) == TSD_KEY_WORDS);
+
 typedef struct _key_slot
 {
     bool used;
+    uint32_t flags;
     void (*destructor)(void* value);
 } KeySlot;
 
 static KeySlot _slots[MAX_KEYS];
-static oe_spinlock_t _lock = OE_SPINLOCK_INITIALIZER;
+static oe_seqlock_t _slots_lock = OE_SEQLOCK_INITIALIZER;
+static oe_spinlock_t _tcs_tds_lock = OE_SPINLOCK_INITIALIZER;
+
+static td_t* _tcs_tds[OE_SGX_MAX_TCS];
+static size_t _num_tcs_tds;
 
 static void** _get_tsd_page(void)
 {
@@ -820,18 +1519,19 @@ static void** _get_tsd_page(void)
     return (void**)((unsigned char*)td + OE_PAGE_SIZE);
 }
 
-oe_result_t oe_thread_key_create(
+oe_result_t oe_thread_key_create_ex(
     oe_thread_key_t* key,
-    void (*destructor)(void* value))
+    void (*destructor)(void* value),
+    uint32_t flags)
 {
-    if (!key)
+    if (!key || (flags & ~OE_THREAD_KEY_TCS_LIFETIME))
         return OE_INVALID_PARAMETER;
 
     oe_result_t result = OE_OUT_OF_MEMORY;
 
     /* Search for an available slot (the first slot is not used) */
     {
-        oe_spin_lock(&_lock);
+        oe_seqlock_write_lock(&_slots_lock);
 
         for (unsigned int i = 1; i < MAX_KEYS; i++)
         {
@@ -840,6 +1540,7 @@ oe_result_t oe_thread_key_create(
             {
                 /* Initialize this slot */
                 _slots[i].used = true;
+                _slots[i].flags = flags;
                 _slots[i].destructor = destructor;
 
                 /* Initialize new key */
@@ -850,12 +1551,19 @@ oe_result_t oe_thread_key_create(
             }
         }
 
-        oe_spin_unlock(&_lock);
+        oe_seqlock_write_unlock(&_slots_lock);
     }
 
     return result;
 }
 
+oe_result_t oe_thread_key_create(
+    oe_thread_key_t* key,
+    void (*destructor)(void* value))
+{
+    return oe_thread_key_create_ex(key, destructor, 0);
+}
+
 oe_result_t oe_thread_key_delete(oe_thread_key_t key)
 {
     /* If key parameter is invalid */
@@ -864,21 +1572,50 @@ oe_result_t oe_thread_key_delete(oe_thread_key_t key)
 
     /* Mark this key as unused */
     {
-        oe_spin_lock(&_lock);
+        oe_seqlock_write_lock(&_slots_lock);
 
         /* Clear this slot */
         _slots[key].used = false;
+        _slots[key].flags = 0;
         _slots[key].destructor = NULL;
 
-        oe_spin_unlock(&_lock);
+        oe_seqlock_write_unlock(&_slots_lock);
     }
 
     return OE_OK;
 }
 
+/* Read a slot consistently without blocking writers */
+static void _read_slot(oe_thread_key_t key, KeySlot* slot)
+{
+    uint32_t seq;
+
+    do
+    {
+        seq = oe_seqlock_read_begin(&_slots_lock);
+        *slot = _slots[key];
+    } while (oe_seqlock_read_retry(&_slots_lock, seq));
+}
+
+/* Record a TCS that holds TCS-lifetime values (once per TCS) */
+static void _register_tcs_td(td_t* td)
+{
+    oe_spin_lock(&_tcs_tds_lock);
+    {
+        if (!td->tsd_registered && _num_tcs_tds < OE_COUNTOF(_tcs_tds))
+        {
+            _tcs_tds[_num_tcs_tds++] = td;
+            td->tsd_registered = 1;
+        }
+    }
+    oe_spin_unlock(&_tcs_tds_lock);
+}
+
 oe_result_t oe_thread_setspecific(oe_thread_key_t key, const void* value)
 {
+    td_t* td;
     void** tsd_page;
+    uint64_t bit = 1ULL << (key % 64);
 
     /* If key parameter is invalid */
     if (key == 0 || key >= MAX_KEYS)
@@ -887,8 +1624,24 @@ oe_result_t oe_thread_setspecific(oe_thread_key_t key, const void* value)
     if (!(tsd_page = _get_tsd_page()))
         return OE_INVALID_PARAMETER;
 
+    td = (td_t*)oe_get_thread_data();
     tsd_page[key] = (void*)value;
 
+    if (value)
+    {
+        td->tsd_keys[key / 64] |= bit;
+
+        if (!td->tsd_registered &&
+            (_slots[key].flags & OE_THREAD_KEY_TCS_LIFETIME))
+        {
+            _register_tcs_td(td);
+        }
+    }
+    else
+    {
+        td->tsd_keys[key / 64] &= ~bit;
+    }
+
     return OE_OK;
 }
 
@@ -905,30 +1658,70 @@ void* oe_thread_getspecific(oe_thread_key_t key)
     return tsd_page[key];
 }
 
-void oe_thread_destruct_specific(void)
+/* Destroy the values of the given TCS. If all is false, the values of the
+ * TCS-lifetime keys are kept. */
+static void _destruct_specific(td_t* td, bool all)
 {
-    void** tsd_page;
+    void** tsd_page = (void**)((unsigned char*)td + OE_PAGE_SIZE);
 
-    /* Get the thread-specific-data page for the current thread. */
-    if ((tsd_page = _get_tsd_page()))
+    for (size_t i = 0; i < TSD_KEY_WORDS; i++)
     {
-        oe_spin_lock(&_lock);
+        uint64_t pending = td->tsd_keys[i];
+
+        while (pending)
         {
-            /* For each thread-specific-data key */
-            for (oe_thread_key_t key = 1; key < MAX_KEYS; key++)
-            {
-                /* If this key is in use: */
-                if (_slots[key].used)
-                {
-                    /* Call the destructor if any. */
-                    if (_slots[key].destructor && tsd_page[key])
-                        (_slots[key].destructor)(tsd_page[key]);
+            oe_thread_key_t key = i * 64 + (size_t)__builtin_ctzll(pending);
+            uint64_t bit = 1ULL << (key % 64);
+            void (*destructor)(void* value) = NULL;
+            void* value;
+            bool keep = false;
+            KeySlot slot;
 
-                    /* Clear the value. */
-                    tsd_page[key] = NULL;
-                }
+            pending &= ~bit;
+
+            /* Values of deleted keys are dropped without a destructor */
+            _read_slot(key, &slot);
+
+            if (slot.used)
+            {
+                destructor = slot.destructor;
+                keep = !all && (slot.flags & OE_THREAD_KEY_TCS_LIFETIME);
             }
+
+            if (keep)
+                continue;
+
+            /* Clear the value before calling the destructor, which may set
+             * a new value. */
+            value = tsd_page[key];
+            tsd_page[key] = NULL;
+            td->tsd_keys[i] &= ~bit;
+
+            if (destructor && value)
+                destructor(value);
         }
-        oe_spin_unlock(&_lock);
     }
 }
+
+void oe_thread_destruct_specific(void)
+{
+    td_t* td;
+
+    /* Get the thread data of the current thread. */
+    if ((td = (td_t*)oe_get_thread_data()))
+        _destruct_specific(td, false);
+}
+
+void oe_thread_destruct_tcs_specific(void)
+{
+    size_t num_tcs_tds;
+
+    oe_spin_lock(&_tcs_tds_lock);
+    num_tcs_tds = _num_tcs_tds;
+    oe_spin_unlock(&_tcs_tds_lock);
+
+    /* The enclave is being terminated, so no other thread is running in it,
+     * and the destructors may be called on behalf of each TCS. */
+    for (size_t i = 0; i < num_tcs_tds; i++)
+        _destruct_specific(_tcs_tds[i], true);
+}
@@ -4,9 +4,24 @@
 #ifndef _OE_CORE_THREAD_H_H
 #define _OE_CORE_THREAD_H_H
 
+#include <openenclave/bits/types.h>
+
 // This function is called when the enclave is finished with a thread (when
 // exiting). It invokes all thread-specific-data destructors for the current
 // thread.
 void oe_thread_destruct_specific(void);
 
+// This function is called when the enclave is terminated. It invokes the
+// destructors of the TCS-lifetime thread-specific data of every thread.
+void oe_thread_destruct_tcs_specific(void);
+
+// Handle OE_ECALL_THREAD_START: run the thread created by oe_thread_create()
+// whose handle is given by the host on this TCS.
+uint64_t oe_handle_thread_start(uint64_t arg_in);
+
+// This function is called when the enclave is terminated. It completes the
+// threads created by oe_thread_create() that the host dropped before they
+// started, so that joining them returns (with a null value).
+void oe_thread_cancel_pending(void);
+
 #endif /* _OE_CORE_THREAD_H_H */
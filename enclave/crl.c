@@ -2,6 +2,7 @@
 // Licensed under the MIT License.
 
 #include "crl.h"
+#include <mbedtls/md.h>
 #include <mbedtls/platform.h>
 #include <mbedtls/x509_crl.h>
 #include <openenclave/bits/safecrt.h>
@@ -16,19 +17,160 @@
 
 OE_STATIC_ASSERT(sizeof(crl_t) <= sizeof(oe_crl_t));
 
-OE_INLINE void _crl_init(crl_t* impl, mbedtls_x509_crl* crl)
+/* Minimum number of slots of the hash set of revoked entries */
+#define CRL_INDEX_MIN_CAPACITY 16
+
+OE_INLINE void _crl_init(
+    crl_t* impl,
+    mbedtls_x509_crl* crl,
+    crl_index_t* index)
 {
     impl->magic = OE_CRL_MAGIC;
     impl->crl = crl;
+    impl->index = index;
 }
 
 bool crl_is_valid(const crl_t* impl)
 {
-    return impl && (impl->magic == OE_CRL_MAGIC) && impl->crl;
+    return impl && (impl->magic == OE_CRL_MAGIC) && impl->crl && impl->index;
+}
+
+/*
+**==============================================================================
+**
+** CRL index:
+**
+**     mbedtls checks a certificate against a CRL by scanning the linked list
+**     of revoked entries, and verifies the CRL signature by hashing the whole
+**     CRL, so the cost of every verification grows with the size of the CRL.
+**     Instead, the revoked entries are indexed by serial number and the CRL
+**     is hashed once when it is read, so that a verification costs one
+**     lookup and one signature verification.
+**
+**==============================================================================
+*/
+
+/* FNV-1a hash of a serial number */
+static uint64_t _hash_serial(const mbedtls_x509_buf* serial)
+{
+    uint64_t hash = 0xcbf29ce484222325;
+
+    for (size_t i = 0; i < serial->len; i++)
+    {
+        hash ^= serial->p[i];
+        hash *= 0x100000001b3;
+    }
+
+    return hash;
+}
+
+static void _crl_index_free(crl_index_t* index)
+{
+    if (index)
+    {
+        oe_free(index->entries);
+        oe_free(index);
+    }
+}
+
+static oe_result_t _crl_index_new(
+    const mbedtls_x509_crl* crl,
+    crl_index_t** index_out)
+{
+    oe_result_t result = OE_UNEXPECTED;
+    crl_index_t* index = NULL;
+    const mbedtls_md_info_t* md_info;
+    size_t count = 0;
+    size_t capacity = CRL_INDEX_MIN_CAPACITY;
+
+    if (!(index = oe_calloc(1, sizeof(crl_index_t))))
+        OE_RAISE(OE_OUT_OF_MEMORY);
+
+    /* Hash the to-be-signed part of the CRL once */
+    if (!(md_info = mbedtls_md_info_from_type(crl->sig_md)))
+        OE_RAISE(OE_FAILURE);
+
+    if (mbedtls_md(md_info, crl->tbs.p, crl->tbs.len, index->tbs_hash) != 0)
+        OE_RAISE(OE_FAILURE);
+
+    index->tbs_hash_size = mbedtls_md_get_size(md_info);
+
+    /* Size the hash set for a load factor of at most one half */
+    for (const mbedtls_x509_crl_entry* p = &crl->entry; p && p->serial.len;
+         p = p->next)
+    {
+        count++;
+    }
+
+    while (capacity < 2 * count)
+        capacity *= 2;
+
+    if (!(index->entries = oe_calloc(capacity, sizeof(index->entries[0]))))
+        OE_RAISE(OE_OUT_OF_MEMORY);
+
+    index->capacity = capacity;
+
+    /* Insert every entry (serial numbers may appear more than once) */
+    for (const mbedtls_x509_crl_entry* p = &crl->entry; p && p->serial.len;
+         p = p->next)
+    {
+        size_t i = _hash_serial(&p->serial) & (capacity - 1);
+
+        while (index->entries[i])
+            i = (i + 1) & (capacity - 1);
+
+        index->entries[i] = p;
+    }
+
+    *index_out = index;
+    index = NULL;
+
+    result = OE_OK;
+
+done:
+    _crl_index_free(index);
+    return result;
+}
+
+bool crl_verify_signature(const crl_t* impl, mbedtls_x509_crt* ca)
+{
+    const crl_index_t* index = impl->index;
+
+    return mbedtls_pk_verify_ext(
+               impl->crl->sig_pk,
+               impl->crl->sig_opts,
+               &ca->pk,
+               impl->crl->sig_md,
+               index->tbs_hash,
+               index->tbs_hash_size,
+               impl->crl->sig.p,
+               impl->crl->sig.len) == 0;
+}
+
+bool crl_is_revoked(const crl_t* impl, const mbedtls_x509_crt* crt)
+{
+    const crl_index_t* index = impl->index;
+    const size_t mask = index->capacity - 1;
+    size_t i = _hash_serial(&crt->serial) & mask;
+
+    for (; index->entries[i]; i = (i + 1) & mask)
+    {
+        const mbedtls_x509_crl_entry* p = index->entries[i];
+
+        if (p->serial.len == crt->serial.len &&
+            oe_memcmp(p->serial.p, crt->serial.p, p->serial.len) == 0 &&
+            mbedtls_x509_time_is_past(&p->revocation_date))
+        {
+            return true;
+        }
+    }
+
+    return false;
 }
 
 OE_INLINE void _crl_free(crl_t* impl)
 {
+    _crl_index_free(impl->index);
     mbedtls_x509_crl_free(impl->crl);
     oe_memset(impl->crl, 0, sizeof(mbedtls_x509_crl));
     mbedtls_free(impl->crl);
@@ -43,6 +185,7 @@ oe_result_t oe_crl_read_der(
     oe_result_t result = OE_UNEXPECTED;
     crl_t* impl = (crl_t*)crl;
     mbedtls_x509_crl* x509_crl = NULL;
+    crl_index_t* index = NULL;
 
     /* Clear the implementation */
     if (impl)
@@ -63,8 +206,11 @@ oe_result_t oe_crl_read_der(
     if (mbedtls_x509_crl_parse_der(x509_crl, der_data, der_size) != 0)
         OE_RAISE(OE_FAILURE);
 
+    /* Index the revoked entries */
+    OE_CHECK(_crl_index_new(x509_crl, &index));
+
     /* Initialize the implementation */
-    _crl_init(impl, x509_crl);
+    _crl_init(impl, x509_crl, index);
     x509_crl = NULL;
 
     result = OE_OK;
@@ -4,15 +4,37 @@
 #ifndef _OE_ENCLAVE_CRL_H
 #define _OE_ENCLAVE_CRL_H
 
+#include <mbedtls/md.h>
 #include <mbedtls/x509_crl.h>
+#include <mbedtls/x509_crt.h>
 #include <openenclave/internal/crl.h>
 
+/* Index of a CRL built once by oe_crl_read_der() */
+typedef struct _crl_index
+{
+    /* Digest of the to-be-signed part of the CRL */
+    uint8_t tbs_hash[MBEDTLS_MD_MAX_SIZE];
+    size_t tbs_hash_size;
+
+    /* Open-addressing hash set of the revoked entries (keyed by serial) */
+    const mbedtls_x509_crl_entry** entries;
+    size_t capacity;
+} crl_index_t;
+
 typedef struct _crl
 {
     uint64_t magic;
     mbedtls_x509_crl* crl;
+    crl_index_t* index;
 } crl_t;
 
 bool crl_is_valid(const crl_t* impl);
 
+/* Verify the signature of the CRL with the public key of its issuer (ca) */
+bool crl_verify_signature(const crl_t* impl, mbedtls_x509_crt* ca);
+
+/* Return true if the CRL revokes the certificate (see
+ * mbedtls_x509_crt_is_revoked()) */
+bool crl_is_revoked(const crl_t* impl, const mbedtls_x509_crt* crt);
+
 #endif /* _OE_ENCLAVE_CRL_H */
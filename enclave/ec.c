@@ -4,11 +4,13 @@
 #include "ec.h"
 #include <mbedtls/asn1.h>
 #include <mbedtls/asn1write.h>
+#include <mbedtls/ecdsa.h>
 #include <mbedtls/ecp.h>
 #include <openenclave/bits/safecrt.h>
 #include <openenclave/enclave.h>
 #include <openenclave/internal/enclavelibc.h>
 #include <openenclave/internal/raise.h>
+#include <openenclave/internal/thread.h>
 #include <openenclave/internal/utils.h>
 #include "key.h"
 #include "pem.h"
@@ -282,6 +284,269 @@ oe_result_t oe_ec_private_key_sign(
         _PRIVATE_KEY_MAGIC);
 }
 
+/*
+**==============================================================================
+**
+** P-256 verification tables:
+**
+**     mbedtls computes u1*G + u2*Q for every ECDSA verification with the comb
+**     method, which first builds a table of multiples of each point. Only the
+**     table of the base point G is kept (in the group), and each key parsed
+**     into a new group builds it again. Attestation verifies signatures of a
+**     few keys over and over (PCK certificates, TCB signing keys and quoting
+**     enclave attestation keys), so the tables of these keys are kept too:
+**     each key gets a group whose base point is the key itself, so that
+**     mbedtls computes and keeps its table on the first multiplication.
+**
+**     Tables are computed with the lock held and published by an atomic
+**     store of the table count. They are read-only afterwards, so lookups
+**     and verifications proceed without a lock. Tables are never released.
+**
+**==============================================================================
+*/
+
+#define OE_EC_MAX_TABLES 32
+
+/* Size of the X and Y coordinates of a P-256 point */
+#define OE_EC_P256_COORDINATE_SIZE 32
+
+typedef struct _ec_table
+{
+    uint8_t xy[2 * OE_EC_P256_COORDINATE_SIZE];
+
+    /* Group whose base point is the key (or G for the base table) */
+    mbedtls_ecp_group grp;
+} ec_table_t;
+
+static ec_table_t _tables[OE_EC_MAX_TABLES];
+static size_t _num_tables;
+static ec_table_t _base_table;
+static bool _base_table_ready;
+static oe_mutex_t _tables_lock = OE_MUTEX_INITIALIZER;
+
+/* Load the group with the given base point and compute its comb table */
+static int _init_table(ec_table_t* table, const mbedtls_ecp_point* base)
+{
+    int ret;
+    mbedtls_ecp_point tmp;
+    mbedtls_mpi one;
+
+    mbedtls_ecp_point_init(&tmp);
+    mbedtls_mpi_init(&one);
+    mbedtls_ecp_group_init(&table->grp);
+
+    MBEDTLS_MPI_CHK(
+        mbedtls_ecp_group_load(&table->grp, MBEDTLS_ECP_DP_SECP256R1));
+
+    /* The loaded G points to constant data, so it is replaced, not copied
+     * over (the group does not free the points of a loaded curve) */
+    if (base)
+    {
+        mbedtls_ecp_point_init(&table->grp.G);
+        MBEDTLS_MPI_CHK(mbedtls_ecp_copy(&table->grp.G, base));
+    }
+
+    /* Multiplying the base point fills table->grp.T */
+    MBEDTLS_MPI_CHK(mbedtls_mpi_lset(&one, 1));
+    MBEDTLS_MPI_CHK(
+        mbedtls_ecp_mul(&table->grp, &tmp, &one, &table->grp.G, NULL, NULL));
+
+cleanup:
+    if (ret != 0)
+    {
+        if (base)
+            mbedtls_ecp_point_free(&table->grp.G);
+
+        mbedtls_ecp_group_free(&table->grp);
+    }
+
+    mbedtls_ecp_point_free(&tmp);
+    mbedtls_mpi_free(&one);
+    return ret;
+}
+
+/* Find or create the table of the given P-256 key */
+static const mbedtls_ecp_group* _get_table(const mbedtls_ecp_point* q)
+{
+    uint8_t xy[sizeof(_tables[0].xy)];
+    const mbedtls_ecp_group* grp = NULL;
+    size_t n;
+
+    if (mbedtls_mpi_write_binary(&q->X, xy, OE_EC_P256_COORDINATE_SIZE) != 0 ||
+        mbedtls_mpi_write_binary(
+            &q->Y,
+            xy + OE_EC_P256_COORDINATE_SIZE,
+            OE_EC_P256_COORDINATE_SIZE) != 0)
+    {
+        return NULL;
+    }
+
+    /* Look up the published tables without the lock */
+    n = __atomic_load_n(&_num_tables, __ATOMIC_ACQUIRE);
+
+    for (size_t i = 0; i < n; i++)
+    {
+        if (oe_memcmp(_tables[i].xy, xy, sizeof(xy)) == 0)
+            return &_tables[i].grp;
+    }
+
+    oe_mutex_lock(&_tables_lock);
+    {
+        /* Compute the table of G on first use */
+        if (!_base_table_ready && _init_table(&_base_table, NULL) == 0)
+            __atomic_store_n(&_base_table_ready, true, __ATOMIC_RELEASE);
+
+        /* Another thread may have added the table meanwhile */
+        for (size_t i = n; i < _num_tables && !grp; i++)
+        {
+            if (oe_memcmp(_tables[i].xy, xy, sizeof(xy)) == 0)
+                grp = &_tables[i].grp;
+        }
+
+        if (!grp && _base_table_ready && _num_tables < OE_EC_MAX_TABLES)
+        {
+            ec_table_t* table = &_tables[_num_tables];
+
+            if (_init_table(table, q) == 0)
+            {
+                oe_memcpy(table->xy, xy, sizeof(xy));
+                grp = &table->grp;
+                __atomic_store_n(
+                    &_num_tables, _num_tables + 1, __ATOMIC_RELEASE);
+            }
+        }
+    }
+    oe_mutex_unlock(&_tables_lock);
+
+    return grp;
+}
+
+/* Read the r and s values of a DER-encoded ECDSA signature */
+static int _read_signature(
+    const uint8_t* signature,
+    size_t signature_size,
+    mbedtls_mpi* r,
+    mbedtls_mpi* s)
+{
+    int ret;
+    uint8_t* p = (uint8_t*)signature;
+    const uint8_t* end = signature + signature_size;
+    size_t len;
+
+    MBEDTLS_MPI_CHK(
+        mbedtls_asn1_get_tag(
+            &p, end, &len, MBEDTLS_ASN1_CONSTRUCTED | MBEDTLS_ASN1_SEQUENCE));
+
+    if (p + len != end)
+        return MBEDTLS_ERR_ECP_BAD_INPUT_DATA;
+
+    MBEDTLS_MPI_CHK(mbedtls_asn1_get_mpi(&p, end, r));
+    MBEDTLS_MPI_CHK(mbedtls_asn1_get_mpi(&p, end, s));
+
+    if (p != end)
+        return MBEDTLS_ERR_ECP_BAD_INPUT_DATA;
+
+cleanup:
+    return ret;
+}
+
+/* Verify an ECDSA signature as mbedtls_ecdsa_verify() does, but multiply
+ * both points with their kept tables */
+static int _verify_with_tables(
+    const mbedtls_ecp_group* qgrp,
+    const mbedtls_ecp_point* q,
+    const uint8_t* hash,
+    size_t hash_size,
+    const uint8_t* signature,
+    size_t signature_size)
+{
+    int ret;
+    mbedtls_ecp_group* ggrp = &_base_table.grp;
+    const size_t n_size = (ggrp->nbits + 7) / 8;
+    const size_t use_size = hash_size > n_size ? n_size : hash_size;
+    mbedtls_mpi r, s, e, s_inv, u1, u2, one;
+    mbedtls_ecp_point p1, p2, sum;
+
+    mbedtls_mpi_init(&r);
+    mbedtls_mpi_init(&s);
+    mbedtls_mpi_init(&e);
+    mbedtls_mpi_init(&s_inv);
+    mbedtls_mpi_init(&u1);
+    mbedtls_mpi_init(&u2);
+    mbedtls_mpi_init(&one);
+    mbedtls_ecp_point_init(&p1);
+    mbedtls_ecp_point_init(&p2);
+    mbedtls_ecp_point_init(&sum);
+
+    MBEDTLS_MPI_CHK(_read_signature(signature, signature_size, &r, &s));
+
+    /* Step 1: make sure r and s are in range 1..n-1 */
+    if (mbedtls_mpi_cmp_int(&r, 1) < 0 ||
+        mbedtls_mpi_cmp_mpi(&r, &ggrp->N) >= 0 ||
+        mbedtls_mpi_cmp_int(&s, 1) < 0 ||
+        mbedtls_mpi_cmp_mpi(&s, &ggrp->N) >= 0)
+    {
+        ret = MBEDTLS_ERR_ECP_VERIFY_FAILED;
+        goto cleanup;
+    }
+
+    /* Step 3: derive the integer e from the hash */
+    MBEDTLS_MPI_CHK(mbedtls_mpi_read_binary(&e, hash, use_size));
+    if (use_size * 8 > ggrp->nbits)
+        MBEDTLS_MPI_CHK(mbedtls_mpi_shift_r(&e, use_size * 8 - ggrp->nbits));
+    if (mbedtls_mpi_cmp_mpi(&e, &ggrp->N) >= 0)
+        MBEDTLS_MPI_CHK(mbedtls_mpi_sub_mpi(&e, &e, &ggrp->N));
+
+    /* Step 4: u1 = e / s mod n, u2 = r / s mod n */
+    MBEDTLS_MPI_CHK(mbedtls_mpi_inv_mod(&s_inv, &s, &ggrp->N));
+    MBEDTLS_MPI_CHK(mbedtls_mpi_mul_mpi(&u1, &e, &s_inv));
+    MBEDTLS_MPI_CHK(mbedtls_mpi_mod_mpi(&u1, &u1, &ggrp->N));
+    MBEDTLS_MPI_CHK(mbedtls_mpi_mul_mpi(&u2, &r, &s_inv));
+    MBEDTLS_MPI_CHK(mbedtls_mpi_mod_mpi(&u2, &u2, &ggrp->N));
+
+    /* mbedtls_ecp_mul() rejects a zero multiplier (u1 is zero when e is), so
+     * such signatures are verified by mbedtls_ecdsa_verify() itself, which
+     * then decides the result */
+    if (mbedtls_mpi_cmp_int(&u1, 0) == 0 || mbedtls_mpi_cmp_int(&u2, 0) == 0)
+    {
+        ret = mbedtls_ecdsa_verify(ggrp, hash, hash_size, q, &r, &s);
+        goto cleanup;
+    }
+
+    /* Step 5: R = u1 G + u2 Q, multiplying each point with its table */
+    MBEDTLS_MPI_CHK(mbedtls_ecp_mul(ggrp, &p1, &u1, &ggrp->G, NULL, NULL));
+    MBEDTLS_MPI_CHK(
+        mbedtls_ecp_mul(
+            (mbedtls_ecp_group*)qgrp, &p2, &u2, &qgrp->G, NULL, NULL));
+    MBEDTLS_MPI_CHK(mbedtls_mpi_lset(&one, 1));
+    MBEDTLS_MPI_CHK(mbedtls_ecp_muladd(ggrp, &sum, &one, &p1, &one, &p2));
+
+    if (mbedtls_ecp_is_zero(&sum))
+    {
+        ret = MBEDTLS_ERR_ECP_VERIFY_FAILED;
+        goto cleanup;
+    }
+
+    /* Steps 6 and 7: check that R.x mod n == r */
+    MBEDTLS_MPI_CHK(mbedtls_mpi_mod_mpi(&sum.X, &sum.X, &ggrp->N));
+
+    if (mbedtls_mpi_cmp_mpi(&sum.X, &r) != 0)
+        ret = MBEDTLS_ERR_ECP_VERIFY_FAILED;
+
+cleanup:
+    mbedtls_mpi_free(&r);
+    mbedtls_mpi_free(&s);
+    mbedtls_mpi_free(&e);
+    mbedtls_mpi_free(&s_inv);
+    mbedtls_mpi_free(&u1);
+    mbedtls_mpi_free(&u2);
+    mbedtls_mpi_free(&one);
+    mbedtls_ecp_point_free(&p1);
+    mbedtls_ecp_point_free(&p2);
+    mbedtls_ecp_point_free(&sum);
+    return ret;
+}
+
 oe_result_t oe_ec_public_key_verify(
     const oe_ec_public_key_t* public_key,
     oe_hash_type_t hash_type,
@@ -290,6 +555,30 @@ oe_result_t oe_ec_public_key_verify(
     const uint8_t* signature,
     size_t signature_size)
 {
+    const oe_public_key_t* impl = (const oe_public_key_t*)public_key;
+    const mbedtls_ecp_keypair* ec;
+    const mbedtls_ecp_group* qgrp;
+
+    /* Use the kept tables for P-256 keys when possible */
+    if (oe_public_key_is_valid(impl, _PUBLIC_KEY_MAGIC) &&
+        hash_type == OE_HASH_TYPE_SHA256 && hash_data && hash_size &&
+        signature && signature_size && (ec = mbedtls_pk_ec(impl->pk)) &&
+        ec->grp.id == MBEDTLS_ECP_DP_SECP256R1 && (qgrp = _get_table(&ec->Q)))
+    {
+        if (_verify_with_tables(
+                qgrp,
+                &ec->Q,
+                hash_data,
+                hash_size,
+                signature,
+                signature_size) != 0)
+        {
+            return OE_VERIFY_FAILED;
+        }
+
+        return OE_OK;
+    }
+
     return oe_public_key_verify(
         (oe_public_key_t*)public_key,
         hash_type,
@@ -48,7 +48,9 @@ void oe_enter_sim(
     uint64_t arg2,
     uint64_t* arg3,
     uint64_t* arg4,
-    oe_enclave_t* enclave);
+    oe_enclave_t* enclave,
+    const void* fsbase,
+    const void* host_fsbase);
 #endif
 
 #ifndef __ASSEMBLER__
@@ -0,0 +1,386 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#include "asyncocall.h"
+#include <openenclave/internal/raise.h>
+#include <stdlib.h>
+#include <string.h>
+#include "callstats.h"
+
+#if defined(__linux__)
+
+/*
+**==============================================================================
+**
+** Asynchronous OCALL pool:
+**
+**     A blocking OCALL (file or network I/O, sleeping) pins the TCS of the
+**     calling enclave thread for its whole duration. An asynchronous OCALL
+**     instead queues the host function on a pool of host worker threads and
+**     returns to the enclave at once. The enclave thread may then do other
+**     work, polling the done flag of the call, or park in a single
+**     OE_OCALL_WAIT_ASYNC until the call completes. The enclave runs its
+**     other ready fibers before it parks, but a parked thread keeps its TCS.
+**
+**     Records of posted calls are kept on a list so that a wait on an
+**     invalid or already released handle is rejected.
+**
+**==============================================================================
+*/
+
+typedef struct _async_ocall
+{
+    /* Polled by the enclave (must be first) */
+    oe_async_ocall_status_t status;
+
+    oe_host_func_t func;
+    void* args;
+    char* name;
+
+    /* Next call in the work queue */
+    struct _async_ocall* next_queued;
+
+    /* Next call in the list of unreleased records */
+    struct _async_ocall* next;
+} async_ocall_t;
+
+OE_STATIC_ASSERT(OE_OFFSETOF(async_ocall_t, status) == 0);
+
+typedef struct _oe_async_ocall_pool
+{
+    pthread_mutex_t lock;
+    pthread_cond_t work;
+    pthread_cond_t done;
+
+    async_ocall_t* queue_head;
+    async_ocall_t* queue_tail;
+    async_ocall_t* records;
+
+    pthread_t threads[OE_MAX_ASYNC_OCALL_THREADS];
+    size_t num_threads;
+    bool shutdown;
+
+    oe_enclave_t* enclave;
+} oe_async_ocall_pool_t;
+
+static void* _worker(void* arg)
+{
+    oe_async_ocall_pool_t* pool = (oe_async_ocall_pool_t*)arg;
+    oe_enclave_t* enclave = pool->enclave;
+
+    pthread_mutex_lock(&pool->lock);
+
+    for (;;)
+    {
+        async_ocall_t* call;
+        uint64_t start_ns;
+
+        while (!pool->queue_head && !pool->shutdown)
+            pthread_cond_wait(&pool->work, &pool->lock);
+
+        /* Drain the queue before honoring a shutdown */
+        if (!(call = pool->queue_head))
+            break;
+
+        if (!(pool->queue_head = call->next_queued))
+            pool->queue_tail = NULL;
+
+        pthread_mutex_unlock(&pool->lock);
+        {
+            start_ns = OE_CALL_STATS_START(enclave);
+            call->func(call->args, enclave);
+
+            if (start_ns)
+            {
+                oe_call_stats_record_user_ocall(
+                    enclave,
+                    OE_OCALL_CALL_HOST_ASYNC,
+                    (void*)call->func,
+                    call->name,
+                    start_ns);
+            }
+        }
+        pthread_mutex_lock(&pool->lock);
+
+        /* Publish the result before the done flag */
+        call->status.result = OE_OK;
+        __atomic_store_n(&call->status.done, 1, __ATOMIC_RELEASE);
+        pthread_cond_broadcast(&pool->done);
+    }
+
+    pthread_mutex_unlock(&pool->lock);
+
+    return NULL;
+}
+
+/* Create the pool of the enclave (called with enclave->lock held) */
+static oe_result_t _create_pool(oe_enclave_t* enclave)
+{
+    oe_result_t result = OE_UNEXPECTED;
+    oe_async_ocall_pool_t* pool;
+    size_t num_threads = enclave->num_async_ocall_threads;
+
+    if (!num_threads)
+        num_threads = OE_DEFAULT_ASYNC_OCALL_THREADS;
+
+    if (!(pool = (oe_async_ocall_pool_t*)calloc(1, sizeof(*pool))))
+        OE_RAISE(OE_OUT_OF_MEMORY);
+
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->work, NULL);
+    pthread_cond_init(&pool->done, NULL);
+    pool->enclave = enclave;
+
+    for (size_t i = 0; i < num_threads; i++)
+    {
+        if (pthread_create(&pool->threads[i], NULL, _worker, pool) != 0)
+            break;
+
+        pool->num_threads++;
+    }
+
+    /* Any thread is enough to make progress */
+    if (!pool->num_threads)
+    {
+        pthread_cond_destroy(&pool->done);
+        pthread_cond_destroy(&pool->work);
+        pthread_mutex_destroy(&pool->lock);
+        free(pool);
+        OE_RAISE(OE_FAILURE);
+    }
+
+    enclave->async_ocall_pool = pool;
+
+    result = OE_OK;
+
+done:
+    return result;
+}
+
+oe_result_t oe_async_ocall_pool_post(
+    oe_enclave_t* enclave,
+    oe_host_func_t func,
+    const char* name,
+    void* args,
+    oe_async_ocall_status_t** handle)
+{
+    oe_result_t result = OE_UNEXPECTED;
+    oe_async_ocall_pool_t* pool;
+    async_ocall_t* call = NULL;
+
+    if (handle)
+        *handle = NULL;
+
+    if (!enclave || !func || !handle)
+        OE_RAISE(OE_INVALID_PARAMETER);
+
+    if (!(call = (async_ocall_t*)calloc(1, sizeof(*call))))
+        OE_RAISE(OE_OUT_OF_MEMORY);
+
+    call->status.result = OE_UNEXPECTED;
+    call->func = func;
+    call->args = args;
+
+    if (name && !(call->name = strdup(name)))
+        OE_RAISE(OE_OUT_OF_MEMORY);
+
+    oe_mutex_lock(&enclave->lock);
+    {
+        if (!enclave->async_ocall_pool)
+        {
+            oe_result_t r = _create_pool(enclave);
+
+            if (r != OE_OK)
+            {
+                oe_mutex_unlock(&enclave->lock);
+                OE_RAISE(r);
+            }
+        }
+
+        pool = enclave->async_ocall_pool;
+    }
+    oe_mutex_unlock(&enclave->lock);
+
+    pthread_mutex_lock(&pool->lock);
+    {
+        call->next = pool->records;
+        pool->records = call;
+
+        if (pool->queue_tail)
+            pool->queue_tail->next_queued = call;
+        else
+            pool->queue_head = call;
+
+        pool->queue_tail = call;
+        pthread_cond_signal(&pool->work);
+    }
+    pthread_mutex_unlock(&pool->lock);
+
+    *handle = &call->status;
+    call = NULL;
+
+    result = OE_OK;
+
+done:
+
+    if (call)
+    {
+        free(call->name);
+        free(call);
+    }
+
+    return result;
+}
+
+oe_result_t oe_async_ocall_pool_wait(
+    oe_enclave_t* enclave,
+    oe_async_ocall_status_t* handle,
+    oe_result_t* result_out)
+{
+    oe_result_t result = OE_UNEXPECTED;
+    oe_async_ocall_pool_t* pool;
+    async_ocall_t** link;
+    async_ocall_t* call = NULL;
+
+    if (!enclave || !handle || !result_out)
+        OE_RAISE(OE_INVALID_PARAMETER);
+
+    oe_mutex_lock(&enclave->lock);
+    pool = enclave->async_ocall_pool;
+    oe_mutex_unlock(&enclave->lock);
+
+    if (!pool)
+        OE_RAISE(OE_INVALID_PARAMETER);
+
+    pthread_mutex_lock(&pool->lock);
+    {
+        /* Find and unlink the record so that it can be waited on only once */
+        for (link = &pool->records; *link; link = &(*link)->next)
+        {
+            if (&(*link)->status == handle)
+            {
+                call = *link;
+                *link = call->next;
+                break;
+            }
+        }
+
+        if (call)
+        {
+            while (!call->status.done)
+                pthread_cond_wait(&pool->done, &pool->lock);
+        }
+    }
+    pthread_mutex_unlock(&pool->lock);
+
+    if (!call)
+        OE_RAISE(OE_INVALID_PARAMETER);
+
+    *result_out = call->status.result;
+    free(call->name);
+    free(call);
+
+    result = OE_OK;
+
+done:
+    return result;
+}
+
+void oe_async_ocall_pool_free(oe_enclave_t* enclave)
+{
+    oe_async_ocall_pool_t* pool;
+
+    if (!enclave || !(pool = enclave->async_ocall_pool))
+        return;
+
+    pthread_mutex_lock(&pool->lock);
+    pool->shutdown = true;
+    pthread_cond_broadcast(&pool->work);
+    pthread_mutex_unlock(&pool->lock);
+
+    for (size_t i = 0; i < pool->num_threads; i++)
+        pthread_join(pool->threads[i], NULL);
+
+    /* Release the records that the enclave never waited on */
+    while (pool->records)
+    {
+        async_ocall_t* call = pool->records;
+        pool->records = call->next;
+        free(call->name);
+        free(call);
+    }
+
+    pthread_cond_destroy(&pool->done);
+    pthread_cond_destroy(&pool->work);
+    pthread_mutex_destroy(&pool->lock);
+    free(pool);
+
+    enclave->async_ocall_pool = NULL;
+}
+
+#else /* !defined(__linux__) */
+
+/* Asynchronous OCALLs are only supported on Linux hosts */
+
+oe_result_t oe_async_ocall_pool_post(
+    oe_enclave_t* enclave,
+    oe_host_func_t func,
+    const char* name,
+    void* args,
+    oe_async_ocall_status_t** handle)
+{
+    OE_UNUSED(enclave);
+    OE_UNUSED(func);
+    OE_UNUSED(name);
+    OE_UNUSED(args);
+
+    if (handle)
+        *handle = NULL;
+
+    return OE_UNSUPPORTED;
+}
+
+oe_result_t oe_async_ocall_pool_wait(
+    oe_enclave_t* enclave,
+    oe_async_ocall_status_t* handle,
+    oe_result_t* result)
+{
+    OE_UNUSED(enclave);
+    OE_UNUSED(handle);
+    OE_UNUSED(result);
+
+    return OE_UNSUPPORTED;
+}
+
+void oe_async_ocall_pool_free(oe_enclave_t* enclave)
+{
+    OE_UNUSED(enclave);
+}
+
+#endif /* !defined(__linux__) */
+
+oe_result_t oe_set_enclave_async_ocall_threads(
+    oe_enclave_t* enclave,
+    size_t num_threads)
+{
+    oe_result_t result = OE_UNEXPECTED;
+
+    if (!enclave || num_threads > OE_MAX_ASYNC_OCALL_THREADS)
+        OE_RAISE(OE_INVALID_PARAMETER);
+
+    oe_mutex_lock(&enclave->lock);
+    {
+        /* The pool is sized when it is started by the first async OCALL */
+        if (enclave->async_ocall_pool)
+            result = OE_BUSY;
+        else
+        {
+            enclave->num_async_ocall_threads = num_threads;
+            result = OE_OK;
+        }
+    }
+    oe_mutex_unlock(&enclave->lock);
+
+done:
+    return result;
+}
@@ -0,0 +1,51 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#ifndef _OE_HOST_ASYNCOCALL_H
+#define _OE_HOST_ASYNCOCALL_H
+
+#include <openenclave/host.h>
+#include <openenclave/internal/calls.h>
+#include "enclave.h"
+
+OE_EXTERNC_BEGIN
+
+/* Number of worker threads used when none was set for the enclave */
+#define OE_DEFAULT_ASYNC_OCALL_THREADS 4
+
+/* Maximum number of worker threads per enclave */
+#define OE_MAX_ASYNC_OCALL_THREADS 64
+
+/*
+**==============================================================================
+**
+** oe_async_ocall_pool_post()
+**
+**     Queue a call of func(args, enclave) on the worker threads of the
+**     enclave, starting them on first use. Returns the status record of the
+**     call, which remains valid until oe_async_ocall_pool_wait() returns.
+**
+**     Only supported on Linux hosts; elsewhere returns OE_UNSUPPORTED.
+**
+**==============================================================================
+*/
+
+oe_result_t oe_async_ocall_pool_post(
+    oe_enclave_t* enclave,
+    oe_host_func_t func,
+    const char* name,
+    void* args,
+    oe_async_ocall_status_t** handle);
+
+/* Wait for a posted call, release its record and return its result */
+oe_result_t oe_async_ocall_pool_wait(
+    oe_enclave_t* enclave,
+    oe_async_ocall_status_t* handle,
+    oe_result_t* result);
+
+/* Drain the queue and stop the worker threads (called on termination) */
+void oe_async_ocall_pool_free(oe_enclave_t* enclave);
+
+OE_EXTERNC_END
+
+#endif /* _OE_HOST_ASYNCOCALL_H */
@@ -3,6 +3,7 @@
 
 #include <assert.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
 #if defined(__linux__)
@@ -19,6 +20,7 @@
 #endif
 
 #include <openenclave/bits/safecrt.h>
+#include <openenclave/bits/safemath.h>
 #include <openenclave/host.h>
 #include <openenclave/internal/calls.h>
 #include <openenclave/internal/raise.h>
@@ -26,8 +28,12 @@
 #include <openenclave/internal/sgxtypes.h>
 #include <openenclave/internal/utils.h>
 #include "asmdefs.h"
+#include "asyncocall.h"
+#include "callstats.h"
+#include "calltable.h"
 #include "enclave.h"
 #include "ocalls.h"
+#include "threadpool.h"
 
 /*
 **==============================================================================
@@ -110,6 +116,8 @@ static oe_result_t _enter_sim(
     oe_result_t result = OE_UNEXPECTED;
     sgx_tcs_t* tcs = (sgx_tcs_t*)tcs_;
     const void* saved_gsbase = NULL;
+    const void* saved_fsbase = NULL;
+    void* fsbase = NULL;
 
     /* Reject null parameters */
     if (!enclave || !enclave->addr || !tcs || !tcs->oentry || !tcs->gsbase)
@@ -133,6 +141,22 @@ static oe_result_t _enter_sim(
         }
     }
 
+    /* If the enclave has a static TLS block, the FS register base must point
+     * to its thread control block (TCB) while the enclave runs. oe_enter_sim()
+     * sets it, and sets the host one back while OCALLs are dispatched. */
+    if (tcs->fsbase != tcs->gsbase)
+    {
+        fsbase = (void*)(enclave->addr + tcs->fsbase);
+        saved_fsbase = oe_get_fs_register_base();
+
+#if defined(__linux__)
+        /* oe_set_fs_register_base() returns with the other TCB, so it may
+         * check its stack protector canary (at fs:0x28 in glibc) there */
+        if (saved_fsbase)
+            ((uint64_t*)fsbase)[5] = ((const uint64_t*)saved_fsbase)[5];
+#endif
+    }
+
     /* Call into enclave */
     {
         if (arg3)
@@ -142,7 +166,10 @@ static oe_result_t _enter_sim(
             *arg4 = 0;
 
         oe_set_gs_register_base(gsbase);
-        oe_enter_sim(tcs, aep, arg1, arg2, arg3, arg4, enclave);
+
+        oe_enter_sim(
+            tcs, aep, arg1, arg2, arg3, arg4, enclave, fsbase, saved_fsbase);
+
         oe_set_gs_register_base(saved_gsbase);
     }
 
@@ -278,6 +305,7 @@ static void _handle_call_host(uint64_t arg, oe_enclave_t* enclave)
 {
     oe_call_host_args_t* args = (oe_call_host_args_t*)arg;
     oe_host_func_t func;
+    uint64_t start_ns;
 
     if (!args)
         return;
@@ -292,8 +320,15 @@ static void _handle_call_host(uint64_t arg, oe_enclave_t* enclave)
     }
 
     /* Invoke the function */
+    start_ns = OE_CALL_STATS_START(enclave);
     func(args->args, enclave);
 
+    if (start_ns)
+    {
+        oe_call_stats_record_user_ocall(
+            enclave, OE_OCALL_CALL_HOST, (void*)func, args->func, start_ns);
+    }
+
     args->result = OE_OK;
 }
 
@@ -311,6 +346,7 @@ static void _handle_call_host_by_address(uint64_t arg, oe_enclave_t* enclave)
 {
     oe_result_t result = OE_UNEXPECTED;
     oe_call_host_by_address_args_t* args = (oe_call_host_by_address_args_t*)arg;
+    uint64_t start_ns;
 
     if (!args || !args->func)
     {
@@ -319,8 +355,19 @@ static void _handle_call_host_by_address(uint64_t arg, oe_enclave_t* enclave)
     }
 
     /* Invoke the function */
+    start_ns = OE_CALL_STATS_START(enclave);
     args->func(args->args, enclave);
 
+    if (start_ns)
+    {
+        oe_call_stats_record_user_ocall(
+            enclave,
+            OE_OCALL_CALL_HOST_BY_ADDRESS,
+            (void*)args->func,
+            NULL,
+            start_ns);
+    }
+
     result = OE_OK;
 
 done:
@@ -329,6 +376,182 @@ done:
         args->result = result;
 }
 
+/*
+**==============================================================================
+**
+** _handle_call_host_async()
+**
+**     Post a call of a named host function to the asynchronous OCALL pool.
+**
+**==============================================================================
+*/
+
+static void _handle_call_host_async(uint64_t arg, oe_enclave_t* enclave)
+{
+    oe_call_host_async_args_t* args = (oe_call_host_async_args_t*)arg;
+    oe_host_func_t func;
+
+    if (!args)
+        return;
+
+    args->handle = NULL;
+
+    /* Find the host function with this name */
+    if (!(func = _find_host_func(args->func)))
+    {
+        args->result = OE_NOT_FOUND;
+        return;
+    }
+
+    args->result = oe_async_ocall_pool_post(
+        enclave, func, args->func, args->args, &args->handle);
+}
+
+/*
+**==============================================================================
+**
+** _handle_get_host_function_id()
+**
+**     Return the host id of the OCALL function named by the zero-terminated
+**     string arg_in in arg_out. A function that was not registered is looked
+**     up among the exported symbols of the host and registered.
+**
+**==============================================================================
+*/
+
+static oe_result_t _handle_get_host_function_id(
+    oe_enclave_t* enclave,
+    uint64_t arg_in,
+    uint64_t* arg_out)
+{
+    oe_result_t result = OE_UNEXPECTED;
+    const char* name = (const char*)arg_in;
+    oe_host_func_t func;
+    uint32_t id;
+
+    if (!name || !arg_out)
+        OE_RAISE(OE_INVALID_PARAMETER);
+
+    if (oe_find_ocall_function(enclave, name, &id) != OE_OK)
+    {
+        if (!(func = _find_host_func(name)))
+            OE_RAISE(OE_NOT_FOUND);
+
+        OE_CHECK(
+            oe_add_ocall_function(
+                enclave, name, (oe_ocall_func_t)func, false, &id));
+    }
+
+    *arg_out = id;
+    result = OE_OK;
+
+done:
+    return result;
+}
+
+/*
+**==============================================================================
+**
+** _handle_call_host_function()
+**
+**     Call the OCALL function whose host id is given by the function number
+**     with arg_in as its argument.
+**
+**==============================================================================
+*/
+
+static oe_result_t _handle_call_host_function(
+    oe_enclave_t* enclave,
+    uint16_t func,
+    uint64_t arg_in)
+{
+    oe_result_t result = OE_UNEXPECTED;
+    oe_ocall_func_t host_func;
+    const char* name;
+    uint64_t start_ns;
+
+    OE_CHECK(
+        oe_get_ocall_function(
+            enclave, func - OE_OCALL_TABLE_BASE, &host_func, &name));
+
+    start_ns = OE_CALL_STATS_START(enclave);
+    host_func((void*)arg_in, enclave);
+
+    if (start_ns)
+    {
+        oe_call_stats_record_user_ocall(
+            enclave, func, (void*)host_func, name, start_ns);
+    }
+
+    result = OE_OK;
+
+done:
+    return result;
+}
+
+/*
+**==============================================================================
+**
+** _handle_wait_async()
+**
+**     Wait for a call posted by _handle_call_host_async() and return its
+**     result in arg_out.
+**
+**==============================================================================
+*/
+
+static void _handle_wait_async(
+    uint64_t arg_in,
+    uint64_t* arg_out,
+    oe_enclave_t* enclave)
+{
+    oe_result_t result = OE_UNEXPECTED;
+    oe_result_t r = oe_async_ocall_pool_wait(
+        enclave, (oe_async_ocall_status_t*)arg_in, &result);
+
+    if (arg_out)
+        *arg_out = (r == OE_OK) ? result : r;
+}
+
+/*
+**==============================================================================
+**
+** _handle_get_host_stack()
+**
+**     Return the host marshalling stack reserved by _assign_tcs() for the
+**     TCS making the OCALL.
+**
+**==============================================================================
+*/
+
+static void _handle_get_host_stack(
+    oe_enclave_t* enclave,
+    void* tcs,
+    uint64_t arg_in)
+{
+    oe_get_host_stack_args_t* args = (oe_get_host_stack_args_t*)arg_in;
+
+    if (!args)
+        return;
+
+    args->base = NULL;
+    args->size = 0;
+
+    oe_mutex_lock(&enclave->lock);
+    for (size_t i = 0; i < enclave->num_bindings; i++)
+    {
+        ThreadBinding* binding = &enclave->bindings[i];
+
+        if (binding->tcs == (uint64_t)tcs && binding->host_stack)
+        {
+            args->base = binding->host_stack;
+            args->size = enclave->host_stack_size;
+            break;
+        }
+    }
+    oe_mutex_unlock(&enclave->lock);
+}
+
 /*
 **==============================================================================
 **
@@ -392,6 +615,14 @@ static oe_result_t _handle_ocall(
             HandleThreadWakeWait(enclave, arg_in);
             break;
 
+        case OE_OCALL_THREAD_WAKE_MULTIPLE:
+            HandleThreadWakeMultiple(enclave, arg_in);
+            break;
+
+        case OE_OCALL_THREAD_CREATE:
+            OE_CHECK(oe_thread_pool_start(enclave, arg_in));
+            break;
+
         case OE_OCALL_GET_QUOTE:
             HandleGetQuote(arg_in);
             break;
@@ -419,8 +650,31 @@ static oe_result_t _handle_ocall(
             oe_handle_backtrace_symbols(enclave, arg_in);
             break;
 
+        case OE_OCALL_GET_HOST_STACK:
+            _handle_get_host_stack(enclave, tcs, arg_in);
+            break;
+
+        case OE_OCALL_CALL_HOST_ASYNC:
+            _handle_call_host_async(arg_in, enclave);
+            break;
+
+        case OE_OCALL_WAIT_ASYNC:
+            _handle_wait_async(arg_in, arg_out, enclave);
+            break;
+
+        case OE_OCALL_GET_HOST_FUNCTION_ID:
+            OE_CHECK(_handle_get_host_function_id(enclave, arg_in, arg_out));
+            break;
+
         default:
         {
+            /* Call the OCALL function with this host id */
+            if (func >= OE_OCALL_TABLE_BASE)
+            {
+                OE_CHECK(_handle_call_host_function(enclave, func, arg_in));
+                break;
+            }
+
             /* No function found with the number */
             OE_RAISE(OE_NOT_FOUND);
         }
@@ -470,8 +724,13 @@ int __oe_dispatch_ocall(
     if (code == OE_CODE_OCALL)
     {
         uint64_t arg_out = 0;
+        uint64_t start_ns = OE_CALL_STATS_START(enclave);
 
         oe_result_t result = _handle_ocall(enclave, tcs, func, arg, &arg_out);
+
+        if (start_ns)
+            oe_call_stats_record_ocall(enclave, func, start_ns);
+
         *arg1_out = oe_make_call_arg1(OE_CODE_ORET, func, 0, result);
         *arg2_out = arg_out;
 
@@ -531,6 +790,11 @@ static void* _assign_tcs(oe_enclave_t* enclave)
 
                 if (!(binding->flags & _OE_THREAD_BUSY))
                 {
+                    /* Reserve the host marshalling stack of this TCS. On
+                     * failure the enclave falls back to oe_host_malloc(). */
+                    if (!binding->host_stack && enclave->host_stack_size)
+                        binding->host_stack = malloc(enclave->host_stack_size);
+
                     binding->flags |= _OE_THREAD_BUSY;
                     binding->thread = thread;
                     binding->count = 1;
@@ -613,10 +877,13 @@ oe_result_t oe_ecall(
     uint16_t func_out = 0;
     uint16_t result_out = 0;
     uint64_t arg_out = 0;
+    uint64_t start_ns = 0;
 
     if (!enclave)
         OE_RAISE(OE_INVALID_PARAMETER);
 
+    start_ns = OE_CALL_STATS_START(enclave);
+
     /* Assign a td_t for this operation */
     if (!(tcs = _assign_tcs(enclave)))
         OE_RAISE(OE_OUT_OF_THREADS);
@@ -649,6 +916,9 @@ done:
     if (enclave && tcs)
         _release_tcs(enclave, tcs);
 
+    if (start_ns)
+        oe_call_stats_record_ecall(enclave, func, start_ns);
+
     /* ATTN: this causes an assertion with call nesting. */
     /* ATTN: make enclave argument a cookie. */
     /* ATTN: the SetEnclave() function no longer exists */
@@ -713,11 +983,14 @@ oe_result_t oe_call_enclave(oe_enclave_t* enclave, const char* func, void* args)
 {
     oe_result_t result = OE_UNEXPECTED;
     oe_call_enclave_args_t call_enclave_args;
+    uint64_t start_ns = 0;
 
     /* Reject invalid parameters */
     if (!enclave || !func)
         OE_RAISE(OE_INVALID_PARAMETER);
 
+    start_ns = OE_CALL_STATS_START(enclave);
+
     /* Initialize the call_enclave_args structure */
     {
         if (!(call_enclave_args.vaddr =
@@ -746,9 +1019,138 @@ oe_result_t oe_call_enclave(oe_enclave_t* enclave, const char* func, void* args)
     /* Check the result */
     OE_CHECK(call_enclave_args.result);
 
+    if (start_ns)
+    {
+        oe_call_stats_record_user_ecall(
+            enclave, call_enclave_args.func, start_ns);
+    }
+
+    result = OE_OK;
+
+done:
+    return result;
+}
+
+/*
+**==============================================================================
+**
+** oe_call_enclave_function()
+**
+**     Call the enclave function with the given id in the ECALL table of an
+**     EDL file. The ECALL passes args directly and its function number gives
+**     the index of the function in the ECALL pages of the enclave.
+**
+**==============================================================================
+*/
+
+oe_result_t oe_call_enclave_function(
+    oe_enclave_t* enclave,
+    const oe_call_table_t* table,
+    uint32_t function_id,
+    void* args)
+{
+    oe_result_t result = OE_UNEXPECTED;
+    uint32_t index;
+    uint64_t start_ns = 0;
+    uint64_t arg_out = 0;
+
+    /* Reject invalid parameters */
+    if (!enclave || !table)
+        OE_RAISE(OE_INVALID_PARAMETER);
+
+    start_ns = OE_CALL_STATS_START(enclave);
+
+    OE_CHECK(oe_get_ecall_index(enclave, table, function_id, &index));
+
+    /* Perform the ECALL */
+    OE_CHECK(
+        oe_ecall(
+            enclave,
+            (uint16_t)(OE_ECALL_TABLE_BASE + index),
+            (uint64_t)args,
+            &arg_out));
+    OE_CHECK(arg_out);
+
+    if (start_ns)
+        oe_call_stats_record_user_ecall(enclave, index, start_ns);
+
+    result = OE_OK;
+
+done:
+    return result;
+}
+
+/*
+**==============================================================================
+**
+** oe_call_enclave_batch()
+**
+**     Call several named functions in the enclave with a single ECALL. The
+**     names are resolved up front so that the batch is either rejected as a
+**     whole or dispatched as a whole.
+**
+**==============================================================================
+*/
+
+oe_result_t oe_call_enclave_batch(
+    oe_enclave_t* enclave,
+    oe_call_enclave_batch_entry_t* calls,
+    size_t num_calls)
+{
+    oe_result_t result = OE_UNEXPECTED;
+    oe_call_enclave_batch_args_t batch_args;
+    oe_call_enclave_args_t* call_args = NULL;
+    size_t size;
+
+    /* Reject invalid parameters */
+    if (!enclave || !calls || !num_calls)
+        OE_RAISE(OE_INVALID_PARAMETER);
+
+    OE_CHECK(oe_safe_mul_sizet(num_calls, sizeof(*call_args), &size));
+
+    if (!(call_args = (oe_call_enclave_args_t*)malloc(size)))
+        OE_RAISE(OE_OUT_OF_MEMORY);
+
+    /* Initialize the call_enclave_args structure of each call */
+    for (size_t i = 0; i < num_calls; i++)
+    {
+        if (!calls[i].func)
+            OE_RAISE(OE_INVALID_PARAMETER);
+
+        if (!(call_args[i].vaddr = _find_enclave_func(
+                  enclave, calls[i].func, &call_args[i].func)))
+        {
+            OE_RAISE(OE_NOT_FOUND);
+        }
+
+        call_args[i].args = calls[i].args;
+        call_args[i].result = OE_UNEXPECTED;
+    }
+
+    batch_args.calls = call_args;
+    batch_args.num_calls = num_calls;
+
+    /* Perform the ECALL */
+    {
+        uint64_t arg_out = 0;
+
+        OE_CHECK(
+            oe_ecall(
+                enclave,
+                OE_ECALL_CALL_ENCLAVE_BATCH,
+                (uint64_t)&batch_args,
+                &arg_out));
+        OE_CHECK(arg_out);
+    }
+
+    /* Return the per-call results */
+    for (size_t i = 0; i < num_calls; i++)
+        calls[i].result = call_args[i].result;
+
     result = OE_OK;
 
 done:
+    free(call_args);
     return result;
 }
 
@@ -0,0 +1,620 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#include "callstats.h"
+#include <openenclave/host.h>
+#include <openenclave/internal/calls.h>
+#include <openenclave/internal/raise.h>
+#include <openenclave/internal/types.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "enclave.h"
+
+static const char* _builtin_ecall_names[] = {
+    "OE_ECALL_DESTRUCTOR",
+    "OE_ECALL_INIT_ENCLAVE",
+    "OE_ECALL_CALL_ENCLAVE",
+    "OE_ECALL_VERIFY_REPORT",
+    "OE_ECALL_GET_SGX_REPORT",
+    "OE_ECALL_VIRTUAL_EXCEPTION_HANDLER",
+    "OE_ECALL_REGISTER_SHARED_BUFFER",
+    "OE_ECALL_UNREGISTER_SHARED_BUFFER",
+    "OE_ECALL_CALL_ENCLAVE_BATCH",
+    "OE_ECALL_THREAD_START",
+    "OE_ECALL_GET_HEAP_PROFILE",
+};
+
+static const char* _builtin_ocall_names[] = {
+    "OE_OCALL_CALL_HOST",
+    "OE_OCALL_CALL_HOST_BY_ADDRESS",
+    "OE_OCALL_GET_QE_TARGET_INFO",
+    "OE_OCALL_GET_QUOTE",
+    "OE_OCALL_GET_REVOCATION_INFO",
+    "OE_OCALL_THREAD_WAKE",
+    "OE_OCALL_THREAD_WAIT",
+    "OE_OCALL_THREAD_WAKE_WAIT",
+    "OE_OCALL_MALLOC",
+    "OE_OCALL_REALLOC",
+    "OE_OCALL_FREE",
+    "OE_OCALL_WRITE",
+    "OE_OCALL_SLEEP",
+    "OE_OCALL_GET_TIME",
+    "OE_OCALL_BACKTRACE_SYMBOLS",
+    "OE_OCALL_GET_HOST_STACK",
+    "OE_OCALL_CALL_HOST_ASYNC",
+    "OE_OCALL_WAIT_ASYNC",
+    "OE_OCALL_GET_HOST_FUNCTION_ID",
+    "OE_OCALL_THREAD_WAKE_MULTIPLE",
+    "OE_OCALL_THREAD_CREATE",
+};
+
+OE_STATIC_ASSERT(
+    OE_COUNTOF(_builtin_ecall_names) <= OE_CALL_STATS_ECALL_TABLE_SLOT);
+OE_STATIC_ASSERT(
+    OE_COUNTOF(_builtin_ocall_names) <= OE_CALL_STATS_OCALL_TABLE_SLOT);
+
+/*
+**==============================================================================
+**
+** Histogram bucket computation:
+**
+**     Values below 4 map to buckets 0-3. Any other value v with its most
+**     significant bit at position e (e >= 2) maps to bucket
+**     4 * (e - 1) + m, where m is given by the two bits below the most
+**     significant bit. Each power of two is thus split into four buckets.
+**
+**==============================================================================
+*/
+
+static unsigned int _msb(uint64_t x)
+{
+#if defined(__GNUC__)
+    return 63 - (unsigned int)__builtin_clzll(x);
+#else
+    unsigned int n = 0;
+
+    while (x >>= 1)
+        n++;
+
+    return n;
+#endif
+}
+
+static size_t _bucket(uint64_t ns)
+{
+    size_t index;
+
+    if (ns < 4)
+        return (size_t)ns;
+
+    {
+        const unsigned int e = _msb(ns);
+        const uint64_t m = (ns >> (e - 2)) & 3;
+        index = 4 * (size_t)(e - 1) + (size_t)m;
+    }
+
+    if (index >= OE_CALL_STATS_HISTOGRAM_BUCKETS)
+        index = OE_CALL_STATS_HISTOGRAM_BUCKETS - 1;
+
+    return index;
+}
+
+uint64_t oe_call_stats_bucket_lower_bound(size_t bucket)
+{
+    if (bucket < 4)
+        return bucket;
+
+    if (bucket >= OE_CALL_STATS_HISTOGRAM_BUCKETS)
+        bucket = OE_CALL_STATS_HISTOGRAM_BUCKETS - 1;
+
+    {
+        const size_t e = bucket / 4 + 1;
+        const uint64_t m = bucket % 4;
+        return (4 + m) << (e - 2);
+    }
+}
+
+static void _init_stats(
+    oe_call_stats_t* stats,
+    oe_call_kind_t kind,
+    uint32_t func,
+    const char* name)
+{
+    memset(stats, 0, sizeof(oe_call_stats_t));
+    stats->kind = kind;
+    stats->func = func;
+
+    if (name)
+    {
+        strncpy(stats->name, name, sizeof(stats->name) - 1);
+        stats->name[sizeof(stats->name) - 1] = '\0';
+    }
+}
+
+static void _clear_counters(oe_call_stats_t* stats)
+{
+    stats->count = 0;
+    stats->total_ns = 0;
+    stats->min_ns = 0;
+    stats->max_ns = 0;
+    memset(stats->histogram, 0, sizeof(stats->histogram));
+}
+
+/* Caller must hold the table lock */
+static void _update(oe_call_stats_t* stats, uint64_t ns)
+{
+    if (stats->count == 0 || ns < stats->min_ns)
+        stats->min_ns = ns;
+
+    if (ns > stats->max_ns)
+        stats->max_ns = ns;
+
+    stats->count++;
+    stats->total_ns += ns;
+    stats->histogram[_bucket(ns)]++;
+}
+
+static uint64_t _elapsed(uint64_t start_ns)
+{
+    uint64_t now = oe_get_monotonic_time_ns();
+    return now > start_ns ? now - start_ns : 0;
+}
+
+static oe_call_stats_table_t* _new_table(oe_enclave_t* enclave)
+{
+    oe_call_stats_table_t* table;
+    size_t i;
+
+    if (!(table = (oe_call_stats_table_t*)calloc(1, sizeof(*table))))
+        return NULL;
+
+    if (oe_mutex_init(&table->lock) != 0)
+    {
+        free(table);
+        return NULL;
+    }
+
+    for (i = 0; i < OE_CALL_STATS_MAX_BUILTIN_ECALLS; i++)
+    {
+        _init_stats(
+            &table->builtin_ecalls[i],
+            OE_CALL_KIND_ECALL,
+            (uint32_t)(OE_ECALL_BASE + i),
+            i < OE_COUNTOF(_builtin_ecall_names) ? _builtin_ecall_names[i]
+                                                 : "OE_ECALL_UNKNOWN");
+    }
+
+    _init_stats(
+        &table->builtin_ecalls[OE_CALL_STATS_ECALL_TABLE_SLOT],
+        OE_CALL_KIND_ECALL,
+        OE_ECALL_TABLE_BASE,
+        "OE_ECALL_CALL_ENCLAVE_FUNCTION");
+
+    for (i = 0; i < OE_CALL_STATS_MAX_BUILTIN_OCALLS; i++)
+    {
+        _init_stats(
+            &table->builtin_ocalls[i],
+            OE_CALL_KIND_OCALL,
+            (uint32_t)(OE_OCALL_BASE + i),
+            i < OE_COUNTOF(_builtin_ocall_names) ? _builtin_ocall_names[i]
+                                                 : "OE_OCALL_UNKNOWN");
+    }
+
+    _init_stats(
+        &table->builtin_ocalls[OE_CALL_STATS_OCALL_TABLE_SLOT],
+        OE_CALL_KIND_OCALL,
+        OE_OCALL_TABLE_BASE,
+        "OE_OCALL_CALL_HOST_FUNCTION");
+
+    if (enclave->num_ecalls)
+    {
+        table->user_ecalls = (oe_call_stats_t*)calloc(
+            enclave->num_ecalls, sizeof(oe_call_stats_t));
+
+        if (!table->user_ecalls)
+        {
+            oe_mutex_destroy(&table->lock);
+            free(table);
+            return NULL;
+        }
+
+        table->num_user_ecalls = enclave->num_ecalls;
+
+        for (i = 0; i < enclave->num_ecalls; i++)
+        {
+            _init_stats(
+                &table->user_ecalls[i],
+                OE_CALL_KIND_ECALL,
+                (uint32_t)i,
+                enclave->ecalls[i].name);
+        }
+    }
+
+    return table;
+}
+
+void oe_call_stats_record_ecall(
+    oe_enclave_t* enclave,
+    uint16_t func,
+    uint64_t start_ns)
+{
+    oe_call_stats_table_t* table = enclave->call_stats;
+    const uint64_t ns = _elapsed(start_ns);
+    size_t index = (size_t)func - OE_ECALL_BASE;
+
+    if (!table)
+        return;
+
+    if (func >= OE_ECALL_TABLE_BASE && func < OE_OCALL_BASE)
+        index = OE_CALL_STATS_ECALL_TABLE_SLOT;
+    else if (index >= OE_CALL_STATS_ECALL_TABLE_SLOT)
+        return;
+
+    oe_mutex_lock(&table->lock);
+    _update(&table->builtin_ecalls[index], ns);
+    oe_mutex_unlock(&table->lock);
+}
+
+void oe_call_stats_record_user_ecall(
+    oe_enclave_t* enclave,
+    uint64_t index,
+    uint64_t start_ns)
+{
+    oe_call_stats_table_t* table = enclave->call_stats;
+    const uint64_t ns = _elapsed(start_ns);
+
+    if (!table || index >= table->num_user_ecalls)
+        return;
+
+    oe_mutex_lock(&table->lock);
+    _update(&table->user_ecalls[index], ns);
+    oe_mutex_unlock(&table->lock);
+}
+
+void oe_call_stats_record_ocall(
+    oe_enclave_t* enclave,
+    uint16_t func,
+    uint64_t start_ns)
+{
+    oe_call_stats_table_t* table = enclave->call_stats;
+    const uint64_t ns = _elapsed(start_ns);
+    size_t index;
+
+    if (!table || func < OE_OCALL_BASE)
+        return;
+
+    if (func >= OE_OCALL_TABLE_BASE)
+        index = OE_CALL_STATS_OCALL_TABLE_SLOT;
+    else if (
+        (index = (size_t)func - OE_OCALL_BASE) >=
+        OE_CALL_STATS_OCALL_TABLE_SLOT)
+        return;
+
+    oe_mutex_lock(&table->lock);
+    _update(&table->builtin_ocalls[index], ns);
+    oe_mutex_unlock(&table->lock);
+}
+
+void oe_call_stats_record_user_ocall(
+    oe_enclave_t* enclave,
+    uint16_t func,
+    const void* host_func,
+    const char* name,
+    uint64_t start_ns)
+{
+    oe_call_stats_table_t* table = enclave->call_stats;
+    const uint64_t ns = _elapsed(start_ns);
+    const uint64_t key = (uint64_t)host_func;
+
+    if (!table || !key)
+        return;
+
+    oe_mutex_lock(&table->lock);
+    {
+        /* Fibonacci hashing of the function address */
+        size_t i = (size_t)((key * 0x9E3779B97F4A7C15ULL) >> 56) %
+                   OE_CALL_STATS_MAX_USER_OCALLS;
+
+        for (size_t n = 0; n < OE_CALL_STATS_MAX_USER_OCALLS; n++)
+        {
+            oe_user_ocall_stats_t* slot = &table->user_ocalls[i];
+
+            if (slot->key == key)
+            {
+                _update(&slot->stats, ns);
+                break;
+            }
+
+            if (slot->key == 0)
+            {
+                char buf[OE_CALL_STATS_NAME_SIZE];
+
+                if (!name)
+                {
+                    snprintf(buf, sizeof(buf), "0x%llx", OE_LLX(key));
+                    name = buf;
+                }
+
+                slot->key = key;
+                _init_stats(&slot->stats, OE_CALL_KIND_OCALL, func, name);
+                _update(&slot->stats, ns);
+                table->num_user_ocalls++;
+                break;
+            }
+
+            i = (i + 1) % OE_CALL_STATS_MAX_USER_OCALLS;
+        }
+
+        /* Calls to further functions are only counted by the built-in
+         * OE_OCALL_CALL_HOST* entries once the table is full */
+    }
+    oe_mutex_unlock(&table->lock);
+}
+
+void oe_call_stats_free(oe_enclave_t* enclave)
+{
+    oe_call_stats_table_t* table = enclave->call_stats;
+
+    enclave->call_stats_enabled = false;
+    enclave->call_stats = NULL;
+
+    if (table)
+    {
+        oe_mutex_destroy(&table->lock);
+        free(table->user_ecalls);
+        free(table);
+    }
+}
+
+oe_result_t oe_enable_enclave_call_stats(oe_enclave_t* enclave, bool enable)
+{
+    oe_result_t result = OE_UNEXPECTED;
+
+    if (!enclave || enclave->magic != ENCLAVE_MAGIC)
+        OE_RAISE(OE_INVALID_PARAMETER);
+
+    oe_mutex_lock(&enclave->lock);
+    {
+        if (enable && !enclave->call_stats)
+        {
+            if (!(enclave->call_stats = _new_table(enclave)))
+            {
+                oe_mutex_unlock(&enclave->lock);
+                OE_RAISE(OE_OUT_OF_MEMORY);
+            }
+        }
+
+        /* The table is never released while the enclave is alive, so the
+         * call paths may use it whenever they observe the flag set */
+        enclave->call_stats_enabled = enable;
+    }
+    oe_mutex_unlock(&enclave->lock);
+
+    result = OE_OK;
+
+done:
+    return result;
+}
+
+oe_result_t oe_reset_enclave_call_stats(oe_enclave_t* enclave)
+{
+    oe_result_t result = OE_UNEXPECTED;
+    oe_call_stats_table_t* table;
+
+    if (!enclave || enclave->magic != ENCLAVE_MAGIC)
+        OE_RAISE(OE_INVALID_PARAMETER);
+
+    if ((table = enclave->call_stats))
+    {
+        oe_mutex_lock(&table->lock);
+        {
+            size_t i;
+
+            for (i = 0; i < OE_CALL_STATS_MAX_BUILTIN_ECALLS; i++)
+                _clear_counters(&table->builtin_ecalls[i]);
+
+            for (i = 0; i < OE_CALL_STATS_MAX_BUILTIN_OCALLS; i++)
+                _clear_counters(&table->builtin_ocalls[i]);
+
+            for (i = 0; i < table->num_user_ecalls; i++)
+                _clear_counters(&table->user_ecalls[i]);
+
+            memset(table->user_ocalls, 0, sizeof(table->user_ocalls));
+            table->num_user_ocalls = 0;
+        }
+        oe_mutex_unlock(&table->lock);
+    }
+
+    result = OE_OK;
+
+done:
+    return result;
+}
+
+/* Copy the called entries into stats[]; return the number of such entries.
+ * Caller must hold the table lock. */
+static size_t _snapshot(
+    const oe_call_stats_table_t* table,
+    oe_call_stats_t* stats,
+    size_t max)
+{
+    size_t n = 0;
+    size_t i;
+
+#define _OE_CALL_STATS_COPY(ENTRY)        \
+    do                                    \
+    {                                     \
+        if ((ENTRY)->count)               \
+        {                                 \
+            if (stats && n < max)         \
+                stats[n] = *(ENTRY);      \
+            n++;                          \
+        }                                 \
+    } while (0)
+
+    for (i = 0; i < OE_CALL_STATS_MAX_BUILTIN_ECALLS; i++)
+        _OE_CALL_STATS_COPY(&table->builtin_ecalls[i]);
+
+    for (i = 0; i < table->num_user_ecalls; i++)
+        _OE_CALL_STATS_COPY(&table->user_ecalls[i]);
+
+    for (i = 0; i < OE_CALL_STATS_MAX_BUILTIN_OCALLS; i++)
+        _OE_CALL_STATS_COPY(&table->builtin_ocalls[i]);
+
+    for (i = 0; i < OE_CALL_STATS_MAX_USER_OCALLS; i++)
+    {
+        if (table->user_ocalls[i].key)
+            _OE_CALL_STATS_COPY(&table->user_ocalls[i].stats);
+    }
+
+#undef _OE_CALL_STATS_COPY
+
+    return n;
+}
+
+oe_result_t oe_get_enclave_call_stats(
+    oe_enclave_t* enclave,
+    oe_call_stats_t* stats,
+    size_t* count)
+{
+    oe_result_t result = OE_UNEXPECTED;
+    oe_call_stats_table_t* table;
+    size_t required = 0;
+
+    if (!enclave || enclave->magic != ENCLAVE_MAGIC || !count)
+        OE_RAISE(OE_INVALID_PARAMETER);
+
+    if ((table = enclave->call_stats))
+    {
+        oe_mutex_lock(&table->lock);
+        required = _snapshot(table, stats, stats ? *count : 0);
+        oe_mutex_unlock(&table->lock);
+    }
+
+    if (required > *count || (required && !stats))
+    {
+        *count = required;
+        OE_RAISE(OE_BUFFER_TOO_SMALL);
+    }
+
+    *count = required;
+    result = OE_OK;
+
+done:
+    return result;
+}
+
+static void _write_json_string(FILE* stream, const char* str)
+{
+    fputc('"', stream);
+
+    for (; *str; str++)
+    {
+        if (*str == '"' || *str == '\\')
+            fputc('\\', stream);
+
+        if ((unsigned char)*str < 0x20)
+            fprintf(stream, "\\u%04x", (unsigned char)*str);
+        else
+            fputc(*str, stream);
+    }
+
+    fputc('"', stream);
+}
+
+static void _write_json_entries(
+    FILE* stream,
+    const oe_call_stats_t* stats,
+    size_t count,
+    oe_call_kind_t kind)
+{
+    bool first = true;
+
+    for (size_t i = 0; i < count; i++)
+    {
+        const oe_call_stats_t* p = &stats[i];
+        bool first_bucket = true;
+
+        if (p->kind != kind)
+            continue;
+
+        fprintf(stream, "%s\n    {\"name\": ", first ? "" : ",");
+        _write_json_string(stream, p->name);
+        fprintf(
+            stream,
+            ", \"func\": %u, \"count\": %llu, \"total_ns\": %llu, "
+            "\"min_ns\": %llu, \"max_ns\": %llu, \"mean_ns\": %llu, "
+            "\"histogram\": {",
+            p->func,
+            OE_LLU(p->count),
+            OE_LLU(p->total_ns),
+            OE_LLU(p->min_ns),
+            OE_LLU(p->max_ns),
+            OE_LLU(p->count ? p->total_ns / p->count : 0));
+
+        for (size_t b = 0; b < OE_CALL_STATS_HISTOGRAM_BUCKETS; b++)
+        {
+            if (!p->histogram[b])
+                continue;
+
+            fprintf(
+                stream,
+                "%s\"%llu\": %llu",
+                first_bucket ? "" : ", ",
+                OE_LLU(oe_call_stats_bucket_lower_bound(b)),
+                OE_LLU(p->histogram[b]));
+            first_bucket = false;
+        }
+
+        fprintf(stream, "}}");
+        first = false;
+    }
+
+    fprintf(stream, "%s", first ? "" : "\n  ");
+}
+
+oe_result_t oe_write_enclave_call_stats_json(
+    oe_enclave_t* enclave,
+    FILE* stream)
+{
+    oe_result_t result = OE_UNEXPECTED;
+    oe_call_stats_t* stats = NULL;
+    size_t count = 0;
+
+    if (!enclave || enclave->magic != ENCLAVE_MAGIC || !stream)
+        OE_RAISE(OE_INVALID_PARAMETER);
+
+    /* Take a consistent snapshot, growing the buffer if calls to new
+     * functions are recorded in between the two calls */
+    for (;;)
+    {
+        oe_result_t r = oe_get_enclave_call_stats(enclave, stats, &count);
+
+        if (r == OE_OK)
+            break;
+
+        if (r != OE_BUFFER_TOO_SMALL)
+            OE_RAISE(r);
+
+        free(stats);
+
+        if (!(stats = (oe_call_stats_t*)calloc(count, sizeof(*stats))))
+            OE_RAISE(OE_OUT_OF_MEMORY);
+    }
+
+    fprintf(stream, "{\n  \"ecalls\": [");
+    _write_json_entries(stream, stats, count, OE_CALL_KIND_ECALL);
+    fprintf(stream, "],\n  \"ocalls\": [");
+    _write_json_entries(stream, stats, count, OE_CALL_KIND_OCALL);
+    fprintf(stream, "]\n}\n");
+
+    if (ferror(stream))
+        OE_RAISE(OE_FAILURE);
+
+    result = OE_OK;
+
+done:
+    free(stats);
+    return result;
+}
@@ -0,0 +1,109 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#ifndef _OE_HOST_CALLSTATS_H
+#define _OE_HOST_CALLSTATS_H
+
+#include <openenclave/host.h>
+#include "enclave.h"
+
+OE_EXTERNC_BEGIN
+
+/* Maximum number of distinct built-in ECALL and OCALL function numbers */
+#define OE_CALL_STATS_MAX_BUILTIN_ECALLS 16
+#define OE_CALL_STATS_MAX_BUILTIN_OCALLS 32
+
+/* The last built-in slot of each kind counts the calls dispatched by table
+ * index (function numbers from OE_ECALL_TABLE_BASE and OE_OCALL_TABLE_BASE) */
+#define OE_CALL_STATS_ECALL_TABLE_SLOT (OE_CALL_STATS_MAX_BUILTIN_ECALLS - 1)
+#define OE_CALL_STATS_OCALL_TABLE_SLOT (OE_CALL_STATS_MAX_BUILTIN_OCALLS - 1)
+
+/* Maximum number of distinct user OCALL functions tracked per enclave */
+#define OE_CALL_STATS_MAX_USER_OCALLS 256
+
+typedef struct _oe_user_ocall_stats
+{
+    /* Address of the host function (zero if the slot is unused) */
+    uint64_t key;
+    oe_call_stats_t stats;
+} oe_user_ocall_stats_t;
+
+/*
+**==============================================================================
+**
+** oe_call_stats_table_t
+**
+**     Per-enclave call statistics. Allocated by the first call to
+**     oe_enable_enclave_call_stats() and released by oe_terminate_enclave().
+**     All counters are protected by the table lock.
+**
+**==============================================================================
+*/
+
+typedef struct _oe_call_stats_table
+{
+    oe_mutex lock;
+
+    /* Indexed by oe_func_t - OE_ECALL_BASE (see also the table slot) */
+    oe_call_stats_t builtin_ecalls[OE_CALL_STATS_MAX_BUILTIN_ECALLS];
+
+    /* Indexed by oe_func_t - OE_OCALL_BASE (see also the table slot) */
+    oe_call_stats_t builtin_ocalls[OE_CALL_STATS_MAX_BUILTIN_OCALLS];
+
+    /* Indexed by the ECALL index (see oe_enclave_t.ecalls) */
+    oe_call_stats_t* user_ecalls;
+    size_t num_user_ecalls;
+
+    /* Open-addressing hash table keyed by host function address */
+    oe_user_ocall_stats_t user_ocalls[OE_CALL_STATS_MAX_USER_OCALLS];
+    size_t num_user_ocalls;
+} oe_call_stats_table_t;
+
+/* Return a monotonic timestamp in nanoseconds (see linux/time.c). */
+uint64_t oe_get_monotonic_time_ns(void);
+
+/*
+**==============================================================================
+**
+** OE_CALL_STATS_START()
+**
+**     Instrumentation helper for the ECALL and OCALL paths. It evaluates to
+**     the start timestamp of the call, or to zero when the statistics are
+**     disabled, in which case the caller skips the oe_call_stats_record_*()
+**     call. The only cost of disabled statistics is therefore the test of
+**     oe_enclave_t.call_stats_enabled (and of the zero timestamp).
+**
+**==============================================================================
+*/
+
+#define OE_CALL_STATS_START(ENCLAVE) \
+    ((ENCLAVE)->call_stats_enabled ? oe_get_monotonic_time_ns() : 0)
+
+void oe_call_stats_record_ecall(
+    oe_enclave_t* enclave,
+    uint16_t func,
+    uint64_t start_ns);
+
+void oe_call_stats_record_user_ecall(
+    oe_enclave_t* enclave,
+    uint64_t index,
+    uint64_t start_ns);
+
+void oe_call_stats_record_ocall(
+    oe_enclave_t* enclave,
+    uint16_t func,
+    uint64_t start_ns);
+
+void oe_call_stats_record_user_ocall(
+    oe_enclave_t* enclave,
+    uint16_t func,
+    const void* host_func,
+    const char* name,
+    uint64_t start_ns);
+
+/* Release the statistics of an enclave (called on termination) */
+void oe_call_stats_free(oe_enclave_t* enclave);
+
+OE_EXTERNC_END
+
+#endif /* _OE_HOST_CALLSTATS_H */
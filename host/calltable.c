@@ -0,0 +1,331 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#include "calltable.h"
+#include <openenclave/internal/atomic.h>
+#include <openenclave/internal/raise.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+**==============================================================================
+**
+** Call tables:
+**
+**     oeedger8r numbers the ECALLs and OCALLs of an EDL file in the order in
+**     which they are declared. An enclave may link several EDL files, so
+**     these ids are mapped to the enclave once:
+**
+**     - The ECALL ids of a table map to indices in the ECALL pages of the
+**       enclave, which hold the address of every ECALL function. The enclave
+**       calls the function at that index directly.
+**
+**     - OCALL functions are registered by name in a per-enclave array. The
+**       enclave asks for the host id (the index in this array) of each
+**       OCALL on its first call and then calls it by id.
+**
+**     Both are only appended to, under the enclave lock, and are read without
+**     taking the lock. Registered OCALL functions may be replaced.
+**
+**==============================================================================
+*/
+
+#define _NOT_FOUND ((uint32_t)-1)
+
+typedef struct _oe_ocall_function
+{
+    char* name;
+    oe_ocall_func_t func;
+} oe_ocall_function_t;
+
+typedef struct _oe_resolved_call_table
+{
+    const oe_call_table_t* table;
+    struct _oe_resolved_call_table* next;
+
+    /* Index in the ECALL pages of each ECALL id (or _NOT_FOUND) */
+    OE_ZERO_SIZED_ARRAY uint32_t indices[];
+} oe_resolved_call_table_t;
+
+static uint32_t _find_ecall(oe_enclave_t* enclave, const char* name)
+{
+    for (size_t i = 0; i < enclave->num_ecalls; i++)
+    {
+        if (strcmp(enclave->ecalls[i].name, name) == 0)
+            return (uint32_t)i;
+    }
+
+    return _NOT_FOUND;
+}
+
+/* Find the OCALL function with the given name (called with the lock held) */
+static uint32_t _find_ocall(oe_enclave_t* enclave, const char* name)
+{
+    for (size_t i = 0; i < enclave->num_ocall_functions; i++)
+    {
+        if (strcmp(enclave->ocall_functions[i].name, name) == 0)
+            return (uint32_t)i;
+    }
+
+    return _NOT_FOUND;
+}
+
+/* Add or replace an OCALL function (called with the lock held) */
+static oe_result_t _add_ocall(
+    oe_enclave_t* enclave,
+    const char* name,
+    oe_ocall_func_t func,
+    bool replace,
+    uint32_t* id)
+{
+    oe_result_t result = OE_UNEXPECTED;
+    oe_ocall_function_t* entry;
+    uint32_t i;
+
+    if ((i = _find_ocall(enclave, name)) != _NOT_FOUND)
+    {
+        if (replace)
+        {
+            oe_atomic_store_pointer(
+                (void* volatile*)&enclave->ocall_functions[i].func,
+                (void*)func);
+        }
+
+        *id = i;
+        result = OE_OK;
+        goto done;
+    }
+
+    if (!enclave->ocall_functions)
+    {
+        enclave->ocall_functions = (oe_ocall_function_t*)calloc(
+            OE_MAX_OCALL_TABLE_FUNCTIONS, sizeof(oe_ocall_function_t));
+
+        if (!enclave->ocall_functions)
+            OE_RAISE(OE_OUT_OF_MEMORY);
+    }
+
+    if (enclave->num_ocall_functions == OE_MAX_OCALL_TABLE_FUNCTIONS)
+        OE_RAISE(OE_OUT_OF_MEMORY);
+
+    entry = &enclave->ocall_functions[enclave->num_ocall_functions];
+
+    if (!(entry->name = strdup(name)))
+        OE_RAISE(OE_OUT_OF_MEMORY);
+
+    entry->func = func;
+
+    /* Publish the entry after it is initialized */
+    *id = (uint32_t)enclave->num_ocall_functions;
+    oe_atomic_store(
+        &enclave->num_ocall_functions, enclave->num_ocall_functions + 1);
+
+    result = OE_OK;
+
+done:
+    return result;
+}
+
+static oe_resolved_call_table_t* _find_table(
+    oe_enclave_t* enclave,
+    const oe_call_table_t* table)
+{
+    oe_resolved_call_table_t* p =
+        (oe_resolved_call_table_t*)oe_atomic_load_pointer(
+            (void* volatile*)&enclave->call_tables);
+
+    for (; p; p = p->next)
+    {
+        if (p->table == table)
+            return p;
+    }
+
+    return NULL;
+}
+
+/* Resolve the table against the enclave (called with the lock held) */
+static oe_result_t _resolve_table(
+    oe_enclave_t* enclave,
+    const oe_call_table_t* table,
+    oe_resolved_call_table_t** resolved)
+{
+    oe_result_t result = OE_UNEXPECTED;
+    oe_resolved_call_table_t* p = NULL;
+    uint32_t id;
+
+    if ((*resolved = _find_table(enclave, table)))
+    {
+        result = OE_OK;
+        goto done;
+    }
+
+    p = (oe_resolved_call_table_t*)malloc(
+        sizeof(*p) + table->num_ecalls * sizeof(uint32_t));
+
+    if (!p)
+        OE_RAISE(OE_OUT_OF_MEMORY);
+
+    p->table = table;
+
+    for (uint32_t i = 0; i < table->num_ecalls; i++)
+    {
+        p->indices[i] = _find_ecall(enclave, table->ecall_names[i]);
+
+        if (p->indices[i] >= OE_MAX_ECALL_TABLE_FUNCTIONS)
+            p->indices[i] = _NOT_FOUND;
+    }
+
+    /* Functions registered by the application take precedence */
+    for (uint32_t i = 0; i < table->num_ocalls; i++)
+    {
+        OE_CHECK(
+            _add_ocall(
+                enclave,
+                table->ocall_names[i],
+                table->ocall_funcs[i],
+                false,
+                &id));
+    }
+
+    p->next = enclave->call_tables;
+    oe_atomic_store_pointer((void* volatile*)&enclave->call_tables, p);
+    *resolved = p;
+    p = NULL;
+
+    result = OE_OK;
+
+done:
+    free(p);
+    return result;
+}
+
+oe_result_t oe_get_ecall_index(
+    oe_enclave_t* enclave,
+    const oe_call_table_t* table,
+    uint32_t function_id,
+    uint32_t* index)
+{
+    oe_result_t result = OE_UNEXPECTED;
+    oe_resolved_call_table_t* resolved;
+
+    if (!enclave || !table || !index)
+        OE_RAISE(OE_INVALID_PARAMETER);
+
+    if (function_id >= table->num_ecalls)
+        OE_RAISE(OE_INVALID_PARAMETER);
+
+    if (!(resolved = _find_table(enclave, table)))
+    {
+        oe_mutex_lock(&enclave->lock);
+        result = _resolve_table(enclave, table, &resolved);
+        oe_mutex_unlock(&enclave->lock);
+        OE_CHECK(result);
+    }
+
+    if ((*index = resolved->indices[function_id]) == _NOT_FOUND)
+        OE_RAISE(OE_NOT_FOUND);
+
+    result = OE_OK;
+
+done:
+    return result;
+}
+
+oe_result_t oe_find_ocall_function(
+    oe_enclave_t* enclave,
+    const char* name,
+    uint32_t* id)
+{
+    oe_result_t result = OE_NOT_FOUND;
+
+    if (!enclave || !name || !id)
+        return OE_INVALID_PARAMETER;
+
+    oe_mutex_lock(&enclave->lock);
+
+    if ((*id = _find_ocall(enclave, name)) != _NOT_FOUND)
+        result = OE_OK;
+
+    oe_mutex_unlock(&enclave->lock);
+
+    return result;
+}
+
+oe_result_t oe_add_ocall_function(
+    oe_enclave_t* enclave,
+    const char* name,
+    oe_ocall_func_t func,
+    bool replace,
+    uint32_t* id)
+{
+    oe_result_t result = OE_UNEXPECTED;
+
+    if (!enclave || !name || !*name || !func || !id)
+        OE_RAISE(OE_INVALID_PARAMETER);
+
+    oe_mutex_lock(&enclave->lock);
+    result = _add_ocall(enclave, name, func, replace, id);
+    oe_mutex_unlock(&enclave->lock);
+
+    OE_CHECK(result);
+
+done:
+    return result;
+}
+
+oe_result_t oe_get_ocall_function(
+    oe_enclave_t* enclave,
+    uint32_t id,
+    oe_ocall_func_t* func,
+    const char** name)
+{
+    oe_result_t result = OE_UNEXPECTED;
+    oe_ocall_function_t* entry;
+
+    if (!enclave || !func || !name)
+        OE_RAISE(OE_INVALID_PARAMETER);
+
+    if (id >= oe_atomic_load(&enclave->num_ocall_functions))
+        OE_RAISE(OE_NOT_FOUND);
+
+    entry = &enclave->ocall_functions[id];
+    *func = (oe_ocall_func_t)oe_atomic_load_pointer(
+        (void* volatile*)&entry->func);
+    *name = entry->name;
+
+    result = OE_OK;
+
+done:
+    return result;
+}
+
+oe_result_t oe_register_ocall_function(
+    oe_enclave_t* enclave,
+    const char* name,
+    oe_ocall_func_t func)
+{
+    uint32_t id;
+
+    return oe_add_ocall_function(enclave, name, func, true, &id);
+}
+
+void oe_call_tables_free(oe_enclave_t* enclave)
+{
+    oe_resolved_call_table_t* p = enclave->call_tables;
+
+    while (p)
+    {
+        oe_resolved_call_table_t* next = p->next;
+        free(p);
+        p = next;
+    }
+
+    for (size_t i = 0; i < enclave->num_ocall_functions; i++)
+        free(enclave->ocall_functions[i].name);
+
+    free(enclave->ocall_functions);
+
+    enclave->call_tables = NULL;
+    enclave->ocall_functions = NULL;
+    enclave->num_ocall_functions = 0;
+}
@@ -0,0 +1,59 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#ifndef _OE_HOST_CALLTABLE_H
+#define _OE_HOST_CALLTABLE_H
+
+#include <openenclave/host.h>
+#include <openenclave/internal/calls.h>
+#include "enclave.h"
+
+OE_EXTERNC_BEGIN
+
+/*
+**==============================================================================
+**
+** oe_get_ecall_index()
+**
+**     Get the index in the ECALL pages of the enclave of the function with
+**     the given id in the ECALL table. The table is resolved by name against
+**     the ECALLs of the enclave on first use, and the host functions of its
+**     OCALL table are registered at the same time.
+**
+**==============================================================================
+*/
+
+oe_result_t oe_get_ecall_index(
+    oe_enclave_t* enclave,
+    const oe_call_table_t* table,
+    uint32_t function_id,
+    uint32_t* index);
+
+/* Find the host id of the registered OCALL function with the given name */
+oe_result_t oe_find_ocall_function(
+    oe_enclave_t* enclave,
+    const char* name,
+    uint32_t* id);
+
+/* Register an OCALL function, replacing any function with the same name only
+ * if replace is true, and return its host id */
+oe_result_t oe_add_ocall_function(
+    oe_enclave_t* enclave,
+    const char* name,
+    oe_ocall_func_t func,
+    bool replace,
+    uint32_t* id);
+
+/* Get the OCALL function with the given host id and its name */
+oe_result_t oe_get_ocall_function(
+    oe_enclave_t* enclave,
+    uint32_t id,
+    oe_ocall_func_t* func,
+    const char** name);
+
+/* Release the call tables of the enclave (called on termination) */
+void oe_call_tables_free(oe_enclave_t* enclave);
+
+OE_EXTERNC_END
+
+#endif /* _OE_HOST_CALLTABLE_H */
@@ -0,0 +1,634 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#include "collateralstore.h"
+#include <openenclave/internal/crl.h>
+#include <openenclave/internal/datetime.h>
+#include <openenclave/internal/raise.h>
+#include <openenclave/internal/trace.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "../common/revocation.h"
+#include "sgxquoteprovider.h"
+
+#ifdef OE_USE_LIBSGX
+
+/*
+**==============================================================================
+**
+** Collateral store:
+**
+**     Fetching revocation info from the quote provider may take a network
+**     round trip to the collateral service for each quote that is verified.
+**     The store instead keeps the revocation info of each platform (FMSPC
+**     and CRL URLs) in memory, serves it to the verifier, and has a
+**     background thread fetch it again shortly before the next update of
+**     its TCB info or CRLs. Only the first request for a platform waits for
+**     the provider. Collateral that was not used since its last refresh is
+**     dropped rather than refreshed.
+**
+**     If a refresh fails, the current collateral is served until its
+**     earliest next update. Past that date it is never served: requests
+**     fetch the collateral from the provider (and fail if the provider
+**     does), and the refresher drops it if it cannot replace it.
+**
+**     The store does not validate the collateral; it is verified on every
+**     use by oe_enforce_revocation() as before.
+**
+**==============================================================================
+*/
+
+typedef struct _collateral
+{
+    /* The inputs of the request */
+    uint8_t fmspc[6];
+    char* crl_urls[3];
+    uint32_t num_crl_urls;
+
+    /* The outputs, all in info.host_out_buffer (info.crl_urls is unused) */
+    oe_get_revocation_info_args_t info;
+    size_t buffer_size;
+
+    time_t refresh_time;
+    time_t expiry_time;
+    time_t last_used;
+    bool used;
+
+    struct _collateral* next;
+} collateral_t;
+
+static pthread_mutex_t _lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t _cond = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t _refreshed = PTHREAD_COND_INITIALIZER;
+static collateral_t* _entries;
+static size_t _num_entries;
+static pthread_t _thread;
+static bool _thread_started;
+static bool _shutdown;
+
+/* Incremented when the store is cleared, so that collateral fetched before
+ * (possibly from another provider) is not stored */
+static uint64_t _generation;
+
+/* Size of the buffer that holds all the outputs */
+static size_t _buffer_size(const oe_get_revocation_info_args_t* info)
+{
+    size_t size = info->tcb_info_size + info->tcb_issuer_chain_size;
+
+    for (uint32_t i = 0; i < info->num_crl_urls; i++)
+        size += info->crl_size[i] + info->crl_issuer_chain_size[i];
+
+    return size;
+}
+
+static uint8_t* _rebase(uint8_t* ptr, const uint8_t* from, uint8_t* to)
+{
+    return ptr ? to + (ptr - from) : NULL;
+}
+
+/* Return a copy of the outputs that the caller releases as usual */
+static oe_result_t _copy_out(
+    const collateral_t* entry,
+    oe_get_revocation_info_args_t* args)
+{
+    oe_result_t result = OE_UNEXPECTED;
+    const oe_get_revocation_info_args_t* info = &entry->info;
+    const uint8_t* from = info->host_out_buffer;
+    uint8_t* to;
+
+    if (!(to = (uint8_t*)malloc(entry->buffer_size)))
+        OE_RAISE(OE_OUT_OF_MEMORY);
+
+    memcpy(to, from, entry->buffer_size);
+
+    args->host_out_buffer = to;
+    args->tcb_info = _rebase(info->tcb_info, from, to);
+    args->tcb_info_size = info->tcb_info_size;
+    args->tcb_issuer_chain = _rebase(info->tcb_issuer_chain, from, to);
+    args->tcb_issuer_chain_size = info->tcb_issuer_chain_size;
+
+    for (uint32_t i = 0; i < entry->num_crl_urls; i++)
+    {
+        args->crl[i] = _rebase(info->crl[i], from, to);
+        args->crl_size[i] = info->crl_size[i];
+        args->crl_issuer_chain[i] =
+            _rebase(info->crl_issuer_chain[i], from, to);
+        args->crl_issuer_chain_size[i] = info->crl_issuer_chain_size[i];
+    }
+
+    result = OE_OK;
+
+done:
+    return result;
+}
+
+static bool _matches(
+    const collateral_t* entry,
+    const oe_get_revocation_info_args_t* args)
+{
+    if (memcmp(entry->fmspc, args->fmspc, sizeof(entry->fmspc)) != 0 ||
+        entry->num_crl_urls != args->num_crl_urls)
+        return false;
+
+    for (uint32_t i = 0; i < entry->num_crl_urls; i++)
+    {
+        const char* url = args->crl_urls[i];
+
+        if (!url || strcmp(entry->crl_urls[i], url) != 0)
+            return false;
+    }
+
+    return true;
+}
+
+static collateral_t* _find(const oe_get_revocation_info_args_t* args)
+{
+    for (collateral_t* entry = _entries; entry; entry = entry->next)
+    {
+        if (_matches(entry, args))
+            return entry;
+    }
+
+    return NULL;
+}
+
+static void _free_collateral(collateral_t* entry)
+{
+    for (uint32_t i = 0; i < entry->num_crl_urls; i++)
+        free(entry->crl_urls[i]);
+
+    oe_cleanup_get_revocation_info_args(&entry->info);
+    free(entry);
+}
+
+/* Make a request with the inputs of the given entry (for the refresher) */
+static oe_result_t _copy_request(
+    const collateral_t* entry,
+    oe_get_revocation_info_args_t* args)
+{
+    oe_result_t result = OE_UNEXPECTED;
+
+    memset(args, 0, sizeof(*args));
+    memcpy(args->fmspc, entry->fmspc, sizeof(args->fmspc));
+    args->num_crl_urls = entry->num_crl_urls;
+
+    for (uint32_t i = 0; i < entry->num_crl_urls; i++)
+    {
+        if (!(args->crl_urls[i] = strdup(entry->crl_urls[i])))
+            OE_RAISE(OE_OUT_OF_MEMORY);
+    }
+
+    result = OE_OK;
+
+done:
+    return result;
+}
+
+static void _free_request(oe_get_revocation_info_args_t* args)
+{
+    for (uint32_t i = 0; i < args->num_crl_urls; i++)
+        free((char*)args->crl_urls[i]);
+
+    oe_cleanup_get_revocation_info_args(args);
+}
+
+static time_t _to_time(const oe_datetime_t* datetime)
+{
+    struct tm tm = {0};
+
+    tm.tm_year = (int)datetime->year - 1900;
+    tm.tm_mon = (int)datetime->month - 1;
+    tm.tm_mday = (int)datetime->day;
+    tm.tm_hour = (int)datetime->hours;
+    tm.tm_min = (int)datetime->minutes;
+    tm.tm_sec = (int)datetime->seconds;
+
+    return timegm(&tm);
+}
+
+/* Find the nextUpdate date of the TCB info JSON, which is zero-terminated */
+static time_t _get_tcb_info_next_update(const uint8_t* tcb_info)
+{
+    const char* p;
+    const char* end;
+    oe_datetime_t next_update;
+
+    if (!tcb_info || !(p = strstr((const char*)tcb_info, "\"nextUpdate\"")))
+        return 0;
+
+    p += sizeof("\"nextUpdate\"") - 1;
+
+    while (*p == ' ' || *p == '\t' || *p == '\r' || *p == '\n' || *p == ':')
+        p++;
+
+    if (*p++ != '"' || !(end = strchr(p, '"')))
+        return 0;
+
+    if (oe_datetime_from_string(p, (size_t)(end - p), &next_update) != OE_OK)
+        return 0;
+
+    return _to_time(&next_update);
+}
+
+static time_t _get_crl_next_update(const uint8_t* der, size_t size)
+{
+    oe_crl_t crl;
+    oe_datetime_t last_update;
+    oe_datetime_t next_update;
+    time_t next = 0;
+
+    if (!der || oe_crl_read_der(&crl, der, size) != OE_OK)
+        return 0;
+
+    if (oe_crl_get_update_dates(&crl, &last_update, &next_update) == OE_OK)
+        next = _to_time(&next_update);
+
+    oe_crl_free(&crl);
+
+    return next;
+}
+
+/* Schedule the refresh of the entry ahead of the earliest next update */
+static void _schedule(collateral_t* entry, time_t now)
+{
+    const oe_get_revocation_info_args_t* info = &entry->info;
+    time_t next = _get_tcb_info_next_update(info->tcb_info);
+    time_t refresh;
+
+    for (uint32_t i = 0; i < entry->num_crl_urls; i++)
+    {
+        time_t crl_next =
+            _get_crl_next_update(info->crl[i], info->crl_size[i]);
+
+        if (crl_next > 0 && (next <= 0 || crl_next < next))
+            next = crl_next;
+    }
+
+    entry->expiry_time = next > 0 ? next : 0;
+
+    if (next > 0)
+        refresh = next - OE_COLLATERAL_REFRESH_MARGIN;
+    else
+        refresh = now + OE_COLLATERAL_MAX_REFRESH_INTERVAL;
+
+    if (refresh < now + OE_COLLATERAL_MIN_REFRESH_INTERVAL)
+        refresh = now + OE_COLLATERAL_MIN_REFRESH_INTERVAL;
+
+    if (refresh > now + OE_COLLATERAL_MAX_REFRESH_INTERVAL)
+        refresh = now + OE_COLLATERAL_MAX_REFRESH_INTERVAL;
+
+    entry->refresh_time = refresh;
+}
+
+/* Whether the entry is past its earliest next update (and not served) */
+static bool _is_expired(const collateral_t* entry, time_t now)
+{
+    return entry->expiry_time > 0 && now > entry->expiry_time;
+}
+
+/* Replace the collateral of the entry with fetched collateral, which is
+ * moved into the entry */
+static void _replace(
+    collateral_t* entry,
+    oe_get_revocation_info_args_t* fetched,
+    time_t now)
+{
+    oe_cleanup_get_revocation_info_args(&entry->info);
+    memcpy(&entry->info, fetched, sizeof(*fetched));
+    entry->buffer_size = _buffer_size(fetched);
+    memset(entry->info.crl_urls, 0, sizeof(entry->info.crl_urls));
+    fetched->host_out_buffer = NULL;
+    _schedule(entry, now);
+}
+
+static void _unlink(collateral_t* entry)
+{
+    for (collateral_t** link = &_entries; *link; link = &(*link)->next)
+    {
+        if (*link == entry)
+        {
+            *link = entry->next;
+            _num_entries--;
+            break;
+        }
+    }
+}
+
+/* Refresh the entries that are due until the store is shut down */
+static void* _refresher(void* arg)
+{
+    OE_UNUSED(arg);
+
+    pthread_mutex_lock(&_lock);
+
+    while (!_shutdown)
+    {
+        collateral_t* entry = NULL;
+        oe_get_revocation_info_args_t request;
+        uint64_t generation;
+        oe_result_t r;
+        time_t now;
+
+        /* Wake oe_collateral_store_refresh() on every change */
+        pthread_cond_broadcast(&_refreshed);
+
+        for (collateral_t* e = _entries; e; e = e->next)
+        {
+            if (!entry || e->refresh_time < entry->refresh_time)
+                entry = e;
+        }
+
+        if (!entry)
+        {
+            pthread_cond_wait(&_cond, &_lock);
+            continue;
+        }
+
+        if (entry->refresh_time > (now = time(NULL)))
+        {
+            struct timespec ts = {entry->refresh_time, 0};
+            pthread_cond_timedwait(&_cond, &_lock, &ts);
+            continue;
+        }
+
+        if (!entry->used)
+        {
+            OE_TRACE_INFO("collateralstore: dropping unused collateral\n");
+            _unlink(entry);
+            _free_collateral(entry);
+            continue;
+        }
+
+        if (_copy_request(entry, &request) != OE_OK)
+        {
+            _free_request(&request);
+            entry->refresh_time = now + OE_COLLATERAL_MIN_REFRESH_INTERVAL;
+            continue;
+        }
+
+        /* Fetch without holding the lock, then find the entry again */
+        generation = _generation;
+        pthread_mutex_unlock(&_lock);
+        r = oe_fetch_revocation_info(&request);
+        pthread_mutex_lock(&_lock);
+
+        now = time(NULL);
+
+        if (generation == _generation && (entry = _find(&request)))
+        {
+            if (r == OE_OK)
+            {
+                OE_TRACE_INFO("collateralstore: refreshed collateral\n");
+                _replace(entry, &request, now);
+                entry->used = false;
+            }
+            else if (_is_expired(entry, now))
+            {
+                OE_TRACE_INFO(
+                    "collateralstore: dropping expired collateral: %s\n",
+                    oe_result_str(r));
+                _unlink(entry);
+                _free_collateral(entry);
+            }
+            else
+            {
+                /* Keep serving the current collateral and retry later */
+                OE_TRACE_INFO(
+                    "collateralstore: refresh failed: %s\n",
+                    oe_result_str(r));
+                entry->refresh_time = now + OE_COLLATERAL_MIN_REFRESH_INTERVAL;
+            }
+        }
+
+        _free_request(&request);
+    }
+
+    pthread_cond_broadcast(&_refreshed);
+    pthread_mutex_unlock(&_lock);
+
+    return NULL;
+}
+
+/* Start the refresh thread (called with the lock held) */
+static void _start_refresher(void)
+{
+    if (_thread_started || _shutdown)
+        return;
+
+    if (pthread_create(&_thread, NULL, _refresher, NULL) != 0)
+    {
+        OE_TRACE_INFO("collateralstore: cannot start the refresh thread\n");
+        return;
+    }
+
+    _thread_started = true;
+
+    /* Stop the thread before the provider library is unloaded at exit */
+    atexit(oe_collateral_store_shutdown);
+}
+
+/* Add fetched collateral, evicting the least recently used one if full */
+static collateral_t* _insert(
+    const oe_get_revocation_info_args_t* args,
+    oe_get_revocation_info_args_t* fetched,
+    time_t now)
+{
+    collateral_t* entry;
+
+    if (!(entry = (collateral_t*)calloc(1, sizeof(*entry))))
+        return NULL;
+
+    memcpy(entry->fmspc, args->fmspc, sizeof(entry->fmspc));
+
+    for (uint32_t i = 0; i < args->num_crl_urls; i++)
+    {
+        if (!(entry->crl_urls[i] = strdup(args->crl_urls[i])))
+        {
+            entry->num_crl_urls = i;
+            _free_collateral(entry);
+            return NULL;
+        }
+    }
+
+    entry->num_crl_urls = args->num_crl_urls;
+    _replace(entry, fetched, now);
+
+    if (_num_entries == OE_COLLATERAL_STORE_MAX_ENTRIES)
+    {
+        collateral_t* lru = _entries;
+
+        for (collateral_t* e = _entries; e; e = e->next)
+        {
+            if (e->last_used < lru->last_used)
+                lru = e;
+        }
+
+        _unlink(lru);
+        _free_collateral(lru);
+    }
+
+    entry->last_used = now;
+    entry->used = true;
+
+    entry->next = _entries;
+    _entries = entry;
+    _num_entries++;
+
+    _start_refresher();
+    pthread_cond_signal(&_cond);
+
+    return entry;
+}
+
+oe_result_t oe_collateral_store_get(oe_get_revocation_info_args_t* args)
+{
+    oe_result_t result = OE_UNEXPECTED;
+    oe_get_revocation_info_args_t fetched;
+    collateral_t* entry;
+    uint64_t generation;
+
+    if (!args || args->num_crl_urls > OE_COUNTOF(args->crl_urls))
+        OE_RAISE(OE_INVALID_PARAMETER);
+
+    for (uint32_t i = 0; i < args->num_crl_urls; i++)
+    {
+        if (!args->crl_urls[i])
+            OE_RAISE(OE_INVALID_PARAMETER);
+    }
+
+    pthread_mutex_lock(&_lock);
+    {
+        time_t now = time(NULL);
+
+        if ((entry = _find(args)) && _is_expired(entry, now))
+        {
+            OE_TRACE_INFO("collateralstore: collateral expired\n");
+            entry = NULL;
+        }
+        else if (entry)
+        {
+            entry->last_used = now;
+            entry->used = true;
+            result = _copy_out(entry, args);
+        }
+
+        generation = _generation;
+    }
+    pthread_mutex_unlock(&_lock);
+
+    if (entry)
+        goto done;
+
+    /* Not in the store yet (or expired), so wait for the provider */
+    memcpy(&fetched, args, sizeof(fetched));
+    OE_CHECK(oe_fetch_revocation_info(&fetched));
+
+    pthread_mutex_lock(&_lock);
+    {
+        time_t now = time(NULL);
+
+        /* Do not store collateral fetched before the store was cleared */
+        if (generation != _generation)
+        {
+            entry = NULL;
+        }
+        else if (!(entry = _find(args)))
+        {
+            entry = _insert(args, &fetched, now);
+        }
+        else if (_is_expired(entry, now))
+        {
+            _replace(entry, &fetched, now);
+            entry->last_used = now;
+            entry->used = true;
+        }
+
+        /* Another thread may have stored newer collateral meanwhile */
+        if (entry)
+            result = _copy_out(entry, args);
+    }
+    pthread_mutex_unlock(&_lock);
+
+    /* Serve the fetched collateral even if it could not be stored */
+    if (!entry)
+    {
+        memcpy(args, &fetched, sizeof(fetched));
+        fetched.host_out_buffer = NULL;
+        result = OE_OK;
+    }
+
+    oe_cleanup_get_revocation_info_args(&fetched);
+
+done:
+    return result;
+}
+
+void oe_collateral_store_clear(void)
+{
+    pthread_mutex_lock(&_lock);
+
+    while (_entries)
+    {
+        collateral_t* entry = _entries;
+        _entries = entry->next;
+        _free_collateral(entry);
+    }
+
+    _num_entries = 0;
+    _generation++;
+    pthread_cond_signal(&_cond);
+    pthread_mutex_unlock(&_lock);
+}
+
+/* Whether an entry is due for a refresh at the given time (called with the
+ * lock held) */
+static bool _has_due_entries(time_t when)
+{
+    for (collateral_t* entry = _entries; entry; entry = entry->next)
+    {
+        if (entry->refresh_time <= when)
+            return true;
+    }
+
+    return false;
+}
+
+void oe_collateral_store_refresh(void)
+{
+    time_t now;
+
+    pthread_mutex_lock(&_lock);
+
+    now = time(NULL);
+
+    for (collateral_t* entry = _entries; entry; entry = entry->next)
+        entry->refresh_time = now;
+
+    pthread_cond_signal(&_cond);
+
+    while (_thread_started && _has_due_entries(now))
+        pthread_cond_wait(&_refreshed, &_lock);
+
+    pthread_mutex_unlock(&_lock);
+}
+
+void oe_collateral_store_shutdown(void)
+{
+    bool started;
+
+    pthread_mutex_lock(&_lock);
+    _shutdown = true;
+    started = _thread_started;
+    _thread_started = false;
+    pthread_cond_signal(&_cond);
+    pthread_mutex_unlock(&_lock);
+
+    if (started)
+        pthread_join(_thread, NULL);
+
+    oe_collateral_store_clear();
+}
+
+#endif
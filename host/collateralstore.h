@@ -0,0 +1,58 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#ifndef _OE_HOST_COLLATERALSTORE_H
+#define _OE_HOST_COLLATERALSTORE_H
+
+#include <openenclave/bits/defs.h>
+#include <openenclave/bits/result.h>
+#include <openenclave/internal/report.h>
+
+OE_EXTERNC_BEGIN
+
+#ifdef OE_USE_LIBSGX
+
+/* Maximum number of platforms (FMSPC and CRL URLs) kept by the store */
+#define OE_COLLATERAL_STORE_MAX_ENTRIES 32
+
+/* Collateral is refreshed this many seconds before its next update */
+#define OE_COLLATERAL_REFRESH_MARGIN 3600
+
+/* Bounds of the interval between two refreshes of the same collateral */
+#define OE_COLLATERAL_MIN_REFRESH_INTERVAL 60
+#define OE_COLLATERAL_MAX_REFRESH_INTERVAL (24 * 3600)
+
+/*
+**==============================================================================
+**
+** oe_collateral_store_get()
+**
+**     Get the revocation info (TCB info, CRLs and their issuer chains) for
+**     the FMSPC and CRL URLs of the given arguments. Collateral that was
+**     fetched before is served from the store; otherwise it is fetched from
+**     the quote provider and added to the store. A background thread then
+**     fetches it again ahead of its next update. Collateral past its next
+**     update is fetched again, and an error is returned if that fails.
+**     The outputs are returned as by oe_fetch_revocation_info() and are
+**     released with oe_cleanup_get_revocation_info_args().
+**
+**==============================================================================
+*/
+
+oe_result_t oe_collateral_store_get(oe_get_revocation_info_args_t* args);
+
+/* Drop all the collateral of the store */
+void oe_collateral_store_clear(void);
+
+/* Refresh all the collateral of the store now and wait until done (for
+ * tests; the refresh thread does this ahead of the next updates) */
+void oe_collateral_store_refresh(void);
+
+/* Stop the refresh thread and drop all the collateral of the store */
+void oe_collateral_store_shutdown(void);
+
+#endif
+
+OE_EXTERNC_END
+
+#endif // _OE_HOST_COLLATERALSTORE_H
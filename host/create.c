@@ -28,10 +28,16 @@
 #include <openenclave/internal/trace.h>
 #include <openenclave/internal/utils.h>
 #include <string.h>
+#include "asyncocall.h"
+#include "callstats.h"
+#include "calltable.h"
 #include "cpuid.h"
 #include "enclave.h"
 #include "memalign.h"
+#include "profiler.h"
 #include "sgxload.h"
+#include "symbols.h"
+#include "threadpool.h"
 
 static oe_once_type _enclave_init_once;
 
@@ -255,11 +261,23 @@ static oe_result_t _add_heap_pages(
     return _add_filled_pages(context, enclave_addr, vaddr, npages, 0, extend);
 }
 
+/* Number of TLS pages per TCS: the TLS block and the thread control block */
+static size_t _get_num_tls_pages(const oe_tls_segment_t* tls)
+{
+    if (!tls->memsz)
+        return 0;
+
+    uint64_t block_size = __oe_tls_segment_block_size(tls);
+
+    return __oe_round_up_to_page_size(block_size) / OE_PAGE_SIZE + 1;
+}
+
 static oe_result_t _add_control_pages(
     oe_sgx_load_context_t* context,
     uint64_t enclave_addr,
     uint64_t enclave_size,
     uint64_t entry,
+    size_t num_tls_pages,
     uint64_t* vaddr,
     oe_enclave_t* enclave)
 {
@@ -276,6 +294,10 @@ static oe_result_t _add_control_pages(
      *     page4 - guard page
      *     page5 - segment space for fs or gs register (holds thread data).
      *     page6 - extra segment space for thread-specific data.
+     *
+     * If the image has a PT_TLS segment, these are followed by the static
+     * TLS block and by the thread control block, to which the fs register
+     * points (see _get_num_tls_pages()).
      */
 
     /* Save the address of new TCS page into enclave object */
@@ -312,8 +334,12 @@ static oe_result_t _add_control_pages(
         /* The entry point for the program (from ELF) */
         tcs->oentry = entry;
 
-        /* FS segment: points to page following SSA slots (page[3]) */
-        tcs->fsbase = *vaddr + (4 * OE_PAGE_SIZE);
+        /* FS segment: points to page following SSA slots (page[3]), or to
+         * the thread control block that follows the TLS block */
+        if (num_tls_pages)
+            tcs->fsbase = *vaddr + ((5 + num_tls_pages) * OE_PAGE_SIZE);
+        else
+            tcs->fsbase = *vaddr + (4 * OE_PAGE_SIZE);
 
         /* GS segment: points to page following SSA slots (page[3]) */
         tcs->gsbase = *vaddr + (4 * OE_PAGE_SIZE);
@@ -352,6 +378,15 @@ static oe_result_t _add_control_pages(
     /* Add one page for thread-specific data (TSD) slots */
     OE_CHECK(_add_filled_pages(context, enclave_addr, vaddr, 1, 0, true));
 
+    /* Add the TLS block and thread control block pages (initialized by the
+     * enclave, since the TLS image may contain relocated addresses) */
+    if (num_tls_pages)
+    {
+        OE_CHECK(
+            _add_filled_pages(
+                context, enclave_addr, vaddr, num_tls_pages, 0, true));
+    }
+
     result = OE_OK;
 
 done:
@@ -366,6 +401,7 @@ static oe_result_t _calculate_enclave_size(
     size_t nheappages,
     size_t nstackpages,
     size_t num_bindings,
+    size_t num_tls_pages,
     size_t* enclave_end, /* end may be less than size due to rounding */
     size_t* enclave_size)
 {
@@ -393,8 +429,8 @@ static oe_result_t _calculate_enclave_size(
     /* Compute size of the stack (one per TCS; include guard pages) */
     stack_size = OE_PAGE_SIZE + (nstackpages * OE_PAGE_SIZE) + OE_PAGE_SIZE;
 
-    /* Compute the control size in bytes (6 pages total) */
-    control_size = 6 * OE_PAGE_SIZE;
+    /* Compute the control size in bytes (6 pages and the TLS pages) */
+    control_size = (6 + num_tls_pages) * OE_PAGE_SIZE;
 
     /* Compute end of the enclave */
     *enclave_end = segments_size + reloc_size + ecall_size + heap_size +
@@ -531,6 +567,7 @@ static oe_result_t _add_pages(
     size_t nheappages,
     size_t nstackpages,
     size_t num_bindings,
+    const oe_tls_segment_t* tls,
     oe_enclave_t* enclave)
 {
     oe_result_t result = OE_UNEXPECTED;
@@ -544,7 +581,7 @@ static oe_result_t _add_pages(
 
     /* Reject invalid parameters */
     if (!context || !enclave_addr || !enclave_size || !segments || !nsegments ||
-        !num_bindings || !nstackpages || !nheappages || !enclave)
+        !num_bindings || !nstackpages || !nheappages || !tls || !enclave)
     {
         OE_RAISE(OE_INVALID_PARAMETER);
     }
@@ -658,6 +695,35 @@ static oe_result_t _add_pages(
         OE_CHECK(_patch_page(segpages, nsegpages, sym.st_value, sym.st_value));
     }
 
+    /* Patch the TLS variables (only needed if the image uses TLS) */
+    if (tls->memsz)
+    {
+        elf64_sym_t sym;
+
+        if (elf64_find_dynamic_symbol_by_name(
+                elf, "oe_tls_image_vaddr", &sym) != 0)
+            OE_RAISE(OE_FAILURE);
+
+        OE_CHECK(_patch_page(segpages, nsegpages, sym.st_value, tls->vaddr));
+
+        if (elf64_find_dynamic_symbol_by_name(
+                elf, "oe_tls_image_size", &sym) != 0)
+            OE_RAISE(OE_FAILURE);
+
+        OE_CHECK(_patch_page(segpages, nsegpages, sym.st_value, tls->filesz));
+
+        if (elf64_find_dynamic_symbol_by_name(
+                elf, "oe_tls_block_size", &sym) != 0)
+            OE_RAISE(OE_FAILURE);
+
+        OE_CHECK(
+            _patch_page(
+                segpages,
+                nsegpages,
+                sym.st_value,
+                __oe_tls_segment_block_size(tls)));
+    }
+
     /* Add the program segments first */
     OE_CHECK(
         _add_segment_pages(
@@ -697,7 +763,13 @@ static oe_result_t _add_pages(
         /* Add the "control" pages */
         OE_CHECK(
             _add_control_pages(
-                context, enclave_addr, enclave_size, entry, &vaddr, enclave));
+                context,
+                enclave_addr,
+                enclave_size,
+                entry,
+                _get_num_tls_pages(tls),
+                &vaddr,
+                enclave));
     }
 
     if (vaddr != enclave_end)
@@ -1155,6 +1227,15 @@ oe_result_t oe_sgx_validate_enclave_properties(
         goto done;
     }
 
+    if (!oe_sgx_is_valid_num_host_stack_pages(
+            properties->config.num_host_stack_pages))
+    {
+        if (field_name)
+            *field_name = "config.num_host_stack_pages";
+        result = OE_FAILURE;
+        goto done;
+    }
+
     if (!oe_sgx_is_valid_product_id(properties->config.product_id))
     {
         if (field_name)
@@ -1198,6 +1279,7 @@ oe_result_t oe_sgx_build_enclave(
     void* ecall_data = NULL;
     size_t ecall_size;
     oe_sgx_enclave_properties_t props;
+    oe_tls_segment_t tls;
 
     memset(&elf, 0, sizeof(elf64_t));
 
@@ -1257,7 +1339,7 @@ oe_result_t oe_sgx_build_enclave(
     /* Load the program segments into memory */
     OE_CHECK(
         __oe_load_segments(
-            path, segments, &num_segments, &entry_addr, &start_addr));
+            path, segments, &num_segments, &entry_addr, &start_addr, &tls));
 
     /* Load the relocations into memory (zero-padded to next page size) */
     if (elf64_load_relocations(&elf, &reloc_data, &reloc_size) != OE_OK)
@@ -1283,6 +1365,7 @@ oe_result_t oe_sgx_build_enclave(
             props.header.size_settings.num_heap_pages,
             props.header.size_settings.num_stack_pages,
             props.header.size_settings.num_tcs,
+            _get_num_tls_pages(&tls),
             &enclave_end,
             &enclave_size));
 
@@ -1293,6 +1376,12 @@ oe_result_t oe_sgx_build_enclave(
     enclave->addr = enclave_addr;
     enclave->size = enclave_size;
 
+    /* Save the size of the per-TCS host marshalling stacks */
+    enclave->host_stack_size =
+        (props.config.num_host_stack_pages ? props.config.num_host_stack_pages
+                                           : OE_SGX_DEFAULT_HOST_STACK_PAGES) *
+        OE_PAGE_SIZE;
+
     /* Clear certain ELF header fields */
     for (i = 0; i < num_segments; i++)
     {
@@ -1326,6 +1415,7 @@ oe_result_t oe_sgx_build_enclave(
             props.header.size_settings.num_heap_pages,
             props.header.size_settings.num_stack_pages,
             props.header.size_settings.num_tcs,
+            &tls,
             enclave));
 
     /* Ask the platform to initialize the enclave and finalize the hash */
@@ -1336,6 +1426,10 @@ oe_result_t oe_sgx_build_enclave(
     /* Save the offset of the .text section */
     OE_CHECK(_save_text_address(enclave, &elf));
 
+    /* Index the function symbols for symbolizing enclave addresses */
+    if (context->type == OE_SGX_LOAD_TYPE_CREATE)
+        OE_CHECK(oe_symbols_build(enclave, &elf));
+
     /* Save path of this enclave */
     if (!(enclave->path = oe_strdup(path)))
         OE_RAISE(OE_OUT_OF_MEMORY);
@@ -1508,9 +1602,21 @@ oe_result_t oe_terminate_enclave(oe_enclave_t* enclave)
     if (!enclave || enclave->magic != ENCLAVE_MAGIC)
         OE_RAISE(OE_INVALID_PARAMETER);
 
-    /* Call the enclave destructor */
+    /* Finish pending asynchronous OCALLs and stop their worker threads */
+    oe_async_ocall_pool_free(enclave);
+
+    /* Drop the threads created by the enclave that did not start yet */
+    oe_thread_pool_shutdown(enclave);
+
+    /* Call the enclave destructor, which stops its task runtime */
     OE_CHECK(oe_ecall(enclave, OE_ECALL_DESTRUCTOR, 0, NULL));
 
+    /* Wait for the threads created by the enclave that are running */
+    oe_thread_pool_free(enclave);
+
+    /* Stop sampling the enclave before its memory is released */
+    oe_profiler_free(enclave);
+
     /* Notify GDB that this enclave is terminated */
     _oe_notify_gdb_enclave_termination(
         enclave, enclave->path, (uint32_t)strlen(enclave->path));
@@ -1549,8 +1655,21 @@ oe_result_t oe_terminate_enclave(oe_enclave_t* enclave)
 
 #endif
 
+        /* Release the host marshalling stacks */
+        for (size_t i = 0; i < enclave->num_bindings; i++)
+            free(enclave->bindings[i].host_stack);
+
         /* Free the path name of the enclave image file */
         free(enclave->path);
+
+        /* Release the call statistics (if ever enabled) */
+        oe_call_stats_free(enclave);
+
+        /* Release the registered OCALLs and resolved ECALL tables */
+        oe_call_tables_free(enclave);
+
+        /* Release the symbol index */
+        oe_symbols_free(enclave);
     }
     /* Release and destroy the mutex object */
     oe_mutex_unlock(&enclave->lock);
@@ -180,42 +180,6 @@ done:
     return result;
 }
 
-/* Clone the certificate to clear any verification state */
-static X509* _clone_x509(X509* x509)
-{
-    X509* ret = NULL;
-    BIO* out = NULL;
-    BIO* in = NULL;
-    BUF_MEM* mem;
-
-    if (!x509)
-        goto done;
-
-    if (!(out = BIO_new(BIO_s_mem())))
-        goto done;
-
-    if (!PEM_write_bio_X509(out, x509))
-        goto done;
-
-    if (!BIO_get_mem_ptr(out, &mem))
-        goto done;
-
-    if (!(in = BIO_new_mem_buf(mem->data, mem->length)))
-        goto done;
-
-    ret = PEM_read_bio_X509(in, NULL, 0, NULL);
-
-done:
-
-    if (out)
-        BIO_free(out);
-
-    if (in)
-        BIO_free(in);
-
-    return ret;
-}
-
 /* Needed because some versions of OpenSSL do not support X509_up_ref() */
 static int _X509_up_ref(X509* x509)
 {
@@ -226,16 +190,6 @@ static int _X509_up_ref(X509* x509)
     return 1;
 }
 
-/* Needed because some versions of OpenSSL do not support X509_CRL_up_ref() */
-static int _X509_CRL_up_ref(X509_CRL* x509_crl)
-{
-    if (!x509_crl)
-        return 0;
-
-    CRYPTO_add(&x509_crl->references, 1, CRYPTO_LOCK_X509_CRL);
-    return 1;
-}
-
 static oe_result_t _cert_chain_get_length(const CertChain* impl, int* length)
 {
     oe_result_t result = OE_UNEXPECTED;
@@ -254,78 +208,33 @@ done:
     return result;
 }
 
-static STACK_OF(X509) * _clone_chain(STACK_OF(X509) * chain)
-{
-    STACK_OF(X509)* sk = NULL;
-    int n = sk_X509_num(chain);
-
-    if (!(sk = sk_X509_new(NULL)))
-        return NULL;
-
-    for (int i = 0; i < n; i++)
-    {
-        X509* x509;
-
-        if (!(x509 = sk_X509_value(chain, (int)i)))
-            return NULL;
-
-        if (!(x509 = _clone_x509(x509)))
-            return NULL;
+/*
+**==============================================================================
+**
+** _get_store()
+**
+**     Return the X509 store shared by all verifications. The store is empty:
+**     the trusted certificates are passed to each verification context with
+**     X509_STORE_CTX_trusted_stack() and the CRLs with
+**     X509_STORE_CTX_set0_crls(). It is only needed because OpenSSL looks up
+**     the CRLs of the issuers that are not in the given CRLs in the store.
+**     Creating a store for each verification is comparatively expensive.
+**
+**==============================================================================
+*/
 
-        if (!sk_X509_push(sk, x509))
-            return NULL;
-    }
+static pthread_once_t _store_once = PTHREAD_ONCE_INIT;
+static X509_STORE* _store;
 
-    return sk;
+static void _create_store(void)
+{
+    _store = X509_STORE_new();
 }
 
-static oe_result_t _verify_cert(X509* cert_, STACK_OF(X509) * chain_)
+static X509_STORE* _get_store(void)
 {
-    oe_result_t result = OE_UNEXPECTED;
-    X509_STORE_CTX* ctx = NULL;
-    X509* cert = NULL;
-    STACK_OF(X509)* chain = NULL;
-
-    /* Clone the certificate to clear any cached verification state */
-    if (!(cert = _clone_x509(cert_)))
-        OE_RAISE(OE_FAILURE);
-
-    /* Clone the chain to clear any cached verification state */
-    if (!(chain = _clone_chain(chain_)))
-        OE_RAISE(OE_FAILURE);
-
-    /* Create a context for verification */
-    if (!(ctx = X509_STORE_CTX_new()))
-        OE_RAISE(OE_FAILURE);
-
-    /* Initialize the context that will be used to verify the certificate */
-    if (!X509_STORE_CTX_init(ctx, NULL, NULL, NULL))
-        OE_RAISE(OE_FAILURE);
-
-    /* Inject the certificate into the verification context */
-    X509_STORE_CTX_set_cert(ctx, cert);
-
-    /* Set the CA chain into the verification context */
-    X509_STORE_CTX_trusted_stack(ctx, chain);
-
-    /* Finally verify the certificate */
-    if (!X509_verify_cert(ctx))
-        OE_RAISE(OE_FAILURE);
-
-    result = OE_OK;
-
-done:
-
-    if (cert)
-        X509_free(cert);
-
-    if (chain)
-        sk_X509_pop_free(chain, X509_free);
-
-    if (ctx)
-        X509_STORE_CTX_free(ctx);
-
-    return result;
+    pthread_once(&_store_once, _create_store);
+    return _store;
 }
 
 // Find the last certificate in the chain and then verify that it's a
@@ -352,21 +261,26 @@ static X509* _find_root_cert(STACK_OF(X509) * chain)
     return x509;
 }
 
-/* Verify each certificate in the chain against its predecessor. */
+/* Verify that the chain (sorted from leaf to root) is a single path from the
+ * leaf to the root. The leaf is verified once, with the root as the only
+ * trusted certificate and the intermediate certificates as untrusted ones.
+ * The path built by OpenSSL must then contain every certificate, so each
+ * one has been verified against its issuer. */
 static oe_result_t _verify_whole_chain(STACK_OF(X509) * chain)
 {
     oe_result_t result = OE_UNEXPECTED;
+    X509_STORE_CTX* ctx = NULL;
+    STACK_OF(X509)* trusted = NULL;
+    STACK_OF(X509)* untrusted = NULL;
+    STACK_OF(X509)* verified;
+    X509_STORE* store;
     X509* root;
-    STACK_OF(X509)* subchain = NULL;
+    X509* leaf;
     int n;
 
     if (!chain)
         OE_RAISE(OE_INVALID_PARAMETER);
 
-    /* Get the root certificate */
-    if (!(root = _find_root_cert(chain)))
-        OE_RAISE(OE_FAILURE);
-
     /* Get number of certificates in the chain */
     n = sk_X509_num(chain);
 
@@ -374,43 +288,65 @@ static oe_result_t _verify_whole_chain(STACK_OF(X509) * chain)
     if (n < 1)
         OE_RAISE(OE_FAILURE);
 
-    /* Create a subchain that grows to include the whole chain */
-    if (!(subchain = sk_X509_new_null()))
-        OE_RAISE(OE_OUT_OF_MEMORY);
+    /* Get the root certificate */
+    if (!(root = _find_root_cert(chain)))
+        OE_RAISE(OE_FAILURE);
 
-    /* Add the root certificate to the subchain */
-    {
-        _X509_up_ref(root);
+    if (!(leaf = sk_X509_value(chain, 0)))
+        OE_RAISE(OE_FAILURE);
 
-        if (!sk_X509_push(subchain, root))
-            OE_RAISE(OE_FAILURE);
-    }
+    /* The stacks share the certificates of the chain (not reference counted
+     * since they are released with sk_X509_free()) */
+    if (!(trusted = sk_X509_new_null()) || !(untrusted = sk_X509_new_null()))
+        OE_RAISE(OE_OUT_OF_MEMORY);
 
-    /* Verify each certificate in the chain against the subchain */
-    for (int i = sk_X509_num(chain) - 1; i >= 0; i--)
+    if (!sk_X509_push(trusted, root))
+        OE_RAISE(OE_OUT_OF_MEMORY);
+
+    for (int i = 1; i < n - 1; i++)
     {
         X509* cert = sk_X509_value(chain, i);
 
         if (!cert)
             OE_RAISE(OE_FAILURE);
 
-        OE_CHECK(_verify_cert(cert, subchain));
+        if (!sk_X509_push(untrusted, cert))
+            OE_RAISE(OE_OUT_OF_MEMORY);
+    }
 
-        /* Add this certificate to the subchain */
-        {
-            _X509_up_ref(cert);
+    /* Create a context for verification */
+    if (!(ctx = X509_STORE_CTX_new()))
+        OE_RAISE(OE_FAILURE);
 
-            if (!sk_X509_push(subchain, cert))
-                OE_RAISE(OE_FAILURE);
-        }
-    }
+    if (!(store = _get_store()))
+        OE_RAISE(OE_OUT_OF_MEMORY);
+
+    if (!X509_STORE_CTX_init(ctx, store, leaf, untrusted))
+        OE_RAISE(OE_FAILURE);
+
+    X509_STORE_CTX_trusted_stack(ctx, trusted);
+
+    if (!X509_verify_cert(ctx))
+        OE_RAISE(OE_FAILURE);
+
+    /* Every certificate of the chain must be on the verified path, which
+     * only contains certificates of the chain */
+    if (!(verified = X509_STORE_CTX_get_chain(ctx)) ||
+        sk_X509_num(verified) != n)
+        OE_RAISE(OE_FAILURE);
 
     result = OE_OK;
 
 done:
 
-    if (subchain)
-        sk_X509_pop_free(subchain, X509_free);
+    if (ctx)
+        X509_STORE_CTX_free(ctx);
+
+    if (trusted)
+        sk_X509_free(trusted);
+
+    if (untrusted)
+        sk_X509_free(untrusted);
 
     return result;
 }
@@ -576,7 +512,7 @@ oe_result_t oe_cert_chain_free(oe_cert_chain_t* chain)
     CertChain* impl = (CertChain*)chain;
 
     /* Check the parameter */
-    if (_cert_chain_is_valid(impl))
+    if (!_cert_chain_is_valid(impl))
         OE_RAISE(OE_INVALID_PARAMETER);
 
     /* Release the stack of certificates */
@@ -591,6 +527,38 @@ done:
     return result;
 }
 
+oe_result_t oe_cert_chain_share(
+    const oe_cert_chain_t* chain,
+    oe_cert_chain_t* shared)
+{
+    oe_result_t result = OE_UNEXPECTED;
+    const CertChain* impl = (const CertChain*)chain;
+    CertChain* shared_impl = (CertChain*)shared;
+    STACK_OF(X509) * sk;
+
+    /* Clear the implementation (making it invalid) */
+    _cert_chain_clear(shared_impl);
+
+    /* Check the parameters */
+    if (!_cert_chain_is_valid(impl) || !shared_impl)
+        OE_RAISE(OE_INVALID_PARAMETER);
+
+    /* Copy the stack, which shares the certificates */
+    if (!(sk = sk_X509_dup(impl->sk)))
+        OE_RAISE(OE_OUT_OF_MEMORY);
+
+    /* Increment the reference counts of the certificates */
+    for (int i = 0; i < sk_X509_num(sk); i++)
+        _X509_up_ref(sk_X509_value(sk, i));
+
+    _cert_chain_init(shared_impl, sk);
+
+    result = OE_OK;
+
+done:
+    return result;
+}
+
 oe_result_t oe_cert_verify(
     oe_cert_t* cert,
     oe_cert_chain_t* chain,
@@ -602,7 +570,8 @@ oe_result_t oe_cert_verify(
     Cert* cert_impl = (Cert*)cert;
     CertChain* chain_impl = (CertChain*)chain;
     X509_STORE_CTX* ctx = NULL;
-    X509_STORE* store = NULL;
+    X509_STORE* store;
+    STACK_OF(X509_CRL)* crl_stack = NULL;
     X509* x509 = NULL;
 
     /* Initialize error to NULL for now */
@@ -623,17 +592,6 @@ oe_result_t oe_cert_verify(
         OE_RAISE(OE_INVALID_PARAMETER);
     }
 
-    /* We must make a copy of the certificate, else previous successful
-     * verifications cause subsequent bad verifications to succeed. It is
-     * likely that some state is stored in the certificate upon successful
-     * verification. We can clear this by making a copy.
-     */
-    if (!(x509 = _clone_x509(cert_impl->x509)))
-    {
-        _set_err(error, "invalid X509 certificate");
-        OE_RAISE(OE_FAILURE);
-    }
-
     /* Initialize OpenSSL (if not already initialized) */
     oe_initialize_openssl();
 
@@ -644,8 +602,8 @@ oe_result_t oe_cert_verify(
         OE_RAISE(OE_FAILURE);
     }
 
-    /* Create a store for the verification */
-    if (!(store = X509_STORE_new()))
+    /* Get the shared store */
+    if (!(store = _get_store()))
     {
         _set_err(error, "failed to allocate X509 store");
         OE_RAISE(OE_FAILURE);
@@ -658,6 +616,18 @@ oe_result_t oe_cert_verify(
         OE_RAISE(OE_FAILURE);
     }
 
+    /* On success, X509_verify_cert() marks the certificate as valid and
+     * later verifications skip its signature check, so a certificate that
+     * was verified against one chain would be accepted with another one.
+     * Verify a copy, since the certificate may be shared with other threads
+     * (for example through a cached chain). The certificates of the chain
+     * are only ever verified against the issuers in the same chain. */
+    if (!(x509 = X509_dup(cert_impl->x509)))
+    {
+        _set_err(error, "failed to copy certificate");
+        OE_RAISE(OE_OUT_OF_MEMORY);
+    }
+
     /* Set the certificate into the verification context */
     X509_STORE_CTX_set_cert(ctx, x509);
 
@@ -669,16 +639,20 @@ oe_result_t oe_cert_verify(
     {
         X509_VERIFY_PARAM* verify_param;
 
+        /* The stack shares the CRLs (released with sk_X509_CRL_free()) */
+        if (!(crl_stack = sk_X509_CRL_new_null()))
+            OE_RAISE(OE_OUT_OF_MEMORY);
+
         for (size_t i = 0; i < num_crls; i++)
         {
             crl_t* crl_impl = (crl_t*)crls[i];
 
-            _X509_CRL_up_ref(crl_impl->crl);
-
-            if (!X509_STORE_add_crl(store, crl_impl->crl))
-                OE_RAISE(OE_FAILURE);
+            if (!sk_X509_CRL_push(crl_stack, crl_impl->crl))
+                OE_RAISE(OE_OUT_OF_MEMORY);
         }
 
+        X509_STORE_CTX_set0_crls(ctx, crl_stack);
+
         /* Get the verify parameter (must not be null) */
         if (!(verify_param = X509_STORE_CTX_get0_param(ctx)))
             OE_RAISE(OE_FAILURE);
@@ -703,8 +677,8 @@ done:
     if (ctx)
         X509_STORE_CTX_free(ctx);
 
-    if (store)
-        X509_STORE_free(store);
+    if (crl_stack)
+        sk_X509_CRL_free(crl_stack);
 
     if (x509)
         X509_free(x509);
@@ -712,6 +686,17 @@ done:
     return result;
 }
 
+oe_result_t oe_cert_verify_with_verified_chain(
+    oe_cert_t* cert,
+    oe_cert_chain_t* chain,
+    const oe_crl_t* const* crls,
+    size_t num_crls,
+    oe_verify_cert_error_t* error)
+{
+    /* OpenSSL verifies the whole path to the root anyway */
+    return oe_cert_verify(cert, chain, crls, num_crls, error);
+}
+
 oe_result_t oe_cert_get_rsa_public_key(
     const oe_cert_t* cert,
     oe_rsa_public_key_t* public_key)
@@ -75,6 +75,9 @@ typedef struct _thread_binding
 
     /* Event signaling object for enclave threading implementation */
     EnclaveEvent event;
+
+    /* Host marshalling stack of this TCS (allocated on first binding) */
+    void* host_stack;
 } ThreadBinding;
 
 OE_STATIC_ASSERT(OE_OFFSETOF(ThreadBinding, tcs) == ThreadBinding_tcs);
@@ -122,6 +125,35 @@ struct _oe_enclave
 
     /* Simulation mode */
     bool simulate;
+
+    /* Size of the host marshalling stack of each TCS */
+    size_t host_stack_size;
+
+    /* Whether call statistics are collected (see callstats.h) */
+    bool call_stats_enabled;
+
+    /* Call statistics (allocated when first enabled) */
+    struct _oe_call_stats_table* call_stats;
+
+    /* Worker threads of asynchronous OCALLs (see asyncocall.h) */
+    struct _oe_async_ocall_pool* async_ocall_pool;
+    size_t num_async_ocall_threads;
+
+    /* Host threads running enclave threads (see threadpool.h) */
+    struct _oe_thread_pool* thread_pool;
+
+    /* OCALL functions by host id and resolved ECALL tables (see calltable.h)
+     */
+    struct _oe_ocall_function* ocall_functions;
+    uint64_t num_ocall_functions;
+    struct _oe_resolved_call_table* call_tables;
+
+    /* Function symbols of the enclave image sorted by address (see
+     * symbols.h) */
+    struct _oe_symbol_index* symbols;
+
+    /* Samples of the CPU profiler (see profiler.h) */
+    struct _oe_profiler* profiler;
 };
 
 /* Get the event for the given TCS */
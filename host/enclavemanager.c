@@ -4,23 +4,84 @@
 #include "enclave.h"
 #include <assert.h>
 #include <openenclave/host.h>
-#include <openenclave/internal/queue.h>
+#include <openenclave/internal/atomic.h>
+#include <stdlib.h>
+#include <string.h>
 
-static OE_LIST_HEAD(EnclaveListHead, _enclave_entry) g_enclave_list_head;
-static oe_mutex g_enclave_list_lock = OE_H_MUTEX_INITIALIZER;
+/*
+**==============================================================================
+**
+** Enclave map:
+**
+**     The enclaves are indexed by their address range, in an immutable array
+**     sorted by base address. The exception handler searches it without
+**     locks to find the enclave that owns a TCS.
+**
+**     Pushing or removing an enclave (under g_enclave_map_lock) publishes a
+**     new array, and frees the previous one once no lookup may still use it.
+**     Each lookup counts itself in one of two reader counters, selected by
+**     the parity of g_enclave_map_phase. The writer flips the phase twice,
+**     each time waiting for the readers of the previous parity to finish:
+**     lookups never wait, and new lookups cannot delay the writer forever.
+**
+**==============================================================================
+*/
 
-typedef struct _enclave_entry
+typedef struct _enclave_range
 {
-    OE_LIST_ENTRY(_enclave_entry) next_entry;
+    uint64_t start;
+    uint64_t end;
     oe_enclave_t* enclave;
-} EnclaveEntry;
+} EnclaveRange;
+
+typedef struct _enclave_map
+{
+    size_t count;
+    OE_ZERO_SIZED_ARRAY EnclaveRange ranges[];
+} EnclaveMap;
+
+static EnclaveMap* g_enclave_map;
+static uint64_t g_enclave_map_phase;
+static uint64_t g_enclave_map_readers[2];
+static oe_mutex g_enclave_map_lock = OE_H_MUTEX_INITIALIZER;
+
+/* Publish the new map and free the old one when no lookup uses it any more
+ * (called with the lock held) */
+static void _publish_enclave_map(EnclaveMap* map)
+{
+    EnclaveMap* old = g_enclave_map;
+
+    oe_atomic_store_pointer((void* volatile*)&g_enclave_map, map);
+
+    for (int i = 0; i < 2; i++)
+    {
+        uint64_t phase = oe_atomic_increment(&g_enclave_map_phase) - 1;
+
+        while (oe_atomic_load(&g_enclave_map_readers[phase & 1]))
+            oe_atomic_pause();
+    }
+
+    free(old);
+}
+
+/* Allocate a map for the given number of enclaves */
+static EnclaveMap* _new_enclave_map(size_t count)
+{
+    EnclaveMap* map =
+        (EnclaveMap*)malloc(sizeof(EnclaveMap) + count * sizeof(EnclaveRange));
+
+    if (map)
+        map->count = count;
+
+    return map;
+}
 
 /*
 **==============================================================================
 **
 ** _oe_push_enclave_instance()
 **
-**     Push the enclave to the head of the global enclave list.
+**     Add the enclave to the global enclave map.
 **     Return 0 if success.
 **
 **==============================================================================
@@ -30,39 +91,53 @@ uint32_t _oe_push_enclave_instance(oe_enclave_t* enclave)
 {
     uint32_t ret = 1;
     bool locked = false;
-    EnclaveEntry* new_entry = NULL;
+    const EnclaveMap* map;
+    EnclaveMap* new_map = NULL;
+    size_t count;
+    size_t i;
 
     // Take the lock.
-    if (oe_mutex_lock(&g_enclave_list_lock) != 0)
+    if (oe_mutex_lock(&g_enclave_map_lock) != 0)
     {
         goto cleanup;
     }
 
     locked = true;
+    map = g_enclave_map;
+    count = map ? map->count : 0;
+
+    // Find the position of the enclave in the map.
+    for (i = 0; i < count && map->ranges[i].start < enclave->addr; i++)
+        ;
 
-    // Return error if the enclave is already in global list.
+    // Return error if the enclave is already in the map or overlaps another
+    // one.
+    if ((i > 0 && map->ranges[i - 1].end > enclave->addr) ||
+        (i < count && map->ranges[i].start < enclave->addr + enclave->size))
     {
-        EnclaveEntry* tmp;
-        OE_LIST_FOREACH(tmp, &g_enclave_list_head, next_entry)
-        {
-            if (tmp->enclave == enclave)
-            {
-                goto cleanup;
-            }
-        }
+        goto cleanup;
     }
 
-    // Allocate new entry.
-    new_entry = (EnclaveEntry*)calloc(1, sizeof(EnclaveEntry));
-    if (new_entry == NULL)
+    // Copy the map with the new enclave inserted.
+    if (!(new_map = _new_enclave_map(count + 1)))
     {
         goto cleanup;
     }
 
-    new_entry->enclave = enclave;
+    if (map)
+    {
+        memcpy(new_map->ranges, map->ranges, i * sizeof(EnclaveRange));
+        memcpy(
+            &new_map->ranges[i + 1],
+            &map->ranges[i],
+            (count - i) * sizeof(EnclaveRange));
+    }
+
+    new_map->ranges[i].start = enclave->addr;
+    new_map->ranges[i].end = enclave->addr + enclave->size;
+    new_map->ranges[i].enclave = enclave;
 
-    // Insert to the beginning of the list.
-    OE_LIST_INSERT_HEAD(&g_enclave_list_head, new_entry, next_entry);
+    _publish_enclave_map(new_map);
 
     // Return success.
     ret = 0;
@@ -71,7 +146,7 @@ cleanup:
     if (locked)
     {
         // Release the lock if it is taken.
-        if (oe_mutex_unlock(&g_enclave_list_lock) != 0)
+        if (oe_mutex_unlock(&g_enclave_map_lock) != 0)
         {
             abort();
         }
@@ -85,7 +160,7 @@ cleanup:
 **
 ** _oe_remove_enclave_instance()
 **
-**     Remove the enclave from the global enclave list.
+**     Remove the enclave from the global enclave map.
 **     Return 0 if success.
 **
 **==============================================================================
@@ -95,35 +170,55 @@ uint32_t _oe_remove_enclave_instance(oe_enclave_t* enclave)
 {
     uint32_t ret = 1;
     bool locked = false;
+    const EnclaveMap* map;
+    EnclaveMap* new_map = NULL;
+    size_t count;
+    size_t i;
 
     // Take the lock.
-    if (oe_mutex_lock(&g_enclave_list_lock) != 0)
+    if (oe_mutex_lock(&g_enclave_map_lock) != 0)
     {
         goto cleanup;
     }
 
     locked = true;
+    map = g_enclave_map;
+    count = map ? map->count : 0;
 
-    // Enumerate the enclave list, remove the target entry if find it.
+    // Find the enclave in the map.
+    for (i = 0; i < count && map->ranges[i].enclave != enclave; i++)
+        ;
+
+    if (i == count)
+    {
+        goto cleanup;
+    }
+
+    // Copy the map without the enclave (an empty map is freed).
+    if (count > 1)
     {
-        EnclaveEntry* tmp;
-        OE_LIST_FOREACH(tmp, &g_enclave_list_head, next_entry)
+        if (!(new_map = _new_enclave_map(count - 1)))
         {
-            if (tmp->enclave == enclave)
-            {
-                OE_LIST_REMOVE(tmp, next_entry);
-                free(tmp);
-                ret = 0;
-                break;
-            }
+            goto cleanup;
         }
+
+        memcpy(new_map->ranges, map->ranges, i * sizeof(EnclaveRange));
+        memcpy(
+            &new_map->ranges[i],
+            &map->ranges[i + 1],
+            (count - i - 1) * sizeof(EnclaveRange));
     }
 
+    _publish_enclave_map(new_map);
+
+    // Return success.
+    ret = 0;
+
 cleanup:
     if (locked)
     {
         // Release the lock if it is taken.
-        if (oe_mutex_unlock(&g_enclave_list_lock) != 0)
+        if (oe_mutex_unlock(&g_enclave_map_lock) != 0)
         {
             abort();
         }
@@ -140,48 +235,59 @@ cleanup:
 **     Query the owner enclave for the given TCS.
 **     Return the owner enclave if success, otherwise return NULL.
 **
+**     This function is called by the exception handler, so it neither takes
+**     locks nor waits.
+**
 **==============================================================================
 */
 
 oe_enclave_t* _oe_query_enclave_instance(void* tcs)
 {
     oe_enclave_t* ret = NULL;
-    bool locked = false;
+    uint64_t address = (uint64_t)tcs;
+    uint64_t reader;
+    const EnclaveMap* map;
 
-    // Take the lock.
-    if (oe_mutex_lock(&g_enclave_list_lock) != 0)
-    {
-        goto cleanup;
-    }
+    // Count this lookup as a reader of the current phase.
+    reader = oe_atomic_load(&g_enclave_map_phase) & 1;
+    oe_atomic_increment(&g_enclave_map_readers[reader]);
 
-    locked = true;
+    map = (const EnclaveMap*)oe_atomic_load_pointer(
+        (void* volatile*)&g_enclave_map);
 
-    // Enumerate the enclave list, find which enclave owns the TCS.
+    if (map)
     {
-        EnclaveEntry* tmp;
-        OE_LIST_FOREACH(tmp, &g_enclave_list_head, next_entry)
+        // Find the last enclave that starts at or below the address.
+        size_t lo = 0;
+        size_t hi = map->count;
+
+        while (lo < hi)
+        {
+            size_t mid = lo + (hi - lo) / 2;
+
+            if (map->ranges[mid].start <= address)
+                lo = mid + 1;
+            else
+                hi = mid;
+        }
+
+        // Check that the address is a TCS of that enclave.
+        if (lo > 0 && address < map->ranges[lo - 1].end)
         {
-            oe_enclave_t* enclave = tmp->enclave;
+            oe_enclave_t* enclave = map->ranges[lo - 1].enclave;
+
             for (uint32_t i = 0; i < OE_COUNTOF(enclave->bindings); i++)
             {
-                if (enclave->bindings[i].tcs == (uint64_t)tcs)
+                if (enclave->bindings[i].tcs == address)
                 {
                     ret = enclave;
-                    goto cleanup;
+                    break;
                 }
             }
         }
     }
 
-cleanup:
-    if (locked)
-    {
-        // Release the lock if it is taken.
-        if (oe_mutex_unlock(&g_enclave_list_lock) != 0)
-        {
-            abort();
-        }
-    }
+    oe_atomic_decrement(&g_enclave_map_readers[reader]);
 
     return ret;
 }
@@ -0,0 +1,126 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#include <openenclave/host.h>
+#include <openenclave/internal/calls.h>
+#include <openenclave/internal/malloc.h>
+#include <openenclave/internal/raise.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "enclave.h"
+
+/* Copy the heap profile sites of the enclave into a new array (the enclave
+ * may add sites between the size query and the copy, hence the loop) */
+static oe_result_t _get_heap_profile(
+    oe_enclave_t* enclave,
+    oe_heap_profile_site_t** sites_out,
+    uint64_t* num_sites_out,
+    uint64_t* sample_interval_out)
+{
+    oe_result_t result = OE_UNEXPECTED;
+    oe_get_heap_profile_args_t args = {0};
+
+    for (;;)
+    {
+        OE_CHECK(oe_ecall(
+            enclave, OE_ECALL_GET_HEAP_PROFILE, (uint64_t)&args, NULL));
+
+        if (args.result != OE_BUFFER_TOO_SMALL)
+            break;
+
+        free(args.sites);
+
+        /* Leave room for sites added before the next call */
+        args.num_sites += 16;
+
+        if (!(args.sites = calloc(args.num_sites, sizeof(*args.sites))))
+            OE_RAISE(OE_OUT_OF_MEMORY);
+    }
+
+    OE_CHECK(args.result);
+
+    *sites_out = args.sites;
+    *num_sites_out = args.num_sites;
+    *sample_interval_out = args.sample_interval;
+    args.sites = NULL;
+
+    result = OE_OK;
+
+done:
+    free(args.sites);
+    return result;
+}
+
+oe_result_t oe_write_enclave_heap_profile(oe_enclave_t* enclave, FILE* stream)
+{
+    oe_result_t result = OE_UNEXPECTED;
+    oe_heap_profile_site_t* sites = NULL;
+    uint64_t num_sites = 0;
+    uint64_t sample_interval = 0;
+    oe_heap_profile_site_t total = {0};
+
+    if (!enclave || enclave->magic != ENCLAVE_MAGIC || !stream)
+        OE_RAISE(OE_INVALID_PARAMETER);
+
+    OE_CHECK(_get_heap_profile(enclave, &sites, &num_sites, &sample_interval));
+
+    for (uint64_t i = 0; i < num_sites; i++)
+    {
+        total.live_count += sites[i].live_count;
+        total.live_bytes += sites[i].live_bytes;
+        total.alloc_count += sites[i].alloc_count;
+        total.alloc_bytes += sites[i].alloc_bytes;
+    }
+
+    /* Legacy heap profile format of gperftools, read by pprof: the live
+     * samples and bytes, then the allocated ones, of the whole profile and
+     * then of each call site. pprof scales the sampled values by the
+     * sample interval. */
+    fprintf(
+        stream,
+        "heap profile: %llu: %llu [%llu: %llu] @ heap_v2/%llu\n",
+        (unsigned long long)total.live_count,
+        (unsigned long long)total.live_bytes,
+        (unsigned long long)total.alloc_count,
+        (unsigned long long)total.alloc_bytes,
+        (unsigned long long)sample_interval);
+
+    for (uint64_t i = 0; i < num_sites; i++)
+    {
+        const oe_heap_profile_site_t* site = &sites[i];
+        uint64_t depth = site->depth;
+
+        if (depth > OE_HEAP_PROFILE_MAX_DEPTH)
+            depth = OE_HEAP_PROFILE_MAX_DEPTH;
+
+        fprintf(
+            stream,
+            "%llu: %llu [%llu: %llu] @",
+            (unsigned long long)site->live_count,
+            (unsigned long long)site->live_bytes,
+            (unsigned long long)site->alloc_count,
+            (unsigned long long)site->alloc_bytes);
+
+        for (uint64_t j = 0; j < depth; j++)
+            fprintf(stream, " 0x%llx", (unsigned long long)site->frames[j]);
+
+        fputc('\n', stream);
+    }
+
+    /* Map the enclave image so that pprof symbolizes the addresses */
+    fprintf(
+        stream,
+        "\nMAPPED_LIBRARIES:\n%llx-%llx r-xp 00000000 00:00 0 %s\n",
+        (unsigned long long)enclave->addr,
+        (unsigned long long)(enclave->addr + enclave->size),
+        enclave->path ? enclave->path : "enclave");
+
+    if (ferror(stream))
+        OE_RAISE(OE_FAILURE);
+
+    result = OE_OK;
+
+done:
+    free(sites);
+    return result;
+}
@@ -3,10 +3,12 @@
 
 #include <errno.h>
 #include <openenclave/internal/time.h>
+#include "../callstats.h"
 #include "../ocalls.h"
 
 static const uint64_t _SEC_TO_MSEC = 1000UL;
 static const uint64_t _MSEC_TO_NSEC = 1000000UL;
+static const uint64_t _SEC_TO_NSEC = 1000000000UL;
 
 /* Return milliseconds elapsed since the Epoch. */
 static uint64_t _time()
@@ -47,3 +49,13 @@ void oe_handle_get_time(uint64_t arg_in, uint64_t* arg_out)
     if (arg_out)
         *arg_out = _time();
 }
+
+uint64_t oe_get_monotonic_time_ns(void)
+{
+    struct timespec ts;
+
+    if (clock_gettime(CLOCK_MONOTONIC, &ts) != 0)
+        return 0;
+
+    return ((uint64_t)ts.tv_sec * _SEC_TO_NSEC) + (uint64_t)ts.tv_nsec;
+}
@@ -17,7 +17,8 @@ oe_result_t __oe_load_segments(
     oe_segment_t segments[OE_MAX_SEGMENTS],
     size_t* nsegments,
     uint64_t* entryaddr,
-    uint64_t* textaddr)
+    uint64_t* textaddr,
+    oe_tls_segment_t* tls)
 {
     oe_result_t result = OE_UNEXPECTED;
     elf64_t elf = ELF64_INIT;
@@ -35,8 +36,11 @@ oe_result_t __oe_load_segments(
     if (textaddr)
         *textaddr = 0;
 
+    if (tls)
+        memset(tls, 0, sizeof(oe_tls_segment_t));
+
     /* Check for null parameters */
-    if (!path || !segments || !nsegments || !entryaddr || !textaddr)
+    if (!path || !segments || !nsegments || !entryaddr || !textaddr || !tls)
         OE_RAISE(OE_INVALID_PARAMETER);
 
     /* Load the ELF-64 object */
@@ -106,6 +110,30 @@ oe_result_t __oe_load_segments(
         if (ph == NULL)
             OE_RAISE(OE_FAILURE);
 
+        /* Save the thread local storage (TLS) segment. Its initialization
+         * image lies within a loadable segment, so it is only recorded here.
+         * The loader reserves a TLS block for each TCS. */
+        if (ph->p_type == PT_TLS)
+        {
+            /* Only one TLS segment is allowed */
+            if (tls->memsz)
+                OE_RAISE(OE_FAILURE);
+
+            if (ph->p_filesz > ph->p_memsz)
+                OE_RAISE(OE_FAILURE);
+
+            /* The thread pointer is page aligned */
+            if (ph->p_align > OE_PAGE_SIZE ||
+                (ph->p_align & (ph->p_align - 1)))
+                OE_RAISE(OE_UNSUPPORTED);
+
+            tls->vaddr = ph->p_vaddr;
+            tls->filesz = ph->p_filesz;
+            tls->memsz = ph->p_memsz;
+            tls->align = ph->p_align;
+            continue;
+        }
+
         /* Skip non-loadable program segments */
         if (ph->p_type != PT_LOAD)
             continue;
@@ -114,10 +142,6 @@ oe_result_t __oe_load_segments(
         if (ph->p_filesz > ph->p_memsz)
             OE_RAISE(OE_FAILURE);
 
-        /* ATTN: handle PT_TLS (thread local storage) segments */
-        if (ph->p_type == PT_TLS)
-            OE_RAISE(OE_UNSUPPORTED);
-
         /* Clear the segment */
         memset(&seg, 0, sizeof(oe_segment_t));
 
@@ -186,6 +210,22 @@ oe_result_t __oe_load_segments(
     if (*nsegments == 0)
         OE_RAISE(OE_FAILURE);
 
+    /* Check that the TLS initialization image is within a loaded segment */
+    if (tls->filesz)
+    {
+        for (i = 0; i < *nsegments; i++)
+        {
+            const oe_segment_t* seg = &segments[i];
+
+            if (tls->vaddr >= seg->vaddr &&
+                tls->vaddr + tls->filesz <= seg->vaddr + seg->filesz)
+                break;
+        }
+
+        if (i == *nsegments)
+            OE_RAISE(OE_FAILURE);
+    }
+
     result = OE_OK;
 
 done:
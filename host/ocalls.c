@@ -19,7 +19,6 @@
 #include <openenclave/bits/safemath.h>
 #include <openenclave/host.h>
 #include <openenclave/internal/calls.h>
-#include <openenclave/internal/elf.h>
 #include <openenclave/internal/report.h>
 #include <openenclave/internal/thread.h>
 #include <openenclave/internal/utils.h>
@@ -27,6 +26,7 @@
 #include "ocalls.h"
 #include "quote.h"
 #include "sgxquoteprovider.h"
+#include "symbols.h"
 
 void HandleMalloc(uint64_t arg_in, uint64_t* arg_out)
 {
@@ -142,6 +142,18 @@ void HandleThreadWakeWait(oe_enclave_t* enclave, uint64_t arg_in)
 #endif
 }
 
+void HandleThreadWakeMultiple(oe_enclave_t* enclave, uint64_t arg_in)
+{
+    oe_thread_wake_multiple_args_t* args =
+        (oe_thread_wake_multiple_args_t*)arg_in;
+
+    if (!args || args->num_tcs > OE_THREAD_WAKE_MULTIPLE_MAX)
+        return;
+
+    for (uint64_t i = 0; i < args->num_tcs; i++)
+        HandleThreadWake(enclave, (uint64_t)args->tcs[i]);
+}
+
 void HandleGetQuote(uint64_t arg_in)
 {
     oe_get_quote_args_t* args = (oe_get_quote_args_t*)arg_in;
@@ -181,8 +193,6 @@ static char** _backtrace_symbols(
     int size)
 {
     char** ret = NULL;
-    elf64_t elf = ELF64_INIT;
-    bool elf_loaded = false;
     size_t malloc_size = 0;
     const char unknown[] = "<unknown>";
     char* ptr = NULL;
@@ -190,14 +200,6 @@ static char** _backtrace_symbols(
     if (!enclave || enclave->magic != ENCLAVE_MAGIC || !buffer || !size)
         goto done;
 
-    /* Open the enclave ELF64 image */
-    {
-        if (elf64_load(enclave->path, &elf) != 0)
-            goto done;
-
-        elf_loaded = true;
-    }
-
     /* Determine total memory requirements */
     {
         /* Calculate space for the array of string pointers */
@@ -208,7 +210,7 @@ static char** _backtrace_symbols(
         for (int i = 0; i < size; i++)
         {
             const uint64_t vaddr = (uint64_t)buffer[i] - enclave->addr;
-            const char* name = elf64_get_function_name(&elf, vaddr);
+            const char* name = oe_symbols_find_function(enclave, vaddr);
 
             if (!name)
                 name = unknown;
@@ -237,7 +239,7 @@ static char** _backtrace_symbols(
     for (int i = 0; i < size; i++)
     {
         const uint64_t vaddr = (uint64_t)buffer[i] - enclave->addr;
-        const char* name = elf64_get_function_name(&elf, vaddr);
+        const char* name = oe_symbols_find_function(enclave, vaddr);
 
         if (!name)
             name = unknown;
@@ -249,10 +251,6 @@ static char** _backtrace_symbols(
     }
 
 done:
-
-    if (elf_loaded)
-        elf64_unload(&elf);
-
     return ret;
 }
 
@@ -15,6 +15,7 @@ void HandleFree(uint64_t arg);
 void HandleThreadWait(oe_enclave_t* enclave, uint64_t arg);
 void HandleThreadWake(oe_enclave_t* enclave, uint64_t arg);
 void HandleThreadWakeWait(oe_enclave_t* enclave, uint64_t arg_in);
+void HandleThreadWakeMultiple(oe_enclave_t* enclave, uint64_t arg_in);
 
 void HandleGetQuote(uint64_t arg_in);
 void HandleGetQETargetInfo(uint64_t arg_in);
@@ -0,0 +1,606 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#include "profiler.h"
+#include <openenclave/host.h>
+#include <openenclave/internal/raise.h>
+#include <openenclave/internal/sgxtypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__linux__)
+#include <errno.h>
+#include <fcntl.h>
+#include <sched.h>
+#include <signal.h>
+#include <sys/time.h>
+#include <ucontext.h>
+#include <unistd.h>
+#endif
+
+#include "asmdefs.h"
+#include "enclave.h"
+#include "symbols.h"
+
+/*
+**==============================================================================
+**
+** Enclave CPU profiler:
+**
+**     A process-wide ITIMER_PROF timer sends SIGPROF to the thread that
+**     consumes CPU time. If that thread runs a profiled enclave, its handler
+**     walks the frame-pointer chain of the enclave code (like oe_backtrace()
+**     does in the enclave) and counts the stack in the enclave profile:
+**
+**     - In simulation mode, the enclave runs on the thread itself, so the
+**       interrupted instruction and frame pointer are in the signal context
+**       and the enclave stack is read directly.
+**
+**     - In debug mode, the thread was interrupted by an asynchronous exit
+**       (AEX) with the TCS in RBX. The registers of the enclave are in the
+**       current SSA frame of the TCS, which is read (with the stack) through
+**       /proc/self/mem, like the debugger does.
+**
+**     Stacks are kept as raw addresses and symbolized with the symbol index
+**     of the enclave only when the profile is written.
+**
+**==============================================================================
+*/
+
+#define _FREE 0
+#define _WRITING 1
+#define _READY 2
+
+#if defined(__linux__)
+
+/* Enabled profilers (NULL entries are unused), read by the SIGPROF handler */
+static oe_profiler_t* _profilers[OE_PROFILER_MAX_ENCLAVES];
+static size_t _num_enabled;
+static oe_mutex _lock = OE_H_MUTEX_INITIALIZER;
+
+/* Number of SIGPROF handlers that may still access a profiler */
+static volatile uint64_t _num_handlers;
+
+static bool _handler_installed;
+static struct sigaction _previous_sigaction;
+
+/* File descriptor of /proc/self/mem (for reading debug enclaves) */
+static int _mem_fd = -1;
+
+static bool _in_enclave(const oe_enclave_t* enclave, uint64_t addr)
+{
+    return addr >= enclave->addr && addr - enclave->addr < enclave->size;
+}
+
+static oe_profiler_t* _find_profiler(uint64_t addr, bool simulate)
+{
+    for (size_t i = 0; i < OE_PROFILER_MAX_ENCLAVES; i++)
+    {
+        oe_profiler_t* profiler =
+            __atomic_load_n(&_profilers[i], __ATOMIC_ACQUIRE);
+
+        if (profiler && profiler->enclave->simulate == simulate &&
+            _in_enclave(profiler->enclave, addr))
+        {
+            return profiler;
+        }
+    }
+
+    return NULL;
+}
+
+/* Read enclave memory from the signal handler */
+static bool _read(
+    const oe_profiler_t* profiler,
+    uint64_t addr,
+    void* buffer,
+    size_t size)
+{
+    const oe_enclave_t* enclave = profiler->enclave;
+
+    if (!_in_enclave(enclave, addr) || !_in_enclave(enclave, addr + size - 1))
+        return false;
+
+    /* The FS register base may point to the enclave TLS in simulation mode,
+     * so errno (and any other thread-local variable) must not be used */
+    if (enclave->simulate)
+    {
+        const volatile uint64_t* src = (const volatile uint64_t*)addr;
+        uint64_t* dest = (uint64_t*)buffer;
+
+        for (size_t i = 0; i < size / sizeof(uint64_t); i++)
+            dest[i] = src[i];
+
+        return true;
+    }
+
+    return pread(_mem_fd, buffer, size, (off_t)addr) == (ssize_t)size;
+}
+
+static uint64_t _hash(const uint64_t* frames, uint32_t depth)
+{
+    uint64_t hash = 14695981039346656037ULL;
+
+    for (uint32_t i = 0; i < depth; i++)
+    {
+        hash ^= frames[i];
+        hash *= 1099511628211ULL;
+    }
+
+    return hash;
+}
+
+static bool _same_stack(
+    const oe_profiler_stack_t* stack,
+    uint64_t hash,
+    const uint64_t* frames,
+    uint32_t depth)
+{
+    if (stack->hash != hash || stack->depth != depth)
+        return false;
+
+    for (uint32_t i = 0; i < depth; i++)
+    {
+        if (stack->frames[i] != frames[i])
+            return false;
+    }
+
+    return true;
+}
+
+/* Count a sample in the stack table (an open-addressing hash table). A stack
+ * that is being written by another thread is skipped, so the same stack may
+ * be counted in two entries, which are merged by flame graph tools. */
+static void _record(
+    oe_profiler_t* profiler,
+    const uint64_t* frames,
+    uint32_t depth)
+{
+    const uint64_t hash = _hash(frames, depth);
+    size_t index = hash & (OE_PROFILER_MAX_STACKS - 1);
+
+    for (size_t n = 0; n < OE_PROFILER_MAX_STACKS; n++)
+    {
+        oe_profiler_stack_t* stack = &profiler->stacks[index];
+        uint32_t state = __atomic_load_n(&stack->state, __ATOMIC_ACQUIRE);
+
+        if (state == _FREE &&
+            __atomic_compare_exchange_n(
+                &stack->state,
+                &state,
+                _WRITING,
+                false,
+                __ATOMIC_ACQUIRE,
+                __ATOMIC_ACQUIRE))
+        {
+            for (uint32_t i = 0; i < depth; i++)
+                stack->frames[i] = frames[i];
+
+            stack->depth = depth;
+            stack->hash = hash;
+            stack->count = 1;
+            __atomic_store_n(&stack->state, _READY, __ATOMIC_RELEASE);
+            return;
+        }
+
+        if (state == _READY && _same_stack(stack, hash, frames, depth))
+        {
+            __atomic_add_fetch(&stack->count, 1, __ATOMIC_RELAXED);
+            return;
+        }
+
+        index = (index + 1) & (OE_PROFILER_MAX_STACKS - 1);
+    }
+
+    __atomic_add_fetch(&profiler->num_dropped, 1, __ATOMIC_RELAXED);
+}
+
+/* Walk the frame-pointer chain from the interrupted instruction */
+static void _sample(oe_profiler_t* profiler, uint64_t rip, uint64_t rbp)
+{
+    uint64_t frames[OE_PROFILER_MAX_DEPTH];
+    uint32_t depth = 0;
+
+    frames[depth++] = rip;
+
+    while (depth < OE_PROFILER_MAX_DEPTH && rbp && !(rbp & 7))
+    {
+        uint64_t frame[2];
+
+        if (!_read(profiler, rbp, frame, sizeof(frame)))
+            break;
+
+        /* Stop at the first return address outside of the enclave (the
+         * frame of oe_enter() returns to the host) */
+        if (!_in_enclave(profiler->enclave, frame[1]))
+            break;
+
+        frames[depth++] = frame[1];
+
+        /* The stack grows down, so callers have higher frame pointers */
+        if (frame[0] <= rbp)
+            break;
+
+        rbp = frame[0];
+    }
+
+    _record(profiler, frames, depth);
+}
+
+/* Sample a debug enclave interrupted by an AEX from the SSA of its TCS */
+static bool _sample_aex(uint64_t tcs)
+{
+    oe_profiler_t* profiler;
+    sgx_tcs_t header;
+    sgx_ssa_gpr_t gpr;
+    uint64_t gpr_addr;
+    const uint64_t frame_size = OE_DEFAULT_SSA_FRAME_SIZE * OE_PAGE_SIZE;
+
+    if (!(profiler = _find_profiler(tcs, false)))
+        return false;
+
+    /* The SSA frames follow the TCS; the current one is CSSA - 1 */
+    if (!_read(profiler, tcs, &header, OE_SGX_TCS_HEADER_BYTE_SIZE) ||
+        header.cssa == 0)
+    {
+        __atomic_add_fetch(&profiler->num_dropped, 1, __ATOMIC_RELAXED);
+        return true;
+    }
+
+    gpr_addr = tcs + OE_SSA_FROM_TCS_BYTE_OFFSET + header.cssa * frame_size -
+               OE_SGX_GPR_BYTE_SIZE;
+
+    if (!_read(profiler, gpr_addr, &gpr, sizeof(gpr)) ||
+        !_in_enclave(profiler->enclave, gpr.rip))
+    {
+        __atomic_add_fetch(&profiler->num_dropped, 1, __ATOMIC_RELAXED);
+        return true;
+    }
+
+    _sample(profiler, gpr.rip, gpr.rbp);
+    return true;
+}
+
+static void _sigprof_handler(int sig_num, siginfo_t* sig_info, void* sig_data)
+{
+    ucontext_t* context = (ucontext_t*)sig_data;
+    const uint64_t rip = (uint64_t)context->uc_mcontext.gregs[REG_RIP];
+    const uint64_t rax = (uint64_t)context->uc_mcontext.gregs[REG_RAX];
+    const uint64_t rbx = (uint64_t)context->uc_mcontext.gregs[REG_RBX];
+    const uint64_t rbp = (uint64_t)context->uc_mcontext.gregs[REG_RBP];
+    oe_profiler_t* profiler;
+    bool sampled = false;
+
+    __atomic_add_fetch(&_num_handlers, 1, __ATOMIC_SEQ_CST);
+
+    if (rip == (uint64_t)OE_AEP && rax == ENCLU_ERESUME)
+    {
+        int saved_errno = errno;
+        sampled = _sample_aex(rbx);
+        errno = saved_errno;
+    }
+    else if ((profiler = _find_profiler(rip, true)))
+    {
+        _sample(profiler, rip, rbp);
+        sampled = true;
+    }
+
+    __atomic_sub_fetch(&_num_handlers, 1, __ATOMIC_SEQ_CST);
+
+    /* Pass other samples to the previous handler (the default action, which
+     * terminates the process, is not taken for the samples of this timer) */
+    if (!sampled)
+    {
+        if (_previous_sigaction.sa_flags & SA_SIGINFO)
+        {
+            _previous_sigaction.sa_sigaction(sig_num, sig_info, sig_data);
+        }
+        else if (
+            _previous_sigaction.sa_handler != SIG_DFL &&
+            _previous_sigaction.sa_handler != SIG_IGN)
+        {
+            _previous_sigaction.sa_handler(sig_num);
+        }
+    }
+}
+
+/* Start or stop the timer (called with the lock held) */
+static oe_result_t _set_timer(bool start)
+{
+    oe_result_t result = OE_UNEXPECTED;
+    struct itimerval timer;
+
+    memset(&timer, 0, sizeof(timer));
+
+    if (start)
+    {
+        timer.it_interval.tv_usec = 1000000 / OE_PROFILER_SAMPLES_PER_SECOND;
+        timer.it_value = timer.it_interval;
+    }
+
+    if (setitimer(ITIMER_PROF, &timer, NULL) != 0)
+        OE_RAISE(OE_FAILURE);
+
+    result = OE_OK;
+
+done:
+    return result;
+}
+
+/* Install the SIGPROF handler once, since a signal of the timer may still
+ * be pending after it is stopped (called with the lock held) */
+static oe_result_t _install_handler(void)
+{
+    oe_result_t result = OE_UNEXPECTED;
+    struct sigaction action;
+
+    if (_handler_installed)
+    {
+        result = OE_OK;
+        goto done;
+    }
+
+    if (_mem_fd == -1 &&
+        (_mem_fd = open("/proc/self/mem", O_RDONLY | O_CLOEXEC)) == -1)
+    {
+        OE_RAISE(OE_FAILURE);
+    }
+
+    memset(&action, 0, sizeof(action));
+    action.sa_sigaction = _sigprof_handler;
+    action.sa_flags = SA_SIGINFO | SA_RESTART;
+    sigemptyset(&action.sa_mask);
+
+    if (sigaction(SIGPROF, &action, &_previous_sigaction) != 0)
+        OE_RAISE(OE_FAILURE);
+
+    _handler_installed = true;
+    result = OE_OK;
+
+done:
+    return result;
+}
+
+/* Stop sampling an enclave and wait for the handlers that may be sampling
+ * it (called with the lock held) */
+static void _remove_profiler(oe_profiler_t* profiler)
+{
+    for (size_t i = 0; i < OE_PROFILER_MAX_ENCLAVES; i++)
+    {
+        if (_profilers[i] == profiler)
+        {
+            __atomic_store_n(&_profilers[i], NULL, __ATOMIC_SEQ_CST);
+
+            if (--_num_enabled == 0)
+                _set_timer(false);
+        }
+    }
+
+    while (__atomic_load_n(&_num_handlers, __ATOMIC_SEQ_CST))
+        sched_yield();
+}
+
+/* Start sampling an enclave (called with the lock held) */
+static oe_result_t _add_profiler(oe_profiler_t* profiler)
+{
+    oe_result_t result = OE_UNEXPECTED;
+    size_t i;
+
+    for (i = 0; i < OE_PROFILER_MAX_ENCLAVES; i++)
+    {
+        if (!_profilers[i])
+            break;
+    }
+
+    if (i == OE_PROFILER_MAX_ENCLAVES)
+        OE_RAISE(OE_FAILURE);
+
+    OE_CHECK(_install_handler());
+
+    if (_num_enabled == 0)
+        OE_CHECK(_set_timer(true));
+
+    _num_enabled++;
+    __atomic_store_n(&_profilers[i], profiler, __ATOMIC_RELEASE);
+
+    result = OE_OK;
+
+done:
+    return result;
+}
+
+oe_result_t oe_enable_enclave_profiler(oe_enclave_t* enclave, bool enable)
+{
+    oe_result_t result = OE_UNEXPECTED;
+    oe_profiler_t* profiler;
+
+    if (!enclave || enclave->magic != ENCLAVE_MAGIC)
+        OE_RAISE(OE_INVALID_PARAMETER);
+
+    /* The registers and stack of other enclaves cannot be read */
+    if (!enclave->simulate && !enclave->debug)
+        OE_RAISE(OE_UNSUPPORTED);
+
+    oe_mutex_lock(&_lock);
+
+    if (enable && !enclave->profiler)
+    {
+        profiler = (oe_profiler_t*)calloc(1, sizeof(oe_profiler_t));
+
+        if (!profiler)
+        {
+            oe_mutex_unlock(&_lock);
+            OE_RAISE(OE_OUT_OF_MEMORY);
+        }
+
+        profiler->enclave = enclave;
+        enclave->profiler = profiler;
+    }
+
+    if ((profiler = enclave->profiler) && profiler->enabled != enable)
+    {
+        if (enable)
+        {
+            result = _add_profiler(profiler);
+        }
+        else
+        {
+            _remove_profiler(profiler);
+            result = OE_OK;
+        }
+
+        if (result == OE_OK)
+            profiler->enabled = enable;
+    }
+    else
+    {
+        result = OE_OK;
+    }
+
+    oe_mutex_unlock(&_lock);
+
+    OE_CHECK(result);
+
+done:
+    return result;
+}
+
+oe_result_t oe_reset_enclave_profiler(oe_enclave_t* enclave)
+{
+    oe_result_t result = OE_UNEXPECTED;
+    oe_profiler_t* profiler;
+
+    if (!enclave || enclave->magic != ENCLAVE_MAGIC)
+        OE_RAISE(OE_INVALID_PARAMETER);
+
+    oe_mutex_lock(&_lock);
+
+    if ((profiler = enclave->profiler))
+    {
+        /* Pause the sampling of the enclave while the table is cleared */
+        if (profiler->enabled)
+            _remove_profiler(profiler);
+
+        memset(profiler->stacks, 0, sizeof(profiler->stacks));
+        profiler->num_dropped = 0;
+
+        if (profiler->enabled && _add_profiler(profiler) != OE_OK)
+            profiler->enabled = false;
+    }
+
+    oe_mutex_unlock(&_lock);
+
+    result = OE_OK;
+
+done:
+    return result;
+}
+
+void oe_profiler_free(oe_enclave_t* enclave)
+{
+    oe_mutex_lock(&_lock);
+
+    if (enclave->profiler)
+    {
+        if (enclave->profiler->enabled)
+            _remove_profiler(enclave->profiler);
+
+        free(enclave->profiler);
+        enclave->profiler = NULL;
+    }
+
+    oe_mutex_unlock(&_lock);
+}
+
+#else /* !defined(__linux__) */
+
+oe_result_t oe_enable_enclave_profiler(oe_enclave_t* enclave, bool enable)
+{
+    OE_UNUSED(enable);
+
+    if (!enclave || enclave->magic != ENCLAVE_MAGIC)
+        return OE_INVALID_PARAMETER;
+
+    return OE_UNSUPPORTED;
+}
+
+oe_result_t oe_reset_enclave_profiler(oe_enclave_t* enclave)
+{
+    if (!enclave || enclave->magic != ENCLAVE_MAGIC)
+        return OE_INVALID_PARAMETER;
+
+    return OE_OK;
+}
+
+void oe_profiler_free(oe_enclave_t* enclave)
+{
+    OE_UNUSED(enclave);
+}
+
+#endif /* defined(__linux__) */
+
+static void _write_frame(
+    const oe_enclave_t* enclave,
+    FILE* stream,
+    uint64_t addr,
+    bool caller)
+{
+    /* A return address may follow the last instruction of its caller */
+    const uint64_t vaddr = addr - enclave->addr - (caller ? 1 : 0);
+    const char* name = oe_symbols_find_function(enclave, vaddr);
+
+    if (name)
+        fputs(name, stream);
+    else
+        fprintf(stream, "0x%llx", (unsigned long long)vaddr);
+}
+
+oe_result_t oe_write_enclave_profile(oe_enclave_t* enclave, FILE* stream)
+{
+    oe_result_t result = OE_UNEXPECTED;
+    const oe_profiler_t* profiler;
+    uint64_t num_dropped;
+
+    if (!enclave || enclave->magic != ENCLAVE_MAGIC || !stream)
+        OE_RAISE(OE_INVALID_PARAMETER);
+
+    if (!(profiler = enclave->profiler))
+    {
+        result = OE_OK;
+        goto done;
+    }
+
+    /* Write one line per stack, from the outermost frame to the sampled
+     * instruction, followed by its number of samples */
+    for (size_t i = 0; i < OE_PROFILER_MAX_STACKS; i++)
+    {
+        const oe_profiler_stack_t* stack = &profiler->stacks[i];
+
+        if (__atomic_load_n(&stack->state, __ATOMIC_ACQUIRE) != _READY)
+            continue;
+
+        for (uint32_t j = stack->depth; j-- > 0;)
+        {
+            _write_frame(enclave, stream, stack->frames[j], j > 0);
+            fputc(j > 0 ? ';' : ' ', stream);
+        }
+
+        fprintf(
+            stream,
+            "%llu\n",
+            (unsigned long long)__atomic_load_n(
+                &stack->count, __ATOMIC_RELAXED));
+    }
+
+    if ((num_dropped = profiler->num_dropped))
+        fprintf(stream, "[dropped] %llu\n", (unsigned long long)num_dropped);
+
+    if (ferror(stream))
+        OE_RAISE(OE_FAILURE);
+
+    result = OE_OK;
+
+done:
+    return result;
+}
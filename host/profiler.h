@@ -0,0 +1,66 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#ifndef _OE_HOST_PROFILER_H
+#define _OE_HOST_PROFILER_H
+
+#include <openenclave/host.h>
+#include "enclave.h"
+
+OE_EXTERNC_BEGIN
+
+/* Number of samples per second of CPU time consumed by the process */
+#define OE_PROFILER_SAMPLES_PER_SECOND 1000
+
+/* Maximum number of distinct stacks recorded per enclave (a power of two).
+ * Samples of new stacks are dropped once the table is full. */
+#define OE_PROFILER_MAX_STACKS 2048
+
+/* Maximum number of enclaves profiled at the same time */
+#define OE_PROFILER_MAX_ENCLAVES 8
+
+typedef struct _oe_profiler_stack
+{
+    /* _FREE, _WRITING or _READY (see profiler.c) */
+    volatile uint32_t state;
+    uint32_t depth;
+    uint64_t hash;
+    volatile uint64_t count;
+
+    /* Addresses of the sampled instruction and of the return addresses of
+     * its callers, innermost first */
+    uint64_t frames[OE_PROFILER_MAX_DEPTH];
+} oe_profiler_stack_t;
+
+/*
+**==============================================================================
+**
+** oe_profiler_t
+**
+**     Per-enclave CPU profile. Allocated by the first call to
+**     oe_enable_enclave_profiler() and released by oe_terminate_enclave().
+**     The stacks are written by the SIGPROF handler of the threads that run
+**     the enclave, without locks: a stack is claimed by switching its state
+**     from _FREE to _WRITING and published by switching it to _READY.
+**
+**==============================================================================
+*/
+
+typedef struct _oe_profiler
+{
+    oe_enclave_t* enclave;
+    bool enabled;
+
+    /* Samples that could not be recorded (table full or unreadable frame) */
+    volatile uint64_t num_dropped;
+
+    oe_profiler_stack_t stacks[OE_PROFILER_MAX_STACKS];
+} oe_profiler_t;
+
+/* Stop profiling the enclave and release its profile (called on
+ * termination, before the enclave memory is released) */
+void oe_profiler_free(oe_enclave_t* enclave);
+
+OE_EXTERNC_END
+
+#endif /* _OE_HOST_PROFILER_H */
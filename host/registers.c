@@ -3,6 +3,7 @@
 
 #if defined(__linux__)
 #include <asm/prctl.h>
+#include <sys/auxv.h>
 #include <sys/syscall.h>
 #include <unistd.h>
 #elif defined(_WIN32)
@@ -14,10 +15,71 @@
 
 #include <openenclave/internal/registers.h>
 
+#if defined(__linux__)
+
+/* Set in AT_HWCAP2 by kernels that let user mode read and write the FS and
+ * GS register bases with the FSGSBASE instructions (Linux 5.9 and later) */
+#ifndef HWCAP2_FSGSBASE
+#define HWCAP2_FSGSBASE (1 << 1)
+#endif
+
+#define _FSGSBASE_UNKNOWN 0
+#define _FSGSBASE_ENABLED 1
+#define _FSGSBASE_DISABLED 2
+#define _FSGSBASE_UNSUPPORTED 3
+
+static int _fsgsbase = _FSGSBASE_UNKNOWN;
+
+/* Whether to use the FSGSBASE instructions, which avoid the arch_prctl()
+ * system call of each access (and so three system calls per simulated
+ * ECALL) */
+static bool _use_fsgsbase(void)
+{
+    int fsgsbase = __atomic_load_n(&_fsgsbase, __ATOMIC_RELAXED);
+
+    if (fsgsbase == _FSGSBASE_UNKNOWN)
+    {
+        if (getauxval(AT_HWCAP2) & HWCAP2_FSGSBASE)
+            fsgsbase = _FSGSBASE_ENABLED;
+        else
+            fsgsbase = _FSGSBASE_UNSUPPORTED;
+
+        __atomic_store_n(&_fsgsbase, fsgsbase, __ATOMIC_RELAXED);
+    }
+
+    return fsgsbase == _FSGSBASE_ENABLED;
+}
+
+#endif /* defined(__linux__) */
+
+bool oe_enable_fsgsbase(bool enable)
+{
+#if defined(__linux__)
+    /* Detect the support on the first call */
+    _use_fsgsbase();
+
+    if (__atomic_load_n(&_fsgsbase, __ATOMIC_RELAXED) == _FSGSBASE_UNSUPPORTED)
+        return false;
+
+    __atomic_store_n(
+        &_fsgsbase,
+        enable ? _FSGSBASE_ENABLED : _FSGSBASE_DISABLED,
+        __ATOMIC_RELAXED);
+
+    return enable;
+#elif defined(_WIN32)
+    OE_UNUSED(enable);
+    return true;
+#endif
+}
+
 void oe_set_gs_register_base(const void* ptr)
 {
 #if defined(__linux__)
-    syscall(__NR_arch_prctl, ARCH_SET_GS, ptr);
+    if (_use_fsgsbase())
+        asm volatile("wrgsbase %0" : : "r"(ptr) : "memory");
+    else
+        syscall(__NR_arch_prctl, ARCH_SET_GS, ptr);
 #elif defined(_WIN32)
     _writegsbase_u64((uint64_t)ptr);
 #endif
@@ -27,9 +89,42 @@ void* oe_get_gs_register_base()
 {
 #if defined(__linux__)
     void* ptr = NULL;
-    syscall(__NR_arch_prctl, ARCH_GET_GS, &ptr);
+
+    if (_use_fsgsbase())
+        asm volatile("rdgsbase %0" : "=r"(ptr));
+    else
+        syscall(__NR_arch_prctl, ARCH_GET_GS, &ptr);
+
     return ptr;
 #elif defined(_WIN32)
     return (void*)_readgsbase_u64();
 #endif
 }
+
+void oe_set_fs_register_base(const void* ptr)
+{
+#if defined(__linux__)
+    if (_use_fsgsbase())
+        asm volatile("wrfsbase %0" : : "r"(ptr) : "memory");
+    else
+        syscall(__NR_arch_prctl, ARCH_SET_FS, ptr);
+#elif defined(_WIN32)
+    _writefsbase_u64((uint64_t)ptr);
+#endif
+}
+
+void* oe_get_fs_register_base()
+{
+#if defined(__linux__)
+    void* ptr = NULL;
+
+    if (_use_fsgsbase())
+        asm volatile("rdfsbase %0" : "=r"(ptr));
+    else
+        syscall(__NR_arch_prctl, ARCH_GET_FS, &ptr);
+
+    return ptr;
+#elif defined(_WIN32)
+    return (void*)_readfsbase_u64();
+#endif
+}
@@ -3,14 +3,17 @@
 
 #include <dlfcn.h>
 #include <openenclave/bits/safecrt.h>
+#include <openenclave/internal/files.h>
 #include <openenclave/internal/hexdump.h>
 #include <openenclave/internal/raise.h>
 #include <openenclave/internal/report.h>
 #include <openenclave/internal/trace.h>
+#include <pthread.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
+#include "collateralstore.h"
 #include "hostthread.h"
 #include "platformquoteprovider.h"
 #include "sgxquoteprovider.h"
@@ -31,6 +34,167 @@ static void* _lib_handle = 0;
 static sgx_ql_get_revocation_info_t _get_revocation_info = 0;
 static sgx_ql_free_revocation_info_t _free_revocation_info = 0;
 
+/* Taken for reading by calls to the provider and for writing when the
+ * provider is replaced, so that a call never mixes two providers */
+static pthread_rwlock_t _provider_lock = PTHREAD_RWLOCK_INITIALIZER;
+
+/*
+**==============================================================================
+**
+** Local quote provider:
+**
+**     A stand-in for libdcap_quoteprov.so that reads the revocation info
+**     from files of a local directory instead of the collateral service:
+**
+**         tcb_info.json
+**         tcb_issuer_chain.pem
+**         crl<i>.der                 (for each CRL URL i of the request)
+**         crl_issuer_chain<i>.pem
+**
+**     It is used when OE_SGX_COLLATERAL_DIR names such a directory, or after
+**     oe_use_local_quote_provider() is called (by tests).
+**
+**==============================================================================
+*/
+
+static char _local_directory[OE_LOCAL_QUOTE_PROVIDER_MAX_PATH];
+
+static sgx_plat_error_t _local_read_file(
+    const char* name,
+    char** data,
+    uint32_t* size)
+{
+    char path[OE_LOCAL_QUOTE_PROVIDER_MAX_PATH];
+    void* file_data = NULL;
+    size_t file_size = 0;
+    int n;
+
+    n = snprintf(path, sizeof(path), "%s/%s", _local_directory, name);
+
+    if (n < 0 || (size_t)n >= sizeof(path))
+        return SGX_PLAT_ERROR_INVALID_PARAMETER;
+
+    if (__oe_load_file(path, 0, &file_data, &file_size) != OE_OK)
+        return SGX_PLAT_NO_DATA_FOUND;
+
+    if (file_size == 0 || file_size > OE_UINT32_MAX)
+    {
+        free(file_data);
+        return SGX_PLAT_NO_DATA_FOUND;
+    }
+
+    *data = (char*)file_data;
+    *size = (uint32_t)file_size;
+
+    return SGX_PLAT_ERROR_OK;
+}
+
+static void _local_free_revocation_info(sgx_ql_revocation_info_t* info)
+{
+    if (info)
+    {
+        free(info->tcb_info);
+        free(info->tcb_issuer_chain);
+
+        for (uint32_t i = 0; info->crls && i < info->crl_count; i++)
+        {
+            free(info->crls[i].crl_data);
+            free(info->crls[i].crl_issuer_chain);
+        }
+
+        free(info->crls);
+        free(info);
+    }
+}
+
+static sgx_plat_error_t _local_get_revocation_info(
+    const sgx_ql_get_revocation_info_params_t* params,
+    sgx_ql_revocation_info_t** pp_info)
+{
+    sgx_plat_error_t r = SGX_PLAT_ERROR_OUT_OF_MEMORY;
+    sgx_ql_revocation_info_t* info = NULL;
+    char name[32];
+
+    if (!params || !pp_info)
+        return SGX_PLAT_ERROR_INVALID_PARAMETER;
+
+    *pp_info = NULL;
+
+    if (!(info = calloc(1, sizeof(*info))))
+        goto done;
+
+    info->version = SGX_QL_REVOCATION_INFO_VERSION_1;
+
+    if (params->crl_url_count &&
+        !(info->crls = calloc(params->crl_url_count, sizeof(*info->crls))))
+        goto done;
+
+    info->crl_count = params->crl_url_count;
+
+    if ((r = _local_read_file(
+             "tcb_info.json", &info->tcb_info, &info->tcb_info_size)) !=
+        SGX_PLAT_ERROR_OK)
+        goto done;
+
+    if ((r = _local_read_file(
+             "tcb_issuer_chain.pem",
+             &info->tcb_issuer_chain,
+             &info->tcb_issuer_chain_size)) != SGX_PLAT_ERROR_OK)
+        goto done;
+
+    for (uint32_t i = 0; i < info->crl_count; i++)
+    {
+        sgx_ql_crl_data_t* crl = &info->crls[i];
+
+        snprintf(name, sizeof(name), "crl%u.der", i);
+
+        if ((r = _local_read_file(
+                 name, &crl->crl_data, &crl->crl_data_size)) !=
+            SGX_PLAT_ERROR_OK)
+            goto done;
+
+        snprintf(name, sizeof(name), "crl_issuer_chain%u.pem", i);
+
+        if ((r = _local_read_file(
+                 name,
+                 &crl->crl_issuer_chain,
+                 &crl->crl_issuer_chain_size)) != SGX_PLAT_ERROR_OK)
+            goto done;
+    }
+
+    *pp_info = info;
+    info = NULL;
+
+done:
+    _local_free_revocation_info(info);
+    return r;
+}
+
+oe_result_t oe_use_local_quote_provider(const char* directory)
+{
+    oe_result_t result = OE_UNEXPECTED;
+
+    if (!directory || !*directory ||
+        strlen(directory) >= sizeof(_local_directory))
+        OE_RAISE(OE_INVALID_PARAMETER);
+
+    pthread_rwlock_wrlock(&_provider_lock);
+    memcpy(_local_directory, directory, strlen(directory) + 1);
+    _get_revocation_info = _local_get_revocation_info;
+    _free_revocation_info = _local_free_revocation_info;
+    pthread_rwlock_unlock(&_provider_lock);
+
+    /* Collateral fetched from another provider must not be served */
+    oe_collateral_store_clear();
+
+    OE_TRACE_INFO("sgxquoteprovider: using files of %s\n", directory);
+
+    result = OE_OK;
+
+done:
+    return result;
+}
+
 static void _unload_quote_provider()
 {
     if (_lib_handle)
@@ -54,15 +218,39 @@ static void _quote_provider_log(sgx_ql_log_level_t level, const char* message)
 
 static void _load_quote_provider()
 {
+    const char* directory = getenv("OE_SGX_COLLATERAL_DIR");
+    bool local;
+
+    /* Keep the local provider if a test selected it already */
+    pthread_rwlock_rdlock(&_provider_lock);
+    local = (_get_revocation_info == _local_get_revocation_info);
+    pthread_rwlock_unlock(&_provider_lock);
+
+    if (local)
+        return;
+
+    if (directory && *directory)
+    {
+        oe_use_local_quote_provider(directory);
+        return;
+    }
+
     if (_lib_handle == 0)
     {
         _lib_handle = dlopen("libdcap_quoteprov.so", RTLD_LAZY | RTLD_LOCAL);
         if (_lib_handle != 0)
         {
-            _get_revocation_info =
-                dlsym(_lib_handle, "sgx_ql_get_revocation_info");
-            _free_revocation_info =
-                dlsym(_lib_handle, "sgx_ql_free_revocation_info");
+            pthread_rwlock_wrlock(&_provider_lock);
+
+            if (_get_revocation_info != _local_get_revocation_info)
+            {
+                _get_revocation_info =
+                    dlsym(_lib_handle, "sgx_ql_get_revocation_info");
+                _free_revocation_info =
+                    dlsym(_lib_handle, "sgx_ql_free_revocation_info");
+            }
+
+            pthread_rwlock_unlock(&_provider_lock);
 
             OE_TRACE_INFO(
                 "sgxquoteprovider: _get_revocation_info = 0x%lx\n",
@@ -103,11 +291,25 @@ static void _load_quote_provider()
 oe_result_t oe_initialize_quote_provider()
 {
     static oe_once_type once = OE_H_ONCE_INITIALIZER;
+    bool loaded;
+
     oe_once(&once, _load_quote_provider);
-    return _lib_handle ? OE_OK : OE_QUOTE_PROVIDER_LOAD_ERROR;
+
+    pthread_rwlock_rdlock(&_provider_lock);
+    loaded = (_get_revocation_info != 0);
+    pthread_rwlock_unlock(&_provider_lock);
+
+    return loaded ? OE_OK : OE_QUOTE_PROVIDER_LOAD_ERROR;
 }
 
 oe_result_t oe_get_revocation_info(oe_get_revocation_info_args_t* args)
+{
+    /* Serve the collateral from the store to keep the provider's latency out
+     * of the verification */
+    return oe_collateral_store_get(args);
+}
+
+oe_result_t oe_fetch_revocation_info(oe_get_revocation_info_args_t* args)
 {
     oe_result_t result = OE_FAILURE;
     sgx_ql_get_revocation_info_params_t params = {0};
@@ -117,6 +319,9 @@ oe_result_t oe_get_revocation_info(oe_get_revocation_info_args_t* args)
     uint8_t* p = 0;
     uint8_t* p_end = 0;
 
+    /* Keep the provider from being replaced until its outputs are freed */
+    pthread_rwlock_rdlock(&_provider_lock);
+
     if (!_get_revocation_info || !_free_revocation_info)
         OE_RAISE(OE_QUOTE_PROVIDER_LOAD_ERROR);
 
@@ -290,6 +495,8 @@ done:
         OE_TRACE_INFO("Freed revocation info.\n");
     }
 
+    pthread_rwlock_unlock(&_provider_lock);
+
     return result;
 }
 
@@ -11,8 +11,30 @@
 
 OE_EXTERNC_BEGIN
 
+/* Maximum length of the directory of the local quote provider */
+#define OE_LOCAL_QUOTE_PROVIDER_MAX_PATH 1024
+
 oe_result_t oe_initialize_quote_provider(void);
 
+/**
+ * Fetch the revocation info of the given arguments from the quote provider.
+ *
+ * Unlike oe_get_revocation_info(), which serves revocation info from the
+ * collateral store, this always calls the provider. The outputs are released
+ * with oe_cleanup_get_revocation_info_args().
+ */
+oe_result_t oe_fetch_revocation_info(oe_get_revocation_info_args_t* args);
+
+/**
+ * Fetch revocation info from files of the given directory instead of
+ * libdcap_quoteprov.so (see sgxquoteprovider.c for the file names).
+ *
+ * This is meant for tests. The provider is replaced once the calls in
+ * progress return, and collateral held by the store (or still being fetched
+ * from the previous provider) is dropped.
+ */
+oe_result_t oe_use_local_quote_provider(const char* directory);
+
 OE_EXTERNC_END
 
 #endif // _OE_SGX_HOST_QUOTE_PROVIDER_H
@@ -0,0 +1,49 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#include <openenclave/host.h>
+#include <openenclave/internal/calls.h>
+#include <openenclave/internal/raise.h>
+
+static oe_result_t _shared_buffer_ecall(
+    oe_enclave_t* enclave,
+    uint16_t func,
+    const void* buffer,
+    size_t size)
+{
+    oe_result_t result = OE_UNEXPECTED;
+    oe_shared_buffer_args_t args;
+    uint64_t arg_out = 0;
+
+    if (!enclave || !buffer || !size)
+        OE_RAISE(OE_INVALID_PARAMETER);
+
+    args.buffer = buffer;
+    args.size = size;
+
+    OE_CHECK(oe_ecall(enclave, func, (uint64_t)&args, &arg_out));
+    OE_CHECK((oe_result_t)arg_out);
+
+    result = OE_OK;
+
+done:
+    return result;
+}
+
+oe_result_t oe_register_shared_buffer(
+    oe_enclave_t* enclave,
+    const void* buffer,
+    size_t size)
+{
+    return _shared_buffer_ecall(
+        enclave, OE_ECALL_REGISTER_SHARED_BUFFER, buffer, size);
+}
+
+oe_result_t oe_unregister_shared_buffer(
+    oe_enclave_t* enclave,
+    const void* buffer,
+    size_t size)
+{
+    return _shared_buffer_ecall(
+        enclave, OE_ECALL_UNREGISTER_SHARED_BUFFER, buffer, size);
+}
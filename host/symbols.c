@@ -0,0 +1,213 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#include "symbols.h"
+#include <openenclave/bits/safemath.h>
+#include <openenclave/internal/raise.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct _oe_symbol
+{
+    /* Address range of the function (the end is included, so that a return
+     * address that follows a final call still resolves to the caller) */
+    uint64_t start;
+    uint64_t end;
+
+    /* Largest end of this symbol and the ones before it, which bounds the
+     * backward search for functions containing other ones */
+    uint64_t max_end;
+
+    /* Name of the function (in the names buffer of the index) */
+    const char* name;
+} oe_symbol_t;
+
+typedef struct _oe_symbol_index
+{
+    oe_symbol_t* symbols;
+    size_t num_symbols;
+    char* names;
+} oe_symbol_index_t;
+
+static int _compare_symbols(const void* a_, const void* b_)
+{
+    const oe_symbol_t* a = (const oe_symbol_t*)a_;
+    const oe_symbol_t* b = (const oe_symbol_t*)b_;
+
+    if (a->start != b->start)
+        return a->start < b->start ? -1 : 1;
+
+    /* The smaller function is searched first */
+    if (a->end != b->end)
+        return a->end > b->end ? -1 : 1;
+
+    return 0;
+}
+
+/* Get the name of a function symbol that can be indexed (or NULL) */
+static const char* _get_function_name(
+    const elf64_t* elf,
+    const elf64_sym_t* sym)
+{
+    uint64_t end;
+
+    if ((sym->st_info & 0x0F) != STT_FUNC || sym->st_value == 0)
+        return NULL;
+
+    if (oe_safe_add_u64(sym->st_value, sym->st_size, &end) != OE_OK)
+        return NULL;
+
+    return elf64_get_string_from_strtab(elf, sym->st_name);
+}
+
+static void _free_index(oe_symbol_index_t* index)
+{
+    if (index)
+    {
+        free(index->symbols);
+        free(index->names);
+        free(index);
+    }
+}
+
+oe_result_t oe_symbols_build(oe_enclave_t* enclave, const elf64_t* elf)
+{
+    oe_result_t result = OE_UNEXPECTED;
+    oe_symbol_index_t* index = NULL;
+    unsigned char* data;
+    size_t size;
+    const elf64_sym_t* symtab = NULL;
+    size_t num_syms = 0;
+    size_t num_symbols = 0;
+    size_t names_size = 0;
+    char* names;
+
+    if (!enclave || !elf)
+        OE_RAISE(OE_INVALID_PARAMETER);
+
+    if (!(index = (oe_symbol_index_t*)calloc(1, sizeof(oe_symbol_index_t))))
+        OE_RAISE(OE_OUT_OF_MEMORY);
+
+    /* Stripped images have no .symtab section (the index stays empty) */
+    if (elf64_find_section(elf, ".symtab", &data, &size) == 0)
+    {
+        symtab = (const elf64_sym_t*)data;
+        num_syms = size / sizeof(elf64_sym_t);
+    }
+
+    /* Count the functions and the size of their names */
+    for (size_t i = 1; i < num_syms; i++)
+    {
+        const char* name = _get_function_name(elf, &symtab[i]);
+
+        if (name)
+        {
+            num_symbols++;
+            names_size += strlen(name) + 1;
+        }
+    }
+
+    if (num_symbols == 0)
+        goto publish;
+
+    index->symbols = (oe_symbol_t*)malloc(num_symbols * sizeof(oe_symbol_t));
+    index->names = (char*)malloc(names_size);
+
+    if (!index->symbols || !index->names)
+        OE_RAISE(OE_OUT_OF_MEMORY);
+
+    /* Copy the functions and their names */
+    names = index->names;
+
+    for (size_t i = 1; i < num_syms; i++)
+    {
+        const elf64_sym_t* sym = &symtab[i];
+        const char* name = _get_function_name(elf, sym);
+        oe_symbol_t* p;
+        size_t name_size;
+
+        if (!name)
+            continue;
+
+        p = &index->symbols[index->num_symbols++];
+        p->start = sym->st_value;
+        p->end = sym->st_value + sym->st_size;
+        p->name = names;
+
+        name_size = strlen(name) + 1;
+        memcpy(names, name, name_size);
+        names += name_size;
+    }
+
+    qsort(
+        index->symbols,
+        index->num_symbols,
+        sizeof(oe_symbol_t),
+        _compare_symbols);
+
+    for (size_t i = 0; i < index->num_symbols; i++)
+    {
+        oe_symbol_t* p = &index->symbols[i];
+
+        p->max_end = p->end;
+
+        if (i > 0 && p[-1].max_end > p->max_end)
+            p->max_end = p[-1].max_end;
+    }
+
+publish:
+    _free_index(enclave->symbols);
+    enclave->symbols = index;
+    index = NULL;
+
+    result = OE_OK;
+
+done:
+    _free_index(index);
+    return result;
+}
+
+const char* oe_symbols_find_function(
+    const oe_enclave_t* enclave,
+    uint64_t vaddr)
+{
+    const oe_symbol_index_t* index;
+    size_t lo = 0;
+    size_t hi;
+
+    if (!enclave || !(index = enclave->symbols))
+        return NULL;
+
+    /* Find the number of functions that start at or before the address */
+    hi = index->num_symbols;
+
+    while (lo < hi)
+    {
+        size_t mid = lo + (hi - lo) / 2;
+
+        if (index->symbols[mid].start <= vaddr)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+
+    /* Search back for the closest function that contains the address */
+    while (lo > 0)
+    {
+        const oe_symbol_t* p = &index->symbols[--lo];
+
+        if (p->max_end < vaddr)
+            break;
+
+        if (p->end >= vaddr)
+            return p->name;
+    }
+
+    return NULL;
+}
+
+void oe_symbols_free(oe_enclave_t* enclave)
+{
+    _free_index(enclave->symbols);
+    enclave->symbols = NULL;
+}
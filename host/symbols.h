@@ -0,0 +1,41 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#ifndef _OE_HOST_SYMBOLS_H
+#define _OE_HOST_SYMBOLS_H
+
+#include <openenclave/host.h>
+#include <openenclave/internal/elf.h>
+#include "enclave.h"
+
+OE_EXTERNC_BEGIN
+
+/*
+**==============================================================================
+**
+** oe_symbols_build()
+**
+**     Build the index of the function symbols of the enclave image (from its
+**     .symtab section), which is sorted by address so that the function that
+**     contains an address is found by a binary search. The index is built
+**     once when the enclave is created and is not modified until the enclave
+**     is terminated, so it is read without locking. An image without symbols
+**     gets an empty index.
+**
+**==============================================================================
+*/
+
+oe_result_t oe_symbols_build(oe_enclave_t* enclave, const elf64_t* elf);
+
+/* Find the name of the function containing the given address (relative to
+ * the base of the enclave), or return NULL if there is none */
+const char* oe_symbols_find_function(
+    const oe_enclave_t* enclave,
+    uint64_t vaddr);
+
+/* Release the symbol index of the enclave (called on termination) */
+void oe_symbols_free(oe_enclave_t* enclave);
+
+OE_EXTERNC_END
+
+#endif /* _OE_HOST_SYMBOLS_H */
@@ -0,0 +1,284 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#include "threadpool.h"
+#include <openenclave/internal/raise.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if __GNUC__
+
+#include <time.h>
+
+/*
+**==============================================================================
+**
+** Enclave thread pool:
+**
+**     Enclave code creates threads with oe_thread_create() (and so with
+**     pthread_create() and std::thread), which posts the handle of the new
+**     thread to the host with OE_OCALL_THREAD_CREATE. A host thread of the
+**     pool then enters the enclave on a free TCS and runs the thread until
+**     its start routine returns. Joining and detaching are handled in the
+**     enclave.
+**
+**==============================================================================
+*/
+
+typedef struct _thread_start
+{
+    uint64_t thread;
+    struct _thread_start* next;
+} thread_start_t;
+
+typedef struct _oe_thread_pool
+{
+    pthread_mutex_t lock;
+    pthread_cond_t work;
+
+    thread_start_t* queue_head;
+    thread_start_t* queue_tail;
+    size_t num_queued;
+
+    pthread_t threads[OE_SGX_MAX_TCS];
+    size_t num_threads;
+    size_t num_idle;
+    bool shutdown;
+
+    oe_enclave_t* enclave;
+} oe_thread_pool_t;
+
+/* Run an enclave thread, waiting for a free TCS */
+static void _run_thread(oe_thread_pool_t* pool, uint64_t thread)
+{
+    const struct timespec retry = {0, OE_THREAD_POOL_RETRY_USEC * 1000};
+    oe_result_t result;
+    uint64_t arg_out = 0;
+
+    for (;;)
+    {
+        result = oe_ecall(
+            pool->enclave, OE_ECALL_THREAD_START, thread, &arg_out);
+
+        if (result != OE_OUT_OF_THREADS ||
+            __atomic_load_n(&pool->shutdown, __ATOMIC_ACQUIRE))
+        {
+            break;
+        }
+
+        nanosleep(&retry, NULL);
+    }
+}
+
+static void* _worker(void* arg)
+{
+    oe_thread_pool_t* pool = (oe_thread_pool_t*)arg;
+
+    pthread_mutex_lock(&pool->lock);
+
+    for (;;)
+    {
+        thread_start_t* start;
+
+        while (!pool->queue_head && !pool->shutdown)
+        {
+            pool->num_idle++;
+            pthread_cond_wait(&pool->work, &pool->lock);
+            pool->num_idle--;
+        }
+
+        /* Threads that were not started are dropped on shutdown */
+        if (pool->shutdown)
+            break;
+
+        start = pool->queue_head;
+
+        if (!(pool->queue_head = start->next))
+            pool->queue_tail = NULL;
+
+        pool->num_queued--;
+
+        pthread_mutex_unlock(&pool->lock);
+        {
+            _run_thread(pool, start->thread);
+            free(start);
+        }
+        pthread_mutex_lock(&pool->lock);
+    }
+
+    pthread_mutex_unlock(&pool->lock);
+
+    return NULL;
+}
+
+/* Create the pool of the enclave (called with enclave->lock held) */
+static oe_result_t _create_pool(oe_enclave_t* enclave)
+{
+    oe_result_t result = OE_UNEXPECTED;
+    oe_thread_pool_t* pool;
+
+    if (!(pool = (oe_thread_pool_t*)calloc(1, sizeof(*pool))))
+        OE_RAISE(OE_OUT_OF_MEMORY);
+
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->work, NULL);
+    pool->enclave = enclave;
+
+    enclave->thread_pool = pool;
+
+    result = OE_OK;
+
+done:
+    return result;
+}
+
+oe_result_t oe_thread_pool_start(oe_enclave_t* enclave, uint64_t thread)
+{
+    oe_result_t result = OE_UNEXPECTED;
+    oe_thread_pool_t* pool;
+    thread_start_t* start = NULL;
+
+    if (!enclave || !thread)
+        OE_RAISE(OE_INVALID_PARAMETER);
+
+    if (!(start = (thread_start_t*)calloc(1, sizeof(*start))))
+        OE_RAISE(OE_OUT_OF_MEMORY);
+
+    start->thread = thread;
+
+    oe_mutex_lock(&enclave->lock);
+    {
+        if (!enclave->thread_pool)
+        {
+            oe_result_t r = _create_pool(enclave);
+
+            if (r != OE_OK)
+            {
+                oe_mutex_unlock(&enclave->lock);
+                OE_RAISE(r);
+            }
+        }
+
+        pool = enclave->thread_pool;
+    }
+    oe_mutex_unlock(&enclave->lock);
+
+    pthread_mutex_lock(&pool->lock);
+    {
+        if (pool->shutdown)
+        {
+            pthread_mutex_unlock(&pool->lock);
+            OE_RAISE(OE_FAILURE);
+        }
+
+        /* Start another host thread unless an idle one is left for the
+         * call: each queued call is taken by one of the idle threads (which
+         * remain counted as idle until they wake up). More host threads than
+         * TCSs could never enter the enclave. */
+        if (pool->num_queued >= pool->num_idle &&
+            pool->num_threads < enclave->num_bindings)
+        {
+            if (pthread_create(
+                    &pool->threads[pool->num_threads], NULL, _worker, pool) ==
+                0)
+            {
+                pool->num_threads++;
+            }
+            else if (pool->num_threads == 0)
+            {
+                pthread_mutex_unlock(&pool->lock);
+                OE_RAISE(OE_FAILURE);
+            }
+        }
+
+        if (pool->queue_tail)
+            pool->queue_tail->next = start;
+        else
+            pool->queue_head = start;
+
+        pool->queue_tail = start;
+        pool->num_queued++;
+        pthread_cond_signal(&pool->work);
+    }
+    pthread_mutex_unlock(&pool->lock);
+
+    start = NULL;
+    result = OE_OK;
+
+done:
+    free(start);
+    return result;
+}
+
+void oe_thread_pool_shutdown(oe_enclave_t* enclave)
+{
+    oe_thread_pool_t* pool;
+    thread_start_t* queue;
+
+    if (!enclave || !(pool = enclave->thread_pool))
+        return;
+
+    pthread_mutex_lock(&pool->lock);
+    {
+        __atomic_store_n(&pool->shutdown, true, __ATOMIC_RELEASE);
+        pthread_cond_broadcast(&pool->work);
+
+        queue = pool->queue_head;
+        pool->queue_head = NULL;
+        pool->queue_tail = NULL;
+        pool->num_queued = 0;
+    }
+    pthread_mutex_unlock(&pool->lock);
+
+    /* Threads that were not started are dropped */
+    while (queue)
+    {
+        thread_start_t* start = queue;
+        queue = start->next;
+        free(start);
+    }
+}
+
+void oe_thread_pool_free(oe_enclave_t* enclave)
+{
+    oe_thread_pool_t* pool;
+
+    if (!enclave || !(pool = enclave->thread_pool))
+        return;
+
+    oe_thread_pool_shutdown(enclave);
+
+    /* Enclave threads that are running are waited for */
+    for (size_t i = 0; i < pool->num_threads; i++)
+        pthread_join(pool->threads[i], NULL);
+
+    pthread_cond_destroy(&pool->work);
+    pthread_mutex_destroy(&pool->lock);
+    free(pool);
+
+    enclave->thread_pool = NULL;
+}
+
+#else /* !__GNUC__ */
+
+/* The thread pool is not implemented yet on this platform */
+
+oe_result_t oe_thread_pool_start(oe_enclave_t* enclave, uint64_t thread)
+{
+    OE_UNUSED(enclave);
+    OE_UNUSED(thread);
+
+    return OE_UNSUPPORTED;
+}
+
+void oe_thread_pool_shutdown(oe_enclave_t* enclave)
+{
+    OE_UNUSED(enclave);
+}
+
+void oe_thread_pool_free(oe_enclave_t* enclave)
+{
+    OE_UNUSED(enclave);
+}
+
+#endif /* !__GNUC__ */
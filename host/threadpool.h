@@ -0,0 +1,43 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#ifndef _OE_HOST_THREADPOOL_H
+#define _OE_HOST_THREADPOOL_H
+
+#include <openenclave/host.h>
+#include <openenclave/internal/calls.h>
+#include "enclave.h"
+
+OE_EXTERNC_BEGIN
+
+/* Interval between two attempts to enter an enclave with no free TCS */
+#define OE_THREAD_POOL_RETRY_USEC 100
+
+/*
+**==============================================================================
+**
+** oe_thread_pool_start()
+**
+**     Run the enclave thread with the given handle (created by
+**     oe_thread_create() in the enclave) on a host thread of the enclave
+**     thread pool, which enters the enclave with OE_ECALL_THREAD_START. Idle
+**     host threads are reused; others are started on demand, up to one per
+**     TCS. A host thread retries until a TCS is free.
+**
+**==============================================================================
+*/
+
+oe_result_t oe_thread_pool_start(oe_enclave_t* enclave, uint64_t thread);
+
+/* Drop the threads that were not started yet, and start no more (called on
+ * termination, before the enclave destructor) */
+void oe_thread_pool_shutdown(oe_enclave_t* enclave);
+
+/* Shut the pool down and wait for the running threads to return (called on
+ * termination, after the enclave destructor stopped the workers of its task
+ * runtime) */
+void oe_thread_pool_free(oe_enclave_t* enclave);
+
+OE_EXTERNC_END
+
+#endif /* _OE_HOST_THREADPOOL_H */
@@ -14,7 +14,13 @@ extern __oe_dispatch_ocall:proc
 ;;     [IN] uint64_t arg2,
 ;;     [OUT] uint64_t* arg3,
 ;;     [OUT] uint64_t* arg4,
-;;     [OUT] oe_enclave_t* enclave);
+;;     [OUT] oe_enclave_t* enclave,
+;;     [IN] const void* fsbase,
+;;     [IN] const void* host_fsbase);
+;;
+;; If FSBASE is not null, the FS register base is set to it while the enclave
+;; runs. The host code does not use FS on Windows, so it is set back to
+;; HOST_FSBASE only on return.
 ;;
 ;; Registers:
 ;;     RCX      - tcs: thread control structure (extended)
@@ -23,6 +29,9 @@ extern __oe_dispatch_ocall:proc
 ;;     R9       - arg2
 ;;     [RBP+48] - arg3
 ;;     [RBP+56] - arg4
+;;     [RBP+64] - enclave
+;;     [RBP+72] - fsbase
+;;     [RBP+80] - host_fsbase
 ;;
 ;; These registers may be destroyed across function calls:
 ;;     RAX, RCX, RDX, R8, R9, R10, R11
@@ -74,6 +83,13 @@ NESTED_ENTRY oe_enter_sim, _TEXT$00
     mov rax, [rbp+64]
     mov ENCLAVE, rax
 
+    ;; Set the FS register base of the enclave (if any):
+    mov rax, [rbp+72]
+    cmp rax, 0
+    je fsbase_set
+    wrfsbase rax
+fsbase_set:
+
     ;; Load CSSA with zero initially:
     mov rax, 0
     mov CSSA, rax
@@ -150,6 +166,14 @@ return_from_ecall_sim:
     mov rax, qword ptr [rbp+56]
     mov qword ptr [rax], rbx
 
+    ;; Set the FS register base of the host back (if switched):
+    mov rax, [rbp+72]
+    cmp rax, 0
+    je host_fsbase_set
+    mov rax, [rbp+80]
+    wrfsbase rax
+host_fsbase_set:
+
     ;; Restore registers:
     pop r15
     pop r14
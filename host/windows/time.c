@@ -4,6 +4,7 @@
 #include <openenclave/bits/types.h>
 #include <openenclave/internal/time.h>
 #include <windows.h>
+#include "../callstats.h"
 
 /*
 **==============================================================================
@@ -58,3 +59,20 @@ void oe_handle_get_time(uint64_t arg_in, uint64_t* arg_out)
     if (arg_out)
         *arg_out = _time();
 }
+
+uint64_t oe_get_monotonic_time_ns(void)
+{
+    static LARGE_INTEGER frequency;
+    LARGE_INTEGER counter;
+
+    if (!frequency.QuadPart && !QueryPerformanceFrequency(&frequency))
+        return 0;
+
+    if (!QueryPerformanceCounter(&counter))
+        return 0;
+
+    /* Split the conversion to avoid overflowing the counter * 10^9 */
+    return (uint64_t)(counter.QuadPart / frequency.QuadPart) * 1000000000ULL +
+           (uint64_t)(counter.QuadPart % frequency.QuadPart) * 1000000000ULL /
+               (uint64_t)frequency.QuadPart;
+}
@@ -29,6 +29,12 @@ OE_EXTERNC_BEGIN
 /* Max number of threads in an enclave supported */
 #define OE_SGX_MAX_TCS 32
 
+/* Host marshalling stack pages per TCS when num_host_stack_pages is zero */
+#define OE_SGX_DEFAULT_HOST_STACK_PAGES 16
+
+/* Max number of host marshalling stack pages per TCS */
+#define OE_SGX_MAX_HOST_STACK_PAGES 4096
+
 typedef struct _oe_enclave_size_settings
 {
     uint64_t num_heap_pages;
@@ -56,8 +62,10 @@ typedef struct oe_sgx_enclave_config_t
     uint16_t product_id;
     uint16_t security_version;
 
-    /* Padding to make packed and unpacked size the same */
-    uint32_t padding;
+    /* Host memory pages reserved per TCS for marshalling OCALL arguments
+     * (zero selects OE_SGX_DEFAULT_HOST_STACK_PAGES). This field also keeps
+     * the packed and unpacked size of the structure the same. */
+    uint32_t num_host_stack_pages;
 
     /* (OE_SGX_FLAGS_DEBUG | OE_SGX_FLAGS_MODE64BIT) */
     uint64_t attributes;
@@ -135,7 +143,7 @@ typedef struct oe_sgx_enclave_properties_t
         {                                                                 \
             .product_id = PRODUCT_ID,                                     \
             .security_version = SECURITY_VERSION,                         \
-            .padding = 0,                                                 \
+            .num_host_stack_pages = 0,                                    \
             .attributes = OE_MAKE_ATTRIBUTES(ALLOW_DEBUG)                 \
         },                                                                \
         .sigstruct =                                                      \
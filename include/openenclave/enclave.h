@@ -95,6 +95,110 @@ oe_result_t oe_remove_vectored_exception_handler(
  */
 oe_result_t oe_call_host(const char* func, void* args);
 
+/**
+ * The OCALL table of an EDL file, generated by oeedger8r.
+ *
+ * The id of a function is its index in the table, which is fixed when the EDL
+ * file is compiled. The host assigns its own id to each function on its first
+ * call, which is kept in **host_ids**.
+ */
+typedef struct _oe_ocall_table
+{
+    /** The names of the host functions, indexed by OCALL id */
+    const char* const* names;
+
+    /** The host ids of the functions (zero until first called) */
+    uint32_t* host_ids;
+
+    /** The number of elements in **names** and **host_ids** */
+    uint32_t num_ocalls;
+} oe_ocall_table_t;
+
+/**
+ * Perform a high-level host function call (OCALL) by table id.
+ *
+ * This function is like oe_call_host(), except that the host function is given
+ * by its id in the OCALL table of an EDL file. The name of the function is
+ * sent to the host only on its first call. Later calls dispatch on the host
+ * id of the function without copying or looking up its name.
+ *
+ * This function is called by the OCALL wrappers that oeedger8r generates.
+ *
+ * @param table The OCALL table of the EDL file that declares the function.
+ * @param function_id The id of the host function in **table**.
+ * @param args The arguments to be passed to the host function.
+ *
+ * @retval OE_OK The function was called.
+ * @retval OE_INVALID_PARAMETER At least one parameter is invalid.
+ * @retval OE_NOT_FOUND The host function was not found.
+ *
+ */
+oe_result_t oe_call_host_function(
+    oe_ocall_table_t* table,
+    uint32_t function_id,
+    void* args);
+
+/**
+ * Handle of an OCALL posted by oe_call_host_async().
+ */
+typedef struct _oe_async_ocall oe_async_ocall_t;
+
+/**
+ * Perform a high-level host function call (OCALL) asynchronously.
+ *
+ * This function is like oe_call_host(), except that the host function runs on
+ * a pool of host worker threads and this function returns as soon as the call
+ * is queued. This keeps a blocking host function (such as file or network
+ * I/O) from occupying the caller's host thread. The calling enclave thread can
+ * do other work while the OCALL runs.
+ *
+ * The call must be completed with oe_async_ocall_wait(), which also releases
+ * the handle. Because the host function runs concurrently with the enclave,
+ * **args** must point to host memory that the enclave does not access until
+ * oe_async_ocall_wait() returns.
+ *
+ * Asynchronous OCALLs are only supported on Linux hosts.
+ *
+ * @param func The name of the host function that will be called.
+ * @param args The arguments to be passed to the host function.
+ * @param handle Receives the handle of the posted call.
+ *
+ * @retval OE_OK The call was posted.
+ * @retval OE_INVALID_PARAMETER At least one parameter is invalid.
+ * @retval OE_NOT_FOUND The host function was not found.
+ * @retval OE_UNSUPPORTED The host does not support asynchronous OCALLs.
+ *
+ */
+oe_result_t oe_call_host_async(
+    const char* func,
+    void* args,
+    oe_async_ocall_t** handle);
+
+/**
+ * Check whether an asynchronous OCALL is done without leaving the enclave.
+ *
+ * @param handle The handle returned by oe_call_host_async().
+ *
+ * @returns true if the call is done and oe_async_ocall_wait() will not block.
+ */
+bool oe_async_ocall_is_done(const oe_async_ocall_t* handle);
+
+/**
+ * Wait for an asynchronous OCALL and release its handle.
+ *
+ * If the call is not done, the other ready fibers of the calling TCS run
+ * first. Once none is ready, the calling thread parks on the host until the
+ * call is done. It keeps its TCS while it is parked, so waiting does not make
+ * the TCS available to other enclave threads.
+ * The handle must not be used after this function returns.
+ *
+ * @param handle The handle returned by oe_call_host_async().
+ *
+ * @returns The result of the call, as oe_call_host() would have returned it.
+ *
+ */
+oe_result_t oe_async_ocall_wait(oe_async_ocall_t* handle);
+
 /**
  * Perform a high-level host function call (OCALL).
  *
@@ -504,6 +608,128 @@ oe_enclave_t* oe_get_enclave(void);
  */
 oe_result_t oe_random(void* data, size_t size);
 
+/**
+ * Query CPUID information without executing the CPUID instruction.
+ *
+ * The CPUID instruction raises an exception in an enclave, which the enclave
+ * emulates after a round trip to the host. This function returns the same
+ * results directly, from the CPUID leaves that the host reported when the
+ * enclave was created. Like the emulation, it supports leaves 0 to 7, and
+ * only subleaf 0 of leaf 4. These values come from the host and are not
+ * trusted.
+ *
+ * @param leaf The CPUID leaf (EAX).
+ * @param subleaf The CPUID subleaf (ECX).
+ * @param eax Set to the value of EAX returned by CPUID.
+ * @param ebx Set to the value of EBX returned by CPUID.
+ * @param ecx Set to the value of ECX returned by CPUID.
+ * @param edx Set to the value of EDX returned by CPUID.
+ *
+ * @retval OE_OK The values of the leaf were returned.
+ * @retval OE_INVALID_PARAMETER One of the output parameters is null.
+ * @retval OE_UNSUPPORTED The leaf (or subleaf) is not available.
+ *
+ */
+oe_result_t oe_cpuid(
+    uint32_t leaf,
+    uint32_t subleaf,
+    uint32_t* eax,
+    uint32_t* ebx,
+    uint32_t* ecx,
+    uint32_t* edx);
+
+/**
+ * A bounds-checked, read-only view of a registered shared host buffer.
+ *
+ * Shared buffers are host memory regions registered once per enclave with
+ * **oe_register_shared_buffer()** on the host. Enclave functions receive
+ * them through **[shared]** EDL parameters or construct views over them with
+ * **oe_shared_buffer_view_init()**, and read them in place without copying
+ * them into enclave memory.
+ *
+ * The host may modify a shared buffer at any time. Any bytes that influence
+ * control flow or memory accesses inside the enclave (such as record headers,
+ * lengths and offsets) must therefore be copied into enclave memory with
+ * **oe_shared_buffer_view_read()** before being used. Payload bytes that are
+ * only streamed through (hashed, decrypted, parsed into enclave copies) may be
+ * accessed directly through **oe_shared_buffer_view_at()**.
+ */
+typedef struct _oe_shared_buffer_view
+{
+    /** Start of the view in host memory */
+    const uint8_t* data;
+
+    /** Size of the view in bytes */
+    size_t size;
+} oe_shared_buffer_view_t;
+
+/**
+ * Check whether the given buffer lies within a registered shared buffer.
+ *
+ * @param ptr The start of the buffer.
+ * @param size The size of the buffer.
+ *
+ * @retval true The buffer lies entirely outside the enclave and within a
+ * single shared buffer registered by the host.
+ * @retval false Otherwise.
+ */
+bool oe_is_within_shared_buffer(const void* ptr, size_t size);
+
+/**
+ * Initialize a view over a part of a registered shared buffer.
+ *
+ * @param view The view to initialize.
+ * @param ptr The start of the view in host memory.
+ * @param size The size of the view in bytes.
+ *
+ * @retval OE_OK The view was initialized.
+ * @retval OE_INVALID_PARAMETER **view** is null or the range [ptr, ptr+size)
+ * is not within a registered shared buffer.
+ */
+oe_result_t oe_shared_buffer_view_init(
+    oe_shared_buffer_view_t* view,
+    const void* ptr,
+    size_t size);
+
+/**
+ * Get a bounds-checked pointer into a shared buffer view.
+ *
+ * The returned pointer refers to host memory whose contents may change at any
+ * time (see **oe_shared_buffer_view_t**).
+ *
+ * @param view The view.
+ * @param offset The offset of the range within the view.
+ * @param size The size of the range.
+ *
+ * @returns A pointer to the start of the range, or NULL if the range
+ * [offset, offset+size) does not lie within the view.
+ */
+const void* oe_shared_buffer_view_at(
+    const oe_shared_buffer_view_t* view,
+    size_t offset,
+    size_t size);
+
+/**
+ * Copy a range of a shared buffer view into enclave memory.
+ *
+ * The copy is taken once, so the enclave may safely validate and then use the
+ * copied bytes without being exposed to concurrent host modification.
+ *
+ * @param view The view.
+ * @param offset The offset of the range within the view.
+ * @param data The enclave buffer that receives the copy.
+ * @param size The size of the range.
+ *
+ * @retval OE_OK The range was copied.
+ * @retval OE_INVALID_PARAMETER The range does not lie within the view or
+ * **data** does not lie within the enclave.
+ */
+oe_result_t oe_shared_buffer_view_read(
+    const oe_shared_buffer_view_t* view,
+    size_t offset,
+    void* data,
+    size_t size);
+
 OE_EXTERNC_END
 
 #endif /* _OE_ENCLAVE_H */
@@ -137,6 +137,134 @@ oe_result_t oe_call_enclave(
     const char* func,
     void* args);
 
+/**
+ * A single call submitted by oe_call_enclave_batch().
+ */
+typedef struct _oe_call_enclave_batch_entry
+{
+    /** The name of the enclave function to call */
+    const char* func;
+
+    /** The arguments passed to the enclave function (may be null) */
+    void* args;
+
+    /** Set to the result of dispatching this call */
+    oe_result_t result;
+} oe_call_enclave_batch_entry_t;
+
+/**
+ * Perform several high-level enclave function calls in one enclave entry.
+ *
+ * This function is equivalent to calling oe_call_enclave() for each entry of
+ * **calls** in order, except that all of the calls are made during a single
+ * enclave entry. This amortizes the cost of the transition, which dominates
+ * for small independent calls.
+ *
+ * The result of dispatching each call is stored in its **result** field. As
+ * with oe_call_enclave(), this does not reflect the success of the enclave
+ * function itself. A call that fails does not stop the remaining calls.
+ *
+ * @param enclave The instance of the enclave to be called.
+ *
+ * @param calls The calls to perform.
+ *
+ * @param num_calls The number of elements in **calls**.
+ *
+ * @retval OE_OK All calls were dispatched, although some may have failed.
+ * @retval OE_INVALID_PARAMETER At least one parameter is invalid.
+ * @retval OE_NOT_FOUND No enclave function is named by one of the calls.
+ * @retval OE_OUT_OF_MEMORY Failed to allocate memory.
+ *
+ */
+oe_result_t oe_call_enclave_batch(
+    oe_enclave_t* enclave,
+    oe_call_enclave_batch_entry_t* calls,
+    size_t num_calls);
+
+/**
+ * The prototype of host functions called through an OCALL table.
+ */
+typedef void (*oe_ocall_func_t)(void* args, oe_enclave_t* enclave);
+
+/**
+ * The ECALL and OCALL tables of an EDL file, generated by oeedger8r.
+ *
+ * The id of a function is its index in these tables, which is fixed when the
+ * EDL file is compiled.
+ */
+typedef struct _oe_call_table
+{
+    /** The names of the enclave functions, indexed by ECALL id */
+    const char* const* ecall_names;
+
+    /** The number of elements in **ecall_names** */
+    uint32_t num_ecalls;
+
+    /** The names of the host functions, indexed by OCALL id */
+    const char* const* ocall_names;
+
+    /** The host functions, indexed by OCALL id */
+    const oe_ocall_func_t* ocall_funcs;
+
+    /** The number of elements in **ocall_names** and **ocall_funcs** */
+    uint32_t num_ocalls;
+} oe_call_table_t;
+
+/**
+ * Perform a high-level enclave function call (ECALL) by table id.
+ *
+ * This function is like oe_call_enclave(), except that the enclave function
+ * is given by its id in the ECALL table of an EDL file. The table is resolved
+ * against the enclave once, when it is first used. The host functions of its
+ * OCALL table are registered with the enclave at the same time (see
+ * oe_register_ocall_function()). Later calls dispatch on the index of the
+ * function in the enclave without looking up its name and without the
+ * arguments structure of oe_call_enclave().
+ *
+ * This function is called by the ECALL wrappers that oeedger8r generates.
+ *
+ * @param enclave The instance of the enclave to be called.
+ * @param table The tables of the EDL file that declares the function.
+ * @param function_id The id of the enclave function in **table**.
+ * @param args The arguments to be passed to the enclave function.
+ *
+ * @retval OE_OK The function was called.
+ * @retval OE_INVALID_PARAMETER At least one parameter is invalid.
+ * @retval OE_NOT_FOUND The enclave does not define the function.
+ * @retval OE_OUT_OF_MEMORY Failed to allocate memory.
+ *
+ */
+oe_result_t oe_call_enclave_function(
+    oe_enclave_t* enclave,
+    const oe_call_table_t* table,
+    uint32_t function_id,
+    void* args);
+
+/**
+ * Register the host function that implements the named OCALL.
+ *
+ * OCALLs made by the enclave with oe_call_host_function() are dispatched to
+ * the function registered under their name. An unregistered name is looked
+ * up among the exported symbols of the host application on its first call,
+ * as with oe_call_host().
+ *
+ * Registering a function under a name that is already registered replaces
+ * the function, so that an OCALL can be rebound while the enclave runs.
+ *
+ * @param enclave The instance of the enclave.
+ * @param name The name of the OCALL function, such as "ocall_foo".
+ * @param func The host function that implements the OCALL.
+ *
+ * @retval OE_OK The function was registered.
+ * @retval OE_INVALID_PARAMETER At least one parameter is invalid.
+ * @retval OE_OUT_OF_MEMORY Too many functions or failed to allocate memory.
+ *
+ */
+oe_result_t oe_register_ocall_function(
+    oe_enclave_t* enclave,
+    const char* name,
+    oe_ocall_func_t func);
+
 /**
  * Get a report signed by the enclave platform for use in attestation.
  *
@@ -245,6 +373,302 @@ oe_result_t oe_verify_report(
     size_t report_size,
     oe_report_t* parsed_report);
 
+/**
+ * Number of buckets in each call latency histogram of **oe_call_stats_t**.
+ *
+ * Latencies are recorded in nanoseconds into log-linear buckets with four
+ * sub-buckets per power of two (the same scheme used by HDR histograms with
+ * two significant bits). Buckets 0-3 hold exact values; bucket **i** (i >= 4)
+ * holds values in the range [oe_call_stats_bucket_lower_bound(i),
+ * oe_call_stats_bucket_lower_bound(i + 1)). The last bucket also collects all
+ * values that exceed the histogram range (roughly 8.6 seconds).
+ */
+#define OE_CALL_STATS_HISTOGRAM_BUCKETS 128
+
+/**
+ * Maximum length (including the null terminator) of **oe_call_stats_t.name**.
+ */
+#define OE_CALL_STATS_NAME_SIZE 64
+
+/**
+ * The kind of enclave transition described by an **oe_call_stats_t**.
+ */
+typedef enum _oe_call_kind {
+    OE_CALL_KIND_ECALL = 1,
+    OE_CALL_KIND_OCALL = 2,
+    __OE_CALL_KIND_MAX = OE_ENUM_MAX,
+} oe_call_kind_t;
+
+/**
+ * Counters and latency histogram for a single ECALL or OCALL function.
+ *
+ * Built-in calls are reported under their **OE_ECALL_*** or **OE_OCALL_***
+ * name and function number. User ECALLs are reported under their exported
+ * name with **func** set to their ECALL index. User OCALLs are reported
+ * under their exported name (or their address for OCALLs made with
+ * **oe_call_host_by_address()**) with **func** set to OE_OCALL_CALL_HOST or
+ * OE_OCALL_CALL_HOST_BY_ADDRESS.
+ *
+ * The calls made by table index (see oe_call_enclave_function(), which the
+ * oeedger8r wrappers use) are also counted together under
+ * OE_ECALL_CALL_ENCLAVE_FUNCTION and OE_OCALL_CALL_HOST_FUNCTION.
+ */
+typedef struct _oe_call_stats
+{
+    /** Whether this entry describes an ECALL or an OCALL */
+    oe_call_kind_t kind;
+
+    /** The function number or ECALL index (see above) */
+    uint32_t func;
+
+    /** The null-terminated name of the function */
+    char name[OE_CALL_STATS_NAME_SIZE];
+
+    /** The number of completed calls */
+    uint64_t count;
+
+    /** The sum of all call latencies in nanoseconds */
+    uint64_t total_ns;
+
+    /** The smallest call latency in nanoseconds */
+    uint64_t min_ns;
+
+    /** The largest call latency in nanoseconds */
+    uint64_t max_ns;
+
+    /** Latency histogram (see OE_CALL_STATS_HISTOGRAM_BUCKETS) */
+    uint64_t histogram[OE_CALL_STATS_HISTOGRAM_BUCKETS];
+} oe_call_stats_t;
+
+/**
+ * Get the smallest latency in nanoseconds recorded by a histogram bucket.
+ *
+ * @param bucket The index of the bucket in **oe_call_stats_t.histogram**.
+ *
+ * @returns The lower bound of the bucket in nanoseconds.
+ */
+uint64_t oe_call_stats_bucket_lower_bound(size_t bucket);
+
+/**
+ * Enable or disable the collection of call statistics for an enclave.
+ *
+ * Call statistics are disabled by default. When enabled, every ECALL and
+ * OCALL of the enclave is counted and its latency recorded. When disabled,
+ * the cost of the statistics to each transition is a single branch. Disabling
+ * the statistics does not discard what has been collected so far.
+ *
+ * @param enclave The enclave whose statistics are enabled or disabled.
+ * @param enable Whether to enable (true) or disable (false) the statistics.
+ *
+ * @retval OE_OK The statistics were enabled or disabled.
+ * @retval OE_INVALID_PARAMETER At least one parameter is invalid.
+ * @retval OE_OUT_OF_MEMORY Failed to allocate memory for the statistics.
+ *
+ */
+oe_result_t oe_enable_enclave_call_stats(oe_enclave_t* enclave, bool enable);
+
+/**
+ * Reset all the call statistics collected for an enclave to zero.
+ *
+ * @param enclave The enclave whose statistics are reset.
+ *
+ * @retval OE_OK The statistics were reset.
+ * @retval OE_INVALID_PARAMETER At least one parameter is invalid.
+ *
+ */
+oe_result_t oe_reset_enclave_call_stats(oe_enclave_t* enclave);
+
+/**
+ * Get the call statistics collected for an enclave.
+ *
+ * This function copies a snapshot of one **oe_call_stats_t** per function
+ * that has been called at least once into the **stats** array.
+ *
+ * If the **stats** array is NULL or the **count** parameter is too small,
+ * this function returns OE_BUFFER_TOO_SMALL and sets **count** to the
+ * required number of entries.
+ *
+ * @param enclave The enclave whose statistics are retrieved.
+ * @param stats The array that receives the statistics.
+ * @param count On input, the number of elements in **stats**. On output, the
+ * number of elements written (or required).
+ *
+ * @retval OE_OK The statistics were retrieved.
+ * @retval OE_INVALID_PARAMETER At least one parameter is invalid.
+ * @retval OE_BUFFER_TOO_SMALL The **stats** array is NULL or too small.
+ *
+ */
+oe_result_t oe_get_enclave_call_stats(
+    oe_enclave_t* enclave,
+    oe_call_stats_t* stats,
+    size_t* count);
+
+/**
+ * Write the call statistics collected for an enclave as a JSON document.
+ *
+ * The document is an object with an "ecalls" and an "ocalls" array. Each
+ * array element holds the fields of an **oe_call_stats_t** and its non-empty
+ * histogram buckets, keyed by their lower bound in nanoseconds.
+ *
+ * @param enclave The enclave whose statistics are written.
+ * @param stream The stream to write the JSON document to.
+ *
+ * @retval OE_OK The statistics were written.
+ * @retval OE_INVALID_PARAMETER At least one parameter is invalid.
+ * @retval OE_OUT_OF_MEMORY Failed to allocate memory.
+ * @retval OE_FAILURE Failed to write to the stream.
+ *
+ */
+oe_result_t oe_write_enclave_call_stats_json(
+    oe_enclave_t* enclave,
+    FILE* stream);
+
+/**
+ * Maximum number of frames recorded by the enclave profiler for a sample.
+ */
+#define OE_PROFILER_MAX_DEPTH 64
+
+/**
+ * Enable or disable the sampling CPU profiler for an enclave.
+ *
+ * While enabled, the host samples the threads that run the enclave about a
+ * thousand times per second of CPU time consumed by the process, and counts
+ * the call stack of the enclave code at each sample. Stacks are found by
+ * following the frame pointers of the enclave code. Disabling the profiler
+ * does not discard the samples collected so far.
+ *
+ * Only simulation and debug enclaves can be profiled (on Linux). The
+ * profiler uses SIGPROF and the ITIMER_PROF timer of the process, which must
+ * not be used by the application at the same time.
+ *
+ * @param enclave The enclave whose profiler is enabled or disabled.
+ * @param enable Whether to enable (true) or disable (false) the profiler.
+ *
+ * @retval OE_OK The profiler was enabled or disabled.
+ * @retval OE_INVALID_PARAMETER At least one parameter is invalid.
+ * @retval OE_UNSUPPORTED The enclave cannot be profiled.
+ * @retval OE_OUT_OF_MEMORY Failed to allocate memory for the profile.
+ * @retval OE_FAILURE Too many enclaves are profiled or the timer could not
+ * be started.
+ *
+ */
+oe_result_t oe_enable_enclave_profiler(oe_enclave_t* enclave, bool enable);
+
+/**
+ * Discard the samples collected by the profiler of an enclave.
+ *
+ * @param enclave The enclave whose profile is reset.
+ *
+ * @retval OE_OK The profile was reset.
+ * @retval OE_INVALID_PARAMETER At least one parameter is invalid.
+ *
+ */
+oe_result_t oe_reset_enclave_profiler(oe_enclave_t* enclave);
+
+/**
+ * Write the profile of an enclave as folded stacks.
+ *
+ * Each line holds the functions of a call stack, from the outermost one to
+ * the sampled one, separated by semicolons, followed by a space and the
+ * number of samples of the stack. This is the input format of flame graph
+ * tools such as flamegraph.pl. Addresses outside of any function are
+ * written as offsets from the enclave base address. Samples that could not
+ * be recorded are counted on a "[dropped]" line.
+ *
+ * @param enclave The enclave whose profile is written.
+ * @param stream The stream to write the profile to.
+ *
+ * @retval OE_OK The profile was written.
+ * @retval OE_INVALID_PARAMETER At least one parameter is invalid.
+ * @retval OE_FAILURE Failed to write to the stream.
+ *
+ */
+oe_result_t oe_write_enclave_profile(oe_enclave_t* enclave, FILE* stream);
+
+/**
+ * Write the heap profile of an enclave in the legacy heap profile format of
+ * gperftools, which pprof reads.
+ *
+ * The enclave starts its sampling heap profiler itself, so that the host
+ * can only read the heap profile of enclaves that expose it. The profile
+ * holds, for each sampled call site, the live and the total sampled
+ * allocations with their sizes, followed by the mapping of the enclave
+ * image used to symbolize the call stacks. It complements the heap totals
+ * returned by oe_get_malloc_stats() in the enclave.
+ *
+ * @param enclave The enclave whose heap profile is written.
+ * @param stream The stream to write the profile to.
+ *
+ * @retval OE_OK The profile was written.
+ * @retval OE_INVALID_PARAMETER At least one parameter is invalid.
+ * @retval OE_NOT_FOUND The enclave did not start its heap profiler.
+ * @retval OE_OUT_OF_MEMORY Failed to allocate memory for the profile.
+ * @retval OE_FAILURE Failed to write to the stream.
+ *
+ */
+oe_result_t oe_write_enclave_heap_profile(oe_enclave_t* enclave, FILE* stream);
+
+/**
+ * Sets the number of host threads that run asynchronous OCALLs.
+ *
+ * An enclave posts an asynchronous OCALL with oe_call_host_async(). The
+ * host function then runs on a pool of host worker threads instead of the
+ * thread of the calling enclave thread. The pool is started by the first
+ * asynchronous OCALL of the enclave, with four threads by default.
+ *
+ * @param enclave The enclave whose pool is configured.
+ * @param num_threads The number of worker threads (zero selects the
+ * default). At most 64 threads are supported.
+ *
+ * @retval OE_OK The number of threads was set.
+ * @retval OE_INVALID_PARAMETER At least one parameter is invalid.
+ * @retval OE_BUSY The pool has already been started.
+ */
+oe_result_t oe_set_enclave_async_ocall_threads(
+    oe_enclave_t* enclave,
+    size_t num_threads);
+
+/**
+ * Registers a host buffer that the enclave may access in place.
+ *
+ * Parameters of ECALLs declared with the EDL **shared** attribute are not
+ * copied into the enclave. Instead, the generated code checks that they lie
+ * entirely within a buffer registered with this function. This avoids a copy
+ * for large payloads, but the host may modify the buffer at any time, so
+ * the enclave must read it through the oe_shared_buffer_view_t functions.
+ *
+ * The buffer must lie outside the enclave and must not overlap another
+ * registered buffer. It must remain valid until it is unregistered.
+ *
+ * @param enclave The instance of the enclave that may access the buffer.
+ * @param buffer The start of the host buffer.
+ * @param size The size of the host buffer in bytes.
+ *
+ * @retval OE_OK The buffer was registered.
+ * @retval OE_INVALID_PARAMETER At least one parameter is invalid.
+ * @retval OE_OUT_OF_MEMORY Too many buffers are registered.
+ */
+oe_result_t oe_register_shared_buffer(
+    oe_enclave_t* enclave,
+    const void* buffer,
+    size_t size);
+
+/**
+ * Unregisters a buffer registered with oe_register_shared_buffer().
+ *
+ * @param enclave The instance of the enclave.
+ * @param buffer The start of the host buffer.
+ * @param size The size of the host buffer, as passed at registration.
+ *
+ * @retval OE_OK The buffer was unregistered.
+ * @retval OE_INVALID_PARAMETER At least one parameter is invalid.
+ * @retval OE_NOT_FOUND No such buffer is registered.
+ */
+oe_result_t oe_unregister_shared_buffer(
+    oe_enclave_t* enclave,
+    const void* buffer,
+    size_t size);
+
 OE_EXTERNC_END
 
 #endif /* _OE_HOST_H */
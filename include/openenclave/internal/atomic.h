@@ -35,4 +35,65 @@ OE_INLINE uint64_t oe_atomic_decrement(volatile uint64_t* x)
 #endif
 }
 
+/* Atomically read **x** (a sequentially consistent load) */
+OE_INLINE uint64_t oe_atomic_load(volatile uint64_t* x)
+{
+#if defined(__GNUC__)
+    return __atomic_load_n(x, __ATOMIC_SEQ_CST);
+#elif defined(_MSC_VER)
+    return (uint64_t)InterlockedCompareExchange64((volatile LONG64*)x, 0, 0);
+#else
+#error "unsupported"
+#endif
+}
+
+/* Atomically write **value** to **x** (a sequentially consistent store) */
+OE_INLINE void oe_atomic_store(volatile uint64_t* x, uint64_t value)
+{
+#if defined(__GNUC__)
+    __atomic_store_n(x, value, __ATOMIC_SEQ_CST);
+#elif defined(_MSC_VER)
+    InterlockedExchange64((volatile LONG64*)x, (LONG64)value);
+#else
+#error "unsupported"
+#endif
+}
+
+/* Atomically read the pointer **p** (a sequentially consistent load) */
+OE_INLINE void* oe_atomic_load_pointer(void* volatile* p)
+{
+#if defined(__GNUC__)
+    return __atomic_load_n(p, __ATOMIC_SEQ_CST);
+#elif defined(_MSC_VER)
+    return InterlockedCompareExchangePointer(p, NULL, NULL);
+#else
+#error "unsupported"
+#endif
+}
+
+/* Atomically write **value** to the pointer **p** (a sequentially consistent
+ * store) */
+OE_INLINE void oe_atomic_store_pointer(void* volatile* p, void* value)
+{
+#if defined(__GNUC__)
+    __atomic_store_n(p, value, __ATOMIC_SEQ_CST);
+#elif defined(_MSC_VER)
+    InterlockedExchangePointer(p, value);
+#else
+#error "unsupported"
+#endif
+}
+
+/* Hint to the processor that the caller is spinning */
+OE_INLINE void oe_atomic_pause(void)
+{
+#if defined(__GNUC__)
+    __builtin_ia32_pause();
+#elif defined(_MSC_VER)
+    YieldProcessor();
+#else
+#error "unsupported"
+#endif
+}
+
 #endif /* _OE_ATOMIC_H */
@@ -8,6 +8,7 @@
 #include <openenclave/bits/types.h>
 #include <openenclave/internal/cpuid.h>
 #include <openenclave/internal/defs.h>
+#include <openenclave/internal/malloc.h>
 #include "backtrace.h"
 #include "sgxtypes.h"
 
@@ -67,6 +68,19 @@ OE_STATIC_ASSERT(sizeof(oe_code_t) == sizeof(unsigned int));
 /* OCALL function numbers are in the range: [32768:65535] */
 #define OE_OCALL_BASE 0x8000
 
+/*
+ * ECALL function numbers from OE_ECALL_TABLE_BASE call the enclave function
+ * with the index (function number - OE_ECALL_TABLE_BASE) in the ECALL pages
+ * of the enclave, passing arg_in as its argument. OCALL function numbers from
+ * OE_OCALL_TABLE_BASE likewise call the host function with the id returned by
+ * OE_OCALL_GET_HOST_FUNCTION_ID. See oe_call_enclave_function() and
+ * oe_call_host_function().
+ */
+#define OE_ECALL_TABLE_BASE 0x1000
+#define OE_OCALL_TABLE_BASE 0x9000
+#define OE_MAX_ECALL_TABLE_FUNCTIONS (OE_OCALL_BASE - OE_ECALL_TABLE_BASE)
+#define OE_MAX_OCALL_TABLE_FUNCTIONS 1024
+
 /* Function numbers are 16 bit integers */
 typedef enum _oe_func {
     OE_ECALL_DESTRUCTOR = OE_ECALL_BASE,
@@ -75,6 +89,11 @@ typedef enum _oe_func {
     OE_ECALL_VERIFY_REPORT,
     OE_ECALL_GET_SGX_REPORT,
     OE_ECALL_VIRTUAL_EXCEPTION_HANDLER,
+    OE_ECALL_REGISTER_SHARED_BUFFER,
+    OE_ECALL_UNREGISTER_SHARED_BUFFER,
+    OE_ECALL_CALL_ENCLAVE_BATCH,
+    OE_ECALL_THREAD_START,
+    OE_ECALL_GET_HEAP_PROFILE,
     /* Caution: always add new ECALL function numbers here */
 
     OE_OCALL_CALL_HOST = OE_OCALL_BASE,
@@ -92,6 +111,12 @@ typedef enum _oe_func {
     OE_OCALL_SLEEP,
     OE_OCALL_GET_TIME,
     OE_OCALL_BACKTRACE_SYMBOLS,
+    OE_OCALL_GET_HOST_STACK,
+    OE_OCALL_CALL_HOST_ASYNC,
+    OE_OCALL_WAIT_ASYNC,
+    OE_OCALL_GET_HOST_FUNCTION_ID,
+    OE_OCALL_THREAD_WAKE_MULTIPLE,
+    OE_OCALL_THREAD_CREATE,
     /* Caution: always add new OCALL function numbers here */
 
     __OE_FUNC_MAX = OE_ENUM_MAX,
@@ -199,6 +224,24 @@ typedef struct _oe_call_enclave_args
     oe_result_t result;
 } oe_call_enclave_args_t;
 
+/*
+**==============================================================================
+**
+** oe_call_enclave_batch_args_t
+**
+**     Arguments of OE_ECALL_CALL_ENCLAVE_BATCH: a vector of high-level calls
+**     that the enclave dispatches in order during a single enclave entry.
+**     The result of each call is returned in its own result field.
+**
+**==============================================================================
+*/
+
+typedef struct _oe_call_enclave_batch_args
+{
+    oe_call_enclave_args_t* calls;
+    size_t num_calls;
+} oe_call_enclave_batch_args_t;
+
 /*
 **==============================================================================
 **
@@ -247,6 +290,45 @@ typedef struct _oe_call_host_args
     OE_ZERO_SIZED_ARRAY char func[];
 } oe_call_host_args_t;
 
+/*
+**==============================================================================
+**
+** oe_async_ocall_status_t
+**
+**     The host allocates one record per asynchronous OCALL. The record begins
+**     with this status, which the enclave polls without an OCALL. The host
+**     stores the result before setting the done flag.
+**
+**==============================================================================
+*/
+
+typedef struct _oe_async_ocall_status
+{
+    volatile uint64_t done;
+    oe_result_t result;
+} oe_async_ocall_status_t;
+
+/*
+**==============================================================================
+**
+** oe_call_host_async_args_t
+**
+**     Arguments of OE_OCALL_CALL_HOST_ASYNC. On success the host returns the
+**     record of the posted call in handle. OE_OCALL_WAIT_ASYNC takes this
+**     handle as its argument, blocks until the call is done, releases the
+**     record and returns the result in arg_out.
+**
+**==============================================================================
+*/
+
+typedef struct _oe_call_host_async_args
+{
+    void* args;
+    oe_result_t result;
+    oe_async_ocall_status_t* handle;
+    OE_ZERO_SIZED_ARRAY char func[];
+} oe_call_host_async_args_t;
+
 /*
 **==============================================================================
 **
@@ -294,6 +376,23 @@ typedef struct _oe_realloc_args
     size_t size;
 } oe_realloc_args_t;
 
+/*
+**==============================================================================
+**
+** oe_get_host_stack_args_t
+**
+**     Returns the host marshalling stack that the host reserved for the
+**     calling TCS when it bound a thread to it (null if none).
+**
+**==============================================================================
+*/
+
+typedef struct _oe_get_host_stack_args
+{
+    void* base;
+    size_t size;
+} oe_get_host_stack_args_t;
+
 /*
 **==============================================================================
 **
@@ -330,6 +429,45 @@ typedef struct _oe_backtrace_symbols_args
     char** ret;
 } oe_backtrace_symbols_args_t;
 
+/*
+**==============================================================================
+**
+** oe_shared_buffer_args_t
+**
+**     Register (or unregister) a host memory region that enclave functions
+**     may read in place through [shared] EDL parameters and shared buffer
+**     views (see oe_register_shared_buffer()).
+**
+**==============================================================================
+*/
+
+typedef struct _oe_shared_buffer_args
+{
+    const void* buffer;
+    size_t size;
+} oe_shared_buffer_args_t;
+
+/*
+**==============================================================================
+**
+** oe_get_heap_profile_args_t
+**
+**     Arguments of OE_ECALL_GET_HEAP_PROFILE. The enclave copies its heap
+**     profile sites to the host array if num_sites (its capacity) is large
+**     enough, and otherwise returns OE_BUFFER_TOO_SMALL. In both cases it
+**     sets num_sites to the number of sites.
+**
+**==============================================================================
+*/
+
+typedef struct _oe_get_heap_profile_args
+{
+    oe_heap_profile_site_t* sites;
+    uint64_t num_sites;
+    uint64_t sample_interval;
+    oe_result_t result;
+} oe_get_heap_profile_args_t;
+
 /**
  * Perform a low-level enclave function call (ECALL).
  *
@@ -110,6 +110,24 @@ oe_result_t oe_cert_free(oe_cert_t* cert);
  */
 oe_result_t oe_cert_chain_free(oe_cert_chain_t* chain);
 
+/**
+ * Create another handle to a certificate chain
+ *
+ * This function initializes a new handle that shares the certificates of the
+ * given chain. Either handle may be released first, with
+ * oe_cert_chain_free(): the certificates are released with the last one.
+ *
+ * @param chain handle of the certificate chain to share
+ * @param shared initialized certificate chain handle upon return
+ *
+ * @return OE_OK the new handle was created
+ * @return OE_INVALID_PARAMETER a parameter is invalid
+ * @return OE_OUT_OF_MEMORY
+ */
+oe_result_t oe_cert_chain_share(
+    const oe_cert_chain_t* chain,
+    oe_cert_chain_t* shared);
+
 /**
  * Verify the given certificate against a given certificate chain
  *
@@ -134,6 +152,33 @@ oe_result_t oe_cert_verify(
     size_t num_crls,
     oe_verify_cert_error_t* error);
 
+/**
+ * Verify the given certificate against an already verified certificate chain
+ *
+ * This function is like oe_cert_verify(), except that the signatures of the
+ * certificates of the chain may not be verified again. The chain must have
+ * been read with oe_cert_chain_read_pem(), which verifies the whole chain,
+ * for example by the certificate cache. The validity periods of the
+ * certificates of the chain and the CRLs are still checked.
+ *
+ * @param cert verify this certificate
+ * @param chain verify the certificate against this verified chain
+ * @param crls verify the certificate against these CRLs (may be null).
+ * @param num_crls number of CRLs.
+ * @param error Optional. Holds the error message if this function failed.
+ *
+ * @return OE_OK verify ok
+ * @return OE_VERIFY_FAILED
+ * @return OE_INVALID_PARAMETER
+ * @return OE_FAILURE
+ */
+oe_result_t oe_cert_verify_with_verified_chain(
+    oe_cert_t* cert,
+    oe_cert_chain_t* chain,
+    const oe_crl_t* const* crls,
+    size_t num_crls,
+    oe_verify_cert_error_t* error);
+
 /**
  * Get the RSA public key from a certificate.
  *
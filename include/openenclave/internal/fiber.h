@@ -0,0 +1,182 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#ifndef _OE_INCLUDE_FIBER_H
+#define _OE_INCLUDE_FIBER_H
+
+#include <openenclave/bits/defs.h>
+#include <openenclave/bits/result.h>
+#include <openenclave/bits/types.h>
+
+OE_EXTERNC_BEGIN
+
+/*
+**==============================================================================
+**
+** Fibers:
+**
+**     Fibers are user-level threads that run on the TCS that created them,
+**     each on its own stack allocated from the enclave heap. A TCS switches
+**     between its fibers only when the running fiber yields, joins a fiber
+**     or waits on a fiber mutex or condition variable; the context of the
+**     ECALL itself is a fiber too. Waits on other objects (such as oe_mutex_t
+**     or OCALLs) block all the fibers of the TCS.
+**
+**     When no fiber of a TCS is ready, the TCS sleeps until a fiber of
+**     another TCS makes one of them ready. Fibers that did not run to
+**     completion when the ECALL that created them returns run in later ECALLs
+**     on the same TCS, so they are normally joined before returning.
+**
+**     Fiber stacks have no guard page.
+**
+**==============================================================================
+*/
+
+/* Stack size of fibers created with a stack size of zero */
+#define OE_FIBER_DEFAULT_STACK_SIZE (64 * 1024)
+
+/* Minimum stack size of fibers */
+#define OE_FIBER_MIN_STACK_SIZE (16 * 1024)
+
+typedef struct _oe_fiber oe_fiber_t;
+
+/**
+ * Create a fiber on the calling TCS.
+ *
+ * The fiber becomes ready to run **func** with **arg**, and runs when the
+ * running fiber yields or blocks. It must be joined with oe_fiber_join().
+ *
+ * @param fiber Set to the new fiber.
+ * @param stack_size The size of the stack of the fiber (rounded up to a
+ *        page), or zero for OE_FIBER_DEFAULT_STACK_SIZE.
+ * @param func The function run by the fiber.
+ * @param arg The argument passed to **func**.
+ *
+ * @return OE_OK the fiber was created
+ * @return OE_INVALID_PARAMETER one or more parameters is invalid
+ * @return OE_OUT_OF_MEMORY insufficient memory exists to create the fiber
+ *
+ */
+oe_result_t oe_fiber_create(
+    oe_fiber_t** fiber,
+    size_t stack_size,
+    void (*func)(void* arg),
+    void* arg);
+
+/**
+ * Wait for a fiber to complete and release it.
+ *
+ * The calling fiber yields until **fiber** returns. A fiber may be joined
+ * from any TCS, but only once.
+ *
+ * @param fiber The fiber to join.
+ *
+ * @return OE_OK the fiber completed and was released
+ * @return OE_INVALID_PARAMETER the fiber is invalid, joined or the calling
+ *         fiber
+ *
+ */
+oe_result_t oe_fiber_join(oe_fiber_t* fiber);
+
+/**
+ * Return the running fiber of the calling TCS.
+ */
+oe_fiber_t* oe_fiber_self(void);
+
+/**
+ * Let the other ready fibers of the calling TCS run.
+ */
+void oe_fiber_yield(void);
+
+/**
+ * Return whether another fiber of the calling TCS is ready to run.
+ */
+bool oe_fiber_has_ready(void);
+
+/**
+ * Mutex that suspends the waiting fiber only (not recursive).
+ */
+typedef struct _oe_fiber_mutex
+{
+    volatile uint32_t lock;
+    oe_fiber_t* owner;
+    oe_fiber_t* front;
+    oe_fiber_t* back;
+} oe_fiber_mutex_t;
+
+#define OE_FIBER_MUTEX_INITIALIZER \
+    {                              \
+        0, NULL, NULL, NULL        \
+    }
+
+/**
+ * Lock a fiber mutex, yielding while another fiber holds it.
+ *
+ * @return OE_OK the mutex was locked
+ * @return OE_INVALID_PARAMETER **mutex** is null
+ * @return OE_BUSY the calling fiber already holds the mutex
+ *
+ */
+oe_result_t oe_fiber_mutex_lock(oe_fiber_mutex_t* mutex);
+
+/**
+ * Try to lock a fiber mutex without yielding.
+ *
+ * @return OE_OK the mutex was locked
+ * @return OE_INVALID_PARAMETER **mutex** is null
+ * @return OE_BUSY another fiber (or the calling one) holds the mutex
+ *
+ */
+oe_result_t oe_fiber_mutex_trylock(oe_fiber_mutex_t* mutex);
+
+/**
+ * Unlock a fiber mutex, handing it to the first waiting fiber.
+ *
+ * @return OE_OK the mutex was unlocked
+ * @return OE_INVALID_PARAMETER **mutex** is null
+ * @return OE_NOT_OWNER the calling fiber does not hold the mutex
+ *
+ */
+oe_result_t oe_fiber_mutex_unlock(oe_fiber_mutex_t* mutex);
+
+/**
+ * Condition variable that suspends the waiting fiber only.
+ */
+typedef struct _oe_fiber_cond
+{
+    volatile uint32_t lock;
+    oe_fiber_t* front;
+    oe_fiber_t* back;
+} oe_fiber_cond_t;
+
+#define OE_FIBER_COND_INITIALIZER \
+    {                             \
+        0, NULL, NULL             \
+    }
+
+/**
+ * Wait on a fiber condition variable.
+ *
+ * The mutex, held by the calling fiber, is unlocked while waiting and locked
+ * again before returning.
+ *
+ * @return OE_OK the fiber was signaled
+ * @return OE_INVALID_PARAMETER one or more parameters is invalid
+ * @return OE_NOT_OWNER the calling fiber does not hold the mutex
+ *
+ */
+oe_result_t oe_fiber_cond_wait(oe_fiber_cond_t* cond, oe_fiber_mutex_t* mutex);
+
+/**
+ * Wake the first fiber waiting on a fiber condition variable.
+ */
+oe_result_t oe_fiber_cond_signal(oe_fiber_cond_t* cond);
+
+/**
+ * Wake all the fibers waiting on a fiber condition variable.
+ */
+oe_result_t oe_fiber_cond_broadcast(oe_fiber_cond_t* cond);
+
+OE_EXTERNC_END
+
+#endif /* _OE_INCLUDE_FIBER_H */
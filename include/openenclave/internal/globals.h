@@ -37,6 +37,14 @@ const void* __oe_get_heap_base(void);
 const void* __oe_get_heap_end(void);
 const size_t __oe_get_heap_size(void);
 
+/* Static TLS */
+extern uint64_t oe_tls_image_vaddr;
+extern uint64_t oe_tls_image_size;
+extern uint64_t oe_tls_block_size;
+const void* __oe_get_tls_image_base(void);
+size_t __oe_get_tls_image_size(void);
+size_t __oe_get_tls_block_size(void);
+
 /* The enclave handle passed by host during initialization */
 extern oe_enclave_t* oe_enclave;
 
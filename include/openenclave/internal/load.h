@@ -38,6 +38,22 @@ typedef struct _oe_segment
     uint32_t flags;
 } oe_segment_t;
 
+/* The PT_TLS segment: the initialization image of the static TLS block */
+typedef struct _oe_tls_segment
+{
+    /* Virtual address of the initialization image (.tdata) */
+    uint64_t vaddr;
+
+    /* Size of the initialization image (.tdata) */
+    size_t filesz;
+
+    /* Size of the TLS block in memory (.tdata and .tbss) */
+    size_t memsz;
+
+    /* Alignment of the TLS block (a power of two, at most OE_PAGE_SIZE) */
+    size_t align;
+} oe_tls_segment_t;
+
 OE_INLINE uint64_t __oe_round_up_to_page_size(uint64_t x)
 {
     uint64_t n = OE_PAGE_SIZE;
@@ -54,7 +70,17 @@ oe_result_t __oe_load_segments(
     oe_segment_t segments[OE_MAX_SEGMENTS],
     size_t* nsegments,
     uint64_t* entryaddr, /* virtual address of entry point */
-    uint64_t* textaddr); /* virtual address of text section */
+    uint64_t* textaddr, /* virtual address of text section */
+    oe_tls_segment_t* tls); /* zero-filled if there is no PT_TLS segment */
+
+/* Size of the static TLS block of a thread (zero if there is no TLS). The
+ * block ends at the thread pointer, which is page aligned, as required by
+ * the x86-64 TLS ABI (variant II). */
+OE_INLINE uint64_t __oe_tls_segment_block_size(const oe_tls_segment_t* tls)
+{
+    uint64_t n = tls->align ? tls->align : 1;
+    return (tls->memsz + n - 1) / n * n;
+}
 
 oe_result_t __oe_calculate_segments_size(
     const oe_segment_t* segments,
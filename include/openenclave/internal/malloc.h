@@ -44,6 +44,65 @@ typedef struct _oe_malloc_stats
  */
 oe_result_t oe_get_malloc_stats(oe_malloc_stats_t* stats);
 
+/* Mean number of bytes allocated between two heap profile samples when the
+ * profiler is started with a sample interval of zero */
+#define OE_HEAP_PROFILE_DEFAULT_SAMPLE_INTERVAL (512 * 1024)
+
+/* Maximum number of frames of a heap profile call site */
+#define OE_HEAP_PROFILE_MAX_DEPTH 32
+
+/* Maximum number of distinct call sites of a heap profile */
+#define OE_HEAP_PROFILE_MAX_SITES 512
+
+/* Maximum number of sampled allocations that are live at the same time */
+#define OE_HEAP_PROFILE_MAX_LIVE 4096
+
+/* Sampled allocations of a call site of the heap profile */
+typedef struct _oe_heap_profile_site
+{
+    /* Sampled allocations (and their requested bytes) since the start */
+    uint64_t alloc_count;
+    uint64_t alloc_bytes;
+
+    /* Sampled allocations (and their requested bytes) not freed yet */
+    uint64_t live_count;
+    uint64_t live_bytes;
+
+    /* Return addresses of the call stack, innermost first */
+    uint64_t depth;
+    uint64_t frames[OE_HEAP_PROFILE_MAX_DEPTH];
+} oe_heap_profile_site_t;
+
+/**
+ * Start the sampling heap profiler of the enclave.
+ *
+ * Allocations are sampled with a probability proportional to their size,
+ * about once every **sample_interval** bytes on average (the interval
+ * between two samples of a TCS follows an exponential distribution, so that
+ * sampling does not correlate with allocation patterns). The call stack of
+ * each sampled allocation is recorded, and its call site is charged when it
+ * is freed. Allocations that are not sampled only pay for a countdown.
+ *
+ * The host writes the profile with oe_write_enclave_heap_profile(), so an
+ * enclave that starts the profiler exposes its sampled call stacks and
+ * allocation sizes to the host. The profiler is not available when the
+ * enclave uses the debug allocator (OE_USE_DEBUG_MALLOC).
+ *
+ * @param sample_interval The mean number of bytes between samples, or zero
+ *        for OE_HEAP_PROFILE_DEFAULT_SAMPLE_INTERVAL.
+ *
+ * @return OE_OK the profiler was started (or its interval changed)
+ * @return OE_OUT_OF_MEMORY the profile could not be allocated
+ * @return OE_UNSUPPORTED the enclave uses the debug allocator
+ */
+oe_result_t oe_heap_profiler_start(size_t sample_interval);
+
+/**
+ * Stop sampling allocations. The profile is kept, and sampled allocations
+ * that are freed later are still accounted for.
+ */
+void oe_heap_profiler_stop(void);
+
 /* Dump the list of all in-use allocations */
 void oe_debug_malloc_dump(void);
 
@@ -31,6 +31,11 @@ OE_INLINE bool oe_sgx_is_valid_num_tcs(uint64_t x)
     return x <= OE_SGX_MAX_TCS;
 }
 
+OE_INLINE bool oe_sgx_is_valid_num_host_stack_pages(uint64_t x)
+{
+    return x <= OE_SGX_MAX_HOST_STACK_PAGES;
+}
+
 OE_INLINE bool oe_sgx_is_valid_attributes(uint64_t x)
 {
     /* Check for illegal bits */
@@ -9,10 +9,21 @@
 #include <stdlib.h>
 #include <string.h>
 
+OE_EXTERNC_BEGIN
+
 void oe_set_gs_register_base(const void* ptr);
 
 void* oe_get_gs_register_base(void);
 
+void oe_set_fs_register_base(const void* ptr);
+
+void* oe_get_fs_register_base(void);
+
+/* Choose whether the functions above use the FSGSBASE instructions when the
+ * kernel supports them (the default) or system calls, to compare both in
+ * tests. Return true if the instructions are used. */
+bool oe_enable_fsgsbase(bool enable);
+
 OE_EXTERNC_END
 
 #endif /* _OE_ASM_H */
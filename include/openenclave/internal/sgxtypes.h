@@ -589,8 +589,46 @@ typedef struct _td
     // for details).
     uint64_t pthread[64];
 
+    /* Per-TCS host marshalling stack (see enclave/core/hoststack.c). These
+     * fields are not cleared by td_clear(), so the stack is obtained from
+     * the host only once for the lifetime of the TCS. td_init() empties the
+     * stack on entry of the outermost ECALL. */
+    uint64_t host_stack_state;
+    uint64_t host_stack_base;
+    uint64_t host_stack_size;
+    uint64_t host_stack_used;
+
+    /* Bitmap of the TSD keys that have a non-null value on this TCS (see
+     * enclave/core/thread.c). Like the TSD page, it is not cleared by
+     * td_clear(). */
+    uint64_t tsd_keys[8];
+    uint64_t tsd_registered;
+
+    /* Read locks of oe_rwlock_t objects held by this TCS without writing to
+     * the lock (see enclave/core/thread.c). Not cleared by td_clear(). */
+    uint64_t rwlock_readers[8];
+    uint64_t rwlock_registered;
+
+    /* Thread created by oe_thread_create() that is running on this TCS (or
+     * zero) */
+    uint64_t created_thread;
+
+    /* Index plus one of the task deque owned by this TCS, or zero (see
+     * enclave/core/task.c). Not cleared by td_clear(). */
+    uint64_t task_deque;
+
+    /* Index plus one of the fiber scheduler of this TCS, or zero (see
+     * enclave/core/fiber.c). Not cleared by td_clear(). */
+    uint64_t fiber_scheduler;
+
+    /* Bytes left to allocate before the next heap profile sample, and the
+     * state of the random generator of the sample intervals (see
+     * enclave/core/heapprofile.c). Not cleared by td_clear(). */
+    int64_t heap_sample_countdown;
+    uint64_t heap_sample_random;
+
     /* Reserved */
-    uint8_t reserved[3324];
+    uint8_t reserved[3108];
 } td_t;
 OE_PACK_END
 
@@ -0,0 +1,153 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#ifndef _OE_INCLUDE_TASK_H
+#define _OE_INCLUDE_TASK_H
+
+#include <openenclave/bits/defs.h>
+#include <openenclave/bits/result.h>
+#include <openenclave/bits/types.h>
+
+OE_EXTERNC_BEGIN
+
+/*
+**==============================================================================
+**
+** Task runtime:
+**
+**     Tasks are run by worker threads that are created in the enclave with
+**     oe_thread_create(), each occupying a TCS for as long as the runtime
+**     runs. Every TCS that spawns or runs tasks owns a work-stealing deque:
+**     it pushes and pops tasks at one end, and idle threads steal them from
+**     the other end. Idle workers sleep until new tasks are spawned.
+**
+**     A thread that waits for a task group runs tasks (its own first) until
+**     the group is complete. Without workers, tasks run on the threads that
+**     wait for them.
+**
+**==============================================================================
+*/
+
+/* Maximum number of tasks held by the deque of a TCS (a power of two).
+ * Tasks spawned while the deque is full run immediately. */
+#define OE_TASK_DEQUE_SIZE 256
+
+/**
+ * Group of tasks that are waited for together.
+ */
+typedef struct _oe_task_group
+{
+    /* Number of tasks of the group that did not complete */
+    volatile uint64_t pending;
+} oe_task_group_t;
+
+#define OE_TASK_GROUP_INITIALIZER \
+    {                             \
+        0                         \
+    }
+
+/**
+ * Start the worker threads of the task runtime.
+ *
+ * This function creates the given number of worker threads, unless the
+ * runtime is already started. Each worker occupies a TCS until the runtime
+ * is stopped, so **num_workers** must be less than the number of TCSs of the
+ * enclave.
+ *
+ * @param num_workers The number of worker threads.
+ *
+ * @return OE_OK the runtime was started
+ * @return OE_INVALID_PARAMETER **num_workers** is zero or too large
+ * @return OE_FAILURE a worker thread could not be created
+ *
+ */
+oe_result_t oe_task_runtime_start(size_t num_workers);
+
+/**
+ * Stop the worker threads of the task runtime.
+ *
+ * The workers run the tasks that were spawned before they return. This
+ * function is called when the enclave is terminated.
+ */
+void oe_task_runtime_stop(void);
+
+/**
+ * Spawn a task in a task group.
+ *
+ * The task calls **func** with **arg** and may spawn other tasks. It is run
+ * by a worker or by a thread waiting for a task group.
+ *
+ * @param group The group of the task.
+ * @param func The function called by the task.
+ * @param arg The argument passed to **func**.
+ *
+ * @return OE_OK the task was spawned (or has run)
+ * @return OE_INVALID_PARAMETER one or more parameters is invalid
+ *
+ */
+oe_result_t oe_task_group_run(
+    oe_task_group_t* group,
+    void (*func)(void* arg),
+    void* arg);
+
+/**
+ * Wait for the tasks of a task group to complete.
+ *
+ * The calling thread runs tasks while waiting.
+ *
+ * @param group The task group.
+ *
+ * @return OE_OK the tasks of the group completed
+ * @return OE_INVALID_PARAMETER **group** is null
+ *
+ */
+oe_result_t oe_task_group_wait(oe_task_group_t* group);
+
+/**
+ * Call a function on subranges of a range in parallel.
+ *
+ * The range [**begin**, **end**) is split in halves recursively, and
+ * **body** is called on each subrange of at most **grain** elements. Halves
+ * are spawned as tasks and may be stolen by other threads. This function
+ * returns when all the subranges were processed.
+ *
+ * @param begin The start of the range.
+ * @param end The end of the range (excluded).
+ * @param grain The maximum size of a subrange, or zero to split the range
+ *        into a few subranges per worker.
+ * @param body The function called on each subrange.
+ * @param arg The argument passed to **body**.
+ *
+ * @return OE_OK the range was processed
+ * @return OE_INVALID_PARAMETER one or more parameters is invalid
+ *
+ */
+oe_result_t oe_parallel_for(
+    size_t begin,
+    size_t end,
+    size_t grain,
+    void (*body)(size_t begin, size_t end, void* arg),
+    void* arg);
+
+OE_EXTERNC_END
+
+#ifdef __cplusplus
+
+/* Call a function object (such as a lambda) on subranges of a range */
+template <typename BODY>
+oe_result_t oe_parallel_for(size_t begin, size_t end, size_t grain, BODY& body)
+{
+    struct _call
+    {
+        static void call(size_t b, size_t e, void* arg)
+        {
+            (*static_cast<BODY*>(arg))(b, e);
+        }
+    };
+
+    return oe_parallel_for(begin, end, grain, _call::call, &body);
+}
+
+#endif /* __cplusplus */
+
+#endif /* _OE_INCLUDE_TASK_H */
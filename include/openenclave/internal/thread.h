@@ -22,6 +22,25 @@ typedef struct _oe_thread_wake_wait_args
     const void* self_tcs;
 } oe_thread_wake_wait_args_t;
 
+/*
+**==============================================================================
+**
+** oe_thread_wake_multiple_args_t
+**
+**     Arguments of OE_OCALL_THREAD_WAKE_MULTIPLE, which wakes the threads of
+**     up to OE_THREAD_WAKE_MULTIPLE_MAX TCSs in one OCALL.
+**
+**==============================================================================
+*/
+
+#define OE_THREAD_WAKE_MULTIPLE_MAX 32
+
+typedef struct _oe_thread_wake_multiple_args
+{
+    uint64_t num_tcs;
+    const void* tcs[OE_THREAD_WAKE_MULTIPLE_MAX];
+} oe_thread_wake_multiple_args_t;
+
 #ifdef _OE_ENCLAVE_H
 OE_EXTERNC_BEGIN
 
@@ -66,6 +85,60 @@ oe_thread_t oe_thread_self(void);
  */
 bool oe_thread_equal(oe_thread_t thread1, oe_thread_t thread2);
 
+/**
+ * Create a new enclave thread.
+ *
+ * This function creates a thread that runs **start_routine** with the given
+ * argument. The thread is run by a host thread that enters the enclave on a
+ * free TCS, so it starts only when a TCS is available. Within the thread,
+ * oe_thread_self() returns the identifier stored in **thread**. The thread
+ * must be joined with oe_thread_join() or detached with oe_thread_detach(),
+ * and must return before the enclave is terminated.
+ *
+ * @param thread Set to the identifier of the new thread.
+ * @param start_routine The function run by the new thread.
+ * @param arg The argument passed to **start_routine**.
+ *
+ * @return OE_OK the thread was created
+ * @return OE_INVALID_PARAMETER one or more parameters is invalid
+ * @return OE_OUT_OF_MEMORY insufficient memory exists to create the thread
+ * @return OE_FAILURE the host could not run the thread
+ *
+ */
+oe_result_t oe_thread_create(
+    oe_thread_t* thread,
+    void* (*start_routine)(void*),
+    void* arg);
+
+/**
+ * Wait for a thread created by oe_thread_create() to return.
+ *
+ * @param thread The identifier of a thread that is neither joined nor
+ *        detached.
+ * @param retval If non-null, set to the value returned by the thread.
+ *
+ * @return OE_OK the thread returned
+ * @return OE_INVALID_PARAMETER the thread is invalid, joined, detached or is
+ *         the calling thread
+ *
+ */
+oe_result_t oe_thread_join(oe_thread_t thread, void** retval);
+
+/**
+ * Detach a thread created by oe_thread_create().
+ *
+ * The resources of the thread are released when it returns, and it cannot
+ * be joined.
+ *
+ * @param thread The identifier of a thread that is neither joined nor
+ *        detached.
+ *
+ * @return OE_OK the thread was detached
+ * @return OE_INVALID_PARAMETER the thread is invalid, joined or detached
+ *
+ */
+oe_result_t oe_thread_detach(oe_thread_t thread);
+
 typedef uint32_t oe_once_t;
 
 /**
@@ -417,6 +490,27 @@ typedef struct _oe_rwlock
  */
 oe_result_t oe_rwlock_init(oe_rwlock_t* rw_lock);
 
+/* Waiting writers keep new readers from acquiring the lock */
+#define OE_RWLOCK_PREFER_WRITER 0x1
+
+/**
+ * Initialize a readers-writer lock with the given flags.
+ *
+ * This function is like oe_rwlock_init(), which uses no flags. With the
+ * OE_RWLOCK_PREFER_WRITER flag, readers wait while a writer waits for the
+ * lock, so that a stream of readers cannot starve writers. A thread that
+ * holds a read lock on such a lock deadlocks if it locks it for reading
+ * again while a writer waits.
+ *
+ * @param rw_lock Initialize this readers-writer variable.
+ * @param flags Zero or OE_RWLOCK_PREFER_WRITER.
+ *
+ * @return OE_OK the operation was successful
+ * @return OE_INVALID_PARAMETER one or more parameters is invalid
+ *
+ */
+oe_result_t oe_rwlock_init_ex(oe_rwlock_t* rw_lock, uint32_t flags);
+
 /**
  * Acquire a read lock on a readers-writer lock.
  *
@@ -573,6 +667,55 @@ oe_result_t oe_rwlock_trywrlock(oe_rwlock_t* rw_lock);
  */
 oe_result_t oe_rwlock_destroy(oe_rwlock_t* rw_lock);
 
+/**
+ * Sequence lock representation.
+ *
+ * A sequence lock protects small read-mostly data. Readers do not write to
+ * the lock: they copy the data and retry if a writer changed it meanwhile.
+ * The protected data must therefore be copied by readers, never followed
+ * through pointers that a writer may free.
+ *
+ *     unsigned seq;
+ *
+ *     do
+ *     {
+ *         seq = oe_seqlock_read_begin(&seqlock);
+ *         copy = data;
+ *     } while (oe_seqlock_read_retry(&seqlock, seq));
+ */
+typedef struct _oe_seqlock
+{
+    volatile uint32_t seq;
+    oe_spinlock_t lock;
+} oe_seqlock_t;
+
+#define OE_SEQLOCK_INITIALIZER {0, OE_SPINLOCK_INITIALIZER}
+
+/* Begin reading the data protected by the lock */
+OE_INLINE uint32_t oe_seqlock_read_begin(const oe_seqlock_t* seqlock)
+{
+    uint32_t seq;
+
+    /* Wait for the writer to finish */
+    while ((seq = __atomic_load_n(&seqlock->seq, __ATOMIC_ACQUIRE)) & 1)
+        __asm__ volatile("pause" ::: "memory");
+
+    return seq;
+}
+
+/* Whether the data read since oe_seqlock_read_begin() must be read again */
+OE_INLINE bool oe_seqlock_read_retry(const oe_seqlock_t* seqlock, uint32_t seq)
+{
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    return __atomic_load_n(&seqlock->seq, __ATOMIC_RELAXED) != seq;
+}
+
+/* Lock the data for writing, excluding other writers */
+void oe_seqlock_write_lock(oe_seqlock_t* seqlock);
+
+/* Unlock the data after writing it */
+void oe_seqlock_write_unlock(oe_seqlock_t* seqlock);
+
 typedef uint32_t oe_thread_key_t;
 
 /**
@@ -596,6 +739,34 @@ oe_result_t oe_thread_key_create(
     oe_thread_key_t* key,
     void (*destructor)(void* value));
 
+/* Values of the key survive across ECALLs on the same TCS */
+#define OE_THREAD_KEY_TCS_LIFETIME 0x1
+
+/**
+ * Create a key for accessing thread-specific data, with flags.
+ *
+ * This function is like oe_thread_key_create(). With the
+ * OE_THREAD_KEY_TCS_LIFETIME flag, the values of the key are bound to the
+ * enclave thread context (TCS) rather than to the outermost ECALL. They
+ * survive across ECALLs that use the same TCS, and their destructor is called
+ * only when the enclave is terminated. This suits per-thread caches that are
+ * expensive to rebuild.
+ *
+ * @param key Set this key to refer to the newly allocated TSD entry.
+ * @param destructor If non-null, this function is called for each non-null
+ *        value when it is destroyed.
+ * @param flags Zero or OE_THREAD_KEY_TCS_LIFETIME.
+ *
+ * @return OE_OK the operation was successful
+ * @return OE_INVALID_PARAMETER one or more parameters is invalid
+ * @return OE_OUT_OF_MEMORY insufficient memory exists to create the key
+ *
+ */
+oe_result_t oe_thread_key_create_ex(
+    oe_thread_key_t* key,
+    void (*destructor)(void* value),
+    uint32_t flags);
+
 /**
  * Delete a key for accessing thread-specific data.
  *
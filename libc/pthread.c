@@ -94,6 +94,15 @@ OE_WEAK_ALIAS(__pthread_self, pthread_self);
 
 int pthread_equal(pthread_t thread1, pthread_t thread2)
 {
+    pthread_t self = __pthread_self();
+
+    /* Threads created by pthread_create() are identified by their handle */
+    if (thread1 == self)
+        thread1 = (pthread_t)oe_thread_self();
+
+    if (thread2 == self)
+        thread2 = (pthread_t)oe_thread_self();
+
     return (int)oe_thread_equal((oe_thread_t)thread1, (oe_thread_t)thread2);
 }
 
@@ -110,35 +119,40 @@ int pthread_create(
     void* (*start_routine)(void*),
     void* arg)
 {
-    if (!_pthread_hooks || !_pthread_hooks->create)
-    {
-        oe_assert("pthread_create(): panic" == NULL);
-        return -1;
-    }
+    oe_thread_t t;
+    oe_result_t result;
+
+    if (_pthread_hooks && _pthread_hooks->create)
+        return _pthread_hooks->create(thread, attr, start_routine, arg);
 
-    return _pthread_hooks->create(thread, attr, start_routine, arg);
+    if (!thread)
+        return EINVAL;
+
+    if ((result = oe_thread_create(&t, start_routine, arg)) != OE_OK)
+        return result == OE_INVALID_PARAMETER ? EINVAL : EAGAIN;
+
+    if (attr && attr->_a_detach)
+        oe_thread_detach(t);
+
+    *thread = (pthread_t)t;
+
+    return 0;
 }
 
 int pthread_join(pthread_t thread, void** retval)
 {
-    if (!_pthread_hooks || !_pthread_hooks->join)
-    {
-        assert("pthread_join(): panic" == NULL);
-        return -1;
-    }
+    if (_pthread_hooks && _pthread_hooks->join)
+        return _pthread_hooks->join(thread, retval);
 
-    return _pthread_hooks->join(thread, retval);
+    return _to_errno(oe_thread_join((oe_thread_t)thread, retval));
 }
 
 int pthread_detach(pthread_t thread)
 {
-    if (!_pthread_hooks || !_pthread_hooks->detach)
-    {
-        assert("pthread_detach(): panic" == NULL);
-        return -1;
-    }
+    if (_pthread_hooks && _pthread_hooks->detach)
+        return _pthread_hooks->detach(thread);
 
-    return _pthread_hooks->detach(thread);
+    return _to_errno(oe_thread_detach((oe_thread_t)thread));
 }
 
 /*
@@ -250,11 +264,21 @@ int pthread_rwlock_rdlock(pthread_rwlock_t* rwlock)
     return _to_errno(oe_rwlock_rdlock((oe_rwlock_t*)rwlock));
 }
 
+int pthread_rwlock_tryrdlock(pthread_rwlock_t* rwlock)
+{
+    return _to_errno(oe_rwlock_tryrdlock((oe_rwlock_t*)rwlock));
+}
+
 int pthread_rwlock_wrlock(pthread_rwlock_t* rwlock)
 {
     return _to_errno(oe_rwlock_wrlock((oe_rwlock_t*)rwlock));
 }
 
+int pthread_rwlock_trywrlock(pthread_rwlock_t* rwlock)
+{
+    return _to_errno(oe_rwlock_trywrlock((oe_rwlock_t*)rwlock));
+}
+
 int pthread_rwlock_unlock(pthread_rwlock_t* rwlock)
 {
     return _to_errno(oe_rwlock_unlock((oe_rwlock_t*)rwlock));
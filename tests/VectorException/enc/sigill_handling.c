@@ -3,6 +3,7 @@
 #include <openenclave/enclave.h>
 #include <openenclave/internal/calls.h>
 #include <openenclave/internal/cpuid.h>
+#include <openenclave/internal/enclavelibc.h>
 #include <openenclave/internal/print.h>
 #include "../args.h"
 
@@ -132,6 +133,55 @@ bool TestUnsupportedCpuidLeaf(uint32_t leaf)
     }
 }
 
+// Test Intent: oe_cpuid() returns the cached CPUID leaves, as emulated for
+// the CPUID instruction, without raising an exception.
+bool TestOeCpuid(
+    const uint32_t cpuid_table[OE_CPUID_LEAF_COUNT][OE_CPUID_REG_COUNT])
+{
+    uint32_t cpuid[OE_CPUID_REG_COUNT];
+
+    g_handled_sigill = HANDLED_SIGILL_NONE;
+
+    for (uint32_t i = 0; i < OE_CPUID_LEAF_COUNT; i++)
+    {
+        oe_result_t result = oe_cpuid(
+            i,
+            0,
+            &cpuid[OE_CPUID_RAX],
+            &cpuid[OE_CPUID_RBX],
+            &cpuid[OE_CPUID_RCX],
+            &cpuid[OE_CPUID_RDX]);
+
+        if (result != OE_OK ||
+            oe_memcmp(cpuid, cpuid_table[i], sizeof(cpuid)) != 0)
+        {
+            oe_host_printf("oe_cpuid() differs for CPUID leaf %x.\n", i);
+            return false;
+        }
+    }
+
+    if (oe_cpuid(
+            OE_CPUID_LEAF_COUNT,
+            0,
+            &cpuid[OE_CPUID_RAX],
+            &cpuid[OE_CPUID_RBX],
+            &cpuid[OE_CPUID_RCX],
+            &cpuid[OE_CPUID_RDX]) != OE_UNSUPPORTED)
+    {
+        oe_host_printf("oe_cpuid() returned an unsupported leaf.\n");
+        return false;
+    }
+
+    if (g_handled_sigill != HANDLED_SIGILL_NONE)
+    {
+        oe_host_printf("oe_cpuid() raised an exception.\n");
+        return false;
+    }
+
+    oe_host_printf("Success-oe_cpuid() returned the cached CPUID leaves.\n");
+    return true;
+}
+
 OE_ECALL void TestSigillHandling(void* args_)
 {
     TestSigillHandlingArgs* args = (TestSigillHandlingArgs*)args_;
@@ -191,6 +241,11 @@ OE_ECALL void TestSigillHandling(void* args_)
         }
     }
 
+    if (!TestOeCpuid(args->cpuid_table))
+    {
+        return;
+    }
+
     // Clean up sigill handler
     if (oe_remove_vectored_exception_handler(TestSigillHandler) != OE_OK)
     {
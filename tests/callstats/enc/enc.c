@@ -0,0 +1,28 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#include <openenclave/enclave.h>
+#include <openenclave/internal/tests.h>
+#include "callstats_t.h"
+
+int enc_make_calls(int num_ocalls)
+{
+    for (int i = 0; i < num_ocalls; i++)
+    {
+        void* p = oe_host_malloc(16);
+        OE_TEST(p != NULL);
+        oe_host_free(p);
+
+        OE_TEST(host_callback() == OE_OK);
+    }
+
+    return num_ocalls;
+}
+
+OE_SET_ENCLAVE_SGX(
+    1,    /* ProductID */
+    1,    /* SecurityVersion */
+    true, /* AllowDebug */
+    1024, /* HeapPageCount */
+    1024, /* StackPageCount */
+    2);   /* TCSCount */
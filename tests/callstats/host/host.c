@@ -0,0 +1,184 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#include <openenclave/host.h>
+#include <openenclave/internal/tests.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "callstats_u.h"
+
+#define NUM_ECALLS 10
+#define NUM_OCALLS 5
+
+static size_t _host_callback_calls;
+
+void host_callback(void)
+{
+    _host_callback_calls++;
+}
+
+static void _make_calls(oe_enclave_t* enclave)
+{
+    for (int i = 0; i < NUM_ECALLS; i++)
+    {
+        int ret = 0;
+        OE_TEST(enc_make_calls(enclave, &ret, NUM_OCALLS) == OE_OK);
+        OE_TEST(ret == NUM_OCALLS);
+    }
+}
+
+static const oe_call_stats_t* _find(
+    const oe_call_stats_t* stats,
+    size_t count,
+    oe_call_kind_t kind,
+    const char* name)
+{
+    for (size_t i = 0; i < count; i++)
+    {
+        if (stats[i].kind == kind && strcmp(stats[i].name, name) == 0)
+            return &stats[i];
+    }
+
+    return NULL;
+}
+
+static void _check_histogram(const oe_call_stats_t* stats)
+{
+    uint64_t sum = 0;
+
+    for (size_t i = 0; i < OE_CALL_STATS_HISTOGRAM_BUCKETS; i++)
+        sum += stats->histogram[i];
+
+    OE_TEST(sum == stats->count);
+    OE_TEST(stats->min_ns <= stats->max_ns);
+    OE_TEST(stats->total_ns >= stats->max_ns);
+}
+
+static void _test_bucket_bounds(void)
+{
+    OE_TEST(oe_call_stats_bucket_lower_bound(0) == 0);
+    OE_TEST(oe_call_stats_bucket_lower_bound(3) == 3);
+    OE_TEST(oe_call_stats_bucket_lower_bound(4) == 4);
+    OE_TEST(oe_call_stats_bucket_lower_bound(8) == 8);
+    OE_TEST(oe_call_stats_bucket_lower_bound(9) == 10);
+
+    for (size_t i = 1; i < OE_CALL_STATS_HISTOGRAM_BUCKETS; i++)
+    {
+        OE_TEST(
+            oe_call_stats_bucket_lower_bound(i) >
+            oe_call_stats_bucket_lower_bound(i - 1));
+    }
+}
+
+int main(int argc, const char* argv[])
+{
+    oe_result_t result;
+    oe_enclave_t* enclave = NULL;
+    oe_call_stats_t* stats = NULL;
+    size_t count = 0;
+
+    if (argc != 2)
+    {
+        fprintf(stderr, "Usage: %s ENCLAVE_PATH\n", argv[0]);
+        return 1;
+    }
+
+    _test_bucket_bounds();
+
+    const uint32_t flags = oe_get_create_flags();
+
+    result = oe_create_enclave(
+        argv[1], OE_ENCLAVE_TYPE_SGX, flags, NULL, 0, &enclave);
+    OE_TEST(result == OE_OK);
+
+    /* Nothing is recorded until the statistics are enabled */
+    _make_calls(enclave);
+    OE_TEST(oe_get_enclave_call_stats(enclave, NULL, &count) == OE_OK);
+    OE_TEST(count == 0);
+
+    OE_TEST(oe_enable_enclave_call_stats(enclave, true) == OE_OK);
+    _make_calls(enclave);
+
+    OE_TEST(
+        oe_get_enclave_call_stats(enclave, NULL, &count) ==
+        OE_BUFFER_TOO_SMALL);
+    OE_TEST(count > 0);
+    OE_TEST((stats = (oe_call_stats_t*)calloc(count, sizeof(*stats))));
+    OE_TEST(oe_get_enclave_call_stats(enclave, stats, &count) == OE_OK);
+
+    {
+        const oe_call_stats_t* p;
+
+        p = _find(stats, count, OE_CALL_KIND_ECALL, "ecall_enc_make_calls");
+        OE_TEST(p != NULL);
+        OE_TEST(p->count == NUM_ECALLS);
+        _check_histogram(p);
+
+        /* The generated wrappers call the functions by table index */
+        p = _find(
+            stats,
+            count,
+            OE_CALL_KIND_ECALL,
+            "OE_ECALL_CALL_ENCLAVE_FUNCTION");
+        OE_TEST(p != NULL);
+        OE_TEST(p->count == NUM_ECALLS);
+        _check_histogram(p);
+
+        p = _find(stats, count, OE_CALL_KIND_OCALL, "ocall_host_callback");
+        OE_TEST(p != NULL);
+        OE_TEST(p->count == NUM_ECALLS * NUM_OCALLS);
+        _check_histogram(p);
+
+        p = _find(
+            stats, count, OE_CALL_KIND_OCALL, "OE_OCALL_CALL_HOST_FUNCTION");
+        OE_TEST(p != NULL);
+        OE_TEST(p->count == NUM_ECALLS * NUM_OCALLS);
+        _check_histogram(p);
+
+        /* The enclave fetched the host id of the OCALL on its first call,
+         * before the statistics were enabled */
+        OE_TEST(
+            _find(
+                stats,
+                count,
+                OE_CALL_KIND_OCALL,
+                "OE_OCALL_GET_HOST_FUNCTION_ID") == NULL);
+
+        /* The OCALL stubs may allocate host memory too */
+        p = _find(stats, count, OE_CALL_KIND_OCALL, "OE_OCALL_MALLOC");
+        OE_TEST(p != NULL);
+        OE_TEST(p->count >= NUM_ECALLS * NUM_OCALLS);
+        _check_histogram(p);
+    }
+
+    OE_TEST(oe_write_enclave_call_stats_json(enclave, stdout) == OE_OK);
+
+    /* Disabling keeps the statistics but stops recording */
+    OE_TEST(oe_enable_enclave_call_stats(enclave, false) == OE_OK);
+    _make_calls(enclave);
+    {
+        const oe_call_stats_t* p;
+        size_t n = count;
+
+        OE_TEST(oe_get_enclave_call_stats(enclave, stats, &n) == OE_OK);
+        OE_TEST(n == count);
+        p = _find(stats, n, OE_CALL_KIND_ECALL, "ecall_enc_make_calls");
+        OE_TEST(p != NULL);
+        OE_TEST(p->count == NUM_ECALLS);
+    }
+
+    OE_TEST(oe_reset_enclave_call_stats(enclave) == OE_OK);
+    count = 0;
+    OE_TEST(oe_get_enclave_call_stats(enclave, NULL, &count) == OE_OK);
+    OE_TEST(count == 0);
+
+    OE_TEST(_host_callback_calls == 3 * NUM_ECALLS * NUM_OCALLS);
+
+    free(stats);
+    OE_TEST(oe_terminate_enclave(enclave) == OE_OK);
+
+    printf("=== passed all tests (callstats)\n");
+
+    return 0;
+}
@@ -0,0 +1,98 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#include <openenclave/internal/cert.h>
+#include <openenclave/internal/tests.h>
+#include <stdio.h>
+#include <time.h>
+
+/* An ECDSA chain (leaf, intermediate CA and root), valid until 2126 */
+static const char _LEAF[] =
+    "-----BEGIN CERTIFICATE-----\n"
+    "MIIBgTCCASagAwIBAgICEjQwCgYIKoZIzj0EAwIwFjEUMBIGA1UEAwwLQ1JMIFRl\n"
+    "c3QgQ0EwIBcNMjYxMDE4MTYyMjE1WhgPMjEyNjA5MjQxNjIyMTVaMBgxFjAUBgNV\n"
+    "BAMMDUNSTCBUZXN0IExlYWYwWTATBgcqhkjOPQIBBggqhkjOPQMBBwNCAARdaaVM\n"
+    "8LaLRPBv2qfIzX3JTcAO2YhtsPGUnw/zrmNcl0aaKqHondymTeaQm5RLA6U5mP52\n"
+    "6VRliuvwsSZ2Saxao2AwXjAMBgNVHRMBAf8EAjAAMA4GA1UdDwEB/wQEAwIHgDAd\n"
+    "BgNVHQ4EFgQUZ4PPDwnbgvnIljC9UM2cGxckGccwHwYDVR0jBBgwFoAUNo+NQn2D\n"
+    "RVah/IAAxA4SLWOtzdkwCgYIKoZIzj0EAwIDSQAwRgIhAPcE7GwJiKDFXitu2Gkg\n"
+    "R7Drc6M2DPH4CRmtZ8DLaaWPAiEAvSIu6ckExNnhljUecmvSTpdBwuRV/TGbvm6b\n"
+    "qXvueFQ=\n"
+    "-----END CERTIFICATE-----\n";
+
+static const char _CHAIN[] =
+    "-----BEGIN CERTIFICATE-----\n"
+    "MIIBgjCCASigAwIBAgIBAjAKBggqhkjOPQQDAjAYMRYwFAYDVQQDDA1DUkwgVGVz\n"
+    "dCBSb290MCAXDTI2MTAxODE2MjIxNVoYDzIxMjYwOTI0MTYyMjE1WjAWMRQwEgYD\n"
+    "VQQDDAtDUkwgVGVzdCBDQTBZMBMGByqGSM49AgEGCCqGSM49AwEHA0IABB+kqjA5\n"
+    "Wf3sxt12lLHLGHoiNHU7F1X2nJIIncDglC+Z9K+lp2lvQz3X0y4hFR5sbcoCIQ/e\n"
+    "YIGGtkWd1jXCMfSjYzBhMA8GA1UdEwEB/wQFMAMBAf8wDgYDVR0PAQH/BAQDAgEG\n"
+    "MB0GA1UdDgQWBBQ2j41CfYNFVqH8gADEDhItY63N2TAfBgNVHSMEGDAWgBT+WAv/\n"
+    "NFxp+mTB65RrYy3249JpQDAKBggqhkjOPQQDAgNIADBFAiEAhZsbG6L8xtT/sk2O\n"
+    "zQ5wXziEy9CY3SaztpuwoII5tj0CIHEtPsf5DyVIfKy6wZvAIQ6FSloJP0SvlnK0\n"
+    "Ij0LIxbw\n"
+    "-----END CERTIFICATE-----\n"
+    "-----BEGIN CERTIFICATE-----\n"
+    "MIIBYjCCAQmgAwIBAgIBATAKBggqhkjOPQQDAjAYMRYwFAYDVQQDDA1DUkwgVGVz\n"
+    "dCBSb290MCAXDTI2MTAxODE2MjIxNVoYDzIxMjYwOTI0MTYyMjE1WjAYMRYwFAYD\n"
+    "VQQDDA1DUkwgVGVzdCBSb290MFkwEwYHKoZIzj0CAQYIKoZIzj0DAQcDQgAENhaZ\n"
+    "61h6fkYUVgcRPIRXd66UNL6r6VVTUvTIU6cqpftOZhgc+Kd+AB71YUUoPHUoZGSa\n"
+    "aUMfNA8514x+uZqeuqNCMEAwDwYDVR0TAQH/BAUwAwEB/zAOBgNVHQ8BAf8EBAMC\n"
+    "AQYwHQYDVR0OBBYEFP5YC/80XGn6ZMHrlGtjLfbj0mlAMAoGCCqGSM49BAMCA0cA\n"
+    "MEQCIEyx+ZjgQyxb2ADuTjbf5xeNjM6iYg2D+vZq9WW72wUvAiBzU2+/SYSxO02Q\n"
+    "0CNjW9SFld6XC5zb/fIjSlktJrFzWQ==\n"
+    "-----END CERTIFICATE-----\n";
+
+static const size_t ITERATIONS = 1000;
+
+static double _seconds_since(clock_t start)
+{
+    return (double)(clock() - start) / CLOCKS_PER_SEC;
+}
+
+/* Measure the rate of certificate chain reads and verifications */
+static void _benchmark_cert_verify(void)
+{
+    oe_verify_cert_error_t error = {0};
+    oe_cert_t cert = {0};
+    oe_cert_chain_t chain = {0};
+    clock_t start;
+    double seconds;
+
+    OE_TEST(oe_cert_read_pem(&cert, _LEAF, sizeof(_LEAF)) == OE_OK);
+
+    start = clock();
+
+    for (size_t i = 0; i < ITERATIONS; i++)
+    {
+        oe_result_t r = oe_cert_chain_read_pem(&chain, _CHAIN, sizeof(_CHAIN));
+        OE_TEST(r == OE_OK);
+        oe_cert_chain_free(&chain);
+    }
+
+    seconds = _seconds_since(start);
+    printf(
+        "chain reads per second: %.0f\n",
+        seconds ? ITERATIONS / seconds : 0.0);
+
+    OE_TEST(oe_cert_chain_read_pem(&chain, _CHAIN, sizeof(_CHAIN)) == OE_OK);
+
+    start = clock();
+
+    for (size_t i = 0; i < ITERATIONS; i++)
+        OE_TEST(oe_cert_verify(&cert, &chain, NULL, 0, &error) == OE_OK);
+
+    seconds = _seconds_since(start);
+    printf(
+        "verifications per second: %.0f\n",
+        seconds ? ITERATIONS / seconds : 0.0);
+
+    oe_cert_free(&cert);
+    oe_cert_chain_free(&chain);
+}
+
+int main(void)
+{
+    _benchmark_cert_verify();
+    return 0;
+}
@@ -314,6 +314,127 @@ static void _test_generate()
     printf("=== passed %s()\n", __FUNCTION__);
 }
 
+/* Sign the hash with the private key (returns the signature size) */
+static size_t _sign_hash(
+    const oe_ec_private_key_t* private_key,
+    const uint8_t hash[OE_SHA256_SIZE],
+    uint8_t* signature,
+    size_t signature_size)
+{
+    oe_result_t r = oe_ec_private_key_sign(
+        private_key,
+        OE_HASH_TYPE_SHA256,
+        hash,
+        OE_SHA256_SIZE,
+        signature,
+        &signature_size);
+    OE_TEST(r == OE_OK);
+
+    return signature_size;
+}
+
+static oe_result_t _verify_hash(
+    const oe_ec_public_key_t* public_key,
+    const uint8_t hash[OE_SHA256_SIZE],
+    const uint8_t* signature,
+    size_t signature_size)
+{
+    return oe_ec_public_key_verify(
+        public_key,
+        OE_HASH_TYPE_SHA256,
+        hash,
+        OE_SHA256_SIZE,
+        signature,
+        signature_size);
+}
+
+/* Enclaves keep the tables of up to 32 P-256 keys to verify signatures, so
+ * verify with more keys than that: each key is verified again once its
+ * table is kept (or once no table is left), with good and bad signatures.
+ *
+ * A zero hash makes u1 (the multiplier of the generator) zero, which the
+ * tables do not handle, so these verifications fall back to mbedtls: their
+ * result must not depend on whether the key has a table. */
+static void _test_verify_many_keys()
+{
+    printf("=== begin %s()\n", __FUNCTION__);
+
+    enum
+    {
+        NUM_KEYS = 40
+    };
+    static oe_ec_private_key_t private_keys[NUM_KEYS];
+    static oe_ec_public_key_t public_keys[NUM_KEYS];
+    const uint8_t* hash = ALPHABET_HASH.buf;
+    const uint8_t zero_hash[OE_SHA256_SIZE] = {0};
+    uint8_t other_hash[OE_SHA256_SIZE];
+    oe_result_t zero_hash_result = OE_UNEXPECTED;
+    oe_result_t r;
+
+    memcpy(other_hash, hash, sizeof(other_hash));
+    other_hash[0] ^= 1;
+
+    for (size_t i = 0; i < NUM_KEYS; i++)
+    {
+        r = oe_ec_generate_key_pair(
+            OE_EC_TYPE_SECP256R1, &private_keys[i], &public_keys[i]);
+        OE_TEST(r == OE_OK);
+    }
+
+    for (size_t pass = 0; pass < 2; pass++)
+    {
+        for (size_t i = 0; i < NUM_KEYS; i++)
+        {
+            uint8_t signature[128];
+            size_t size = _sign_hash(
+                &private_keys[i], hash, signature, sizeof(signature));
+
+            OE_TEST(
+                _verify_hash(&public_keys[i], hash, signature, size) == OE_OK);
+
+            /* Wrong hash, wrong key, and corrupted signature */
+            OE_TEST(
+                _verify_hash(&public_keys[i], other_hash, signature, size) ==
+                OE_VERIFY_FAILED);
+            OE_TEST(
+                _verify_hash(
+                    &public_keys[(i + 1) % NUM_KEYS], hash, signature, size) ==
+                OE_VERIFY_FAILED);
+
+            signature[size - 1] ^= 1;
+            OE_TEST(
+                _verify_hash(&public_keys[i], hash, signature, size) ==
+                OE_VERIFY_FAILED);
+
+            size = _sign_hash(
+                &private_keys[i], zero_hash, signature, sizeof(signature));
+            r = _verify_hash(&public_keys[i], zero_hash, signature, size);
+            OE_TEST(r == OE_OK || r == OE_VERIFY_FAILED);
+
+            if (zero_hash_result == OE_UNEXPECTED)
+                zero_hash_result = r;
+
+            OE_TEST(r == zero_hash_result);
+            OE_TEST(
+                _verify_hash(&public_keys[i], hash, signature, size) ==
+                OE_VERIFY_FAILED);
+        }
+    }
+
+#if !defined(OE_BUILD_ENCLAVE)
+    /* OpenSSL accepts signatures of a zero hash */
+    OE_TEST(zero_hash_result == OE_OK);
+#endif
+
+    for (size_t i = 0; i < NUM_KEYS; i++)
+    {
+        oe_ec_private_key_free(&private_keys[i]);
+        oe_ec_public_key_free(&public_keys[i]);
+    }
+
+    printf("=== passed %s()\n", __FUNCTION__);
+}
+
 static void _test_write_private()
 {
     printf("=== begin %s()\n", __FUNCTION__);
@@ -919,6 +1040,7 @@ void TestEC()
     _test_crl_distribution_points();
     _test_sign_and_verify();
     _test_generate();
+    _test_verify_many_keys();
     _test_write_private();
     _test_write_public();
     _test_cert_methods();
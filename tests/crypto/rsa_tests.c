@@ -365,6 +365,42 @@ static void _test_cert_verify_bad()
     printf("=== passed %s()\n", __FUNCTION__);
 }
 
+static void _test_cert_verify_good_then_bad()
+{
+    printf("=== begin %s()\n", __FUNCTION__);
+
+    oe_result_t r;
+    oe_verify_cert_error_t error = {0};
+    oe_cert_t cert = {0};
+    oe_cert_chain_t chain1 = {0};
+    oe_cert_chain_t chain2 = {0};
+
+    r = oe_cert_read_pem(&cert, _CERT1, sizeof(_CERT1));
+    OE_TEST(r == OE_OK);
+
+    r = oe_cert_chain_read_pem(&chain1, CHAIN1, sizeof(CHAIN1));
+    OE_TEST(r == OE_OK);
+
+    r = oe_cert_chain_read_pem(&chain2, CHAIN2, sizeof(CHAIN2));
+    OE_TEST(r == OE_OK);
+
+    /* A successful verification must not leak into the next one */
+    r = oe_cert_verify(&cert, &chain1, NULL, 0, &error);
+    OE_TEST(r == OE_OK);
+
+    r = oe_cert_verify(&cert, &chain2, NULL, 0, &error);
+    OE_TEST(r == OE_VERIFY_FAILED);
+
+    r = oe_cert_verify(&cert, &chain1, NULL, 0, &error);
+    OE_TEST(r == OE_OK);
+
+    oe_cert_free(&cert);
+    oe_cert_chain_free(&chain1);
+    oe_cert_chain_free(&chain2);
+
+    printf("=== passed %s()\n", __FUNCTION__);
+}
+
 static void _test_mixed_chain()
 {
     printf("=== begin %s()\n", __FUNCTION__);
@@ -658,6 +694,7 @@ void TestRSA(void)
     _test_cert_methods();
     _test_cert_verify_good();
     _test_cert_verify_bad();
+    _test_cert_verify_good_then_bad();
     _test_mixed_chain();
     _test_generate();
     _test_sign();
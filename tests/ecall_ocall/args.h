@@ -33,12 +33,33 @@ struct EncRecursionArg
     uint32_t crc;                     // InOut
 };
 
+struct EncAccumulateArg
+{
+    unsigned value; // In
+    unsigned total; // Out
+};
+
+struct EncAsyncOcallsArg
+{
+    oe_result_t result; // Out
+    unsigned count;     // In
+    unsigned* values;   // InOut (host memory)
+};
+
 struct EncTestCallHostFunctionArg
 {
     oe_result_t result;        // Out
     const char* function_name; // In
 };
 
+struct EncCallHostFunctionByIdArg
+{
+    oe_result_t result;   // Out
+    uint32_t function_id; // In
+    unsigned count;       // In
+    unsigned value;       // InOut
+};
+
 enum
 {
     TAG_START_HOST,
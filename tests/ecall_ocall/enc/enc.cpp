@@ -2,6 +2,7 @@
 // Licensed under the MIT License.
 
 #include <openenclave/enclave.h>
+#include <openenclave/internal/fiber.h>
 #include <openenclave/internal/globals.h> // for __oe_get_enclave_base()
 #include <openenclave/internal/tests.h>
 #include <openenclave/internal/thread.h>
@@ -137,6 +138,33 @@ OE_ECALL void EncTestCallHostFunction(void* Args_)
     args_host->result = oe_call_host(args.function_name, NULL);
 }
 
+// OCALL table like the ones oeedger8r generates. The host registers the
+// first function with oe_register_ocall_function(); the second one does not
+// exist.
+static const char* const OcallNames[] = {"HostTableOcall",
+                                         "NonExistingFunction"};
+static uint32_t OcallHostIds[OE_COUNTOF(OcallNames)];
+static oe_ocall_table_t OcallTable = {OcallNames,
+                                      OcallHostIds,
+                                      OE_COUNTOF(OcallNames)};
+
+// Call a function of the OCALL table by id, count times
+OE_ECALL void EncCallHostFunctionById(void* args_)
+{
+    EncCallHostFunctionByIdArg* args = (EncCallHostFunctionByIdArg*)args_;
+
+    if (!oe_is_outside_enclave(args, sizeof(EncCallHostFunctionByIdArg)))
+        return;
+
+    args->result = OE_OK;
+
+    for (unsigned i = 0; i < args->count && args->result == OE_OK; i++)
+    {
+        args->result =
+            oe_call_host_function(&OcallTable, args->function_id, &args->value);
+    }
+}
+
 size_t Factor = 0;
 
 OE_ECALL void EncCrossEnclaveCall(CrossEnclaveCallArg* arg)
@@ -165,6 +193,78 @@ OE_ECALL void EncSetFactor(void* arg)
     Factor = (size_t)arg;
 }
 
+// Post one asynchronous OCALL per value, then wait for all of them.
+static void _set_flag(void* arg)
+{
+    *(bool*)arg = true;
+}
+
+OE_ECALL void EncAsyncOcalls(void* args_)
+{
+    EncAsyncOcallsArg* args = (EncAsyncOcallsArg*)args_;
+    oe_async_ocall_t* handles[16];
+    oe_async_ocall_t* handle = NULL;
+
+    if (!oe_is_outside_enclave(args, sizeof(EncAsyncOcallsArg)) ||
+        args->count > OE_COUNTOF(handles) ||
+        !oe_is_outside_enclave(args->values, args->count * sizeof(unsigned)))
+    {
+        return;
+    }
+
+    for (unsigned i = 0; i < args->count; i++)
+    {
+        OE_TEST(
+            oe_call_host_async(
+                "HostAsyncDouble", &args->values[i], &handles[i]) == OE_OK);
+    }
+
+    for (unsigned i = 0; i < args->count; i++)
+    {
+        OE_TEST(oe_async_ocall_wait(handles[i]) == OE_OK);
+    }
+
+    OE_TEST(
+        oe_call_host_async("NonExistingFunction", NULL, &handle) ==
+        OE_NOT_FOUND);
+    OE_TEST(handle == NULL);
+
+    // A handle that completed can be polled before it is waited on.
+    OE_TEST(
+        oe_call_host_async("HostAsyncDouble", &args->values[0], &handle) ==
+        OE_OK);
+    while (!oe_async_ocall_is_done(handle))
+        ;
+    OE_TEST(oe_async_ocall_wait(handle) == OE_OK);
+
+    // A ready fiber of the TCS runs while the wait is pending.
+    bool ran = false;
+    oe_fiber_t* fiber;
+    OE_TEST(oe_fiber_create(&fiber, 0, _set_flag, &ran) == OE_OK);
+    OE_TEST(
+        oe_call_host_async("HostAsyncDouble", &args->values[0], &handle) ==
+        OE_OK);
+    OE_TEST(oe_async_ocall_wait(handle) == OE_OK);
+    OE_TEST(ran);
+    OE_TEST(oe_fiber_join(fiber) == OE_OK);
+
+    args->result = OE_OK;
+}
+
+static unsigned Total = 0;
+
+// Used by the batch test: results depend on the order of the calls.
+OE_ECALL void EncAccumulate(void* args_)
+{
+    EncAccumulateArg* args = (EncAccumulateArg*)args_;
+
+    if (!oe_is_outside_enclave(args, sizeof(EncAccumulateArg)))
+        return;
+
+    Total += args->value;
+    args->total = Total;
+}
+
 OE_SET_ENCLAVE_SGX(
     1,    /* ProductID */
     1,    /* SecurityVersion */
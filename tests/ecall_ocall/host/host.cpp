@@ -7,10 +7,12 @@
 #include <openenclave/internal/types.h>
 #include <atomic>
 #include <cassert>
+#include <chrono>
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
 #include <map>
+#include <mutex>
 #include <set>
 #include <system_error>
 #include <thread>
@@ -203,6 +205,119 @@ static void TestInvalidFunctions(unsigned enclave_id)
     OE_TEST(args.result == OE_OK);
 }
 
+// OCALL functions of the OCALL table of the enclave. They are not exported,
+// so they can only be called once registered.
+static void HostAddOne(void* arg_, oe_enclave_t*)
+{
+    ++*(unsigned*)arg_;
+}
+
+static void HostAddOneAgain(void* arg_, oe_enclave_t*)
+{
+    ++*(unsigned*)arg_;
+}
+
+static void HostDouble(void* arg_, oe_enclave_t*)
+{
+    *(unsigned*)arg_ *= 2;
+}
+
+// Call a function of the OCALL table of the enclave by id
+static oe_result_t CallHostFunctionById(
+    unsigned enclave_id,
+    uint32_t function_id,
+    unsigned count,
+    unsigned* value)
+{
+    EncCallHostFunctionByIdArg args = {};
+
+    args.result = OE_FAILURE;
+    args.function_id = function_id;
+    args.count = count;
+    args.value = *value;
+    OE_TEST(
+        oe_call_enclave(
+            EnclaveWrap::Get(enclave_id), "EncCallHostFunctionById", &args) ==
+        OE_OK);
+    *value = args.value;
+
+    return args.result;
+}
+
+// Test OCALLs by table id: registration, replacement of a registered
+// function between calls and while the enclave calls it, and functions that
+// are not registered.
+static void TestOcallRegistration(unsigned enclave_id)
+{
+    oe_enclave_t* enclave = EnclaveWrap::Get(enclave_id);
+    const unsigned COUNT = 1000;
+    unsigned value = 1;
+
+    // Not registered (nor exported) yet.
+    OE_TEST(CallHostFunctionById(enclave_id, 0, 1, &value) == OE_NOT_FOUND);
+    OE_TEST(value == 1);
+
+    OE_TEST(
+        oe_register_ocall_function(enclave, "HostTableOcall", HostAddOne) ==
+        OE_OK);
+    OE_TEST(CallHostFunctionById(enclave_id, 0, 1, &value) == OE_OK);
+    OE_TEST(value == 2);
+
+    // The enclave keeps the host id of the function, which now calls the
+    // replacement.
+    OE_TEST(
+        oe_register_ocall_function(enclave, "HostTableOcall", HostDouble) ==
+        OE_OK);
+    OE_TEST(CallHostFunctionById(enclave_id, 0, 2, &value) == OE_OK);
+    OE_TEST(value == 8);
+
+    // Replace the function while the enclave calls it: every call runs one of
+    // the two functions.
+    OE_TEST(
+        oe_register_ocall_function(enclave, "HostTableOcall", HostAddOne) ==
+        OE_OK);
+    {
+        std::atomic<bool> done(false);
+        std::thread reloader([&]() {
+            for (unsigned i = 0; !done; i++)
+            {
+                OE_TEST(
+                    oe_register_ocall_function(
+                        enclave,
+                        "HostTableOcall",
+                        i % 2 ? HostAddOne : HostAddOneAgain) == OE_OK);
+            }
+        });
+
+        value = 0;
+        OE_TEST(CallHostFunctionById(enclave_id, 0, COUNT, &value) == OE_OK);
+        done = true;
+        reloader.join();
+        OE_TEST(value == COUNT);
+    }
+
+    // Not registered and not exported by the host.
+    OE_TEST(CallHostFunctionById(enclave_id, 1, 1, &value) == OE_NOT_FOUND);
+    OE_TEST(value == COUNT);
+
+    // Not in the table.
+    OE_TEST(
+        CallHostFunctionById(enclave_id, 2, 1, &value) ==
+        OE_INVALID_PARAMETER);
+
+    OE_TEST(
+        oe_register_ocall_function(enclave, NULL, HostAddOne) ==
+        OE_INVALID_PARAMETER);
+    OE_TEST(
+        oe_register_ocall_function(enclave, "", HostAddOne) ==
+        OE_INVALID_PARAMETER);
+    OE_TEST(
+        oe_register_ocall_function(enclave, "HostTableOcall", NULL) ==
+        OE_INVALID_PARAMETER);
+
+    printf("=== TestOcallRegistration passed\n");
+}
+
 // Helper function for parallel test
 static void ParallelThread(
     unsigned enclave_id,
@@ -350,6 +465,106 @@ static void TestCrossEnclaveCalls()
     printf("=== TestCrossEnclaveCalls passed\n");
 }
 
+static std::mutex AsyncThreadsLock;
+static std::set<std::thread::id> AsyncThreads;
+
+OE_OCALL void HostAsyncDouble(void* arg_)
+{
+    unsigned* value = (unsigned*)arg_;
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    *value *= 2;
+
+    std::lock_guard<std::mutex> lock(AsyncThreadsLock);
+    AsyncThreads.insert(std::this_thread::get_id());
+}
+
+// Test that asynchronous OCALLs run on the worker pool, not on the thread
+// that entered the enclave.
+static void TestAsyncOcalls(unsigned enclave_id)
+{
+    const unsigned COUNT = 8;
+    unsigned values[COUNT];
+    EncAsyncOcallsArg args = {};
+
+    for (unsigned i = 0; i < COUNT; i++)
+        values[i] = i + 1;
+
+    args.result = OE_FAILURE;
+    args.count = COUNT;
+    args.values = values;
+
+    OE_TEST(
+        oe_call_enclave(
+            EnclaveWrap::Get(enclave_id), "EncAsyncOcalls", &args) == OE_OK);
+    OE_TEST(args.result == OE_OK);
+
+    // values[0] is doubled again by the polling and the fiber tests.
+    OE_TEST(values[0] == 8);
+    for (unsigned i = 1; i < COUNT; i++)
+        OE_TEST(values[i] == 2 * (i + 1));
+
+    OE_TEST(!AsyncThreads.empty());
+    OE_TEST(AsyncThreads.count(std::this_thread::get_id()) == 0);
+
+    // The pool is already running.
+    OE_TEST(
+        oe_set_enclave_async_ocall_threads(EnclaveWrap::Get(enclave_id), 2) ==
+        OE_BUSY);
+
+    printf("=== TestAsyncOcalls passed\n");
+}
+
+// Test that a batch of calls is dispatched in order during one entry and
+// that each call reports its own result.
+static void TestBatchCalls(unsigned enclave_id)
+{
+    const size_t NUM_CALLS = 8;
+    EncAccumulateArg args[NUM_CALLS];
+    oe_call_enclave_batch_entry_t calls[NUM_CALLS + 1];
+    unsigned expected_total = 0;
+
+    for (size_t i = 0; i < NUM_CALLS; i++)
+    {
+        args[i].value = (unsigned)i + 1;
+        args[i].total = 0;
+        calls[i].func = "EncAccumulate";
+        calls[i].args = &args[i];
+        calls[i].result = OE_FAILURE;
+    }
+
+    calls[NUM_CALLS].func = "EncDummyEncFunction";
+    calls[NUM_CALLS].args = NULL;
+    calls[NUM_CALLS].result = OE_FAILURE;
+
+    OE_TEST(
+        oe_call_enclave_batch(
+            EnclaveWrap::Get(enclave_id), calls, NUM_CALLS + 1) == OE_OK);
+
+    for (size_t i = 0; i < NUM_CALLS; i++)
+    {
+        expected_total += args[i].value;
+        OE_TEST(calls[i].result == OE_OK);
+        OE_TEST(args[i].total == expected_total);
+    }
+    OE_TEST(calls[NUM_CALLS].result == OE_OK);
+
+    // A batch naming an unknown function is rejected as a whole.
+    calls[0].func = "NonExistingFunction";
+    calls[1].result = OE_FAILURE;
+    OE_TEST(
+        oe_call_enclave_batch(EnclaveWrap::Get(enclave_id), calls, 2) ==
+        OE_NOT_FOUND);
+    OE_TEST(calls[1].result == OE_FAILURE);
+    OE_TEST(args[1].total == 3);
+
+    OE_TEST(
+        oe_call_enclave_batch(EnclaveWrap::Get(enclave_id), NULL, 1) ==
+        OE_INVALID_PARAMETER);
+
+    printf("=== TestBatchCalls passed\n");
+}
+
 int main(int argc, const char* argv[])
 {
     if (argc != 2)
@@ -371,6 +586,15 @@ int main(int argc, const char* argv[])
     // invalid function tests
     TestInvalidFunctions(enc1.GetId());
 
+    // OCALLs by table id
+    TestOcallRegistration(enc1.GetId());
+
+    // batched calls
+    TestBatchCalls(enc1.GetId());
+
+    // asynchronous OCALLs
+    TestAsyncOcalls(enc1.GetId());
+
     // verify threads execute in parallel
     TestExecutionParallel({enc1.GetId()}, THREAD_COUNT);
 
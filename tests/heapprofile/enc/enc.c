@@ -0,0 +1,65 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#include <openenclave/enclave.h>
+#include <openenclave/internal/enclavelibc.h>
+#include <openenclave/internal/malloc.h>
+#include <openenclave/internal/tests.h>
+#include "heapprofile_t.h"
+
+#define MAX_ALLOCATIONS 256
+
+static void* _allocations[MAX_ALLOCATIONS];
+static uint64_t _num_allocations;
+static uint64_t _num_freed;
+
+uint64_t enc_start_heap_profiler(uint64_t sample_interval)
+{
+    oe_result_t result = oe_heap_profiler_start(sample_interval);
+
+    /* The first allocation of the TCS seeds its sampling and is not
+     * sampled */
+    oe_free(oe_malloc(1));
+
+    return result;
+}
+
+void enc_stop_heap_profiler(void)
+{
+    oe_heap_profiler_stop();
+}
+
+/* All the allocations of the test share this call site */
+OE_NEVER_INLINE static void* _heapprofile_allocate(size_t size)
+{
+    return oe_malloc(size);
+}
+
+void enc_allocate(uint64_t count, uint64_t size)
+{
+    OE_TEST(_num_allocations + count <= MAX_ALLOCATIONS);
+
+    for (uint64_t i = 0; i < count; i++)
+    {
+        void* ptr = _heapprofile_allocate(size);
+
+        OE_TEST(ptr != NULL);
+        _allocations[_num_allocations++] = ptr;
+    }
+}
+
+void enc_free(uint64_t count)
+{
+    OE_TEST(_num_freed + count <= _num_allocations);
+
+    for (uint64_t i = 0; i < count; i++)
+        oe_free(_allocations[_num_freed++]);
+}
+
+OE_SET_ENCLAVE_SGX(
+    1,    /* ProductID */
+    1,    /* SecurityVersion */
+    true, /* AllowDebug */
+    1024, /* HeapPageCount */
+    1024, /* StackPageCount */
+    1);   /* TCSCount */
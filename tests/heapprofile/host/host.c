@@ -0,0 +1,92 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#include <openenclave/host.h>
+#include <openenclave/internal/tests.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "heapprofile_u.h"
+
+#define NUM_ALLOCATIONS 100
+#define ALLOCATION_SIZE 1024
+
+/* Return true if the profile has a line that starts with the prefix */
+static bool _has_line(oe_enclave_t* enclave, const char* prefix)
+{
+    char line[4096];
+    bool found = false;
+    FILE* stream;
+
+    OE_TEST((stream = tmpfile()) != NULL);
+    OE_TEST(oe_write_enclave_heap_profile(enclave, stream) == OE_OK);
+    rewind(stream);
+
+    while (!found && fgets(line, sizeof(line), stream))
+        found = strncmp(line, prefix, strlen(prefix)) == 0;
+
+    fclose(stream);
+    return found;
+}
+
+int main(int argc, const char* argv[])
+{
+    oe_result_t result;
+    oe_enclave_t* enclave = NULL;
+    uint64_t ret = 0;
+    FILE* stream;
+
+    if (argc != 2)
+    {
+        fprintf(stderr, "Usage: %s ENCLAVE_PATH\n", argv[0]);
+        return 1;
+    }
+
+    const uint32_t flags = oe_get_create_flags();
+
+    result = oe_create_enclave(
+        argv[1], OE_ENCLAVE_TYPE_SGX, flags, NULL, 0, &enclave);
+    OE_TEST(result == OE_OK);
+
+    /* The host cannot read the profile before the enclave starts it */
+    OE_TEST((stream = tmpfile()) != NULL);
+    result = oe_write_enclave_heap_profile(enclave, stream);
+    OE_TEST(result == OE_NOT_FOUND);
+    fclose(stream);
+
+    /* Sample every allocation */
+    OE_TEST(enc_start_heap_profiler(enclave, &ret, 1) == OE_OK);
+
+    if (ret == OE_UNSUPPORTED)
+    {
+        OE_TEST(oe_terminate_enclave(enclave) == OE_OK);
+        printf("=== skipped (heapprofile): debug allocator\n");
+        return 0;
+    }
+
+    OE_TEST(ret == OE_OK);
+    OE_TEST(_has_line(enclave, "heap profile: "));
+    OE_TEST(_has_line(enclave, "MAPPED_LIBRARIES:"));
+
+    /* Half of the allocations of the call site are live */
+    OE_TEST(
+        enc_allocate(enclave, NUM_ALLOCATIONS, ALLOCATION_SIZE) == OE_OK);
+    OE_TEST(enc_free(enclave, NUM_ALLOCATIONS / 2) == OE_OK);
+    OE_TEST(_has_line(enclave, "50: 51200 [100: 102400] @ 0x"));
+
+    /* Allocations sampled before the profiler stops are still credited when
+     * they are freed */
+    OE_TEST(enc_stop_heap_profiler(enclave) == OE_OK);
+    OE_TEST(enc_free(enclave, NUM_ALLOCATIONS / 2) == OE_OK);
+    OE_TEST(
+        enc_allocate(enclave, NUM_ALLOCATIONS, ALLOCATION_SIZE) == OE_OK);
+    OE_TEST(_has_line(enclave, "0: 0 [100: 102400] @ 0x"));
+
+    OE_TEST(
+        oe_write_enclave_heap_profile(enclave, NULL) == OE_INVALID_PARAMETER);
+    OE_TEST(oe_terminate_enclave(enclave) == OE_OK);
+
+    printf("=== passed all tests (heapprofile)\n");
+
+    return 0;
+}
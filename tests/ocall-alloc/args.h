@@ -9,3 +9,16 @@ typedef struct
 {
     oe_result_t result;
 } TestOcallAllocArgs;
+
+typedef struct
+{
+    // Leave an allocation of the host stack behind on return
+    bool leak;
+    oe_result_t result;
+} TestHostStackArgs;
+
+typedef struct
+{
+    uint64_t value;
+    uint64_t doubled;
+} HostDoubleArgs;
@@ -9,6 +9,7 @@
 #include <openenclave/enclave.h>
 #include <openenclave/internal/hostalloc.h>
 #include <openenclave/internal/print.h>
+#include <openenclave/internal/sgxtypes.h>
 #include <openenclave/internal/tests.h>
 #include <openenclave/internal/trace.h>
 #include <stdint.h>
@@ -278,6 +279,80 @@ OE_ECALL void TestAllocaDealloc(void* args)
     *result = OE_OK;
 }
 
+static bool _on_host_stack(const void* p)
+{
+    const td_t* td = oe_get_td();
+    const uint64_t addr = (uint64_t)p;
+
+    return addr >= td->host_stack_base &&
+           addr < td->host_stack_base + td->host_stack_size;
+}
+
+// The arguments of the OCALL are marshalled from the same allocator
+static void _call_host_double(HostDoubleArgs* args, uint64_t value)
+{
+    args->value = value;
+    args->doubled = 0;
+    OE_TEST(oe_call_host("HostDouble", args) == OE_OK);
+    OE_TEST(args->doubled == 2 * value);
+}
+
+// Test the host stack path of the native functions
+OE_ECALL void TestHostStack(void* args_)
+{
+    TestHostStackArgs* test_args = (TestHostStackArgs*)args_;
+    td_t* td = oe_get_td();
+    HostDoubleArgs* args;
+    HostDoubleArgs* overflow;
+    void* filler;
+    uint64_t used;
+
+    if (!oe_is_outside_enclave(test_args, sizeof(TestHostStackArgs)))
+        return;
+
+    // Each outermost ECALL starts with an empty host stack
+    OE_TEST(td->host_stack_used == 0);
+
+    args = (HostDoubleArgs*)oe_host_alloc_for_call_host(sizeof(*args));
+    OE_TEST(args != NULL);
+    OE_TEST(td->host_stack_size > 0);
+    OE_TEST(_on_host_stack(args));
+
+    // OCALLs allocate above the arguments and release what they allocated
+    used = td->host_stack_used;
+    _call_host_double(args, 1);
+    OE_TEST(td->host_stack_used == used);
+
+    // Exhaust the host stack: allocations fall back to the buckets
+    filler = oe_host_alloc_for_call_host(td->host_stack_size - used);
+    OE_TEST(filler != NULL);
+    OE_TEST(_on_host_stack(filler));
+    OE_TEST(td->host_stack_used == td->host_stack_size);
+
+    overflow = (HostDoubleArgs*)oe_host_alloc_for_call_host(sizeof(*overflow));
+    OE_TEST(overflow != NULL);
+    OE_TEST(!_on_host_stack(overflow));
+
+    _call_host_double(args, 2);
+    _call_host_double(overflow, 3);
+    OE_TEST(td->host_stack_used == td->host_stack_size);
+
+    // Release in reverse order
+    oe_host_free_for_call_host(overflow);
+    oe_host_free_for_call_host(filler);
+    OE_TEST(td->host_stack_used == used);
+
+    _call_host_double(args, 4);
+
+    if (!test_args->leak)
+    {
+        oe_host_free_for_call_host(args);
+        OE_TEST(td->host_stack_used == 0);
+    }
+
+    test_args->result = OE_OK;
+}
+
 OE_SET_ENCLAVE_SGX(
     1,    /* ProductID */
     1,    /* SecurityVersion */
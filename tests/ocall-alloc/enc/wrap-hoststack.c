@@ -10,13 +10,18 @@
    + oe_host_malloc
    + oe_host_free
 
+   The per-TCS host stack is disabled so that all allocations come from the
+   tracked buckets.
+
  */
 
+#define OE_HOST_STACK_BUCKETS_ONLY
+
 #define oe_host_alloc_for_call_host test_host_alloc_for_call_host
 #define oe_host_free_for_call_host test_host_free_for_call_host
 #define oe_host_malloc test_host_malloc
 #define oe_host_free test_host_free
-#define oe_thread_key_create test_thread_key_create
+#define oe_thread_key_create_ex test_thread_key_create_ex
 #define oe_thread_setspecific test_thread_setspecific
 #define oe_free_thread_buckets test_free_thread_buckets
 #define __cxa_atexit test_cxa_atexit
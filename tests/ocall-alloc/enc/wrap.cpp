@@ -48,12 +48,13 @@ void test_host_free(void* ptr)
     oe_host_free(ptr);
 }
 
-oe_result_t test_thread_key_create(
+oe_result_t test_thread_key_create_ex(
     oe_thread_key_t* key,
-    void (*destructor)(void* value))
+    void (*destructor)(void* value),
+    uint32_t flags)
 {
     // Ignore the destrutor.
-    return oe_thread_key_create(key, NULL);
+    return oe_thread_key_create_ex(key, NULL, flags);
 }
 
 void test_free_thread_buckets(void* arg);
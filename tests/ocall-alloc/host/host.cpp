@@ -12,6 +12,13 @@
 
 static oe_enclave_t* enclave;
 
+OE_OCALL void HostDouble(void* args_)
+{
+    HostDoubleArgs* args = (HostDoubleArgs*)args_;
+
+    args->doubled = 2 * args->value;
+}
+
 int main(int argc, const char* argv[])
 {
     oe_result_t result;
@@ -40,6 +47,17 @@ int main(int argc, const char* argv[])
         OE_TEST(res == OE_OK);
     }
 
+    /* Allocations left on the host stack are dropped when the ECALL
+     * returns, so later ECALLs on the same TCS start with an empty stack */
+    for (size_t i = 0; i < 32; i++)
+    {
+        TestHostStackArgs args = {i % 2 == 0, OE_FAILURE};
+
+        result = oe_call_enclave(enclave, "TestHostStack", &args);
+        OE_TEST(result == OE_OK);
+        OE_TEST(args.result == OE_OK);
+    }
+
     oe_terminate_enclave(enclave);
 
     printf("=== passed all tests (%s)\n", argv[0]);
@@ -1,6 +1,8 @@
 // Copyright (c) Microsoft Corporation. All rights reserved.
 // Licensed under the MIT License.
 
+#include <openenclave/enclave.h>
+#include <openenclave/internal/tests.h>
 #include "misc_t.c"
 
 int8_t* get_enclave_mem_ptr()
@@ -13,3 +15,30 @@ void test_invalid_ptr(int8_t* p1, int8_t* p2)
     // This functions is never reached since invalid
     // pointers are passed in.
 }
+
+uint64_t sum_shared_buffer(const uint8_t* buf, size_t size)
+{
+    oe_shared_buffer_view_t view;
+    uint64_t header;
+    uint64_t sum = 0;
+
+    // The generated code only checked the bounds; buf is still host memory.
+    OE_TEST(!oe_is_within_enclave(buf, size));
+    OE_TEST(oe_shared_buffer_view_init(&view, buf, size) == OE_OK);
+
+    // Copy the header in before using it, then stream the rest in place.
+    OE_TEST(
+        oe_shared_buffer_view_read(&view, 0, &header, sizeof(header)) ==
+        OE_OK);
+    OE_TEST(
+        oe_shared_buffer_view_at(&view, sizeof(header), size) == NULL);
+
+    const uint8_t* p = (const uint8_t*)oe_shared_buffer_view_at(
+        &view, sizeof(header), size - sizeof(header));
+    OE_TEST(p != NULL);
+
+    for (size_t i = 0; i < size - sizeof(header); i++)
+        sum += p[i];
+
+    return sum + header;
+}
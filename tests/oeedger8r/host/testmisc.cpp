@@ -4,6 +4,7 @@
 
 #include <openenclave/host.h>
 #include <openenclave/internal/tests.h>
+#include <string.h>
 #include <algorithm>
 #include "misc_u.c"
 
@@ -23,5 +24,41 @@ void run_misc_tests(oe_enclave_t* enclave)
     // Pass invalid second pointer.
     OE_TEST(test_invalid_ptr(enclave, arr, ptr) == OE_INVALID_PARAMETER);
 
+    // Shared buffers are checked against the registered regions.
+    uint8_t shared[64];
+    uint64_t header = 1000;
+    uint64_t sum = 0;
+    memcpy(shared, &header, sizeof(header));
+    for (size_t i = sizeof(header); i < sizeof(shared); i++)
+        shared[i] = (uint8_t)i;
+
+    OE_TEST(
+        sum_shared_buffer(enclave, &sum, shared, sizeof(shared)) ==
+        OE_INVALID_PARAMETER);
+
+    OE_TEST(
+        oe_register_shared_buffer(enclave, shared, sizeof(shared)) == OE_OK);
+    OE_TEST(
+        oe_register_shared_buffer(enclave, shared + 8, 8) ==
+        OE_INVALID_PARAMETER);
+
+    OE_TEST(
+        sum_shared_buffer(enclave, &sum, shared, sizeof(shared)) == OE_OK);
+    OE_TEST(sum == 1000 + (8 + 63) * 56 / 2);
+
+    // A range extending past the registered buffer is rejected.
+    OE_TEST(
+        sum_shared_buffer(enclave, &sum, shared + 8, sizeof(shared)) ==
+        OE_INVALID_PARAMETER);
+
+    OE_TEST(
+        oe_unregister_shared_buffer(enclave, shared, sizeof(shared)) == OE_OK);
+    OE_TEST(
+        oe_unregister_shared_buffer(enclave, shared, sizeof(shared)) ==
+        OE_NOT_FOUND);
+    OE_TEST(
+        sum_shared_buffer(enclave, &sum, shared, sizeof(shared)) ==
+        OE_INVALID_PARAMETER);
+
     printf("=== misc tests passed\n");
 }
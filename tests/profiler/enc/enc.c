@@ -0,0 +1,27 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#include <openenclave/enclave.h>
+#include "profiler_t.h"
+
+static volatile uint64_t _sink;
+
+OE_NEVER_INLINE static void _profiler_busy_loop(uint64_t iterations)
+{
+    for (uint64_t i = 0; i < iterations; i++)
+        _sink += i * i;
+}
+
+uint64_t enc_spin(uint64_t iterations)
+{
+    _profiler_busy_loop(iterations);
+    return _sink;
+}
+
+OE_SET_ENCLAVE_SGX(
+    1,    /* ProductID */
+    1,    /* SecurityVersion */
+    true, /* AllowDebug */
+    1024, /* HeapPageCount */
+    1024, /* StackPageCount */
+    2);   /* TCSCount */
@@ -0,0 +1,102 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#include <openenclave/host.h>
+#include <openenclave/internal/tests.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "profiler_u.h"
+
+#define SPIN_ITERATIONS 100000000
+
+/* Sum the samples of the folded stacks that contain the given function */
+static uint64_t _count_samples(FILE* stream, const char* function)
+{
+    char line[4096];
+    uint64_t count = 0;
+
+    rewind(stream);
+
+    while (fgets(line, sizeof(line), stream))
+    {
+        char* space = strrchr(line, ' ');
+
+        OE_TEST(space != NULL);
+
+        if (strstr(line, function))
+            count += strtoull(space + 1, NULL, 10);
+    }
+
+    return count;
+}
+
+static void _spin(oe_enclave_t* enclave)
+{
+    uint64_t ret = 0;
+
+    OE_TEST(enc_spin(enclave, &ret, SPIN_ITERATIONS) == OE_OK);
+}
+
+int main(int argc, const char* argv[])
+{
+    oe_result_t result;
+    oe_enclave_t* enclave = NULL;
+    FILE* stream;
+    uint64_t samples;
+
+    if (argc != 2)
+    {
+        fprintf(stderr, "Usage: %s ENCLAVE_PATH\n", argv[0]);
+        return 1;
+    }
+
+    const uint32_t flags = oe_get_create_flags();
+
+    result = oe_create_enclave(
+        argv[1], OE_ENCLAVE_TYPE_SGX, flags, NULL, 0, &enclave);
+    OE_TEST(result == OE_OK);
+
+    result = oe_enable_enclave_profiler(enclave, true);
+
+    /* Release enclaves cannot be profiled */
+    if (result == OE_UNSUPPORTED)
+    {
+        OE_TEST(!(flags & (OE_ENCLAVE_FLAG_DEBUG | OE_ENCLAVE_FLAG_SIMULATE)));
+        OE_TEST(oe_terminate_enclave(enclave) == OE_OK);
+        printf("=== skipped (profiler): release enclave\n");
+        return 0;
+    }
+
+    OE_TEST(result == OE_OK);
+    _spin(enclave);
+    OE_TEST(oe_enable_enclave_profiler(enclave, false) == OE_OK);
+
+    /* Most samples are taken in the busy loop */
+    OE_TEST((stream = tmpfile()) != NULL);
+    OE_TEST(oe_write_enclave_profile(enclave, stream) == OE_OK);
+    OE_TEST(_count_samples(stream, ";_profiler_busy_loop ") > 0);
+    samples = _count_samples(stream, "");
+    fclose(stream);
+
+    /* Disabling keeps the samples but stops sampling */
+    _spin(enclave);
+    OE_TEST((stream = tmpfile()) != NULL);
+    OE_TEST(oe_write_enclave_profile(enclave, stream) == OE_OK);
+    OE_TEST(_count_samples(stream, "") == samples);
+    fclose(stream);
+
+    /* Resetting discards the samples */
+    OE_TEST(oe_reset_enclave_profiler(enclave) == OE_OK);
+    OE_TEST((stream = tmpfile()) != NULL);
+    OE_TEST(oe_write_enclave_profile(enclave, stream) == OE_OK);
+    OE_TEST(_count_samples(stream, "") == 0);
+    fclose(stream);
+
+    OE_TEST(oe_write_enclave_profile(enclave, NULL) == OE_INVALID_PARAMETER);
+    OE_TEST(oe_terminate_enclave(enclave) == OE_OK);
+
+    printf("=== passed all tests (profiler)\n");
+
+    return 0;
+}
@@ -33,7 +33,7 @@ static void _check_properties(
     /* Check the SGX config */
     OE_TEST(config->product_id == product_id);
     OE_TEST(config->security_version == security_version);
-    OE_TEST(config->padding == 0);
+    OE_TEST(config->num_host_stack_pages == 0);
     OE_TEST(config->attributes == attributes);
 
     /* Initialize a zero-filled sigstruct */
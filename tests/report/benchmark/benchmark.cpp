@@ -0,0 +1,142 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#include <openenclave/host.h>
+#include <openenclave/internal/tests.h>
+
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <streambuf>
+#include <vector>
+#include "../../../common/tcbinfo.h"
+
+#ifdef OE_USE_LIBSGX
+
+// The parser before the TCB info cache (see tcbinfo_baseline.c).
+extern "C" oe_result_t oe_parse_tcb_info_json_baseline(
+    const uint8_t* tcb_info_json,
+    size_t tcb_info_json_size,
+    oe_tcb_level_t* platform_tcb_level,
+    oe_parsed_tcb_info_t* parsed_info);
+
+typedef oe_result_t (*parse_function_t)(
+    const std::vector<uint8_t>& tcbInfo,
+    oe_parsed_tcb_info_t* parsed_info);
+
+static const size_t ITERATIONS = 100000;
+
+static std::vector<uint8_t> FileToBytes(const char* path)
+{
+    std::ifstream f(path, std::ios::binary);
+    std::vector<uint8_t> bytes = std::vector<uint8_t>(
+        std::istreambuf_iterator<char>(f), std::istreambuf_iterator<char>());
+
+    if (bytes.empty())
+    {
+        printf("File %s not found\n", path);
+        exit(1);
+    }
+
+    bytes.push_back('\0');
+    return bytes;
+}
+
+static void InitPlatformTCBLevel(oe_tcb_level_t* platform_tcb_level)
+{
+    const oe_tcb_level_t level = {
+        {4, 4, 2, 4, 1, 128, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1},
+        8,
+        OE_TCB_LEVEL_STATUS_UNKNOWN};
+
+    *platform_tcb_level = level;
+}
+
+static oe_result_t ParseBaseline(
+    const std::vector<uint8_t>& tcbInfo,
+    oe_parsed_tcb_info_t* parsed_info)
+{
+    oe_tcb_level_t platform_tcb_level;
+
+    InitPlatformTCBLevel(&platform_tcb_level);
+    return oe_parse_tcb_info_json_baseline(
+        &tcbInfo[0], tcbInfo.size(), &platform_tcb_level, parsed_info);
+}
+
+static oe_result_t Parse(
+    const std::vector<uint8_t>& tcbInfo,
+    oe_parsed_tcb_info_t* parsed_info)
+{
+    oe_tcb_level_t platform_tcb_level;
+
+    InitPlatformTCBLevel(&platform_tcb_level);
+    return oe_parse_tcb_info_json(
+        &tcbInfo[0], tcbInfo.size(), &platform_tcb_level, parsed_info);
+}
+
+// Verify a tcb info that is cached (the chain is not used then).
+static oe_result_t VerifyCached(
+    const std::vector<uint8_t>& tcbInfo,
+    oe_parsed_tcb_info_t* parsed_info)
+{
+    oe_tcb_level_t platform_tcb_level;
+    oe_cert_chain_t tcb_cert_chain;
+
+    memset(&tcb_cert_chain, 0, sizeof(tcb_cert_chain));
+    InitPlatformTCBLevel(&platform_tcb_level);
+    return oe_verify_tcb_info_json(
+        &tcbInfo[0],
+        tcbInfo.size(),
+        &tcb_cert_chain,
+        &platform_tcb_level,
+        parsed_info);
+}
+
+static void Run(
+    const char* name,
+    parse_function_t parse,
+    const std::vector<uint8_t>& tcbInfo)
+{
+    static oe_parsed_tcb_info_t parsed_info;
+    clock_t start = clock();
+
+    for (size_t i = 0; i < ITERATIONS; ++i)
+        OE_TEST(parse(tcbInfo, &parsed_info) == OE_OK);
+
+    double us = (double)(clock() - start) * 1000000 / CLOCKS_PER_SEC;
+    printf("%-24s %8.3f us\n", name, us / ITERATIONS);
+}
+
+// Compare the parse of a tcb info by the baseline and the current parsers,
+// and its verification when it is cached. This is not run by ctest.
+int main(int argc, const char* argv[])
+{
+    const char* path = argc > 1 ? argv[1] : "./data/tcbInfo.json";
+    std::vector<uint8_t> tcbInfo = FileToBytes(path);
+    static oe_parsed_tcb_info_t parsed_info;
+
+    OE_TEST(Parse(tcbInfo, &parsed_info) == OE_OK);
+    oe_cache_tcb_info_json(&tcbInfo[0], tcbInfo.size(), &parsed_info);
+
+    printf(
+        "%s (%zu bytes, %d iterations)\n",
+        path,
+        tcbInfo.size(),
+        (int)ITERATIONS);
+    Run("baseline parse", ParseBaseline, tcbInfo);
+    Run("parse", Parse, tcbInfo);
+    Run("cached verification", VerifyCached, tcbInfo);
+
+    return 0;
+}
+
+#else
+
+int main()
+{
+    printf("The tcb info benchmark requires OE_USE_LIBSGX\n");
+    return 0;
+}
+
+#endif
@@ -0,0 +1,207 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+#ifdef OE_USE_LIBSGX
+
+#include <openenclave/host.h>
+#include <openenclave/internal/cert.h>
+#include <openenclave/internal/tests.h>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+#include "../../../common/certcache.h"
+#include "../../../common/quote.h"
+
+extern std::vector<uint8_t> FileToBytes(const char* path);
+
+// Both chains share their certificates if they come from the same cache
+// entry: the host implementation hands out the same X509 objects.
+static bool SameCerts(
+    const oe_cert_chain_t* chain1,
+    const oe_cert_chain_t* chain2)
+{
+    oe_cert_t cert1;
+    oe_cert_t cert2;
+    bool same;
+
+    OE_TEST(oe_cert_chain_get_cert(chain1, 0, &cert1) == OE_OK);
+    OE_TEST(oe_cert_chain_get_cert(chain2, 0, &cert2) == OE_OK);
+    same = memcmp(&cert1, &cert2, sizeof(cert1)) == 0;
+    oe_cert_free(&cert1);
+    oe_cert_free(&cert2);
+
+    return same;
+}
+
+static std::string ToString(const std::vector<uint8_t>& pem)
+{
+    // Drop the zero-terminator added by FileToBytes().
+    return std::string(pem.begin(), pem.end() - 1);
+}
+
+static oe_result_t ReadChain(const std::string& pem, oe_cert_chain_t* chain)
+{
+    return oe_cert_cache_read_chain(pem.c_str(), pem.size() + 1, chain);
+}
+
+static void TestCertCacheHit(const std::string& issuers)
+{
+    oe_cert_chain_t chain1;
+    oe_cert_chain_t chain2;
+    oe_cert_chain_t uncached;
+    size_t length = 0;
+
+    OE_TEST(ReadChain(issuers, &chain1) == OE_OK);
+    OE_TEST(ReadChain(issuers, &chain2) == OE_OK);
+    OE_TEST(
+        oe_cert_chain_read_pem(
+            &uncached, issuers.c_str(), issuers.size() + 1) == OE_OK);
+
+    OE_TEST(oe_cert_chain_get_length(&chain2, &length) == OE_OK);
+    OE_TEST(length == 2);
+    OE_TEST(SameCerts(&chain1, &chain2));
+    OE_TEST(!SameCerts(&chain1, &uncached));
+
+    oe_cert_chain_free(&uncached);
+    oe_cert_chain_free(&chain2);
+    oe_cert_chain_free(&chain1);
+
+    printf("TestCertCache: Hit test passed\n");
+}
+
+// A chain stays valid when its cache entry is evicted.
+static void TestCertCacheEviction(const std::string& issuers)
+{
+    oe_cert_chain_t held;
+    oe_cert_chain_t chain;
+    oe_cert_t root;
+    oe_ec_public_key_t key;
+
+    OE_TEST(ReadChain(issuers, &held) == OE_OK);
+
+    // The same chain followed by white space has another PEM text, and
+    // therefore another entry.
+    for (size_t i = 1; i <= OE_CERT_CACHE_MAX_CHAINS; i++)
+    {
+        OE_TEST(ReadChain(issuers + std::string(i, '\n'), &chain) == OE_OK);
+        oe_cert_chain_free(&chain);
+    }
+
+    // The held chain was evicted: reading it again makes new certificates.
+    OE_TEST(ReadChain(issuers, &chain) == OE_OK);
+    OE_TEST(!SameCerts(&held, &chain));
+    oe_cert_chain_free(&chain);
+
+    OE_TEST(oe_cert_chain_get_root_cert(&held, &root) == OE_OK);
+    OE_TEST(oe_cert_get_ec_public_key(&root, &key) == OE_OK);
+    oe_ec_public_key_free(&key);
+    oe_cert_free(&root);
+    OE_TEST(oe_cert_chain_free(&held) == OE_OK);
+
+    printf("TestCertCache: Eviction test passed\n");
+}
+
+static void TestCertCacheTampered(const std::string& issuers)
+{
+    oe_cert_chain_t chain;
+    std::string tampered = issuers;
+
+    // Change the signature of the processor CA, which still parses.
+    size_t pos = tampered.find("QkgfZl8ElCe");
+    OE_TEST(pos != std::string::npos);
+    tampered[pos + 6] = '9';
+
+    OE_TEST(ReadChain(issuers, &chain) == OE_OK);
+    oe_cert_chain_free(&chain);
+
+    OE_TEST(ReadChain(tampered, &chain) != OE_OK);
+
+    printf("TestCertCache: Tampered chain test passed\n");
+}
+
+static oe_result_t ReadLeafCert(const std::string& pem, std::string* issuers)
+{
+    oe_result_t result;
+    oe_cert_t leaf;
+    const uint8_t* issuer_pem = NULL;
+    size_t issuer_pem_size = 0;
+
+    result = oe_read_leaf_cert(
+        (const uint8_t*)pem.c_str(),
+        pem.size() + 1,
+        &leaf,
+        &issuer_pem,
+        &issuer_pem_size);
+
+    if (result == OE_OK)
+    {
+        issuers->assign((const char*)issuer_pem, issuer_pem_size - 1);
+        oe_cert_free(&leaf);
+    }
+
+    return result;
+}
+
+static void TestReadLeafCert(
+    const std::string& leaf,
+    const std::string& issuers)
+{
+    const std::string end = "-----END CERTIFICATE-----";
+    std::string leaf_only = leaf.substr(0, leaf.find(end) + end.size());
+    std::string read;
+
+    OE_TEST(ReadLeafCert(leaf + issuers, &read) == OE_OK);
+    OE_TEST(read == issuers);
+
+    // Any white space between the leaf and its issuers is skipped.
+    OE_TEST(ReadLeafCert(leaf_only + " \t\r\n\r\n" + issuers, &read) == OE_OK);
+    OE_TEST(read == issuers);
+    OE_TEST(ReadLeafCert(leaf_only + issuers, &read) == OE_OK);
+    OE_TEST(read == issuers);
+
+    // No issuers.
+    OE_TEST(ReadLeafCert(leaf, &read) == OE_INVALID_PARAMETER);
+    OE_TEST(ReadLeafCert(leaf + "\n \n", &read) == OE_INVALID_PARAMETER);
+
+    // No end of the leaf.
+    OE_TEST(
+        ReadLeafCert(leaf.substr(0, leaf.find(end)), &read) ==
+        OE_INVALID_PARAMETER);
+    OE_TEST(ReadLeafCert("", &read) == OE_INVALID_PARAMETER);
+
+    // A malformed leaf.
+    std::string malformed = leaf;
+    malformed.replace(malformed.find('\n') + 1, 4, "!!!!");
+    OE_TEST(ReadLeafCert(malformed + issuers, &read) != OE_OK);
+
+    // Not zero-terminated.
+    {
+        std::string pem = leaf + issuers;
+        oe_cert_t cert;
+        const uint8_t* issuer_pem = NULL;
+        size_t issuer_pem_size = 0;
+
+        OE_TEST(
+            oe_read_leaf_cert(
+                (const uint8_t*)pem.c_str(),
+                pem.size(),
+                &cert,
+                &issuer_pem,
+                &issuer_pem_size) == OE_INVALID_PARAMETER);
+    }
+
+    printf("TestCertCache: Leaf certificate tests passed\n");
+}
+
+void TestCertCache()
+{
+    std::string leaf = ToString(FileToBytes("./data/pckCert.pem"));
+    std::string issuers = ToString(FileToBytes("./data/pckIssuerChain.pem"));
+
+    TestCertCacheHit(issuers);
+    TestCertCacheEviction(issuers);
+    TestCertCacheTampered(issuers);
+    TestReadLeafCert(leaf, issuers);
+}
+
+#endif
@@ -0,0 +1,203 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+#ifdef OE_USE_LIBSGX
+
+#include <openenclave/host.h>
+#include <openenclave/internal/report.h>
+#include <openenclave/internal/tests.h>
+#include <sys/stat.h>
+#include <cstdio>
+#include <cstring>
+#include "../../../host/collateralstore.h"
+#include "../../../host/sgxquoteprovider.h"
+
+#define COLLATERAL_DIR "./data/collateral"
+
+static void WriteFile(const char* name, const char* contents)
+{
+    char path[256];
+    snprintf(path, sizeof(path), "%s/%s", COLLATERAL_DIR, name);
+
+    FILE* file = fopen(path, "wb");
+    OE_TEST(file != NULL);
+    fputs(contents, file);
+    fclose(file);
+}
+
+static void RemoveFile(const char* name)
+{
+    char path[256];
+    snprintf(path, sizeof(path), "%s/%s", COLLATERAL_DIR, name);
+
+    OE_TEST(remove(path) == 0);
+}
+
+static oe_result_t TryGetRevocationInfo(
+    uint8_t fmspc0,
+    oe_get_revocation_info_args_t* args)
+{
+    memset(args, 0, sizeof(*args));
+    args->fmspc[0] = fmspc0;
+    args->crl_urls[0] = "https://localhost/leaf.crl";
+    args->crl_urls[1] = "https://localhost/intermediate.crl";
+    args->num_crl_urls = 2;
+
+    return oe_get_revocation_info(args);
+}
+
+static void GetRevocationInfo(
+    uint8_t fmspc0,
+    oe_get_revocation_info_args_t* args)
+{
+    OE_TEST(TryGetRevocationInfo(fmspc0, args) == OE_OK);
+}
+
+static void AssertString(
+    const uint8_t* data,
+    size_t size,
+    const char* expected,
+    bool zero_terminated)
+{
+    size_t length = strlen(expected);
+
+    OE_TEST(size == length + (zero_terminated ? 1 : 0));
+    OE_TEST(memcmp(data, expected, length) == 0);
+}
+
+static void AssertTcbIssuerChain(uint8_t fmspc0, const char* expected)
+{
+    oe_get_revocation_info_args_t args;
+
+    GetRevocationInfo(fmspc0, &args);
+    AssertString(
+        args.tcb_issuer_chain, args.tcb_issuer_chain_size, expected, true);
+    oe_cleanup_get_revocation_info_args(&args);
+}
+
+// Stored collateral is replaced when it is refreshed, and is still served
+// if the refresh fails before its next update.
+static void TestCollateralRefresh()
+{
+    oe_get_revocation_info_args_t args;
+
+    WriteFile(
+        "tcb_info.json",
+        "{\"tcbInfo\":{\"nextUpdate\":\"2099-01-01T00:00:00Z\"}}");
+    WriteFile("tcb_issuer_chain.pem", "tcb issuer chain 1");
+    AssertTcbIssuerChain(3, "tcb issuer chain 1");
+
+    // The refresh fetches the new files.
+    WriteFile("tcb_issuer_chain.pem", "tcb issuer chain 2");
+    oe_collateral_store_refresh();
+    AssertTcbIssuerChain(3, "tcb issuer chain 2");
+
+    // The refresh fails, so the stored collateral is served.
+    RemoveFile("tcb_issuer_chain.pem");
+    oe_collateral_store_refresh();
+    AssertTcbIssuerChain(3, "tcb issuer chain 2");
+
+    // But a platform that is not stored yet fails.
+    OE_TEST(TryGetRevocationInfo(4, &args) != OE_OK);
+
+    WriteFile("tcb_issuer_chain.pem", "tcb issuer chain 3");
+    oe_collateral_store_refresh();
+    AssertTcbIssuerChain(3, "tcb issuer chain 3");
+
+    printf("TestCollateralRefresh: Positive Test passed\n");
+}
+
+// Collateral past its next update is never served: it is fetched again, and
+// the request fails if that fails.
+static void TestCollateralExpiry()
+{
+    oe_get_revocation_info_args_t args;
+
+    WriteFile(
+        "tcb_info.json",
+        "{\"tcbInfo\":{\"nextUpdate\":\"2000-01-01T00:00:00Z\"}}");
+    WriteFile("tcb_issuer_chain.pem", "expired tcb issuer chain 1");
+    AssertTcbIssuerChain(5, "expired tcb issuer chain 1");
+
+    WriteFile("tcb_issuer_chain.pem", "expired tcb issuer chain 2");
+    AssertTcbIssuerChain(5, "expired tcb issuer chain 2");
+
+    RemoveFile("tcb_issuer_chain.pem");
+    OE_TEST(TryGetRevocationInfo(5, &args) != OE_OK);
+
+    // The refresh fails too, which drops the collateral.
+    oe_collateral_store_refresh();
+    OE_TEST(TryGetRevocationInfo(5, &args) != OE_OK);
+
+    WriteFile("tcb_issuer_chain.pem", "expired tcb issuer chain 3");
+    AssertTcbIssuerChain(5, "expired tcb issuer chain 3");
+
+    printf("TestCollateralExpiry: Positive Test passed\n");
+}
+
+// Revocation info is served from the collateral store once it was fetched
+// from the (local) quote provider. Must run last, since it replaces the
+// quote provider of the process.
+void TestCollateralStore()
+{
+    const char* tcb_info =
+        "{\"tcbInfo\":{\"nextUpdate\":\"2099-01-01T00:00:00Z\"}}";
+    oe_get_revocation_info_args_t args;
+
+    mkdir(COLLATERAL_DIR, 0755);
+    WriteFile("tcb_info.json", tcb_info);
+    WriteFile("tcb_issuer_chain.pem", "tcb issuer chain");
+    WriteFile("crl0.der", "leaf crl");
+    WriteFile("crl_issuer_chain0.pem", "leaf crl issuer chain");
+    WriteFile("crl1.der", "intermediate crl");
+    WriteFile("crl_issuer_chain1.pem", "intermediate crl issuer chain");
+
+    OE_TEST(oe_use_local_quote_provider(COLLATERAL_DIR) == OE_OK);
+
+    GetRevocationInfo(1, &args);
+    AssertString(args.tcb_info, args.tcb_info_size, tcb_info, true);
+    AssertString(
+        args.tcb_issuer_chain,
+        args.tcb_issuer_chain_size,
+        "tcb issuer chain",
+        true);
+    AssertString(args.crl[0], args.crl_size[0], "leaf crl", false);
+    AssertString(
+        args.crl_issuer_chain[0],
+        args.crl_issuer_chain_size[0],
+        "leaf crl issuer chain",
+        true);
+    AssertString(args.crl[1], args.crl_size[1], "intermediate crl", false);
+    AssertString(
+        args.crl_issuer_chain[1],
+        args.crl_issuer_chain_size[1],
+        "intermediate crl issuer chain",
+        true);
+    oe_cleanup_get_revocation_info_args(&args);
+
+    // The same platform is served from the store, not from the files.
+    WriteFile("tcb_issuer_chain.pem", "new tcb issuer chain");
+
+    GetRevocationInfo(1, &args);
+    AssertString(
+        args.tcb_issuer_chain,
+        args.tcb_issuer_chain_size,
+        "tcb issuer chain",
+        true);
+    oe_cleanup_get_revocation_info_args(&args);
+
+    // Another platform is fetched from the provider.
+    GetRevocationInfo(2, &args);
+    AssertString(
+        args.tcb_issuer_chain,
+        args.tcb_issuer_chain_size,
+        "new tcb issuer chain",
+        true);
+    oe_cleanup_get_revocation_info_args(&args);
+
+    printf("TestCollateralStore: Positive Test passed\n");
+
+    TestCollateralRefresh();
+    TestCollateralExpiry();
+}
+
+#endif
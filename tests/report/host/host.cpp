@@ -17,6 +17,8 @@
 #define SKIP_RETURN_CODE 2
 
 extern void TestVerifyTCBInfo(oe_enclave_t* enclave);
+extern void TestCertCache();
+extern void TestCollateralStore();
 extern std::vector<uint8_t> FileToBytes(const char* path);
 
 void generate_and_save_report(oe_enclave_t* enclave)
@@ -133,6 +135,8 @@ int main(int argc, const char* argv[])
 
     TestVerifyTCBInfo(enclave);
 
+    TestCertCache();
+
     // Get current time and pass it to enclave.
     std::time_t t = std::time(0);
     std::tm* tm = std::gmtime(&t);
@@ -147,6 +151,8 @@ int main(int argc, const char* argv[])
     test_minimum_issue_date(enclave, now);
 
     generate_and_save_report(enclave);
+
+    TestCollateralStore();
 #endif
 
     /* Terminate the enclave */
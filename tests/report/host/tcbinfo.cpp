@@ -12,6 +12,7 @@
 
 #include <fstream>
 #include <streambuf>
+#include <string>
 #include <vector>
 #include "../../../common/tcbinfo.h"
 #include "../../../host/quote.h"
@@ -106,6 +107,215 @@ void TestVerifyTCBInfo(
     OE_TEST(oe_datetime_compare(&parsed_info.next_update, &nextUpdate) == 0);
 }
 
+static oe_result_t ParseTCBInfo(const std::vector<uint8_t>& tcbInfo)
+{
+    oe_tcb_level_t platform_tcb_level = {
+        {4, 4, 2, 4, 1, 128, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1},
+        8,
+        OE_TCB_LEVEL_STATUS_UNKNOWN};
+    static oe_parsed_tcb_info_t parsed_info;
+
+    memset(&parsed_info, 0, sizeof(parsed_info));
+    return oe_parse_tcb_info_json(
+        &tcbInfo[0], tcbInfo.size(), &platform_tcb_level, &parsed_info);
+}
+
+// Parse truncated and corrupted copies of a valid tcb info on the host, which
+// shares the parser with the enclave. The parser must reject them without
+// reading out of bounds (run under valgrind or ASAN to check the latter).
+static void TestMutatedTCBInfo()
+{
+    std::vector<uint8_t> tcbInfo = FileToBytes("./data/tcbInfo.json");
+    const uint8_t replacements[] = {'"', '\\', '{', '}', ',', ' ', 'x'};
+
+    size_t end = tcbInfo.size();
+
+    OE_TEST(ParseTCBInfo(tcbInfo) == OE_OK);
+
+    // Find the closing brace of the json.
+    while (end > 0 && tcbInfo[end - 1] != '}')
+        --end;
+
+    for (size_t size = 1; size < end; ++size)
+    {
+        std::vector<uint8_t> truncated(
+            tcbInfo.begin(), tcbInfo.begin() + size);
+        OE_TEST(ParseTCBInfo(truncated) == OE_TCB_INFO_PARSE_ERROR);
+    }
+
+    for (size_t i = 0; i < tcbInfo.size() - 1; ++i)
+    {
+        for (size_t j = 0; j < OE_COUNTOF(replacements); ++j)
+        {
+            std::vector<uint8_t> corrupted = tcbInfo;
+            corrupted[i] = replacements[j];
+
+            oe_result_t r = ParseTCBInfo(corrupted);
+            OE_TEST(
+                r == OE_OK || r == OE_TCB_INFO_PARSE_ERROR ||
+                r == OE_TCB_LEVEL_INVALID);
+        }
+    }
+
+    printf("TestVerifyTCBInfo: Mutation tests passed\n");
+}
+
+// Replace the first occurrence of a string in a tcb info.
+static std::vector<uint8_t> Replace(
+    const std::vector<uint8_t>& tcbInfo,
+    const std::string& from,
+    const std::string& to)
+{
+    std::string text(tcbInfo.begin(), tcbInfo.end());
+    size_t pos = text.find(from);
+
+    OE_TEST(pos != std::string::npos);
+    text.replace(pos, from.size(), to);
+
+    return std::vector<uint8_t>(text.begin(), text.end());
+}
+
+// Copy a tcb info with the first of its tcb levels repeated.
+static std::vector<uint8_t> RepeatFirstTCBLevel(
+    const std::vector<uint8_t>& tcbInfo,
+    size_t copies)
+{
+    std::string text(tcbInfo.begin(), tcbInfo.end());
+    size_t begin = text.find('{', text.find("\"tcbLevels\""));
+    size_t end = text.find('}', text.find("\"status\"", begin)) + 1;
+    std::string level = text.substr(begin, end - begin);
+
+    for (size_t i = 0; i < copies; ++i)
+        text.insert(end, ",\n" + level);
+
+    return std::vector<uint8_t>(text.begin(), text.end());
+}
+
+static oe_result_t VerifyTCBInfo(
+    const std::vector<uint8_t>& tcbInfo,
+    oe_parsed_tcb_info_t* parsed_info)
+{
+    oe_tcb_level_t platform_tcb_level = {
+        {4, 4, 2, 4, 1, 128, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1},
+        8,
+        OE_TCB_LEVEL_STATUS_UNKNOWN};
+
+    // An invalid chain: only cached tcb infos verify.
+    oe_cert_chain_t tcb_cert_chain = {0};
+
+    memset(parsed_info, 0, sizeof(*parsed_info));
+    return oe_verify_tcb_info_json(
+        &tcbInfo[0],
+        tcbInfo.size(),
+        &tcb_cert_chain,
+        &platform_tcb_level,
+        parsed_info);
+}
+
+static void CacheTCBInfo(const std::vector<uint8_t>& tcbInfo)
+{
+    oe_tcb_level_t platform_tcb_level = {
+        {4, 4, 2, 4, 1, 128, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1},
+        8,
+        OE_TCB_LEVEL_STATUS_UNKNOWN};
+    static oe_parsed_tcb_info_t parsed_info;
+
+    OE_TEST(
+        oe_parse_tcb_info_json(
+            &tcbInfo[0],
+            tcbInfo.size(),
+            &platform_tcb_level,
+            &parsed_info) == OE_OK);
+    oe_cache_tcb_info_json(&tcbInfo[0], tcbInfo.size(), &parsed_info);
+}
+
+// The number of tcb levels of a tcb info is not bounded: the parse determines
+// the status of the platform as it reads them.
+static void TestTCBInfoManyLevels()
+{
+    std::vector<uint8_t> tcbInfo = FileToBytes("./data/tcbInfo.json");
+    static oe_parsed_tcb_info_t parsed_info;
+
+    // ./data/tcbInfo.json contains 4 tcb levels.
+    std::vector<uint8_t> many = RepeatFirstTCBLevel(tcbInfo, 1000);
+
+    OE_TEST(ParseTCBInfo(many) == OE_OK);
+
+    // The cached copy keeps all the levels, down to the last (revoked) one.
+    oe_clear_tcb_info_cache();
+    CacheTCBInfo(many);
+    OE_TEST(VerifyTCBInfo(many, &parsed_info) == OE_OK);
+    OE_TEST(parsed_info.num_tcb_levels == 1004);
+
+    oe_tcb_level_t platform_tcb_level = {
+        {4, 4, 2, 4, 1, 128, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1},
+        2,
+        OE_TCB_LEVEL_STATUS_UNKNOWN};
+    oe_cert_chain_t tcb_cert_chain = {0};
+
+    OE_TEST(
+        oe_verify_tcb_info_json(
+            &many[0],
+            many.size(),
+            &tcb_cert_chain,
+            &platform_tcb_level,
+            &parsed_info) == OE_TCB_LEVEL_INVALID);
+    OE_TEST(platform_tcb_level.status == OE_TCB_LEVEL_STATUS_REVOKED);
+
+    oe_clear_tcb_info_cache();
+
+    printf("TestVerifyTCBInfo: Many levels test passed\n");
+}
+
+// oe_verify_tcb_info_json skips the signature verification of a tcb info
+// identical to a cached one. Since the test has no tcb signing chain, a tcb
+// info verifies if and only if it is served from the cache.
+static void TestTCBInfoCache()
+{
+    static oe_parsed_tcb_info_t parsed_info;
+    std::vector<uint8_t> tcbInfo = FileToBytes("./data/tcbInfo.json");
+
+    // Same FMSPC as ./data/tcbInfo.json, with a nextUpdate field.
+    std::vector<uint8_t> tcbInfo1 = FileToBytes("./data/tcbInfo1.json");
+    std::vector<uint8_t> otherFmspc =
+        Replace(tcbInfo, "00906EA10000", "00906EA10001");
+    std::vector<uint8_t> changed = Replace(tcbInfo, "UpToDate", "Revoked");
+
+    oe_clear_tcb_info_cache();
+
+    // Miss.
+    OE_TEST(VerifyTCBInfo(tcbInfo, &parsed_info) != OE_OK);
+
+    // Hit, with the parsed info pointing into the given json.
+    CacheTCBInfo(tcbInfo);
+    OE_TEST(VerifyTCBInfo(tcbInfo, &parsed_info) == OE_OK);
+    AssertParsedValues(parsed_info);
+    OE_TEST(parsed_info.num_tcb_levels == 4);
+    OE_TEST(
+        parsed_info.tcb_info_start > &tcbInfo[0] &&
+        parsed_info.tcb_info_start < &tcbInfo[0] + tcbInfo.size());
+
+    // A changed json of the same FMSPC and a json of another FMSPC miss.
+    OE_TEST(VerifyTCBInfo(changed, &parsed_info) != OE_OK);
+    OE_TEST(VerifyTCBInfo(tcbInfo1, &parsed_info) != OE_OK);
+    OE_TEST(VerifyTCBInfo(otherFmspc, &parsed_info) != OE_OK);
+
+    // A new json of the same FMSPC replaces the cached one.
+    CacheTCBInfo(tcbInfo1);
+    OE_TEST(VerifyTCBInfo(tcbInfo1, &parsed_info) == OE_OK);
+    OE_TEST(VerifyTCBInfo(tcbInfo, &parsed_info) != OE_OK);
+
+    // A json of another FMSPC is cached alongside.
+    CacheTCBInfo(otherFmspc);
+    OE_TEST(VerifyTCBInfo(otherFmspc, &parsed_info) == OE_OK);
+    OE_TEST(VerifyTCBInfo(tcbInfo1, &parsed_info) == OE_OK);
+
+    oe_clear_tcb_info_cache();
+    OE_TEST(VerifyTCBInfo(tcbInfo1, &parsed_info) != OE_OK);
+
+    printf("TestVerifyTCBInfo: Cache tests passed\n");
+}
+
 void TestVerifyTCBInfo(oe_enclave_t* enclave)
 {
     oe_tcb_level_t platform_tcb_level = {
@@ -222,6 +432,10 @@ void TestVerifyTCBInfo(oe_enclave_t* enclave)
         printf(
             "TestVerifyTCBInfo: Negative Test %s passed\n", negative_files[i]);
     }
+
+    TestMutatedTCBInfo();
+    TestTCBInfoCache();
+    TestTCBInfoManyLevels();
 }
 
 #endif
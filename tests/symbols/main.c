@@ -0,0 +1,257 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#include <openenclave/internal/elf.h>
+#include <openenclave/internal/tests.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+#include "../../host/symbols.h"
+
+#define MAX_SYMBOLS 32
+
+/* An ELF image with just the sections read by oe_symbols_build() */
+typedef struct _image
+{
+    elf64_ehdr_t ehdr;
+    elf64_shdr_t shdrs[4];
+    elf64_sym_t symtab[MAX_SYMBOLS];
+    char shstrtab[32];
+    char strtab[1024];
+    size_t num_syms;
+    size_t strtab_size;
+} image_t;
+
+static const char _shstrtab[] = "\0.shstrtab\0.strtab\0.symtab";
+
+static void _init_image(image_t* image)
+{
+    elf64_ehdr_t* ehdr = &image->ehdr;
+
+    memset(image, 0, sizeof(image_t));
+
+    ehdr->e_ident[EI_MAG0] = ELFMAG0;
+    ehdr->e_ident[EI_MAG1] = ELFMAG1;
+    ehdr->e_ident[EI_MAG2] = ELFMAG2;
+    ehdr->e_ident[EI_MAG3] = ELFMAG3;
+    ehdr->e_ident[EI_CLASS] = ELFCLASS64;
+    ehdr->e_ident[EI_DATA] = ELFDATA2LSB;
+    ehdr->e_ident[EI_VERSION] = EV_CURRENT;
+    ehdr->e_type = ET_DYN;
+    ehdr->e_machine = EM_X86_64;
+    ehdr->e_version = EV_CURRENT;
+    ehdr->e_ehsize = sizeof(elf64_ehdr_t);
+    ehdr->e_phentsize = sizeof(elf64_phdr_t);
+    ehdr->e_shentsize = sizeof(elf64_shdr_t);
+    ehdr->e_shoff = offsetof(image_t, shdrs);
+    ehdr->e_shnum = OE_COUNTOF(image->shdrs);
+    ehdr->e_shstrndx = 1;
+
+    memcpy(image->shstrtab, _shstrtab, sizeof(_shstrtab));
+    image->shdrs[1].sh_name = 1;
+    image->shdrs[1].sh_type = SHT_STRTAB;
+    image->shdrs[1].sh_offset = offsetof(image_t, shstrtab);
+    image->shdrs[1].sh_size = sizeof(_shstrtab);
+
+    /* The first symbol and the first string are empty */
+    image->num_syms = 1;
+    image->strtab_size = 1;
+}
+
+static void _add_symbol(
+    image_t* image,
+    const char* name,
+    unsigned char type,
+    uint64_t start,
+    uint64_t size)
+{
+    elf64_sym_t* sym = &image->symtab[image->num_syms++];
+    size_t name_size = strlen(name) + 1;
+
+    OE_TEST(image->num_syms <= MAX_SYMBOLS);
+    OE_TEST(image->strtab_size + name_size <= sizeof(image->strtab));
+
+    sym->st_name = (elf64_word_t)image->strtab_size;
+    sym->st_info = type;
+    sym->st_value = start;
+    sym->st_size = size;
+
+    memcpy(image->strtab + image->strtab_size, name, name_size);
+    image->strtab_size += name_size;
+}
+
+static void _build_index(oe_enclave_t* enclave, image_t* image)
+{
+    elf64_t elf = {ELF_MAGIC, image, sizeof(image_t)};
+
+    image->shdrs[2].sh_name = sizeof("\0.shstrtab");
+    image->shdrs[2].sh_type = SHT_STRTAB;
+    image->shdrs[2].sh_offset = offsetof(image_t, strtab);
+    image->shdrs[2].sh_size = image->strtab_size;
+
+    image->shdrs[3].sh_name = sizeof("\0.shstrtab\0.strtab");
+    image->shdrs[3].sh_type = SHT_SYMTAB;
+    image->shdrs[3].sh_offset = offsetof(image_t, symtab);
+    image->shdrs[3].sh_size = image->num_syms * sizeof(elf64_sym_t);
+    image->shdrs[3].sh_entsize = sizeof(elf64_sym_t);
+    image->shdrs[3].sh_link = 2;
+
+    OE_TEST(oe_symbols_build(enclave, &elf) == OE_OK);
+}
+
+static bool _resolves_to(
+    const oe_enclave_t* enclave,
+    uint64_t vaddr,
+    const char* name)
+{
+    const char* found = oe_symbols_find_function(enclave, vaddr);
+
+    if (!name || !found)
+        return name == found;
+
+    return strcmp(name, found) == 0;
+}
+
+/* A function includes its end address, unless the next function starts
+ * there */
+static void TestEndOfSymbol(void)
+{
+    static oe_enclave_t enclave;
+    static image_t image;
+
+    _init_image(&image);
+    _add_symbol(&image, "first", STT_FUNC, 0x1000, 0x100);
+    _add_symbol(&image, "second", STT_FUNC, 0x1100, 0x80);
+    _add_symbol(&image, "third", STT_FUNC, 0x1200, 0x10);
+    _build_index(&enclave, &image);
+
+    OE_TEST(_resolves_to(&enclave, 0, NULL));
+    OE_TEST(_resolves_to(&enclave, 0xfff, NULL));
+    OE_TEST(_resolves_to(&enclave, 0x1000, "first"));
+    OE_TEST(_resolves_to(&enclave, 0x10ff, "first"));
+    OE_TEST(_resolves_to(&enclave, 0x1100, "second"));
+    OE_TEST(_resolves_to(&enclave, 0x1180, "second"));
+    OE_TEST(_resolves_to(&enclave, 0x1181, NULL));
+    OE_TEST(_resolves_to(&enclave, 0x11ff, NULL));
+    OE_TEST(_resolves_to(&enclave, 0x1200, "third"));
+    OE_TEST(_resolves_to(&enclave, 0x1210, "third"));
+    OE_TEST(_resolves_to(&enclave, 0x1211, NULL));
+    OE_TEST(_resolves_to(&enclave, OE_UINT64_MAX, NULL));
+
+    oe_symbols_free(&enclave);
+
+    printf("TestEndOfSymbol: passed\n");
+}
+
+/* The innermost function that contains an address is found, even if other
+ * functions lie between its start and the address */
+static void TestNestedSymbols(void)
+{
+    static oe_enclave_t enclave;
+    static image_t image;
+
+    _init_image(&image);
+    _add_symbol(&image, "outer", STT_FUNC, 0x2000, 0x400);
+    _add_symbol(&image, "inner1", STT_FUNC, 0x2100, 0x100);
+    _add_symbol(&image, "innermost", STT_FUNC, 0x2180, 0x10);
+    _add_symbol(&image, "inner2", STT_FUNC, 0x2300, 0x50);
+    _add_symbol(&image, "after", STT_FUNC, 0x2800, 0x10);
+    _build_index(&enclave, &image);
+
+    OE_TEST(_resolves_to(&enclave, 0x2000, "outer"));
+    OE_TEST(_resolves_to(&enclave, 0x20ff, "outer"));
+    OE_TEST(_resolves_to(&enclave, 0x2100, "inner1"));
+    OE_TEST(_resolves_to(&enclave, 0x217f, "inner1"));
+    OE_TEST(_resolves_to(&enclave, 0x2180, "innermost"));
+    OE_TEST(_resolves_to(&enclave, 0x2190, "innermost"));
+    OE_TEST(_resolves_to(&enclave, 0x2191, "inner1"));
+    OE_TEST(_resolves_to(&enclave, 0x2200, "inner1"));
+    OE_TEST(_resolves_to(&enclave, 0x2201, "outer"));
+    OE_TEST(_resolves_to(&enclave, 0x2300, "inner2"));
+    OE_TEST(_resolves_to(&enclave, 0x2350, "inner2"));
+    OE_TEST(_resolves_to(&enclave, 0x2351, "outer"));
+    OE_TEST(_resolves_to(&enclave, 0x2400, "outer"));
+    OE_TEST(_resolves_to(&enclave, 0x2401, NULL));
+    OE_TEST(_resolves_to(&enclave, 0x2800, "after"));
+
+    oe_symbols_free(&enclave);
+
+    printf("TestNestedSymbols: passed\n");
+}
+
+/* Functions with the same address (aliases) resolve to the smallest one, and
+ * to the same one for every address */
+static void TestAliasedSymbols(void)
+{
+    static oe_enclave_t enclave;
+    static image_t image;
+    const char* name;
+
+    _init_image(&image);
+    _add_symbol(&image, "alias1", STT_FUNC, 0x3000, 0x40);
+    _add_symbol(&image, "short_alias", STT_FUNC, 0x3000, 0x10);
+    _add_symbol(&image, "alias2", STT_FUNC, 0x3000, 0x40);
+    _add_symbol(&image, "object", STT_OBJECT, 0x3000, 0x100);
+    _add_symbol(&image, "alias3", STT_FUNC, 0x3000, 0x40);
+    _build_index(&enclave, &image);
+
+    OE_TEST(_resolves_to(&enclave, 0x2fff, NULL));
+    OE_TEST(_resolves_to(&enclave, 0x3000, "short_alias"));
+    OE_TEST(_resolves_to(&enclave, 0x3010, "short_alias"));
+
+    name = oe_symbols_find_function(&enclave, 0x3011);
+    OE_TEST(name != NULL);
+    OE_TEST(
+        strcmp(name, "alias1") == 0 || strcmp(name, "alias2") == 0 ||
+        strcmp(name, "alias3") == 0);
+    OE_TEST(_resolves_to(&enclave, 0x3020, name));
+    OE_TEST(_resolves_to(&enclave, 0x3040, name));
+
+    /* Data objects are not indexed */
+    OE_TEST(_resolves_to(&enclave, 0x3041, NULL));
+    OE_TEST(_resolves_to(&enclave, 0x3100, NULL));
+
+    oe_symbols_free(&enclave);
+
+    printf("TestAliasedSymbols: passed\n");
+}
+
+static void TestNoSymbols(void)
+{
+    static oe_enclave_t enclave;
+    static image_t image;
+
+    OE_TEST(oe_symbols_find_function(NULL, 0x1000) == NULL);
+    OE_TEST(oe_symbols_find_function(&enclave, 0x1000) == NULL);
+
+    /* A symbol table without functions */
+    _init_image(&image);
+    _add_symbol(&image, "object", STT_OBJECT, 0x1000, 0x100);
+    _build_index(&enclave, &image);
+    OE_TEST(_resolves_to(&enclave, 0x1000, NULL));
+    oe_symbols_free(&enclave);
+
+    /* A stripped image, without a symbol table */
+    _init_image(&image);
+    _add_symbol(&image, "hidden", STT_FUNC, 0x1000, 0x100);
+    _build_index(&enclave, &image);
+    OE_TEST(_resolves_to(&enclave, 0x1000, "hidden"));
+    image.ehdr.e_shnum = 2;
+    _build_index(&enclave, &image);
+    OE_TEST(_resolves_to(&enclave, 0x1000, NULL));
+    oe_symbols_free(&enclave);
+
+    printf("TestNoSymbols: passed\n");
+}
+
+int main(void)
+{
+    TestEndOfSymbol();
+    TestNestedSymbols();
+    TestAliasedSymbols();
+    TestNoSymbols();
+
+    printf("=== passed all tests (symbols)\n");
+
+    return 0;
+}
@@ -36,4 +36,134 @@ typedef struct _test_rwlock_args
     bool readers_and_writers;
 } TestRWLockArgs;
 
+typedef struct _test_rwlock_scaling_args
+{
+    // Number of locks to take
+    size_t iterations;
+
+    // Take a write lock once in this many locks
+    size_t write_interval;
+
+    // A reader saw a partial update by a writer
+    bool torn;
+} TestRWLockScalingArgs;
+
+typedef struct _test_rwlock_starvation_args
+{
+    // Whether this thread writes or reads
+    bool writer;
+
+    // Whether the enclave tests a lock that prefers writers
+    bool supported;
+
+    // Number of locks taken
+    size_t count;
+
+    // A reader gave up waiting for the writer
+    bool starved;
+} TestRWLockStarvationArgs;
+
+typedef struct _test_rwlock_reader_slots_args
+{
+    // Number of threads that hold the read lock together
+    size_t num_threads;
+
+    // The thread data of the TCS of the ECALL
+    uint64_t td;
+
+    // The read lock was held through a slot of the TCS
+    bool in_slot;
+
+    // The slot was cleared when the lock was released
+    bool released;
+} TestRWLockReaderSlotsArgs;
+
+typedef struct _test_rwlock_stress_args
+{
+    // Number of locks to take
+    size_t iterations;
+
+    // Take a write lock once in this many locks
+    size_t write_interval;
+
+    // Use a lock that prefers writers (if supported)
+    bool prefer_writer;
+
+    // A reader and a writer, or two writers, held the lock together
+    bool violated;
+} TestRWLockStressArgs;
+
+typedef struct _test_seqlock_args
+{
+    // Number of reads or writes
+    size_t iterations;
+
+    // Whether this thread writes or reads
+    bool writer;
+
+    // Whether the enclave tests the seqlock
+    bool supported;
+
+    // A reader saw a partial update by a writer
+    bool torn;
+} TestSeqLockArgs;
+
+typedef struct _test_thread_local_args
+{
+    /* Number of increments of the thread-local counter */
+    size_t iterations;
+
+    /* Number of OCALLs that use the thread-local storage of the host
+     * (interleaved with the increments) */
+    size_t ocalls;
+} TestThreadLocalArgs;
+
+typedef struct _test_thread_create_args
+{
+    /* Number of threads that are joined */
+    size_t num_joined;
+
+    /* Number of threads that are detached */
+    size_t num_detached;
+} TestThreadCreateArgs;
+
+typedef struct _test_thread_starts_args
+{
+    /* Number of threads created at once, which all wait for each other */
+    size_t num_threads;
+} TestThreadStartsArgs;
+
+typedef struct _test_parallel_for_args
+{
+    /* Number of workers of the task runtime (or zero) */
+    size_t num_workers;
+
+    /* Number of elements of the range */
+    size_t size;
+} TestParallelForArgs;
+
+typedef struct _test_fibers_args
+{
+    /* Number of fibers created by the ECALL */
+    size_t num_fibers;
+
+    /* Number of increments of the shared counter by each fiber */
+    size_t iterations;
+
+    /* Value of the shared counter when the fibers completed */
+    size_t count;
+} TestFibersArgs;
+
+typedef struct _test_tcs_keys_args
+{
+    /* Identifies the TCS of the ECALL */
+    uint64_t tcs;
+
+    /* Number of ECALLs that found the value of the TCS */
+    size_t count;
+
+    /* Incremented by the destructor of each value (host memory) */
+    size_t* destructed;
+} TestTCSKeysArgs;
+
 #endif /* _stdc_args_h */
@@ -0,0 +1,83 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#include <openenclave/host.h>
+#include <openenclave/internal/error.h>
+#include <openenclave/internal/tests.h>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include "../args.h"
+#include "../rwlock_tests.h"
+
+static void RWLockScalingThread(
+    oe_enclave_t* enclave,
+    TestRWLockScalingArgs* args)
+{
+    OE_TEST(oe_call_enclave(enclave, "RWLockScalingImpl", args) == OE_OK);
+}
+
+// Measure the throughput of a read-mostly lock shared by 1, 2, 4, ... TCSs.
+static void BenchmarkReadersWriterLockScaling(oe_enclave_t* enclave)
+{
+    std::thread threads[RWLOCK_SCALING_MAX_THREADS];
+    TestRWLockScalingArgs args[RWLOCK_SCALING_MAX_THREADS];
+
+    for (size_t n = 1; n <= RWLOCK_SCALING_MAX_THREADS; n *= 2)
+    {
+        auto start = std::chrono::steady_clock::now();
+
+        for (size_t i = 0; i < n; i++)
+        {
+            args[i].iterations = RWLOCK_SCALING_ITERS;
+            args[i].write_interval = RWLOCK_SCALING_WRITE_INTERVAL;
+            args[i].torn = false;
+            threads[i] = std::thread(RWLockScalingThread, enclave, &args[i]);
+        }
+
+        for (size_t i = 0; i < n; i++)
+            threads[i].join();
+
+        auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - start);
+
+        for (size_t i = 0; i < n; i++)
+            OE_TEST(!args[i].torn);
+
+        printf(
+            "rwlock scaling: %zu threads: %.2f Mlocks/s\n",
+            n,
+            (double)(n * RWLOCK_SCALING_ITERS) /
+                (double)(elapsed.count() ? elapsed.count() : 1));
+    }
+}
+
+int main(int argc, const char* argv[])
+{
+    oe_result_t result;
+    oe_enclave_t* enclave = NULL;
+
+    if (argc != 2)
+    {
+        fprintf(stderr, "Usage: %s ENCLAVE\n", argv[0]);
+        exit(1);
+    }
+
+    const uint32_t flags = oe_get_create_flags();
+
+    if ((result = oe_create_enclave(
+             argv[1], OE_ENCLAVE_TYPE_SGX, flags, NULL, 0, &enclave)) != OE_OK)
+    {
+        oe_put_err("oe_create_enclave(): result=%u", result);
+    }
+
+    BenchmarkReadersWriterLockScaling(enclave);
+
+    if ((result = oe_terminate_enclave(enclave)) != OE_OK)
+    {
+        oe_put_err("oe_terminate_enclave(): result=%u", result);
+    }
+
+    return 0;
+}
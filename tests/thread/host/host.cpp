@@ -4,11 +4,15 @@
 #include <openenclave/host.h>
 #include <openenclave/internal/error.h>
 #include <openenclave/internal/tests.h>
+#include <pthread.h>
 #include <cassert>
+#include <cerrno>
 #include <chrono>
+#include <climits>
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
+#include <map>
 #include <thread>
 #include "../args.h"
 
@@ -230,7 +234,184 @@ void TestThreadLockingPatterns(oe_enclave_t* enclave)
     printf("TestThreadLockingPatterns Complete\n");
 }
 
+static thread_local pthread_t _host_tls_thread;
+static thread_local size_t _host_tls_ocalls;
+
+// Uses errno, malloc() and thread_local, which glibc finds through the FS
+// register base (switched to the enclave one while a simulated enclave runs)
+OE_OCALL void HostThreadLocal(void* args)
+{
+    const size_t ocall = (size_t)args;
+
+    OE_TEST(pthread_equal(_host_tls_thread, pthread_self()));
+
+    if (ocall == 0)
+        _host_tls_ocalls = 0;
+
+    OE_TEST(_host_tls_ocalls++ == ocall);
+
+    errno = 0;
+    OE_TEST(strtoul("99999999999999999999999", NULL, 10) == ULONG_MAX);
+    OE_TEST(errno == ERANGE);
+
+    for (size_t i = 0; i < 16; i++)
+    {
+        void* ptr = malloc(i * 64 + 1);
+        OE_TEST(ptr != NULL);
+        memset(ptr, 0xAB, i * 64 + 1);
+        free(ptr);
+    }
+}
+
+void* ThreadLocalThread(void* args)
+{
+    oe_enclave_t* enclave = (oe_enclave_t*)args;
+    TestThreadLocalArgs thread_local_args = {100000, 100};
+
+    _host_tls_thread = pthread_self();
+
+    for (size_t i = 0; i < 10; i++)
+    {
+        OE_TEST(
+            oe_call_enclave(enclave, "TestThreadLocal", &thread_local_args) ==
+            OE_OK);
+    }
+
+    return NULL;
+}
+
+void TestThreadLocal(oe_enclave_t* enclave)
+{
+    std::thread threads[NUM_THREADS];
+
+    for (size_t i = 0; i < NUM_THREADS; i++)
+        threads[i] = std::thread(ThreadLocalThread, enclave);
+
+    for (size_t i = 0; i < NUM_THREADS; i++)
+        threads[i].join();
+
+    printf("TestThreadLocal Complete\n");
+}
+
+// In simulation mode, the host switches the FS register base to the enclave
+// thread-local storage, so run the test there as well
+void TestThreadLocalSimulation(const char* path, uint32_t flags)
+{
+    oe_enclave_t* enclave = NULL;
+
+    if (flags & OE_ENCLAVE_FLAG_SIMULATE)
+        return;
+
+    OE_TEST(
+        oe_create_enclave(
+            path,
+            OE_ENCLAVE_TYPE_SGX,
+            flags | OE_ENCLAVE_FLAG_SIMULATE,
+            NULL,
+            0,
+            &enclave) == OE_OK);
+
+    TestThreadLocal(enclave);
+
+    OE_TEST(oe_terminate_enclave(enclave) == OE_OK);
+}
+
+void TestThreadCreate(oe_enclave_t* enclave)
+{
+    TestThreadCreateArgs args = {8, 4};
+
+    for (size_t i = 0; i < 10; i++)
+        OE_TEST(oe_call_enclave(enclave, "TestThreadCreate", &args) == OE_OK);
+
+    printf("TestThreadCreate Complete\n");
+}
+
+// Create more threads at once than the pool has idle host threads: the
+// pool has as many host threads as the previous call needed, and each call
+// needs one more.
+void TestThreadStarts(oe_enclave_t* enclave)
+{
+    TestThreadStartsArgs args = {0};
+
+    for (args.num_threads = 1; args.num_threads <= 15; args.num_threads++)
+        OE_TEST(oe_call_enclave(enclave, "TestThreadStarts", &args) == OE_OK);
+
+    printf("TestThreadStarts Complete\n");
+}
+
+void TestParallelFor(oe_enclave_t* enclave)
+{
+    TestParallelForArgs args = {0, 100000};
+
+    // Before and after the task runtime is started
+    OE_TEST(oe_call_enclave(enclave, "TestParallelFor", &args) == OE_OK);
+
+    args.num_workers = 4;
+    OE_TEST(oe_call_enclave(enclave, "TestParallelFor", &args) == OE_OK);
+    OE_TEST(oe_call_enclave(enclave, "TestParallelFor", &args) == OE_OK);
+
+    printf("TestParallelFor Complete\n");
+}
+
+void* FibersThread(void* args)
+{
+    oe_enclave_t* enclave = (oe_enclave_t*)args;
+    TestFibersArgs fibers_args = {8, 50, 0};
+
+    OE_TEST(oe_call_enclave(enclave, "TestFibers", &fibers_args) == OE_OK);
+
+    return NULL;
+}
+
+// Fibers of different TCSs contend for the same fiber mutex
+void TestFibers(oe_enclave_t* enclave)
+{
+    TestFibersArgs args = {0, 0, 0};
+    std::thread threads[NUM_THREADS];
+
+    for (size_t i = 0; i < NUM_THREADS; i++)
+        threads[i] = std::thread(FibersThread, enclave);
+
+    for (size_t i = 0; i < NUM_THREADS; i++)
+        threads[i].join();
+
+    OE_TEST(oe_call_enclave(enclave, "TestFibers", &args) == OE_OK);
+    OE_TEST(args.count == NUM_THREADS * 8 * 50);
+
+    OE_TEST(
+        oe_call_enclave(enclave, "TestFiberStackAlignment", NULL) == OE_OK);
+
+    printf("TestFibers Complete\n");
+}
+
+static size_t _num_tcs_values;
+static size_t _num_tcs_destructed;
+
+// Values of TCS-lifetime keys survive across ECALLs on the same TCS
+void TestTCSKeys(oe_enclave_t* enclave)
+{
+    std::map<uint64_t, size_t> counts;
+
+    // With fewer TCSs than ECALLs, some ECALLs reuse a TCS
+    for (size_t i = 0; i < 32; i++)
+    {
+        TestTCSKeysArgs args = {0, 0, &_num_tcs_destructed};
+
+        OE_TEST(oe_call_enclave(enclave, "TestTCSKeys", &args) == OE_OK);
+        OE_TEST(args.count == ++counts[args.tcs]);
+    }
+
+    OE_TEST(counts.size() < 32);
+    _num_tcs_values = counts.size();
+
+    printf("TestTCSKeys Complete\n");
+}
+
 void TestReadersWriterLock(oe_enclave_t* enclave);
+void TestReadersWriterLockStarvation(oe_enclave_t* enclave);
+void TestReadersWriterLockReaderSlots(oe_enclave_t* enclave);
+void TestReadersWriterLockStress(oe_enclave_t* enclave);
+void TestSeqLock(oe_enclave_t* enclave);
 
 int main(int argc, const char* argv[])
 {
@@ -263,11 +444,36 @@ int main(int argc, const char* argv[])
 
     TestReadersWriterLock(enclave);
 
+    TestReadersWriterLockStarvation(enclave);
+
+    TestReadersWriterLockReaderSlots(enclave);
+
+    TestReadersWriterLockStress(enclave);
+
+    TestSeqLock(enclave);
+
+    TestThreadLocal(enclave);
+
+    TestThreadCreate(enclave);
+
+    TestThreadStarts(enclave);
+
+    TestParallelFor(enclave);
+
+    TestFibers(enclave);
+
+    TestTCSKeys(enclave);
+
     if ((result = oe_terminate_enclave(enclave)) != OE_OK)
     {
         oe_put_err("oe_terminate_enclave(): result=%u", result);
     }
 
+    // The values of the TCS-lifetime keys are destroyed on termination
+    OE_TEST(_num_tcs_destructed == _num_tcs_values);
+
+    TestThreadLocalSimulation(argv[1], flags);
+
     printf("=== passed all tests (%s)\n", argv[0]);
 
     return 0;
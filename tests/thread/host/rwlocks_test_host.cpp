@@ -66,3 +66,145 @@ void TestReadersWriterLock(oe_enclave_t* enclave)
     // simultaneously active at least once.
     OE_TEST(_rw_args.max_readers == NUM_READER_THREADS);
 }
+
+static void RWLockStarvationThread(
+    oe_enclave_t* enclave,
+    TestRWLockStarvationArgs* args)
+{
+    OE_TEST(oe_call_enclave(enclave, "RWLockStarvationImpl", args) == OE_OK);
+}
+
+// A writer gets the lock although readers keep taking it.
+void TestReadersWriterLockStarvation(oe_enclave_t* enclave)
+{
+    std::thread threads[NUM_RW_TEST_THREADS];
+    TestRWLockStarvationArgs args[NUM_RW_TEST_THREADS];
+
+    for (size_t i = 0; i < NUM_RW_TEST_THREADS; i++)
+    {
+        memset(&args[i], 0, sizeof(args[i]));
+        args[i].writer = i == 0;
+        threads[i] = std::thread(RWLockStarvationThread, enclave, &args[i]);
+    }
+
+    for (size_t i = 0; i < NUM_RW_TEST_THREADS; i++)
+        threads[i].join();
+
+    if (!args[0].supported)
+    {
+        printf("TestReadersWriterLockStarvation: skipped\n");
+        return;
+    }
+
+    OE_TEST(args[0].count == RWLOCK_STARVATION_WRITES);
+
+    for (size_t i = 1; i < NUM_RW_TEST_THREADS; i++)
+        OE_TEST(!args[i].starved);
+
+    printf("TestReadersWriterLockStarvation Complete\n");
+}
+
+static void RWLockReaderSlotsThread(
+    oe_enclave_t* enclave,
+    TestRWLockReaderSlotsArgs* args)
+{
+    OE_TEST(oe_call_enclave(enclave, "RWLockReaderSlotsImpl", args) == OE_OK);
+}
+
+// Readers on different TCSs take the lock through the slots of their own
+// TCSs, all at the same time.
+void TestReadersWriterLockReaderSlots(oe_enclave_t* enclave)
+{
+    std::thread threads[NUM_RW_TEST_THREADS];
+    TestRWLockReaderSlotsArgs args[NUM_RW_TEST_THREADS];
+
+    for (size_t i = 0; i < NUM_RW_TEST_THREADS; i++)
+    {
+        memset(&args[i], 0, sizeof(args[i]));
+        args[i].num_threads = NUM_RW_TEST_THREADS;
+        threads[i] = std::thread(RWLockReaderSlotsThread, enclave, &args[i]);
+    }
+
+    for (size_t i = 0; i < NUM_RW_TEST_THREADS; i++)
+        threads[i].join();
+
+    for (size_t i = 0; i < NUM_RW_TEST_THREADS; i++)
+    {
+        OE_TEST(args[i].in_slot);
+        OE_TEST(args[i].released);
+
+        for (size_t j = 0; j < i; j++)
+            OE_TEST(args[i].td != args[j].td);
+    }
+
+    printf("TestReadersWriterLockReaderSlots Complete\n");
+}
+
+static void RWLockStressThread(
+    oe_enclave_t* enclave,
+    TestRWLockStressArgs* args)
+{
+    OE_TEST(oe_call_enclave(enclave, "RWLockStressImpl", args) == OE_OK);
+}
+
+// Mix frequent writers with readers on the same lock, with and without the
+// writer preference.
+void TestReadersWriterLockStress(oe_enclave_t* enclave)
+{
+    std::thread threads[NUM_RW_TEST_THREADS];
+    TestRWLockStressArgs args[NUM_RW_TEST_THREADS];
+
+    for (int prefer_writer = 0; prefer_writer < 2; prefer_writer++)
+    {
+        for (size_t i = 0; i < NUM_RW_TEST_THREADS; i++)
+        {
+            memset(&args[i], 0, sizeof(args[i]));
+            args[i].iterations = RWLOCK_STRESS_ITERS;
+            args[i].write_interval = (i & 1) ? 3 : 50;
+            args[i].prefer_writer = prefer_writer != 0;
+            threads[i] = std::thread(RWLockStressThread, enclave, &args[i]);
+        }
+
+        for (size_t i = 0; i < NUM_RW_TEST_THREADS; i++)
+            threads[i].join();
+
+        for (size_t i = 0; i < NUM_RW_TEST_THREADS; i++)
+            OE_TEST(!args[i].violated);
+    }
+
+    printf("TestReadersWriterLockStress Complete\n");
+}
+
+static void SeqLockThread(oe_enclave_t* enclave, TestSeqLockArgs* args)
+{
+    OE_TEST(oe_call_enclave(enclave, "SeqLockImpl", args) == OE_OK);
+}
+
+// Readers never see a partial update by concurrent writers.
+void TestSeqLock(oe_enclave_t* enclave)
+{
+    std::thread threads[NUM_RW_TEST_THREADS];
+    TestSeqLockArgs args[NUM_RW_TEST_THREADS];
+
+    for (size_t i = 0; i < NUM_RW_TEST_THREADS; i++)
+    {
+        memset(&args[i], 0, sizeof(args[i]));
+        args[i].iterations = SEQLOCK_TEST_ITERS;
+        args[i].writer = i < NUM_SEQLOCK_WRITER_THREADS;
+        threads[i] = std::thread(SeqLockThread, enclave, &args[i]);
+    }
+
+    for (size_t i = 0; i < NUM_RW_TEST_THREADS; i++)
+        threads[i].join();
+
+    if (!args[0].supported)
+    {
+        printf("TestSeqLock: skipped\n");
+        return;
+    }
+
+    for (size_t i = 0; i < NUM_RW_TEST_THREADS; i++)
+        OE_TEST(!args[i].torn);
+
+    printf("TestSeqLock Complete\n");
+}
@@ -251,3 +251,152 @@ OE_SET_ENCLAVE_SGX(
     512,  /* HeapPageCount */
     512,  /* StackPageCount */
     16);  /* TCSCount */
+
+#define TLS_MAGIC 0x7f3c9a1bU
+
+// Initialized from .tdata and .tbss for each TCS
+static __thread unsigned int _tls_magic = TLS_MAGIC;
+static __thread size_t _tls_count;
+
+OE_ECALL void TestThreadLocal(void* args_)
+{
+    TestThreadLocalArgs* args = (TestThreadLocalArgs*)args_;
+    volatile size_t* count = &_tls_count;
+    size_t start = *count;
+
+    OE_TEST(_tls_magic == TLS_MAGIC);
+
+    // Other threads increment their own copy of the counter concurrently
+    for (size_t i = 0; i < args->iterations; i++)
+    {
+        // The OCALLs run with the thread-local storage of the host thread
+        if (args->ocalls && i % (args->iterations / args->ocalls) == 0)
+        {
+            size_t ocall = i / (args->iterations / args->ocalls);
+            OE_TEST(oe_call_host("HostThreadLocal", (void*)ocall) == OE_OK);
+        }
+
+        ++*count;
+    }
+
+    OE_TEST(_tls_magic == TLS_MAGIC);
+    OE_TEST(*count == start + args->iterations);
+}
+
+#define MAX_CREATED_THREADS 8
+
+// All TCSs but the one of the ECALL
+#define MAX_STARTED_THREADS 15
+
+static oe_thread_t _created_threads[MAX_CREATED_THREADS];
+static oe_mutex_t _detached_mutex = OE_MUTEX_INITIALIZER;
+static oe_cond_t _detached_cond = OE_COND_INITIALIZER;
+static size_t _num_detached_running;
+
+static void* _joined_thread(void* arg)
+{
+    size_t i = (size_t)arg;
+    oe_thread_t thread;
+
+    // Wait for the creator to publish the identifier of this thread
+    while (!(thread = __atomic_load_n(&_created_threads[i], __ATOMIC_ACQUIRE)))
+        ;
+
+    OE_TEST(oe_thread_equal(oe_thread_self(), thread));
+
+    return (void*)(i + 1);
+}
+
+static void* _detached_thread(void* arg)
+{
+    OE_UNUSED(arg);
+
+    oe_mutex_lock(&_detached_mutex);
+
+    if (--_num_detached_running == 0)
+        oe_cond_signal(&_detached_cond);
+
+    oe_mutex_unlock(&_detached_mutex);
+
+    return NULL;
+}
+
+OE_ECALL void TestThreadCreate(void* args_)
+{
+    TestThreadCreateArgs* args = (TestThreadCreateArgs*)args_;
+    oe_thread_t threads[MAX_CREATED_THREADS];
+
+    OE_TEST(args->num_joined <= MAX_CREATED_THREADS);
+
+    for (size_t i = 0; i < args->num_joined; i++)
+    {
+        _created_threads[i] = 0;
+        OE_TEST(oe_thread_create(&threads[i], _joined_thread, (void*)i) == 0);
+        __atomic_store_n(&_created_threads[i], threads[i], __ATOMIC_RELEASE);
+    }
+
+    for (size_t i = 0; i < args->num_joined; i++)
+    {
+        void* retval = NULL;
+
+        OE_TEST(oe_thread_join(threads[i], &retval) == 0);
+        OE_TEST(retval == (void*)(i + 1));
+    }
+
+    // Detached threads release their resources when they return
+    _num_detached_running = args->num_detached;
+
+    for (size_t i = 0; i < args->num_detached; i++)
+    {
+        oe_thread_t thread;
+
+        OE_TEST(oe_thread_create(&thread, _detached_thread, NULL) == 0);
+        OE_TEST(oe_thread_detach(thread) == 0);
+    }
+
+    oe_mutex_lock(&_detached_mutex);
+
+    while (_num_detached_running > 0)
+        oe_cond_wait(&_detached_cond, &_detached_mutex);
+
+    oe_mutex_unlock(&_detached_mutex);
+}
+
+static size_t _num_started;
+
+// Wait for all the threads of TestThreadStarts() to run
+static void* _waiting_thread(void* arg)
+{
+    size_t num_threads = (size_t)arg;
+
+    __atomic_add_fetch(&_num_started, 1, __ATOMIC_ACQ_REL);
+
+    while (__atomic_load_n(&_num_started, __ATOMIC_ACQUIRE) < num_threads)
+        ;
+
+    return NULL;
+}
+
+// The threads run at the same time, so the host must start a thread for
+// each one that no idle host thread takes
+OE_ECALL void TestThreadStarts(void* args_)
+{
+    TestThreadStartsArgs* args = (TestThreadStartsArgs*)args_;
+    oe_thread_t threads[MAX_STARTED_THREADS];
+
+    OE_TEST(args->num_threads <= MAX_STARTED_THREADS);
+
+    _num_started = 0;
+
+    for (size_t i = 0; i < args->num_threads; i++)
+    {
+        OE_TEST(
+            oe_thread_create(
+                &threads[i], _waiting_thread, (void*)args->num_threads) == 0);
+    }
+
+    for (size_t i = 0; i < args->num_threads; i++)
+        OE_TEST(oe_thread_join(threads[i], NULL) == 0);
+
+    OE_TEST(_num_started == args->num_threads);
+}
@@ -0,0 +1,118 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#include <openenclave/enclave.h>
+#include <openenclave/internal/fiber.h>
+#include <openenclave/internal/tests.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include "../args.h"
+
+#define MAX_FIBERS 16
+
+// Shared by the fibers of all the TCSs
+static oe_fiber_mutex_t _fiber_mutex = OE_FIBER_MUTEX_INITIALIZER;
+static size_t _fiber_count;
+
+struct fiber_group
+{
+    oe_fiber_cond_t cond;
+    size_t remaining;
+    size_t iterations;
+};
+
+static void _fiber(void* arg)
+{
+    fiber_group* group = (fiber_group*)arg;
+
+    // Yield while holding the mutex, so that other fibers wait for it
+    for (size_t i = 0; i < group->iterations; i++)
+    {
+        OE_TEST(oe_fiber_mutex_lock(&_fiber_mutex) == OE_OK);
+        size_t count = _fiber_count;
+        oe_fiber_yield();
+        _fiber_count = count + 1;
+        OE_TEST(oe_fiber_mutex_unlock(&_fiber_mutex) == OE_OK);
+    }
+
+    OE_TEST(oe_fiber_mutex_lock(&_fiber_mutex) == OE_OK);
+
+    if (--group->remaining == 0)
+        OE_TEST(oe_fiber_cond_signal(&group->cond) == OE_OK);
+
+    OE_TEST(oe_fiber_mutex_unlock(&_fiber_mutex) == OE_OK);
+}
+
+OE_ECALL void TestFibers(void* args_)
+{
+    TestFibersArgs* args = (TestFibersArgs*)args_;
+    fiber_group group = {OE_FIBER_COND_INITIALIZER, 0, args->iterations};
+    oe_fiber_t* fibers[MAX_FIBERS];
+
+    OE_TEST(args->num_fibers <= MAX_FIBERS);
+    group.remaining = args->num_fibers;
+
+    for (size_t i = 0; i < args->num_fibers; i++)
+    {
+        OE_TEST(
+            oe_fiber_create(
+                &fibers[i], OE_FIBER_MIN_STACK_SIZE, _fiber, &group) == OE_OK);
+    }
+
+    // The context of the ECALL waits like the other fibers
+    OE_TEST(oe_fiber_mutex_lock(&_fiber_mutex) == OE_OK);
+
+    while (group.remaining > 0)
+        OE_TEST(oe_fiber_cond_wait(&group.cond, &_fiber_mutex) == OE_OK);
+
+    args->count = _fiber_count;
+    OE_TEST(oe_fiber_mutex_unlock(&_fiber_mutex) == OE_OK);
+
+    for (size_t i = 0; i < args->num_fibers; i++)
+        OE_TEST(oe_fiber_join(fibers[i]) == OE_OK);
+}
+
+struct fiber_alignment
+{
+    bool aligned;
+    char formatted[32];
+};
+
+// Code compiled for the SysV ABI assumes that RSP + 8 is aligned on 16 bytes
+// on entry to a function. Aligned locals and the vector registers saved by
+// variadic functions rely on it.
+static void _fiber_alignment(void* arg)
+{
+    fiber_alignment* alignment = (fiber_alignment*)arg;
+    alignas(16) volatile uint8_t local[16] = {0};
+    uintptr_t address = (uintptr_t)local;
+
+    // Keep the compiler from assuming the alignment of the address
+    asm volatile("" : "+r"(address));
+    alignment->aligned = (address & 15) == 0;
+
+    snprintf(
+        alignment->formatted,
+        sizeof(alignment->formatted),
+        "%.2f %.2f",
+        1.5,
+        (double)local[0] + 2.25);
+}
+
+OE_ECALL void TestFiberStackAlignment(void* args_)
+{
+    fiber_alignment alignment = {false, {0}};
+    oe_fiber_t* fiber;
+
+    OE_UNUSED(args_);
+
+    OE_TEST(
+        oe_fiber_create(
+            &fiber, OE_FIBER_MIN_STACK_SIZE, _fiber_alignment, &alignment) ==
+        OE_OK);
+    OE_TEST(oe_fiber_join(fiber) == OE_OK);
+
+    OE_TEST(alignment.aligned);
+    OE_TEST(strcmp(alignment.formatted, "1.50 2.25") == 0);
+}
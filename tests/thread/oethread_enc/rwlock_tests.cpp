@@ -4,6 +4,7 @@
 #include "../rwlock_tests.h"
 #include <openenclave/enclave.h>
 #include <openenclave/internal/print.h>
+#include <openenclave/internal/sgxtypes.h>
 #include <openenclave/internal/thread.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -146,3 +147,288 @@ OE_ECALL void WriterThreadImpl(void* args_)
 
     oe_host_printf("%llu: Writer Exiting\n", OE_LLU(oe_thread_self()));
 }
+
+static oe_rwlock_t scaling_lock = OE_RWLOCK_INITIALIZER;
+static volatile size_t scaling_table[64];
+
+// Read a table under the lock, updating it once in a while.
+OE_ECALL void RWLockScalingImpl(void* args_)
+{
+    TestRWLockScalingArgs* args = (TestRWLockScalingArgs*)args_;
+    const size_t count = sizeof(scaling_table) / sizeof(scaling_table[0]);
+
+    for (size_t i = 0; i < args->iterations; ++i)
+    {
+        if (args->write_interval && i % args->write_interval == 0)
+        {
+            oe_rwlock_wrlock(&scaling_lock);
+
+            for (size_t j = 0; j < count; j++)
+                scaling_table[j]++;
+
+            oe_rwlock_unlock(&scaling_lock);
+        }
+        else
+        {
+            oe_rwlock_rdlock(&scaling_lock);
+
+            // All entries are updated together.
+            for (size_t j = 1; j < count; j++)
+            {
+                if (scaling_table[j] != scaling_table[0])
+                    args->torn = true;
+            }
+
+            oe_rwlock_unlock(&scaling_lock);
+        }
+    }
+}
+
+// Only locks that prefer writers keep readers from starving a writer.
+#ifdef OE_RWLOCK_PREFER_WRITER
+static oe_rwlock_t starvation_lock;
+static oe_once_t starvation_lock_once = OE_ONCE_INITIALIZER;
+static volatile bool starvation_started;
+static size_t starvation_readers;
+static size_t starvation_writes;
+
+static void _init_starvation_lock()
+{
+    oe_rwlock_init_ex(&starvation_lock, OE_RWLOCK_PREFER_WRITER);
+}
+#endif
+
+// One writer takes write locks while the other threads keep taking read
+// locks, which the writer waits for (through the slots of their TCSs too).
+OE_ECALL void RWLockStarvationImpl(void* args_)
+{
+#ifdef OE_RWLOCK_PREFER_WRITER
+
+    TestRWLockStarvationArgs* args = (TestRWLockStarvationArgs*)args_;
+    const size_t num_readers = NUM_RW_TEST_THREADS - 1;
+
+    args->supported = true;
+    oe_once(&starvation_lock_once, _init_starvation_lock);
+
+    if (args->writer)
+    {
+        // Start once all the readers are taking read locks.
+        starvation_started = true;
+
+        while (__atomic_load_n(&starvation_readers, __ATOMIC_ACQUIRE) <
+               num_readers)
+            ;
+
+        for (size_t i = 0; i < RWLOCK_STARVATION_WRITES; ++i)
+        {
+            oe_rwlock_wrlock(&starvation_lock);
+            __atomic_add_fetch(&starvation_writes, 1, __ATOMIC_RELEASE);
+            oe_rwlock_unlock(&starvation_lock);
+            args->count++;
+        }
+    }
+    else
+    {
+        size_t last = 0;
+        size_t stalled = 0;
+        size_t writes;
+
+        while (!starvation_started)
+            ;
+
+        __atomic_add_fetch(&starvation_readers, 1, __ATOMIC_RELEASE);
+
+        while ((writes = __atomic_load_n(
+                    &starvation_writes, __ATOMIC_ACQUIRE)) <
+               RWLOCK_STARVATION_WRITES)
+        {
+            if (writes != last)
+            {
+                last = writes;
+                stalled = 0;
+            }
+            else if (++stalled == RWLOCK_STARVATION_MAX_READS)
+            {
+                args->starved = true;
+                break;
+            }
+
+            oe_rwlock_rdlock(&starvation_lock);
+            args->count++;
+            oe_rwlock_unlock(&starvation_lock);
+        }
+    }
+
+#else
+
+    // The host skips the test.
+    (void)args_;
+
+#endif
+}
+
+static oe_rwlock_t slots_lock = OE_RWLOCK_INITIALIZER;
+static size_t slots_holders;
+
+static bool _in_reader_slot(const td_t* td, const oe_rwlock_t* lock)
+{
+    const size_t count = OE_COUNTOF(td->rwlock_readers);
+
+    for (size_t i = 0; i < count; i++)
+    {
+        if (td->rwlock_readers[i] == (uint64_t)lock)
+            return true;
+    }
+
+    return false;
+}
+
+// Readers on different TCSs hold the lock together, each through a slot of
+// its own TCS rather than through the shared reader count.
+OE_ECALL void RWLockReaderSlotsImpl(void* args_)
+{
+    TestRWLockReaderSlotsArgs* args = (TestRWLockReaderSlotsArgs*)args_;
+    const td_t* td = oe_get_td();
+
+    args->td = (uint64_t)td;
+
+    // A reader that uses the reader count sets the read bias.
+    oe_rwlock_rdlock(&slots_lock);
+    oe_rwlock_unlock(&slots_lock);
+
+    oe_rwlock_rdlock(&slots_lock);
+    args->in_slot = _in_reader_slot(td, &slots_lock);
+
+    // Wait for all the readers to hold the lock.
+    __atomic_add_fetch(&slots_holders, 1, __ATOMIC_SEQ_CST);
+
+    while (__atomic_load_n(&slots_holders, __ATOMIC_SEQ_CST) <
+           args->num_threads)
+        ;
+
+    oe_rwlock_unlock(&slots_lock);
+    args->released = !_in_reader_slot(td, &slots_lock);
+}
+
+static oe_rwlock_t stress_lock = OE_RWLOCK_INITIALIZER;
+static int64_t stress_state;
+
+#ifdef OE_RWLOCK_PREFER_WRITER
+static oe_rwlock_t stress_writer_lock;
+static oe_once_t stress_writer_lock_once = OE_ONCE_INITIALIZER;
+static int64_t stress_writer_state;
+
+static void _init_stress_writer_lock()
+{
+    oe_rwlock_init_ex(&stress_writer_lock, OE_RWLOCK_PREFER_WRITER);
+}
+#endif
+
+// Overwrite the stack where the lock functions keep their waiter nodes, so
+// that a node left queued after a wake is caught.
+static OE_NEVER_INLINE void _scribble_stack()
+{
+    volatile uint8_t buffer[1024];
+
+    for (size_t i = 0; i < sizeof(buffer); i++)
+        buffer[i] = 0xdd;
+}
+
+// Take short read and write locks from many threads, so that threads often
+// wait and are woken while other threads acquire the lock.
+OE_ECALL void RWLockStressImpl(void* args_)
+{
+    TestRWLockStressArgs* args = (TestRWLockStressArgs*)args_;
+    oe_rwlock_t* lock = &stress_lock;
+    int64_t* state = &stress_state;
+
+#ifdef OE_RWLOCK_PREFER_WRITER
+    if (args->prefer_writer)
+    {
+        oe_once(&stress_writer_lock_once, _init_stress_writer_lock);
+        lock = &stress_writer_lock;
+        state = &stress_writer_state;
+    }
+#endif
+
+    for (size_t i = 0; i < args->iterations; ++i)
+    {
+        if (i % args->write_interval == 0)
+        {
+            oe_rwlock_wrlock(lock);
+
+            // -1 while a writer holds the lock.
+            if (__atomic_exchange_n(state, -1, __ATOMIC_SEQ_CST) != 0)
+                args->violated = true;
+
+            __atomic_store_n(state, 0, __ATOMIC_SEQ_CST);
+
+            oe_rwlock_unlock(lock);
+        }
+        else
+        {
+            oe_rwlock_rdlock(lock);
+
+            // The number of readers that hold the lock otherwise.
+            if (__atomic_add_fetch(state, 1, __ATOMIC_SEQ_CST) <= 0)
+                args->violated = true;
+
+            __atomic_sub_fetch(state, 1, __ATOMIC_SEQ_CST);
+
+            oe_rwlock_unlock(lock);
+        }
+
+        _scribble_stack();
+    }
+}
+
+// Sequence locks are not routed to pthreads.
+#ifdef OE_SEQLOCK_INITIALIZER
+
+static oe_seqlock_t seqlock = OE_SEQLOCK_INITIALIZER;
+static volatile size_t seqlock_data[2];
+
+#endif
+
+OE_ECALL void SeqLockImpl(void* args_)
+{
+#ifdef OE_SEQLOCK_INITIALIZER
+
+    TestSeqLockArgs* args = (TestSeqLockArgs*)args_;
+
+    args->supported = true;
+
+    for (size_t i = 0; i < args->iterations; ++i)
+    {
+        if (args->writer)
+        {
+            oe_seqlock_write_lock(&seqlock);
+            seqlock_data[0]++;
+            seqlock_data[1]++;
+            oe_seqlock_write_unlock(&seqlock);
+        }
+        else
+        {
+            size_t first;
+            size_t second;
+            uint32_t seq;
+
+            do
+            {
+                seq = oe_seqlock_read_begin(&seqlock);
+                first = seqlock_data[0];
+                second = seqlock_data[1];
+            } while (oe_seqlock_read_retry(&seqlock, seq));
+
+            if (first != second)
+                args->torn = true;
+        }
+    }
+
+#else
+
+    // The host skips the test.
+    (void)args_;
+
+#endif
+}
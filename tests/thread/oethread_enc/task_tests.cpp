@@ -0,0 +1,79 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#include <openenclave/enclave.h>
+#include <openenclave/internal/task.h>
+#include <openenclave/internal/tests.h>
+#include <stdlib.h>
+#include "../args.h"
+
+struct fib_args
+{
+    size_t n;
+    size_t result;
+};
+
+static void _fib_task(void* arg);
+
+// Each call spawns one half of the recursion as a task
+static size_t _fib(size_t n)
+{
+    if (n < 12)
+        return n < 2 ? n : _fib(n - 1) + _fib(n - 2);
+
+    oe_task_group_t group = OE_TASK_GROUP_INITIALIZER;
+    fib_args args1 = {n - 1, 0};
+    fib_args args2 = {n - 2, 0};
+
+    OE_TEST(oe_task_group_run(&group, _fib_task, &args1) == OE_OK);
+    _fib_task(&args2);
+    OE_TEST(oe_task_group_wait(&group) == OE_OK);
+
+    return args1.result + args2.result;
+}
+
+static void _fib_task(void* arg)
+{
+    fib_args* args = (fib_args*)arg;
+    args->result = _fib(args->n);
+}
+
+static void _square(size_t begin, size_t end, void* arg)
+{
+    uint64_t* values = (uint64_t*)arg;
+
+    for (size_t i = begin; i < end; i++)
+        values[i] = (uint64_t)i * i;
+}
+
+OE_ECALL void TestParallelFor(void* args_)
+{
+    TestParallelForArgs* args = (TestParallelForArgs*)args_;
+    uint64_t* values;
+
+    // Without workers, tasks run on the calling thread
+    if (args->num_workers)
+        OE_TEST(oe_task_runtime_start(args->num_workers) == OE_OK);
+
+    OE_TEST(values = (uint64_t*)calloc(args->size, sizeof(uint64_t)));
+
+    OE_TEST(oe_parallel_for(0, args->size, 0, _square, values) == OE_OK);
+
+    for (size_t i = 0; i < args->size; i++)
+        OE_TEST(values[i] == (uint64_t)i * i);
+
+    auto add = [values](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++)
+            values[i] += i;
+    };
+
+    OE_TEST(oe_parallel_for(0, args->size, 64, add) == OE_OK);
+
+    for (size_t i = 0; i < args->size; i++)
+        OE_TEST(values[i] == (uint64_t)i * i + i);
+
+    free(values);
+
+    // fib(25) spawns thousands of nested tasks
+    OE_TEST(_fib(25) == 75025);
+}
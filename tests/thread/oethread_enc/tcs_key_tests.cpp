@@ -0,0 +1,56 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#include <openenclave/enclave.h>
+#include <openenclave/internal/tests.h>
+#include <openenclave/internal/thread.h>
+#include <stdlib.h>
+#include "../args.h"
+
+struct tcs_value
+{
+    size_t count;
+};
+
+static oe_once_t _tcs_key_once = OE_ONCE_INIT;
+static oe_thread_key_t _tcs_key;
+static size_t* _destructed;
+
+// Each TCS has its own copy, whose address identifies the TCS
+static __thread char _tcs_tag;
+
+// Called for each TCS when the enclave is terminated
+static void _destruct_tcs_value(void* value)
+{
+    if (_destructed)
+        ++*_destructed;
+
+    free(value);
+}
+
+static void _create_tcs_key(void)
+{
+    OE_TEST(
+        oe_thread_key_create_ex(
+            &_tcs_key, _destruct_tcs_value, OE_THREAD_KEY_TCS_LIFETIME) ==
+        OE_OK);
+}
+
+OE_ECALL void TestTCSKeys(void* args_)
+{
+    TestTCSKeysArgs* args = (TestTCSKeysArgs*)args_;
+    tcs_value* value;
+
+    OE_TEST(oe_once(&_tcs_key_once, _create_tcs_key) == OE_OK);
+    _destructed = args->destructed;
+
+    // The value set by an earlier ECALL on this TCS is still there
+    if (!(value = (tcs_value*)oe_thread_getspecific(_tcs_key)))
+    {
+        OE_TEST((value = (tcs_value*)calloc(1, sizeof(*value))) != NULL);
+        OE_TEST(oe_thread_setspecific(_tcs_key, value) == OE_OK);
+    }
+
+    args->tcs = (uint64_t)&_tcs_tag;
+    args->count = ++value->count;
+}
@@ -0,0 +1,6 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+// TCS-lifetime keys have no pthread counterpart, so the test uses the
+// oe_thread API directly.
+#include "../oethread_enc/tcs_key_tests.cpp"
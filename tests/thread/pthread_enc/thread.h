@@ -23,6 +23,11 @@ static __inline pthread_mutex_t __mutex_initializer_recursive()
 
 typedef pthread_t oe_thread_t;
 #define oe_thread_self pthread_self
+#define oe_thread_equal pthread_equal
+#define oe_thread_create(thread, start_routine, arg) \
+    pthread_create(thread, NULL, start_routine, arg)
+#define oe_thread_join pthread_join
+#define oe_thread_detach pthread_detach
 
 typedef pthread_mutex_t oe_mutex_t;
 #define OE_MUTEX_INITIALIZER __mutex_initializer_recursive()
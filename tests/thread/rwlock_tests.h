@@ -17,4 +17,32 @@ const size_t NUM_RW_TEST_THREADS = 8;
 // Number of reader threads.
 const size_t NUM_READER_THREADS = NUM_RW_TEST_THREADS / 2;
 
+// Number of locks taken by each thread of the scaling benchmark (see
+// tests/thread/benchmark).
+const size_t RWLOCK_SCALING_ITERS = 200000;
+
+// One in this many locks of the scaling benchmark is a write lock.
+const size_t RWLOCK_SCALING_WRITE_INTERVAL = 1000;
+
+// The scaling benchmark runs with 1, 2, 4, ... up to this many threads
+// (the TCSCount of the test enclaves).
+const size_t RWLOCK_SCALING_MAX_THREADS = 16;
+
+// Number of write locks taken by the writer of the starvation test, while
+// the other threads keep taking read locks.
+const size_t RWLOCK_STARVATION_WRITES = 1000;
+
+// A reader of the starvation test gives up after this many read locks
+// without a write in between, and reports the writer as starved.
+const size_t RWLOCK_STARVATION_MAX_READS = 10000000;
+
+// Number of locks taken by each thread of the stress test.
+const size_t RWLOCK_STRESS_ITERS = 20000;
+
+// Number of reads or writes by each thread of the seqlock test.
+const size_t SEQLOCK_TEST_ITERS = 100000;
+
+// Number of writer threads of the seqlock test (all others read).
+const size_t NUM_SEQLOCK_WRITER_THREADS = 2;
+
 #endif /* _rwlock_tests_h */
@@ -0,0 +1,76 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#include <openenclave/host.h>
+#include <openenclave/internal/registers.h>
+#include <openenclave/internal/tests.h>
+#include <chrono>
+#include <cstdio>
+#include "transitions_u.h"
+
+#define NUM_ECALLS 100000
+
+// Measure the ECALL round trips per second with the FS and GS register bases
+// switched by system calls or by the FSGSBASE instructions, which matters in
+// simulation mode.
+static void TestTransitions(oe_enclave_t* enclave, bool fsgsbase)
+{
+    const char* name = fsgsbase ? "FSGSBASE" : "system calls";
+
+    if (oe_enable_fsgsbase(fsgsbase) != fsgsbase)
+    {
+        printf("TestTransitions: %s: unsupported\n", name);
+        return;
+    }
+
+    void* gsbase = oe_get_gs_register_base();
+    void* fsbase = oe_get_fs_register_base();
+    uint64_t value = 0;
+
+    auto start = std::chrono::steady_clock::now();
+
+    for (uint64_t i = 0; i < NUM_ECALLS; i++)
+        OE_TEST(enc_increment(enclave, &value, value) == OE_OK);
+
+    auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - start);
+
+    OE_TEST(value == NUM_ECALLS);
+
+    // The host register bases are restored after each ECALL
+    OE_TEST(oe_get_gs_register_base() == gsbase);
+    OE_TEST(oe_get_fs_register_base() == fsbase);
+
+    printf(
+        "TestTransitions: %s: %.2f ECALLs/us\n",
+        name,
+        (double)NUM_ECALLS /
+            (double)(elapsed.count() ? elapsed.count() : 1));
+}
+
+int main(int argc, const char* argv[])
+{
+    oe_result_t result;
+    oe_enclave_t* enclave = NULL;
+
+    if (argc != 2)
+    {
+        fprintf(stderr, "Usage: %s ENCLAVE_PATH\n", argv[0]);
+        return 1;
+    }
+
+    const uint32_t flags = oe_get_create_flags();
+
+    result = oe_create_enclave(
+        argv[1], OE_ENCLAVE_TYPE_SGX, flags, NULL, 0, &enclave);
+    OE_TEST(result == OE_OK);
+
+    TestTransitions(enclave, false);
+    TestTransitions(enclave, true);
+
+    OE_TEST(oe_terminate_enclave(enclave) == OE_OK);
+
+    printf("=== passed all tests (transitions)\n");
+
+    return 0;
+}
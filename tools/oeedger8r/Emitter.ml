@@ -319,40 +319,73 @@ let get_cast_from_mem_expr (ptype, decl)=
 
 (* oe: Generate arg check macro*)
 let oe_gen_arg_check_macro(os : out_channel) =  
-  fprintf os "#define OE_CHECKED_COPY_INPUT(enc_ptr, host_ptr, size) \\\n";
-  fprintf os " do {                                                  \\\n";
-  fprintf os "     if (host_ptr &&                                   \\\n";
-  fprintf os "             !oe_is_outside_enclave(host_ptr, size)) { \\\n";
-  fprintf os "         __result = OE_INVALID_PARAMETER;              \\\n";
-  fprintf os "         goto done;                                    \\\n";
-  fprintf os "     }                                                 \\\n";
-  fprintf os "     enc_ptr = NULL;                                   \\\n"; 
-  fprintf os "     if (host_ptr) {                                   \\\n";
-  fprintf os "         *(void**)&enc_ptr = malloc(size);             \\\n";
-  fprintf os "         if (!enc_ptr) {                               \\\n";
-  fprintf os "             __result = OE_OUT_OF_MEMORY;              \\\n";
-  fprintf os "             goto done;                                \\\n";
-  fprintf os "         }                                             \\\n";
-  fprintf os "         memcpy(enc_ptr, host_ptr, size);              \\\n";
-  fprintf os "     }                                                 \\\n";  
-  fprintf os " } while(0)\n\n";
-  fprintf os "#define OE_CHECKED_ALLOCATE_OUTPUT(enc_ptr, host_ptr, size) \\\n";
+  fprintf os "/* Buffers up to this size are copied to the stack of the ecall. */\n";
+  fprintf os "#ifndef OE_ECALL_SCRATCH_SIZE\n";
+  fprintf os "#define OE_ECALL_SCRATCH_SIZE 256\n";
+  fprintf os "#endif\n\n";
+  fprintf os "#define OE_BUFFER_ALIGN(size) (((size_t)(size) + 15) & ~(size_t)15)\n\n";
+  fprintf os "#define OE_CHECK_INPUT_SIZE(host_ptr, size)                 \\\n";
   fprintf os " do {                                                       \\\n";
   fprintf os "     if (host_ptr &&                                        \\\n";
-  fprintf os "             !oe_is_outside_enclave(host_ptr, size)) {      \\\n";
+  fprintf os "             (!oe_is_outside_enclave(host_ptr, size) ||     \\\n";
+  fprintf os "              (size_t)(size) > SIZE_MAX - 15 -              \\\n";
+  fprintf os "                  __enc_buffer_size)) {                     \\\n";
   fprintf os "         __result = OE_INVALID_PARAMETER;                   \\\n";
   fprintf os "         goto done;                                         \\\n";
   fprintf os "     }                                                      \\\n";
-  fprintf os "     enc_ptr = NULL;                                        \\\n";
-  fprintf os "     if (host_ptr) {                                        \\\n";
-  fprintf os "         *(void**)&enc_ptr = malloc(size);                  \\\n";
-  fprintf os "         if (!enc_ptr) {                                    \\\n";
+  fprintf os "     if (host_ptr)                                          \\\n";
+  fprintf os "         __enc_buffer_size += OE_BUFFER_ALIGN(size);        \\\n";
+  fprintf os " } while(0)\n\n";
+  fprintf os "#define OE_ALLOCATE_BUFFERS()                               \\\n";
+  fprintf os " do {                                                       \\\n";
+  fprintf os "     if (__enc_buffer_size > sizeof(__enc_scratch)) {       \\\n";
+  fprintf os "         __enc_buffer = (uint8_t*) malloc(__enc_buffer_size); \\\n";
+  fprintf os "         if (!__enc_buffer) {                               \\\n";
   fprintf os "             __result = OE_OUT_OF_MEMORY;                   \\\n";
   fprintf os "             goto done;                                     \\\n";
   fprintf os "         }                                                  \\\n";
   fprintf os "     }                                                      \\\n";
+  fprintf os "     __enc_ptr = __enc_buffer;                              \\\n";
+  fprintf os " } while(0)\n\n";
+  fprintf os "#define OE_FREE_BUFFERS()                                   \\\n";
+  fprintf os " do {                                                       \\\n";
+  fprintf os "     if (__enc_buffer != __enc_scratch)                     \\\n";
+  fprintf os "         free(__enc_buffer);                                \\\n";
+  fprintf os " } while(0)\n\n";
+  fprintf os "#define OE_COPY_INPUT(enc_ptr, host_ptr, size)              \\\n";
+  fprintf os " do {                                                       \\\n";
+  fprintf os "     enc_ptr = NULL;                                        \\\n";
+  fprintf os "     if (host_ptr) {                                        \\\n";
+  fprintf os "         *(void**)&enc_ptr = __enc_ptr;                     \\\n";
+  fprintf os "         __enc_ptr += OE_BUFFER_ALIGN(size);                \\\n";
+  fprintf os "         memcpy(enc_ptr, host_ptr, size);                   \\\n";
+  fprintf os "     }                                                      \\\n";
+  fprintf os " } while(0)\n\n";
+  fprintf os "#define OE_ALLOCATE_OUTPUT(enc_ptr, host_ptr, size)         \\\n";
+  fprintf os " do {                                                       \\\n";
+  fprintf os "     enc_ptr = NULL;                                        \\\n";
+  fprintf os "     if (host_ptr) {                                        \\\n";
+  fprintf os "         *(void**)&enc_ptr = __enc_ptr;                     \\\n";
+  fprintf os "         __enc_ptr += OE_BUFFER_ALIGN(size);                \\\n";
+  fprintf os "     }                                                      \\\n";
+  fprintf os " } while(0)\n\n";
+  fprintf os "#define OE_CHECK_SHARED_BUFFER(host_ptr, size)              \\\n";
+  fprintf os " do {                                                       \\\n";
+  fprintf os "     if (host_ptr &&                                        \\\n";
+  fprintf os "             !oe_is_within_shared_buffer(host_ptr, size)) { \\\n";
+  fprintf os "         __result = OE_INVALID_PARAMETER;                   \\\n";
+  fprintf os "         goto done;                                         \\\n";
+  fprintf os "     }                                                      \\\n";
   fprintf os " } while(0)\n\n"
   
+(* Whether the ecall copies any buffer into the enclave *)
+let has_checked_buffers (fd: Ast.func_decl) =
+  List.exists (fun (ptype, _) ->
+    match ptype with
+      | Ast.PTPtr (_, ptr_attr) -> ptr_attr.Ast.pa_chkptr
+      | _ -> false
+  ) fd.Ast.plist
+
 let oe_copy_members_to_enclave (os:out_channel) (fd: Ast.func_decl) =  
   let is_primitive ptype =
     match ptype with
@@ -369,7 +402,26 @@ let oe_copy_members_to_enclave (os:out_channel) (fd: Ast.func_decl) =
   List.iter gen_copy_member fd.Ast.plist;
   fprintf os "\n"
 
+(*
+  Check the buffers and sum the sizes of their enclave copies, then copy
+  them into one allocation: the stack of the ecall for small buffers, else
+  a single malloc. Output buffers are not initialized.
+*)
 let oe_gen_allocate_buffers (os:out_channel) (fd: Ast.func_decl) =    
+  let gen_check_buffer (ptype, decl) =
+    match ptype with
+      | Ast.PTPtr (atype, ptr_attr) ->
+          if ptr_attr.Ast.pa_chkptr then
+            fprintf os "    OE_CHECK_INPUT_SIZE(args.%s, %s); \n"
+                decl.Ast.identifier
+                (oe_get_param_size (ptype, decl, "args."))
+          else if ptr_attr.Ast.pa_isshared then
+            fprintf os "    OE_CHECK_SHARED_BUFFER(args.%s, %s); \n"
+                decl.Ast.identifier
+                (oe_get_param_size (ptype, decl, "args."))
+          else ()
+      | _ -> () (* Non pointer arguments *)    
+  in 
   let gen_allocate_buffer (ptype, decl) =
     match ptype with
       | Ast.PTPtr (atype, ptr_attr) ->
@@ -377,8 +429,8 @@ let oe_gen_allocate_buffers (os:out_channel) (fd: Ast.func_decl) =
             let size = oe_get_param_size (ptype, decl, "args.") in
             let macro = 
               match ptr_attr.Ast.pa_direction with
-                | Ast.PtrOut -> "OE_CHECKED_ALLOCATE_OUTPUT"                
-                | _ -> "OE_CHECKED_COPY_INPUT"
+                | Ast.PtrOut -> "OE_ALLOCATE_OUTPUT"                
+                | _ -> "OE_COPY_INPUT"
             in 
             fprintf os "    %s(enc_args.%s, args.%s, %s); \n" 
                 macro decl.Ast.identifier 
@@ -387,23 +439,18 @@ let oe_gen_allocate_buffers (os:out_channel) (fd: Ast.func_decl) =
           else ()
       | _ -> () (* Non pointer arguments *)    
   in 
-  fprintf os "    /* Copy checked buffers properties to enclave memory */\n";
-  List.iter gen_allocate_buffer fd.Ast.plist;
+  fprintf os "    /* Check buffers and compute the size of their enclave copies */\n";
+  List.iter gen_check_buffer fd.Ast.plist;
+  if has_checked_buffers fd then (
+    fprintf os "\n    /* Copy checked buffers to enclave memory */\n";
+    fprintf os "    OE_ALLOCATE_BUFFERS();\n";
+    List.iter gen_allocate_buffer fd.Ast.plist);
   fprintf os "\n"
   
 let oe_gen_free_buffers (os:out_channel) (fd: Ast.func_decl) =  
-  let gen_free_buffer (ptype, decl) =
-    match ptype with
-      | Ast.PTPtr (atype, ptr_attr) ->
-          if ptr_attr.Ast.pa_chkptr then
-            (fprintf os "    if (enc_args.%s)\n" decl.Ast.identifier;
-             fprintf os "        free (enc_args.%s); \n" decl.Ast.identifier)            
-          else ()
-      | _ -> () (* Non pointer arguments *)    
-  in 
-  fprintf os "    /* Free enclave buffers */\n";
-  List.iter gen_free_buffer fd.Ast.plist;
-  fprintf os "\n"
+  if has_checked_buffers fd then (
+    fprintf os "    /* Free enclave buffers */\n";
+    fprintf os "    OE_FREE_BUFFERS();\n\n")
 
 let oe_gen_copy_outputs (os:out_channel) (fd: Ast.func_decl) =  
   let gen_free_buffer (ptype, decl) =
@@ -445,9 +492,13 @@ let oe_gen_ecall_function (os:out_channel) (fd: Ast.func_decl) =
   fprintf os "OE_ECALL void ecall_%s(%s_args_t* p_host_args)\n" fd.Ast.fname fd.Ast.fname;
   fprintf os "{\n";
   fprintf os "    oe_result_t __result = OE_FAILURE;\n";
-  fprintf os "    %s_args_t args, enc_args;\n\n" fd.Ast.fname;
-  fprintf os "    memset(&args, 0, sizeof(args));\n";
-  fprintf os "    memset(&enc_args, 0, sizeof(enc_args));\n\n";
+  fprintf os "    %s_args_t args, enc_args;\n" fd.Ast.fname;
+  if has_checked_buffers fd then (
+    fprintf os "    OE_ALIGNED(16) uint8_t __enc_scratch[OE_ECALL_SCRATCH_SIZE];\n";
+    fprintf os "    uint8_t* __enc_buffer = __enc_scratch;\n";
+    fprintf os "    uint8_t* __enc_ptr = NULL;\n";
+    fprintf os "    size_t __enc_buffer_size = 0;\n");
+  fprintf os "\n";
   fprintf os "    if (!p_host_args || !oe_is_outside_enclave(p_host_args, sizeof(*p_host_args)))\n";
   fprintf os "        goto done;\n\n";
   fprintf os "    /* Copy p_host_arg to prevent TOCTOU issues. */\n";
@@ -487,7 +538,7 @@ let gen_fill_marshal_struct (os:out_channel) (fd:Ast.func_decl)  (args:string) =
   ) fd.Ast.plist;
   fprintf os "\n"
 
-let oe_get_host_ecall_function (os:out_channel) (fd:Ast.func_decl) =
+let oe_get_host_ecall_function (os:out_channel) (idx:int) (fd:Ast.func_decl) =
   fprintf os "%s" (oe_gen_wrapper_prototype fd true);
   fprintf os "\n";
   fprintf os "{\n";
@@ -497,7 +548,7 @@ let oe_get_host_ecall_function (os:out_channel) (fd:Ast.func_decl) =
   fprintf os "    memset(&__args, 0, sizeof(__args));\n";
   gen_fill_marshal_struct os fd "__args";
   fprintf os "    /* Call enclave function */\n";
-  fprintf os "    if(oe_call_enclave(enclave, \"ecall_%s\", &__args) != OE_OK || (__result=__args._result) != OE_OK)\n" fd.Ast.fname;
+  fprintf os "    if(oe_call_enclave_function(enclave, &__oe_call_table, %d /* ecall_%s */, &__args) != OE_OK || (__result=__args._result) != OE_OK)\n" idx fd.Ast.fname;
   fprintf os "        goto done;\n\n";
   fprintf os "    /* successful ecall. */\n";
   if fd.Ast.rtype <> Ast.Void then 
@@ -508,6 +559,50 @@ let oe_get_host_ecall_function (os:out_channel) (fd:Ast.func_decl) =
   fprintf os "}\n\n"
 
 
+(* Generate the names of the given functions, which oeedger8r numbers in the
+   order in which they are declared. *)
+let oe_gen_function_names (os:out_channel) (var:string) (prefix:string) (fds:Ast.func_decl list) =
+  fprintf os "static const char* const %s[] = {\n" var;
+  List.iter (fun fd -> fprintf os "    \"%s_%s\",\n" prefix fd.Ast.fname) fds;
+  fprintf os "};\n\n"
+
+(* Generate the table of ocalls used by the ocall wrappers in the enclave.
+   The host ids of the ocalls are fetched on first use. *)
+let oe_gen_ocall_table (os:out_channel) (ec: enclave_content) =
+  let fds = List.map (fun d -> d.Ast.uf_fdecl) ec.ufunc_decls in
+  fprintf os "/* ocall table */\n\n";
+  oe_gen_function_names os "__oe_ocall_names" "ocall" fds;
+  fprintf os "static uint32_t __oe_ocall_host_ids[%d];\n\n" (List.length fds);
+  fprintf os "static oe_ocall_table_t __oe_ocall_table = {\n";
+  fprintf os "    __oe_ocall_names,\n";
+  fprintf os "    __oe_ocall_host_ids,\n";
+  fprintf os "    %d\n" (List.length fds);
+  fprintf os "};\n\n"
+
+(* Generate the table of ecalls and ocalls used by the ecall wrappers in the
+   host. The ocall functions must be defined before it. *)
+let oe_gen_call_table (os:out_channel) (ec: enclave_content) =
+  let tfds = List.map (fun d -> d.Ast.tf_fdecl) ec.tfunc_decls in
+  let ufds = List.map (fun d -> d.Ast.uf_fdecl) ec.ufunc_decls in
+  fprintf os "/* ecall and ocall table */\n\n";
+  oe_gen_function_names os "__oe_ecall_names" "ecall" tfds;
+  if ufds <> [] then (
+    oe_gen_function_names os "__oe_ocall_names" "ocall" ufds;
+    fprintf os "static const oe_ocall_func_t __oe_ocall_funcs[] = {\n";
+    List.iter (fun fd -> fprintf os "    (oe_ocall_func_t)ocall_%s,\n" fd.Ast.fname) ufds;
+    fprintf os "};\n\n");
+  fprintf os "static const oe_call_table_t __oe_call_table = {\n";
+  fprintf os "    __oe_ecall_names,\n";
+  fprintf os "    %d,\n" (List.length tfds);
+  if ufds <> [] then (
+    fprintf os "    __oe_ocall_names,\n";
+    fprintf os "    __oe_ocall_funcs,\n")
+  else (
+    fprintf os "    NULL,\n";
+    fprintf os "    NULL,\n");
+  fprintf os "    %d\n" (List.length ufds);
+  fprintf os "};\n\n"
+
 (* Generate macros for ocall *)
 let oe_gen_ocall_macros (os:out_channel) =
   fprintf os "#define OE_COPY_TO_HOST(host_ptr, enc_ptr, size) \\\n";
@@ -537,7 +632,7 @@ let iter_ptr_params f params =
   ) params
 
 (* Generate ocalls wrapper function *)
-let oe_gen_ocall_enclave_wrapper (os:out_channel) (fd:Ast.func_decl) =
+let oe_gen_ocall_enclave_wrapper (os:out_channel) (idx:int) (fd:Ast.func_decl) =
   fprintf os "%s\n{\n" (oe_gen_wrapper_prototype fd false);
   fprintf os "    oe_result_t __result = OE_FAILURE;\n\n";
   fprintf os "    /* Marshal arguments */ \n";
@@ -578,7 +673,7 @@ let oe_gen_ocall_enclave_wrapper (os:out_channel) (fd:Ast.func_decl) =
 
  (* Generate call to host *)
   fprintf os "\n    /* Call host function */\n";
-  fprintf os "    if(oe_call_host(\"ocall_%s\", __p_host_args) != OE_OK)\n" fd.Ast.fname;
+  fprintf os "    if(oe_call_host_function(&__oe_ocall_table, %d /* ocall_%s */, __p_host_args) != OE_OK)\n" idx fd.Ast.fname;
   fprintf os "        goto done;\n\n";
   fprintf os "    /* Copy args struct back to enclave memory to prevent TOCTOU issues. */ \n";
   fprintf os "    __host_args = *(%s_args_t*) __p_host_args; \n" fd.Ast.fname;
@@ -691,8 +786,9 @@ let gen_t_c (ec: enclave_content) (ep: edger8r_params) =
     oe_gen_ecall_functions os ec);
   if ec.ufunc_decls <> [] then (
     oe_gen_ocall_macros os;
+    oe_gen_ocall_table os ec;
     fprintf os "\n/* ocall wrappers */\n\n";
-    List.iter (fun d -> oe_gen_ocall_enclave_wrapper os d.Ast.uf_fdecl)  ec.ufunc_decls);
+    List.iteri (fun idx d -> oe_gen_ocall_enclave_wrapper os idx d.Ast.uf_fdecl)  ec.ufunc_decls);
   fprintf os "OE_EXTERNC_END\n";
   close_out os 
 
@@ -727,12 +823,13 @@ let gen_u_c (ec: enclave_content) (ep: edger8r_params) =
   fprintf os "#include <wchar.h>\n";  
   fprintf os "\n";
   fprintf os "OE_EXTERNC_BEGIN\n\n";
-  if ec.tfunc_decls <> [] then (
-    fprintf os "/* Wrappers for ecalls */\n\n";
-    List.iter (fun d -> oe_get_host_ecall_function os d.Ast.tf_fdecl; fprintf os "\n\n")  ec.tfunc_decls);
   if ec.ufunc_decls <> [] then (
     fprintf os "\n/* ocall functions */\n\n";
     List.iter (fun d -> oe_gen_ocall_host_wrapper os d.Ast.uf_fdecl)  ec.ufunc_decls);
+  if ec.tfunc_decls <> [] then (
+    oe_gen_call_table os ec;
+    fprintf os "/* Wrappers for ecalls */\n\n";
+    List.iteri (fun idx d -> oe_get_host_ecall_function os idx d.Ast.tf_fdecl; fprintf os "\n\n")  ec.tfunc_decls);
   fprintf os "OE_EXTERNC_END\n";
   close_out os   
 
@@ -159,6 +159,7 @@ typedef struct _config_file_options
     uint64_t num_heap_pages;
     uint64_t num_stack_pages;
     uint64_t num_tcs;
+    uint64_t num_host_stack_pages;
     uint16_t product_id;
     uint16_t security_version;
 } ConfigFileOptions;
@@ -167,6 +168,7 @@ typedef struct _config_file_options
     {                                                                   \
         .debug = false, .num_heap_pages = OE_UINT64_MAX,                \
         .num_stack_pages = OE_UINT64_MAX, .num_tcs = OE_UINT64_MAX,     \
+        .num_host_stack_pages = OE_UINT64_MAX,                          \
         .product_id = OE_UINT16_MAX, .security_version = OE_UINT16_MAX, \
     }
 
@@ -298,6 +300,19 @@ static int _load_config_file(const char* path, ConfigFileOptions* options)
 
             options->num_tcs = n;
         }
+        else if (strcmp(str_ptr(&lhs), "NumHostStackPages") == 0)
+        {
+            uint64_t n;
+
+            if (str_u64(&rhs, &n) != 0 ||
+                !oe_sgx_is_valid_num_host_stack_pages(n))
+            {
+                Err("%s(%zu): bad value for 'NumHostStackPages'", path, line);
+                goto done;
+            }
+
+            options->num_host_stack_pages = n;
+        }
         else if (strcmp(str_ptr(&lhs), "ProductID") == 0)
         {
             uint16_t n;
@@ -482,6 +497,11 @@ void _merge_config_file_options(
     /* If NumTCS option is present */
     if (options->num_tcs != OE_UINT64_MAX)
         properties->header.size_settings.num_tcs = options->num_tcs;
+
+    /* If NumHostStackPages option is present */
+    if (options->num_host_stack_pages != OE_UINT64_MAX)
+        properties->config.num_host_stack_pages =
+            (uint32_t)options->num_host_stack_pages;
 }
 
 static const char _usage[] =
@@ -510,6 +530,9 @@ static const char _usage[] =
     "        NumStackPages - the number of stack pages for this enclave\n"
     "        NumTCS - the number of thread control structures for this "
     "enclave\n"
+    "        NumHostStackPages - the number of host pages per thread for "
+    "marshalling\n"
+    "            OCALL arguments (optional)\n"
     "\n"
     "    The configuration file contains simple NAME=VALUE entries. For "
     "example:\n"